@@ -12,23 +12,29 @@
 #include "pico/stdlib.h"
 #include "hardware/pio.h"
 #include "hardware/irq.h"
+#include "hardware/sync.h"
 
 #include "crp42602y_measure_pulse.pio.h"
 #include "crp42602y_ctrl.h"
 
-#define CRP42602Y_PIO __CONCAT(pio, PICO_CRP42602Y_CTRL_PIO)
-#define PIO_IRQ_x __CONCAT(__CONCAT(PIO, PICO_CRP42602Y_CTRL_PIO), _IRQ_0)  // e.g. PIO0_IRQ_0
+crp42602y_counter* crp42602y_counter::_inst_map[NUM_PIOS][NUM_PIO_STATE_MACHINES] = {};
+uint32_t crp42602y_counter::_sm_mask[NUM_PIOS] = {};
+uint crp42602y_counter::_program_offset[NUM_PIOS] = {};
 
-crp42602y_counter* crp42602y_counter::_inst_map[4] = {nullptr, nullptr, nullptr, nullptr};
-
-// irq handler for PIO
+// irq handler for PIO (shared by the IRQ lines of all PIO blocks)
 void __isr __time_critical_func(crp42602y_counter_pio_irq_handler)()
 {
-    // PIOx_IRQ_0 throws 0 ~ 3 flags corresponding to state machine 0 ~ 3 thanks to 'irq 0 rel' instruction
-    for (uint sm = 0; sm < 4; sm++) {
-        if (pio_interrupt_get(CRP42602Y_PIO, sm)) {
-            pio_interrupt_clear(CRP42602Y_PIO, sm);  // state machine stalls until clear only when timeout
-            crp42602y_counter* inst = crp42602y_counter::_inst_map[sm];
+    for (uint pio_index = 0; pio_index < NUM_PIOS; pio_index++) {
+        uint32_t sm_mask = crp42602y_counter::_sm_mask[pio_index];
+        if (sm_mask == 0) continue;
+        PIO pio = pio_get_instance(pio_index);
+        // PIOx_IRQ_y throws 0 ~ 3 flags corresponding to state machine 0 ~ 3 thanks to 'irq 0 rel' instruction
+        uint32_t flags = pio->irq & sm_mask;  // read flags only once
+        while (flags) {
+            uint sm = __builtin_ctz(flags);
+            flags &= flags - 1;
+            pio_interrupt_clear(pio, sm);  // state machine stalls until clear only when timeout
+            crp42602y_counter* inst = crp42602y_counter::_inst_map[pio_index][sm];
             if (inst != nullptr) {
                 inst->_irq_callback();  // invoke callback of corresponding instance
             }
@@ -36,8 +42,20 @@ void __isr __time_critical_func(crp42602y_counter_pio_irq_handler)()
     }
 }
 
-crp42602y_counter::crp42602y_counter(const uint pin_rotation_sens, crp42602y_ctrl* const ctrl) :
-    _ctrl(ctrl), _sm(0),
+const crp42602y_counter::counter_config_t crp42602y_counter::DEFAULT_CONFIG = {
+    ROTATION_GEAR_RATIO,  // rotation_gear_ratio
+    ADDITIONAL_US,        // additional_us
+    MAX_NUM_TO_AVERAGE,   // num_to_average
+    40,                   // ref_count
+    100,                  // thickness_count
+    10,                   // thickness_interval
+    200,                  // update_count
+    100,                  // update_interval
+    {7.5, 10.5, 15.0}     // thickness_threshold_um
+};
+
+crp42602y_counter::crp42602y_counter(crp42602y_ctrl* const ctrl, const counter_config_t& config) :
+    _ctrl(ctrl), _config(config), _pio(nullptr), _sm(0),
     _enable(false),
     _status(NONE_BITS), _rot_count(0), _count(0),
     _total_playing_sec{NAN, NAN},
@@ -46,63 +64,170 @@ crp42602y_counter::crp42602y_counter(const uint pin_rotation_sens, crp42602y_ctr
     _estimated_hub_radius_cm{0.0, 0.0},
     _hub_radius_cm_history{},
     _ref_hub_radius_cm(0.0),
-    _tape_thickness_um(DEFAULT_ESTIMATED_TAPE_THICKNESS_UM)
+    _tape_thickness_um(DEFAULT_ESTIMATED_TAPE_THICKNESS_UM),
+    _snapshot_seq(0),
+    _snapshot{},
+    _trace_callback(nullptr),
+    _trace_transport_state(0),
+    _log_callback(nullptr)
 {
     queue_init(&_rotation_event_queue, sizeof(rotation_event_t), ROTATION_EVENT_QUEUE_LENGTH);
+    queue_init(&_command_queue, sizeof(counter_command_t), COMMAND_QUEUE_LENGTH);
+    _publish_snapshot();
+}
 
-    // PIO
-    while (pio_sm_is_claimed(CRP42602Y_PIO, _sm)) {
-        if (++_sm >= 4) panic("All PIO state machines are reserved");
-    }
-    pio_sm_claim(CRP42602Y_PIO, _sm);
-    _inst_map[_sm] = this;  // link this instance to corresponding state machine here to pass global interrupt to the instance
+crp42602y_counter::crp42602y_counter(const uint pin_rotation_sens, crp42602y_ctrl* const ctrl) :
+    crp42602y_counter(ctrl, DEFAULT_CONFIG)
+{
+    // PIO (the program is loaded only once per PIO block)
+    _alloc_pio_sm();
+    uint pio_index = pio_get_index(_pio);
+    _inst_map[pio_index][_sm] = this;  // link this instance to corresponding state machine here to pass global interrupt to the instance
 
     // PIO_IRQ
-    if (!irq_has_shared_handler(PIO_IRQ_x)) {
-        irq_add_shared_handler(PIO_IRQ_x, crp42602y_counter_pio_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
-    }
+    pio_set_irqn_source_enabled(_pio, PICO_CRP42602Y_CTRL_PIO_IRQ, (enum pio_interrupt_source) ((uint) pis_interrupt0 + _sm), true);  // for IRQ relative
+    pio_interrupt_clear(_pio, _sm);
 
-    pio_set_irq0_source_enabled(CRP42602Y_PIO, (enum pio_interrupt_source) ((uint) pis_interrupt0 + _sm), true);   // for IRQ relative
-    pio_set_irq1_source_enabled(CRP42602Y_PIO, (enum pio_interrupt_source) ((uint) pis_interrupt0 + _sm), false);  // not use
-    pio_interrupt_clear(CRP42602Y_PIO, _sm);
-    irq_set_enabled(PIO_IRQ_x, true);
-
-    // PIO
-    uint offset = pio_add_program(CRP42602Y_PIO, &crp42602y_measure_pulse_program);
     crp42602y_measure_pulse_program_init(
-        CRP42602Y_PIO,
+        _pio,
         _sm,
-        offset,
+        _program_offset[pio_index],
         crp42602y_measure_pulse_offset_entry_point,
         crp42602y_measure_pulse_program_get_default_config,
         pin_rotation_sens
     );
-    pio_sm_put_blocking(CRP42602Y_PIO, _sm, (uint32_t) -TIMEOUT_COUNT);
+    pio_sm_put_blocking(_pio, _sm, (uint32_t) -TIMEOUT_COUNT);
 }
 
 crp42602y_counter::~crp42602y_counter()
 {
     queue_free(&_rotation_event_queue);
-    _inst_map[_sm] = nullptr;
-    pio_sm_unclaim(CRP42602Y_PIO, _sm);
-
-    // Remove handler if there are no instances
-    bool exist_inst = false;
-    for (int i = 0; i < 4; i++) {
-        if (_inst_map[_sm] != nullptr) {
-            exist_inst = true;
-            break;
+    queue_free(&_command_queue);
+    if (_pio == nullptr) return;  // without rotation sensor
+    pio_sm_set_enabled(_pio, _sm, false);
+    pio_set_irqn_source_enabled(_pio, PICO_CRP42602Y_CTRL_PIO_IRQ, (enum pio_interrupt_source) ((uint) pis_interrupt0 + _sm), false);
+    _free_pio_sm();
+}
+
+bool crp42602y_counter::restart()
+{
+    counter_command_t command = {CMD_RESTART, 0};
+    return queue_try_add(&_command_queue, &command);
+}
+
+float crp42602y_counter::get() const
+{
+    counter_snapshot_t snapshot;
+    get_snapshot(snapshot);
+    bool is_dir_a = _ctrl->get_head_dir_is_a();
+    return snapshot.playing_sec[!is_dir_a];
+}
+
+bool crp42602y_counter::reset()
+{
+    bool is_dir_a = _ctrl->get_head_dir_is_a();
+    counter_command_t command = {CMD_RESET_SIDE, !is_dir_a};
+    return queue_try_add(&_command_queue, &command);
+}
+
+bool crp42602y_counter::reset_other_side()
+{
+    bool is_dir_a = _ctrl->get_head_dir_is_a();
+    counter_command_t command = {CMD_RESET_SIDE, is_dir_a};
+    return queue_try_add(&_command_queue, &command);
+}
+
+uint32_t crp42602y_counter::get_state() const
+{
+    counter_snapshot_t snapshot;
+    get_snapshot(snapshot);
+    return snapshot.state;
+}
+
+void crp42602y_counter::get_snapshot(counter_snapshot_t& snapshot) const
+{
+    // seqlock reader: retry if the writer has been updating _snapshot meanwhile
+    uint32_t seq;
+    do {
+        seq = _snapshot_seq;
+        __mem_fence_acquire();
+        snapshot = _snapshot;
+        __mem_fence_acquire();
+    } while ((seq & 1) || seq != _snapshot_seq);
+}
+
+void crp42602y_counter::set_config(const counter_config_t& config)
+{
+    _config = config;
+    if (_config.num_to_average < 1) _config.num_to_average = 1;
+    if (_config.num_to_average > MAX_NUM_TO_AVERAGE) _config.num_to_average = MAX_NUM_TO_AVERAGE;
+    if (_config.thickness_interval < 1) _config.thickness_interval = 1;
+    if (_config.update_interval < 1) _config.update_interval = 1;
+    _restart();
+}
+
+const crp42602y_counter::counter_config_t& crp42602y_counter::get_config() const
+{
+    return _config;
+}
+
+void crp42602y_counter::set_trace_callback(void (*func)(const trace_record_t& record))
+{
+    _trace_transport_state = 0;
+    _trace_callback = func;
+}
+
+void crp42602y_counter::set_log_callback(void (*func)(const char* fmt, va_list args))
+{
+    _log_callback = func;
+}
+
+void crp42602y_counter::_alloc_pio_sm()
+{
+    // search from PICO_CRP42602Y_CTRL_PIO, then the other PIO blocks
+    for (uint i = 0; i < NUM_PIOS; i++) {
+        uint pio_index = (PICO_CRP42602Y_CTRL_PIO + i) % NUM_PIOS;
+        PIO pio = pio_get_instance(pio_index);
+        bool loaded = _sm_mask[pio_index] != 0;
+        if (!loaded && !pio_can_add_program(pio, &crp42602y_measure_pulse_program)) continue;
+        int sm = pio_claim_unused_sm(pio, false);
+        if (sm < 0) continue;
+        if (!loaded) {
+            _program_offset[pio_index] = pio_add_program(pio, &crp42602y_measure_pulse_program);
+            uint irq_num = pio_get_irq_num(pio, PICO_CRP42602Y_CTRL_PIO_IRQ);
+            irq_add_shared_handler(irq_num, crp42602y_counter_pio_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+            irq_set_enabled(irq_num, true);
         }
+        _sm_mask[pio_index] |= 1UL << sm;
+        _pio = pio;
+        _sm = (uint) sm;
+        return;
     }
-    if (!exist_inst) {
-        if (irq_has_shared_handler(PIO_IRQ_x)) {
-            irq_remove_handler(PIO_IRQ_x, crp42602y_counter_pio_irq_handler);
-        }
+    panic("All PIO state machines are reserved");
+}
+
+void crp42602y_counter::_free_pio_sm()
+{
+    uint pio_index = pio_get_index(_pio);
+    _sm_mask[pio_index] &= ~(1UL << _sm);
+    _inst_map[pio_index][_sm] = nullptr;
+    pio_sm_unclaim(_pio, _sm);
+
+    // Remove handler and program if there are no instances left on this PIO
+    if (_sm_mask[pio_index] == 0) {
+        irq_remove_handler(pio_get_irq_num(_pio, PICO_CRP42602Y_CTRL_PIO_IRQ), crp42602y_counter_pio_irq_handler);
+        pio_remove_program(_pio, &crp42602y_measure_pulse_program, _program_offset[pio_index]);
     }
 }
 
-void crp42602y_counter::restart()
+void crp42602y_counter::_enable_counter()
+{
+    _enable = true;
+}
+
+void crp42602y_counter::_restart()
 {
+    _trace(TRACE_RESTART);
     _status = NONE_BITS;
     _rot_count = 0;
     _count = 0;
@@ -112,40 +237,20 @@ void crp42602y_counter::restart()
         _last_hub_radius_cm[i] = NAN;
         _estimated_hub_radius_cm[i] = 0.0;
     }
-    for (int i = 0; i < MAX_NUM_TO_AVERAGE; i++) {
+    for (uint32_t i = 0; i < MAX_NUM_TO_AVERAGE; i++) {
         _hub_radius_cm_history[i] = 0;
     }
     _ref_hub_radius_cm = 0.0;
     _tape_thickness_um = DEFAULT_ESTIMATED_TAPE_THICKNESS_UM;
+    _publish_snapshot();
 }
 
-float crp42602y_counter::get() const
-{
-    bool is_dir_a = _ctrl->get_head_dir_is_a();
-    if (_check_status(TIME_BIT)) {
-        return _total_playing_sec[!is_dir_a];
-    } else {
-        return NAN;
-    }
-}
-
-void crp42602y_counter::reset()
-{
-    bool is_dir_a = _ctrl->get_head_dir_is_a();
-    if (_check_status(TIME_BIT)) {
-        _total_playing_sec[!is_dir_a] = 0.0;
-    }
-}
-
-void crp42602y_counter::reset_other_side()
+bool crp42602y_counter::_check_status(uint32_t bits) const
 {
-    bool is_dir_a = _ctrl->get_head_dir_is_a();
-    if (_check_status(TIME_BIT)) {
-        _total_playing_sec[is_dir_a] = 0.0;
-    }
+    return (_status & bits) == bits;
 }
 
-uint32_t crp42602y_counter::get_state() const
+crp42602y_counter::counter_state_t crp42602y_counter::_get_state() const
 {
     if (_check_status(ALL_BITS)) {
         return FULL_READY;
@@ -158,24 +263,62 @@ uint32_t crp42602y_counter::get_state() const
     }
 }
 
-void crp42602y_counter::_enable_counter()
+void crp42602y_counter::_publish_snapshot()
 {
-    _enable = true;
+    // seqlock writer: only the core running process_loop() updates _snapshot
+    uint32_t seq = _snapshot_seq;
+    _snapshot_seq = seq + 1;
+    __mem_fence_release();
+    for (int i = 0; i < 2; i++) {
+        int bs = 1 - i;  // the hub rolling up for the other side supplies the tape for this side
+        _snapshot.playing_sec[i] = _check_status(TIME_BIT) ? _total_playing_sec[i] : NAN;
+        _snapshot.hub_radius_cm[i] = _check_status(RADIUS_A_BIT << i) ? _last_hub_radius_cm[i] : NAN;
+        if (_check_status(THICKNESS_BIT | (RADIUS_A_BIT << bs))) {
+            float remaining_area = M_PI * (pow(_last_hub_radius_cm[bs], 2.0) - pow(HUB_CORE_RADIUS_CM, 2.0));
+            float remaining_sec = remaining_area / (TAPE_SPEED_CM_PER_SEC * _tape_thickness_um / 1e4);
+            _snapshot.remaining_sec[i] = (remaining_sec > 0.0) ? remaining_sec : 0.0;
+        } else {
+            _snapshot.remaining_sec[i] = NAN;
+        }
+    }
+    _snapshot.tape_thickness_um = _tape_thickness_um;
+    _snapshot.state = _get_state();
+    __mem_fence_release();
+    _snapshot_seq = seq + 2;
 }
 
-bool crp42602y_counter::_check_status(uint32_t bits) const
+bool crp42602y_counter::_process_commands()
 {
-    return (_status & bits) == bits;
+    bool flag = false;
+    while (queue_get_level(&_command_queue) > 0) {
+        counter_command_t command;
+        queue_remove_blocking(&_command_queue, &command);
+        switch (command.type) {
+        case CMD_RESTART:
+            _restart();
+            break;
+        case CMD_RESET_SIDE:
+            _trace(TRACE_RESET_SIDE, 0, (uint16_t) command.side);
+            if (_check_status(TIME_BIT)) {
+                _total_playing_sec[command.side] = 0.0;
+            }
+            break;
+        default:
+            break;
+        }
+        flag = true;
+    }
+    return flag;
 }
 
 float crp42602y_counter::_correct_tape_thickness_um(float tape_thickness_um)
 {
     // standardize value
-    if (tape_thickness_um < 7.5) {
+    if (tape_thickness_um < _config.thickness_threshold_um[0]) {
         tape_thickness_um = 6.0;  // correct to 6 um (C-120)
-    } else if (tape_thickness_um < 10.5) {
+    } else if (tape_thickness_um < _config.thickness_threshold_um[1]) {
         tape_thickness_um = 9.0;  // correct to 9 um (C-100)
-    } else if (tape_thickness_um < 15.0) {
+    } else if (tape_thickness_um < _config.thickness_threshold_um[2]) {
         tape_thickness_um = 12.0;  // correct to 12 um (C-90)
     } else {
         tape_thickness_um = 18.0;  // correct to 18 um (C-60, C-46)
@@ -186,30 +329,32 @@ float crp42602y_counter::_correct_tape_thickness_um(float tape_thickness_um)
 void crp42602y_counter::_irq_callback()
 {
     uint32_t accum_time_us = 0;
-    while (pio_sm_get_rx_fifo_level(CRP42602Y_PIO, _sm)) {
-        uint32_t val = pio_sm_get_blocking(CRP42602Y_PIO, _sm);
+    while (pio_sm_get_rx_fifo_level(_pio, _sm)) {
+        uint32_t val = pio_sm_get_blocking(_pio, _sm);
         if (val == 0) {  // timeout
             accum_time_us = 0;
             break;
         }
         accum_time_us += -((int32_t) val) * PIO_COUNT_DIV;  // val is always negative value
     }
-    bool is_playing = _ctrl->is_playing();
-    bool is_ff_rew_ing = _ctrl->is_ff_rew_ing();
-    bool is_cueing = _ctrl->is_cueing();
-    bool is_playing_internal = _ctrl->_is_playing_internal();
-    bool gear_is_changing = _ctrl->_gear_is_changing();
-    bool head_dir_is_a = _ctrl->get_head_dir_is_a();
-    bool cue_dir_is_a = _ctrl->get_cue_dir_is_a();
+    // take all the transport flags at once to attribute this rotation to the mode consistently
+    uint32_t transport_state = _ctrl->get_transport_state();
+    bool is_playing = transport_state & crp42602y_ctrl::TS_PLAYING_BIT;
+    bool is_ff_rew_ing = transport_state & crp42602y_ctrl::TS_FF_REW_BIT;
+    bool is_cueing = transport_state & crp42602y_ctrl::TS_CUEING_BIT;
+    bool is_playing_internal = transport_state & crp42602y_ctrl::TS_PLAYING_INTERNAL_BIT;
+    bool gear_is_changing = transport_state & crp42602y_ctrl::TS_GEAR_CHANGING_BIT;
+    bool head_dir_is_a = transport_state & crp42602y_ctrl::TS_HEAD_DIR_A_BIT;
+    bool cue_dir_is_a = transport_state & crp42602y_ctrl::TS_CUE_DIR_A_BIT;
     // Discard dummy rotations
     if ((!is_playing && !is_ff_rew_ing && !is_cueing && !is_playing_internal) || gear_is_changing) {
-        pio_sm_put_blocking(CRP42602Y_PIO, _sm, (uint32_t) -TIMEOUT_COUNT);
+        pio_sm_put_blocking(_pio, _sm, (uint32_t) -TIMEOUT_COUNT);
         _rot_count = 0;
         return;
     }
     // Timeout, thus rotation stopped
     if (accum_time_us == 0) {
-        pio_sm_put_blocking(CRP42602Y_PIO, _sm, (uint32_t) -TIMEOUT_COUNT);
+        pio_sm_put_blocking(_pio, _sm, (uint32_t) -TIMEOUT_COUNT);
         _rot_count = 0;
         _ctrl->_on_rotation_stop();
         return;
@@ -219,9 +364,9 @@ void crp42602y_counter::_irq_callback()
     //   1st time: wrong interval
     //   2nd time: sometimes inaccurate interval
     if (_rot_count > 1) {  // wait 2 times for early stop detection because of lack of accuracy
-        pio_sm_put_blocking(CRP42602Y_PIO, _sm, (uint32_t) ((int32_t) -(accum_time_us / PIO_COUNT_DIV)));
+        pio_sm_put_blocking(_pio, _sm, (uint32_t) ((int32_t) -(accum_time_us / PIO_COUNT_DIV)));
     } else {
-        pio_sm_put_blocking(CRP42602Y_PIO, _sm, (uint32_t) -TIMEOUT_COUNT);
+        pio_sm_put_blocking(_pio, _sm, (uint32_t) -TIMEOUT_COUNT);
     }
     if (!_enable) {
         _rot_count++;
@@ -231,20 +376,20 @@ void crp42602y_counter::_irq_callback()
     if (_rot_count > 0) {  // ignore 1 time to avoid wrong interval inforamtion
         if (is_playing || is_playing_internal) {
             rotation_event_t event = {
-                accum_time_us + ADDITIONAL_US,
+                accum_time_us,
                 PLAY,
                 head_dir_is_a,
-                _rot_count - 1
+                (int) _rot_count - 1
             };
             if (!queue_try_add(&_rotation_event_queue, &event)) {
                 _ctrl->_dispatch_callback((crp42602y_ctrl::callback_type_t) crp42602y_ctrl_with_counter::ON_COUNTER_FIFO_OVERFLOW);
             }
         } else if (is_ff_rew_ing || is_cueing) {
             rotation_event_t event = {
-                accum_time_us + ADDITIONAL_US,
+                accum_time_us,
                 CUE,
                 cue_dir_is_a,
-                _rot_count - 1
+                (int) _rot_count - 1
             };
             if (!queue_try_add(&_rotation_event_queue, &event)) {
                 _ctrl->_dispatch_callback((crp42602y_ctrl::callback_type_t) crp42602y_ctrl_with_counter::ON_COUNTER_FIFO_OVERFLOW);
@@ -254,11 +399,22 @@ void crp42602y_counter::_irq_callback()
     if (_rot_count < MAX_NUM_TO_AVERAGE + 1) _rot_count++;
 }
 
-void crp42602y_counter::_process()
+bool crp42602y_counter::_process()
 {
+    if (_trace_callback != nullptr) {
+        uint32_t transport_state = _ctrl->get_transport_state() & crp42602y_ctrl::TS_FLAG_BITS;
+        if (transport_state != _trace_transport_state) {
+            _trace(TRACE_TRANSPORT, 0, 0, transport_state);
+            _trace_transport_state = transport_state;
+        }
+    }
+    bool updated = _process_commands();
     while (queue_get_level(&_rotation_event_queue) > 0) {
         rotation_event_t event;
         queue_remove_blocking(&_rotation_event_queue, &event);
+        _trace(TRACE_ROTATION, ((event.type == CUE) ? TRACE_FLAG_CUE : 0) | (event.is_dir_a ? TRACE_FLAG_DIR_A : 0), (uint16_t) event.num_to_average, event.interval_us);
+        event.interval_us += _config.additional_us;
+        if (event.num_to_average > (int) _config.num_to_average) event.num_to_average = (int) _config.num_to_average;
         // reset count if function (play/cue) has changed
         if (event.num_to_average == 0) _count = 0;
 
@@ -267,7 +423,12 @@ void crp42602y_counter::_process()
         } else if (event.type == CUE) {
             _process_cue(event);
         }
+        updated = true;
+    }
+    if (updated) {
+        _publish_snapshot();
     }
+    return updated;
 }
 
 void crp42602y_counter::_process_play(const rotation_event_t& event)
@@ -276,9 +437,9 @@ void crp42602y_counter::_process_play(const rotation_event_t& event)
     int bs = 1 - fs; // back side
 
     // rotation calculation
-    float rotation_per_second = 1.0e6 / NUM_ROTATION_WINGS / ROTATION_GEAR_RATIO / event.interval_us;
+    float rotation_per_second = 1.0e6 / NUM_ROTATION_WINGS / _config.rotation_gear_ratio / event.interval_us;
     float hub_radius_cm = TAPE_SPEED_CM_PER_SEC / 2.0 / M_PI / rotation_per_second;
-    float hub_rotations = (float) _count / NUM_ROTATION_WINGS / ROTATION_GEAR_RATIO;
+    float hub_rotations = (float) _count / NUM_ROTATION_WINGS / _config.rotation_gear_ratio;
     float tape_length = TAPE_SPEED_CM_PER_SEC * event.interval_us / 1e6;
     // reflect to total playing sec
     float add_time = event.interval_us / 1e6;
@@ -317,18 +478,9 @@ void crp42602y_counter::_process_play(const rotation_event_t& event)
         // calculate diff area, then it leads diff tape length -> diff sec
         float actual_diff_area = M_PI * (pow(average_hub_radius_cm, 2.0) - pow(original_hub_radius_cm, 2.0));
         float actual_diff_sec = actual_diff_area / (TAPE_SPEED_CM_PER_SEC * tape_thickness_um / 1e4);
-        /*
-        printf("----------------------------\r\n");
-        printf("original hub radius: %7.4f\r\n", _last_hub_radius_cm[fs] - _estimated_hub_radius_cm[fs]);
-        printf("current hub radius: %7.4f\r\n", _last_hub_radius_cm[fs]);
-        printf("estimated hub radius: %7.4f\r\n", _estimated_hub_radius_cm[fs]);
-        printf("actual hub radius: %7.4f\r\n", average_hub_radius_cm);
-        printf("threshold hub radius: %7.4f\r\n", DEFAULT_ESTIMATED_TAPE_THICKNESS_UM / 1e4 * 10);
-        printf("calculated tape_thickness_um: %7.4f\r\n", tape_thickness_um);
-        printf("estimated diff sec = %7.4f\r\n", _estimated_playing_sec[fs]);
-        printf("actual diff sec = %7.4f\r\n", actual_diff_sec);
-        printf("----------------------------\r\n");
-        */
+        _log("thickness: hub radius original %7.4f current %7.4f estimated %7.4f actual %7.4f\r\n",
+            original_hub_radius_cm, _last_hub_radius_cm[fs], _estimated_hub_radius_cm[fs], average_hub_radius_cm);
+        _log("thickness: tape %7.4f um, diff sec estimated %7.4f actual %7.4f\r\n", tape_thickness_um, _estimated_playing_sec[fs], actual_diff_sec);
         float error_sec = _estimated_playing_sec[fs] - actual_diff_sec;
         _total_playing_sec[fs] -= error_sec;
         _total_playing_sec[bs] += error_sec;
@@ -347,12 +499,13 @@ void crp42602y_counter::_process_play(const rotation_event_t& event)
     _status |= RADIUS_A_BIT << fs;
 
     // [2] Tape thickness measurement during PLAY
-    if (_count == 40) {  // this is reference (need to avoid leader tape)
+    const uint32_t ref_count = _config.ref_count;
+    if (_count == ref_count) {  // this is reference (need to avoid leader tape)
         _ref_hub_radius_cm = average_hub_radius_cm;
-    } else if ((!_check_status(THICKNESS_BIT) && _count >= 100 && _count % 10 == 0) ||
-                (_count >= 200 && _count % 100 == 0)) {  // calculate diff from reference
+    } else if ((!_check_status(THICKNESS_BIT) && _count >= _config.thickness_count && _count % _config.thickness_interval == 0) ||
+                (_count >= _config.update_count && _count % _config.update_interval == 0)) {  // calculate diff from reference
         float diff_hub_radius_cm = average_hub_radius_cm - _ref_hub_radius_cm;
-        float diff_hub_rotations = 1.0 / NUM_ROTATION_WINGS / ROTATION_GEAR_RATIO * (_count - 40);
+        float diff_hub_rotations = 1.0 / NUM_ROTATION_WINGS / _config.rotation_gear_ratio * ((float) _count - ref_count);
         _tape_thickness_um = diff_hub_radius_cm * 1e4 / diff_hub_rotations;
         _tape_thickness_um = _correct_tape_thickness_um(_tape_thickness_um);
         if (!_check_status(THICKNESS_BIT)) {
@@ -375,21 +528,11 @@ void crp42602y_counter::_process_play(const rotation_event_t& event)
             _estimated_hub_radius_cm[bs] -= _tape_thickness_um / 1e4 * tape_length / (2.0 * M_PI * _last_hub_radius_cm[bs]);
         }
     }
-    /*
-    if (_count % 10 == 0) {
-        printf("--------\r\n");
-        printf("interval_us = %d\r\n", (int) event.interval_us);
-        printf("rps = %7.4f\r\n", rotation_per_second);
-        printf("hub radius[fs] = %7.4f\r\n", _last_hub_radius_cm[fs]);
-        printf("hub radius[bs] = %7.4f\r\n", _last_hub_radius_cm[bs]);
-        printf("hub rotations = %7.4f\r\n", hub_rotations);
-        printf("tape thicknesss (um)= %7.4f\r\n", _tape_thickness_um);
-        printf("time A = %7.4f\r\n", _total_playing_sec[0]);
-        printf("time B = %7.4f\r\n", _total_playing_sec[1]);
-        printf("_status = %04b\r\n", _status);
-        printf("_count = %d\r\n", _count);
+    if (_log_callback != nullptr && _count % 10 == 0) {
+        _log("play: count %u interval %d us rps %7.4f hub rotations %7.4f\r\n", _count, (int) event.interval_us, rotation_per_second, hub_rotations);
+        _log("play: hub radius fs %7.4f bs %7.4f tape %7.4f um status %x\r\n", _last_hub_radius_cm[fs], _last_hub_radius_cm[bs], _tape_thickness_um, _status);
+        _log("play: time A %7.4f B %7.4f\r\n", _total_playing_sec[0], _total_playing_sec[1]);
     }
-    */
     _count++;
 }
 
@@ -399,8 +542,7 @@ void crp42602y_counter::_process_cue(const rotation_event_t& event)
     int bs = 1 - fs; // back side
 
     // rotation calculation
-    float hub_rotations = (float) _count / NUM_ROTATION_WINGS / ROTATION_GEAR_RATIO;
-    float diff_hub_rotations = 1.0 / NUM_ROTATION_WINGS / ROTATION_GEAR_RATIO;
+    float diff_hub_rotations = 1.0 / NUM_ROTATION_WINGS / _config.rotation_gear_ratio;
     if (!_check_status(RADIUS_A_BIT << fs)) {
         _total_playing_sec[fs] = NAN;
         _total_playing_sec[bs] = NAN;
@@ -411,7 +553,7 @@ void crp42602y_counter::_process_cue(const rotation_event_t& event)
     } else if (_check_status(TIME_BIT)) {
         float tape_length = 2.0 * M_PI * _last_hub_radius_cm[fs] * diff_hub_rotations;
         float add_time = tape_length / TAPE_SPEED_CM_PER_SEC;
-        //printf("%7.4f %7.4f %7.4f %7.4f\r\n", add_time, hub_rotations, _last_hub_radius_cm[fs], diff_hub_rotations);
+        //printf("%7.4f %7.4f %7.4f\r\n", add_time, _last_hub_radius_cm[fs], diff_hub_rotations);
         _total_playing_sec[fs] += add_time;
         _total_playing_sec[bs] -= add_time;
         _last_hub_radius_cm[fs] += _tape_thickness_um / 1e4 * diff_hub_rotations;
@@ -426,18 +568,28 @@ void crp42602y_counter::_process_cue(const rotation_event_t& event)
                 _estimated_hub_radius_cm[bs] -= _tape_thickness_um / 1e4 * tape_length / (2.0 * M_PI * _last_hub_radius_cm[bs]);
             }
         }
-        /*
-        if (_count % 10 == 0) {
-            printf("--------\r\n");
-            printf("hub radius[fs] = %7.4f\r\n", _last_hub_radius_cm[fs]);
-            printf("hub radius[bs] = %7.4f\r\n", _last_hub_radius_cm[bs]);
-            printf("tape thicknesss (um)= %7.4f\r\n", _tape_thickness_um);
-            printf("time A = %7.4f\r\n", _total_playing_sec[0]);
-            printf("time B = %7.4f\r\n", _total_playing_sec[1]);
-            printf("_status = %04b\r\n", _status);
-            printf("_count = %d\r\n", _count);
+        if (_log_callback != nullptr && _count % 10 == 0) {
+            _log("cue: count %u hub radius fs %7.4f bs %7.4f tape %7.4f um\r\n", _count, _last_hub_radius_cm[fs], _last_hub_radius_cm[bs], _tape_thickness_um);
+            _log("cue: time A %7.4f B %7.4f status %x\r\n", _total_playing_sec[0], _total_playing_sec[1], _status);
         }
-        */
         _count++;
     }
-}
\ No newline at end of file
+}
+
+void crp42602y_counter::_trace(const trace_type_t type, const uint8_t flags, const uint16_t arg, const uint32_t value)
+{
+    void (*func)(const trace_record_t& record) = _trace_callback;
+    if (func == nullptr) return;
+    trace_record_t record = {(uint8_t) type, flags, arg, value};
+    func(record);
+}
+
+void crp42602y_counter::_log(const char* fmt, ...)
+{
+    void (*func)(const char* fmt, va_list args) = _log_callback;
+    if (func == nullptr) return;
+    va_list args;
+    va_start(args, fmt);
+    func(fmt, args);
+    va_end(args);
+}
@@ -14,7 +14,10 @@
 #define PICO_CRP42602Y_CTRL_PIO_IRQ 0
 #endif
 
+#include <cstdarg>
+
 #include "pico/util/queue.h"
+#include "hardware/pio.h"
 
 // references to avoid inter lock
 class crp42602y_ctrl;
@@ -42,6 +45,63 @@ class crp42602y_counter {
         FULL_READY
     } counter_state_t;
 
+    /**
+     * counter snapshot
+     *   consistent set of counter values published by the control core
+     *   index 0 is for side A, index 1 is for side B
+     */
+    typedef struct _counter_snapshot_t {
+        float playing_sec[2];     // counter value (NAN if undetermined)
+        float remaining_sec[2];   // approximate remaining playing time down to HUB_CORE_RADIUS_CM (NAN if undetermined)
+        float hub_radius_cm[2];   // radius of the hub rolling up (NAN if undetermined)
+        float tape_thickness_um;  // estimated tape thickness
+        counter_state_t state;    // counter state
+    } counter_snapshot_t;
+
+    /**
+     * counter configuration
+     *   constants of the counter algorithm (DEFAULT_CONFIG is tuned for CRP42602Y)
+     */
+    static constexpr uint32_t MAX_NUM_TO_AVERAGE = 20;
+    typedef struct _counter_config_t {
+        float    rotation_gear_ratio;        // rotations of rotation sensor obstacle per hub rotation
+        uint32_t additional_us;              // added to each measured interval (cycles not counted by PIO program)
+        uint32_t num_to_average;             // window to average hub radius (1 ~ MAX_NUM_TO_AVERAGE)
+        uint32_t ref_count;                  // count to take reference hub radius for thickness measurement (to avoid leader tape)
+        uint32_t thickness_count;            // count to start thickness measurement during play
+        uint32_t thickness_interval;         // interval count of thickness measurement until determined
+        uint32_t update_count;               // count to start periodic thickness update
+        uint32_t update_interval;            // interval count of periodic thickness update
+        float    thickness_threshold_um[3];  // boundaries to standardize thickness to 6 / 9 / 12 / 18 um
+    } counter_config_t;
+    static const counter_config_t DEFAULT_CONFIG;
+
+    /**
+     * trace record
+     *   input sequence of the counter algorithm in the order of processing for offline analysis
+     *   a trace stream starts with TRACE_HEADER, followed by 8-byte records (little endian)
+     */
+    typedef enum _trace_type_t {
+        TRACE_HEADER = 0,  // value: TRACE_MAGIC, arg: TRACE_VERSION
+        TRACE_ROTATION,    // value: measured interval_us (without additional_us), arg: num_to_average, flags: trace_flag_t
+        TRACE_TRANSPORT,   // value: transport state (see crp42602y_ctrl::get_transport_state())
+        TRACE_RESTART,     // counter restart
+        TRACE_RESET_SIDE,  // arg: side (0: side A, 1: side B)
+        TRACE_TRUTH        // value: actual tape position as elapsed playing time of side A in milliseconds (given by the recorder)
+    } trace_type_t;
+    typedef enum _trace_flag_t {
+        TRACE_FLAG_CUE   = (1 << 0),
+        TRACE_FLAG_DIR_A = (1 << 1)
+    } trace_flag_t;
+    typedef struct _trace_record_t {
+        uint8_t  type;
+        uint8_t  flags;
+        uint16_t arg;
+        uint32_t value;
+    } trace_record_t;
+    static constexpr uint32_t TRACE_MAGIC = 0x54504352;  // "RCPT"
+    static constexpr uint16_t TRACE_VERSION = 2;
+
     /**
      * crp42602y_counter class constructor
      *
@@ -55,11 +115,29 @@ class crp42602y_counter {
      */
     virtual ~crp42602y_counter();
 
+    /**
+     * set counter configuration
+     *   call before process_loop() starts, the counter is restarted
+     *
+     * @param[in] config counter configuration (see counter_config_t)
+     */
+    void set_config(const counter_config_t& config);
+
+    /**
+     * get counter configuration
+     *
+     * @return counter configuration
+     */
+    const counter_config_t& get_config() const;
+
     /**
      * restart the counter
      *   this is supposed to be called when the cassette has been replaced
+     *   (applied on the core running process_loop())
+     *
+     * @return false if the request is lost by the full request queue (COMMAND_QUEUE_LENGTH)
      */
-    void restart();
+    bool restart();
 
     /**
      * get the counter value of current side
@@ -68,20 +146,53 @@ class crp42602y_counter {
 
     /**
      * reset the counter value of current side
+     *   (applied on the core running process_loop())
+     *
+     * @return false if the request is lost by the full request queue (COMMAND_QUEUE_LENGTH)
      */
-    void reset();
+    bool reset();
 
     /**
      * reset the counter value of the other side
+     *   (applied on the core running process_loop())
+     *
+     * @return false if the request is lost by the full request queue (COMMAND_QUEUE_LENGTH)
      */
-    void reset_other_side();
+    bool reset_other_side();
 
     /**
      * get the counter state
      */
     uint32_t get_state() const;
 
-    private:
+    /**
+     * get all the counter values at once
+     *   this is safe to call from the other core than the one running process_loop()
+     *
+     * @param[out] snapshot counter values (see counter_snapshot_t)
+     */
+    void get_snapshot(counter_snapshot_t& snapshot) const;
+
+    /**
+     * set trace callback
+     *   the callback is invoked on the core running process_loop() for each input of the counter algorithm,
+     *   thus it should only pass the record to the other core
+     *
+     * @param[in] func callback function (nullptr to stop tracing)
+     */
+    void set_trace_callback(void (*func)(const trace_record_t& record));
+
+    /**
+     * set log callback
+     *   the callback is invoked on the core running process_loop() with the debug lines of the counter algorithm,
+     *   thus it should only store the format and the arguments (e.g. dma_log::vlog()), not to block the control
+     *   the format strings are static, the arguments are up to 4 integers or floating point numbers
+     *
+     * @param[in] func callback function (nullptr to stop logging)
+     */
+    void set_log_callback(void (*func)(const char* fmt, va_list args));
+
+    protected:
     typedef enum _rotation_event_type_t {
         PLAY = 0,
         CUE
@@ -93,6 +204,14 @@ class crp42602y_counter {
         bool is_dir_a;
         int num_to_average;  // 0 ~ MAX_NUM_TO_AVERAGE: 0 means not to use for average
     } rotation_event_t;
+    typedef enum _counter_command_type_t {
+        CMD_RESTART = 0,
+        CMD_RESET_SIDE
+    } counter_command_type_t;
+    typedef struct _counter_command_t {
+        counter_command_type_t type;
+        int side;  // 0: side A, 1: side B
+    } counter_command_t;
     typedef enum _counter_status_bit_t {
         NONE_BITS     = 0,
         TIME_BIT      = (1 << 0),
@@ -103,25 +222,30 @@ class crp42602y_counter {
     } counter_status_bit_t;
 
     static constexpr uint32_t NUM_ROTATION_WINGS = 2;  // determined by the physical wing number of rotation sensor obstacle
-    static constexpr float    ROTATION_GEAR_RATIO = 43.0 / 23.0;  // detemined by the gear teeth number ratio of hub and rotation sensor obstacle
+    static constexpr float    ROTATION_GEAR_RATIO = 43.0 / 23.0;  // detemined by the gear teeth number ratio of hub and rotation sensor obstacle (default)
     static constexpr uint32_t TIMEOUT_MILLI_SEC = 1000;
     static constexpr uint32_t PIO_FREQUENCY_HZ = 1000000;
     static constexpr uint32_t PIO_COUNT_DIV = 4;  // determined by the cycles for 1 count in PIO program
     static constexpr uint32_t TIMEOUT_COUNT = TIMEOUT_MILLI_SEC * PIO_FREQUENCY_HZ / 1000 / PIO_COUNT_DIV;
-    static constexpr uint32_t ADDITIONAL_US = 5 + 4;  // additional cycles from PIO program
+    static constexpr uint32_t ADDITIONAL_US = 5 + 4;  // additional cycles from PIO program (default)
     static constexpr uint     ROTATION_EVENT_QUEUE_LENGTH = 4;
+    static constexpr uint     COMMAND_QUEUE_LENGTH = 4;
     static constexpr float    TAPE_SPEED_CM_PER_SEC = 4.75;
     static constexpr float    DEFAULT_ESTIMATED_TAPE_THICKNESS_UM = 18.0;
-    static constexpr uint32_t MAX_NUM_TO_AVERAGE = 20;
+    static constexpr float    HUB_CORE_RADIUS_CM = 1.1;  // nominal radius of the empty hub (not measured, thus remaining_sec is approximate)
 
-    static crp42602y_counter* _inst_map[4];
+    static crp42602y_counter* _inst_map[NUM_PIOS][NUM_PIO_STATE_MACHINES];
+    static uint32_t _sm_mask[NUM_PIOS];  // state machines used by the instances
+    static uint _program_offset[NUM_PIOS];
 
     crp42602y_ctrl* const _ctrl;
+    counter_config_t _config;
+    PIO _pio;
     uint _sm;
     bool _enable;
     uint32_t _status;
-    int _rot_count;
-    int _count;
+    uint32_t _rot_count;
+    uint32_t _count;
     float _total_playing_sec[2];
     float _estimated_playing_sec[2];
     float _last_hub_radius_cm[2];
@@ -130,14 +254,37 @@ class crp42602y_counter {
     float _ref_hub_radius_cm;
     float _tape_thickness_um;
     queue_t _rotation_event_queue;
+    queue_t _command_queue;
+    volatile uint32_t _snapshot_seq;  // odd while _snapshot is being updated
+    counter_snapshot_t _snapshot;
+    void (* volatile _trace_callback)(const trace_record_t& record);
+    uint32_t _trace_transport_state;
+    void (* volatile _log_callback)(const char* fmt, va_list args);
+
+    /**
+     * crp42602y_counter class constructor without rotation sensor
+     *   the inputs are given by a derived class (e.g. replay of traces) when ctrl is nullptr
+     *
+     * @param[in] ctrl   pointer of crp42602y_ctrl instance
+     * @param[in] config counter configuration
+     */
+    crp42602y_counter(crp42602y_ctrl* const ctrl, const counter_config_t& config);
 
+    void _alloc_pio_sm();
+    void _free_pio_sm();
     void _enable_counter();
+    void _restart();
     bool _check_status(uint32_t bits) const;
+    counter_state_t _get_state() const;
+    void _publish_snapshot();
+    bool _process_commands();
     float _correct_tape_thickness_um(float tape_thickness_um);
     void _irq_callback();
-    void _process();
+    bool _process();
     void _process_play(const rotation_event_t& event);
     void _process_cue(const rotation_event_t& event);
+    void _trace(const trace_type_t type, const uint8_t flags = 0, const uint16_t arg = 0, const uint32_t value = 0);
+    void _log(const char* fmt, ...);
 
     friend crp42602y_ctrl;
     friend crp42602y_ctrl_with_counter;
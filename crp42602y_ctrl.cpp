@@ -4,15 +4,48 @@
 / refer to https://opensource.org/licenses/BSD-2-Clause
 /------------------------------------------------------*/
 
+#include <algorithm>
+
 #include "crp42602y_ctrl.h"
 
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "hardware/sync.h"
+
 //#include <cstdio>
 
+crp42602y_ctrl* crp42602y_ctrl::_gpio_inst_map[NUM_BANK0_GPIOS] = {};
+uint32_t crp42602y_ctrl::_gpio_irq_mask = 0;
+
+// irq handler for edges of switch inputs (shared by all instances)
+void __isr __time_critical_func(crp42602y_ctrl_gpio_irq_handler)()
+{
+    uint32_t mask = crp42602y_ctrl::_gpio_irq_mask;
+    while (mask) {
+        uint gpio = __builtin_ctz(mask);
+        mask &= mask - 1;
+        uint32_t events = gpio_get_irq_event_mask(gpio) & (GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE);
+        if (events == 0) continue;
+        gpio_acknowledge_irq(gpio, events);
+        crp42602y_ctrl* inst = crp42602y_ctrl::_gpio_inst_map[gpio];
+        if (inst != nullptr) {
+            inst->_gpio_callback(gpio);
+        }
+    }
+}
+
 static inline uint32_t _millis()
 {
     return to_ms_since_boot(get_absolute_time());
 }
 
+static inline uint32_t _micros()
+{
+    return time_us_32();
+}
+
 static inline uint32_t _get_diff_time(uint32_t prev, uint32_t now)
 {
     uint32_t diff_time;
@@ -24,6 +57,19 @@ static inline uint32_t _get_diff_time(uint32_t prev, uint32_t now)
     return diff_time;
 }
 
+static inline uint32_t _get_remaining_time(uint32_t prev, uint32_t duration, uint32_t now)
+{
+    uint32_t diff_time = _get_diff_time(prev, now);
+    return (diff_time < duration) ? duration - diff_time : 0;
+}
+
+// remaining microseconds until _millis() reaches (prev_ms + duration_ms)
+static inline uint32_t _get_remaining_us_by_ms(uint32_t prev_ms, uint32_t duration_ms, uint64_t now_us)
+{
+    uint32_t remaining_ms = _get_remaining_time(prev_ms, duration_ms, (uint32_t) (now_us / 1000));
+    return (remaining_ms > 0) ? remaining_ms * 1000 - (uint32_t) (now_us % 1000) : 0;
+}
+
 crp42602y_ctrl::crp42602y_ctrl(
     const uint pin_cassette_detect,
     const uint pin_gear_status_sw,
@@ -50,7 +96,6 @@ crp42602y_ctrl::crp42602y_ctrl(
     _playing(false),
     _ff_rew_ing(false),
     _cueing(false),
-    _prev_filter_time(0),
     _prev_func_time(0),
     _has_cur_gear_status(false),
     _cur_head_dir_is_a(false),
@@ -58,10 +103,46 @@ crp42602y_ctrl::crp42602y_ctrl(
     _cur_reel_fwd(false),
     _gear_changing(false),
     _gear_last_time(0),
+    _gear_seq_state(GEAR_SEQ_IDLE),
+    _gear_steps{},
+    _num_gear_steps(0),
+    _solenoid_pwm(false),
+    _solenoid_pwm_clk_hz(0),
+    _solenoid_level(0),
+    _solenoid_level_time_us(0),
+    _solenoid_drive_acc(0),
+    _solenoid_drive_us(0),
+    _gear_step_index(0),
+    _gear_step_time(0),
+    _gear_verify_count(0),
+    _gear_expect_in_func(false),
+    _gear_target_head_dir_is_a(false),
+    _gear_target_lift_head(false),
+    _gear_target_reel_fwd(false),
+    _start_hold(false),
+    _gear_start_time_us(0),
+    _gear_drive_time_us(0),
+    _exec_command(VOID_COMMAND),
+    _command_executing(false),
+    _command_abortable(false),
+    _action_phase(ACTION_PHASE_START),
     _power_off_timeout_sec(DEFAULT_POWER_OFF_TIMEOUT_SEC),
     _power_enable(false),
+    _power_on_time(0),
+    _warm_standby_ms(DEFAULT_WARM_STANDBY_MS),
+    _warm_standby(false),
+    _warm_up_request(false),
+    _motor_stable_ms(WAIT_MOTOR_STABLE_MS),
+    _gear_begin_power_on_ms(0),
+    _gear_arrival_ref_us(0),
+    _first_func_after_power_on(false),
+    _first_command_latency_ms(0),
+    _gear_status_edge_count(0),
+    _gear_status_edge_time_us(0),
+    _gear_status_seen_edge_count(0),
     _extend_timeout(false),
-    _signal_filter{}
+    _debounce{},
+    _transport_state(0)
 {
     for (int i = 0; i < NUM_COMMAND_HISTORY_REGISTERED; i++) {
         _command_history_registered[i] = VOID_COMMAND;
@@ -72,10 +153,15 @@ crp42602y_ctrl::crp42602y_ctrl(
     for (int i = 0; i < __NUM_CALLBACK_TYPE__; i++) {
         _callbacks[i] = nullptr;
     }
+    for (int i = 0; i < __NUM_SOLENOID_PHASES__; i++) {
+        _solenoid_profiles[i] = FULL_DRIVE_PROFILE;
+    }
 
     queue_init(&_stop_queue, sizeof(command_t), 1);
     queue_init(&_command_queue, sizeof(command_t), COMMAND_QUEUE_LENGTH);
     queue_init(&_callback_queue, sizeof(callback_type_t), CALLBACK_QUEUE_LENGTH);
+    critical_section_init(&_transport_state_lock);
+    _publish_transport_state();
 
     // GPIO setting (pull-up should be done in advance outside if needed)
     gpio_init(_pin_cassette_detect);
@@ -84,8 +170,9 @@ crp42602y_ctrl::crp42602y_ctrl(
     gpio_init(_pin_gear_status_sw);
     gpio_set_dir(_pin_gear_status_sw, GPIO_IN);
 
+    // Solenoid is driven by GPIO until PWM is claimed by a hold profile (see set_solenoid_profile())
     gpio_init(_pin_solenoid_ctrl);
-    _pull_solenoid(false); // set default before setting output mode
+    _pull_solenoid(0); // set default before setting output mode
     gpio_set_dir(_pin_solenoid_ctrl, GPIO_OUT);
 
     if (_pin_power_ctrl != 0) {
@@ -93,33 +180,56 @@ crp42602y_ctrl::crp42602y_ctrl(
         _set_power_enable(false); // set default before setting output mode
         gpio_set_dir(_pin_power_ctrl, GPIO_OUT);
     }
+
+    // Switch inputs are debounced by edge IRQ (on the core constructing the instance)
+    _init_debounce(FILT_CASSETTE_DETECT, _pin_cassette_detect, true);
+    _init_debounce(FILT_REC_A_OK, _pin_rec_a_sw, _pin_rec_a_sw != 0);
+    _init_debounce(FILT_REC_B_OK, _pin_rec_b_sw, _pin_rec_b_sw != 0);
+
+    // Arrival of the function gear is timestamped by edge IRQ to evaluate the motor stable
+    _enable_gpio_irq(_pin_gear_status_sw, GPIO_IRQ_EDGE_FALL);
 }
 
 crp42602y_ctrl::~crp42602y_ctrl()
 {
+    for (int i = 0; i < __NUM_FILTER_SIGNALS__; i++) {
+        _deinit_debounce((filter_signal_t) i);
+    }
+    _disable_gpio_irq(_pin_gear_status_sw);
     queue_free(&_stop_queue);
     queue_free(&_command_queue);
     queue_free(&_callback_queue);
+    critical_section_deinit(&_transport_state_lock);
 }
 
 bool crp42602y_ctrl::is_operating() const
 {
-    return _playing || _ff_rew_ing || _cueing;
+    return (_transport_state & (TS_PLAYING_BIT | TS_FF_REW_BIT | TS_CUEING_BIT)) != 0;
+}
+
+bool crp42602y_ctrl::is_idle()
+{
+    return !is_operating() && _gear_seq_state == GEAR_SEQ_IDLE && !_is_command_pending();
 }
 
 bool crp42602y_ctrl::is_playing() const
 {
-    return _playing;
+    return (_transport_state & TS_PLAYING_BIT) != 0;
 }
 
 bool crp42602y_ctrl::is_ff_rew_ing() const
 {
-    return _ff_rew_ing;
+    return (_transport_state & TS_FF_REW_BIT) != 0;
 }
 
 bool crp42602y_ctrl::is_cueing() const
 {
-    return _cueing;
+    return (_transport_state & TS_CUEING_BIT) != 0;
+}
+
+uint32_t crp42602y_ctrl::get_transport_state() const
+{
+    return _transport_state;
 }
 
 bool crp42602y_ctrl::set_head_dir_is_a(const bool head_dir_is_a)
@@ -127,18 +237,19 @@ bool crp42602y_ctrl::set_head_dir_is_a(const bool head_dir_is_a)
     // ignore when in func
     if (!_gear_is_in_func()) {
         _head_dir_is_a = head_dir_is_a;
+        _publish_transport_state();
     }
     return _head_dir_is_a;
 }
 
 bool crp42602y_ctrl::get_head_dir_is_a() const
 {
-    return _head_dir_is_a;
+    return (_transport_state & TS_HEAD_DIR_A_BIT) != 0;
 }
 
 bool crp42602y_ctrl::get_cue_dir_is_a() const
 {
-    return _cue_dir_is_a;
+    return (_transport_state & TS_CUE_DIR_A_BIT) != 0;
 }
 
 void crp42602y_ctrl::set_reverse_mode(const reverse_mode_t mode)
@@ -156,6 +267,60 @@ void crp42602y_ctrl::set_power_off_timeout_sec(uint32_t sec)
     _power_off_timeout_sec = sec;
 }
 
+void crp42602y_ctrl::set_signal_settle_ms(const filter_signal_t filter_signal, const uint32_t settle_ms)
+{
+    _debounce[filter_signal].settle_us = settle_ms * 1000;
+}
+
+uint32_t crp42602y_ctrl::get_signal_change_time_us(const filter_signal_t filter_signal) const
+{
+    return _debounce[filter_signal].change_time_us;
+}
+
+void crp42602y_ctrl::set_motor_stable_ms(const uint32_t ms)
+{
+    _motor_stable_ms = std::min(std::max(ms, MIN_MOTOR_STABLE_MS), WAIT_MOTOR_STABLE_MS);
+}
+
+void crp42602y_ctrl::set_warm_standby_ms(const uint32_t ms)
+{
+    _warm_standby_ms = ms;
+}
+
+void crp42602y_ctrl::warm_up()
+{
+    _warm_up_request = true;
+    __sev();  // wake up the core waiting in wait_for_event()
+}
+
+bool crp42602y_ctrl::is_warm_standby() const
+{
+    return _warm_standby;
+}
+
+void crp42602y_ctrl::set_solenoid_profile(const solenoid_phase_t phase, const solenoid_profile_t& profile)
+{
+    _solenoid_profiles[phase] = profile;
+    if (profile.hold_percent < 100 && !_solenoid_pwm) {
+        _enable_solenoid_pwm();
+    }
+}
+
+uint32_t crp42602y_ctrl::get_solenoid_drive_us() const
+{
+    return _solenoid_drive_us;
+}
+
+uint32_t crp42602y_ctrl::get_motor_stable_ms() const
+{
+    return _motor_stable_ms;
+}
+
+uint32_t crp42602y_ctrl::get_first_command_latency_ms() const
+{
+    return _first_command_latency_ms;
+}
+
 void crp42602y_ctrl::extend_timeout_power_off()
 {
     _extend_timeout = true;
@@ -163,11 +328,11 @@ void crp42602y_ctrl::extend_timeout_power_off()
 
 void crp42602y_ctrl::recover_power_from_timeout()
 {
-    bool power_enable = _power_enable;
-    _set_power_enable(true);
-    if (!power_enable) {
-        _dispatch_callback(ON_RECOVER_POWER_FROM_TIMEOUT);
-        send_command(STOP_COMMAND);
+    if (_recover_power()) {
+        // STOP is queued in order (not by _stop_queue) so that it doesn't cancel the command to be sent next
+        if (!queue_try_add(&_command_queue, &STOP_COMMAND)) {
+            _dispatch_callback(ON_COMMAND_FIFO_OVERFLOW);
+        }
     }
 }
 
@@ -214,25 +379,157 @@ void crp42602y_ctrl::register_callback_all(void (*func)(const callback_type_t ca
 void crp42602y_ctrl::process_loop()
 {
     uint32_t now = _millis();
-    _process_filter(now);
+    _process_filter();
     _process_set_eject_detection();
+    _process_warm_standby();
     _process_timeout_power_off(now);
     _process_command();
+    _publish_transport_state();
     _process_callbacks();
 }
 
-void crp42602y_ctrl::_filter_signal(const filter_signal_t filter_signal, const bool raw_signal, bool& filtered_signal)
+absolute_time_t crp42602y_ctrl::get_next_deadline() const
 {
-    // Shift
-    _signal_filter[filter_signal] = (_signal_filter[filter_signal] << 1) | raw_signal;
+    absolute_time_t now = get_absolute_time();
+    uint64_t now_us = to_us_since_boot(now);
+    uint32_t wait_us = UINT32_MAX;
+    for (int i = 0; i < __NUM_FILTER_SIGNALS__; i++) {
+        const debounce_t& debounce = _debounce[i];
+        if (!debounce.tracking) continue;
+        uint32_t settle_us = _get_remaining_time(debounce.stable_since_us, debounce.settle_us, (uint32_t) now_us);
+        if (settle_us < wait_us) wait_us = settle_us;
+    }
+    if (_pin_power_ctrl != 0 && _power_enable) {
+        uint32_t timeout_us = _get_remaining_us_by_ms(_prev_func_time, _get_power_off_timeout_ms(), now_us);
+        if (timeout_us < wait_us) wait_us = timeout_us;
+    }
+    uint32_t step_us = wait_us;
+    switch (_gear_seq_state) {
+    case GEAR_SEQ_WAIT_MOTOR:
+        step_us = (_pin_power_ctrl != 0) ? _get_remaining_us_by_ms(_power_on_time, _motor_stable_ms, now_us) : 0;
+        break;
+    case GEAR_SEQ_HOLD:
+        // released in the same loop by crp42602y_multi_deck
+        if (!(_start_hold && _gear_expect_in_func)) step_us = 0;
+        break;
+    case GEAR_SEQ_STEP:
+        step_us = _get_remaining_time(_gear_step_time, _gear_steps[_gear_step_index].duration_ms * 1000, (uint32_t) now_us);
+        break;
+    case GEAR_SEQ_VERIFY:
+        step_us = _get_remaining_time(_gear_step_time, _gear_verify_count * GEAR_STATUS_POLL_MS * 1000, (uint32_t) now_us);
+        break;
+    default:
+        break;
+    }
+    if (step_us < wait_us) wait_us = step_us;
+    return (wait_us == UINT32_MAX) ? at_the_end_of_time : delayed_by_us(now, wait_us);
+}
 
-    // Apply if same value repeated SIGNAL_FILTER_TIMES times
-    uint32_t mask = (1UL << SIGNAL_FILTER_TIMES) - 1;
-    if ((_signal_filter[filter_signal] & mask) == mask) {
-        filtered_signal = true;
-    } else if ((_signal_filter[filter_signal] & mask) == 0) {
-        filtered_signal = false;
+bool crp42602y_ctrl::wait_for_event(const absolute_time_t limit)
+{
+    // events before this point are not lost because SEV of them leaves the event register set for WFE
+    if (_has_pending_event()) return true;
+    return _wait_until(absolute_time_min(get_next_deadline(), limit));
+}
+
+bool crp42602y_ctrl::_wait_until(const absolute_time_t deadline)
+{
+    if (time_reached(deadline)) return false;
+    return !best_effort_wfe_or_timeout(deadline);
+}
+
+void crp42602y_ctrl::_set_gpio_irq_mask(const uint32_t mask)
+{
+    // re-register the raw handler with the new mask so that the default GPIO callback of the application skips these pins
+    if (_gpio_irq_mask != 0) {
+        gpio_remove_raw_irq_handler_masked(_gpio_irq_mask, crp42602y_ctrl_gpio_irq_handler);
     }
+    _gpio_irq_mask = mask;
+    if (_gpio_irq_mask != 0) {
+        gpio_add_raw_irq_handler_masked(_gpio_irq_mask, crp42602y_ctrl_gpio_irq_handler);
+        irq_set_enabled(IO_IRQ_BANK0, true);
+    }
+}
+
+void crp42602y_ctrl::_enable_gpio_irq(const uint pin, const uint32_t events)
+{
+    _gpio_inst_map[pin] = this;
+    gpio_set_irq_enabled(pin, events, true);
+    _set_gpio_irq_mask(_gpio_irq_mask | (1UL << pin));
+}
+
+void crp42602y_ctrl::_disable_gpio_irq(const uint pin)
+{
+    gpio_set_irq_enabled(pin, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, false);
+    _set_gpio_irq_mask(_gpio_irq_mask & ~(1UL << pin));
+    _gpio_inst_map[pin] = nullptr;
+}
+
+void crp42602y_ctrl::_init_debounce(const filter_signal_t filter_signal, const uint pin, const bool enabled)
+{
+    debounce_t& debounce = _debounce[filter_signal];
+    debounce.pin = pin;
+    debounce.enabled = enabled;
+    debounce.settle_us = DEFAULT_SIGNAL_SETTLE_MS * 1000;
+    if (!enabled) return;
+    _enable_gpio_irq(pin, GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE);
+}
+
+void crp42602y_ctrl::_deinit_debounce(const filter_signal_t filter_signal)
+{
+    debounce_t& debounce = _debounce[filter_signal];
+    if (!debounce.enabled) return;
+    _disable_gpio_irq(debounce.pin);
+    debounce.enabled = false;
+}
+
+void crp42602y_ctrl::_gpio_callback(uint gpio)
+{
+    if (gpio == _pin_gear_status_sw) {
+        _gear_status_edge_time_us = _micros();
+        _gear_status_edge_count = _gear_status_edge_count + 1;  // publish after the time
+    }
+    for (int i = 0; i < __NUM_FILTER_SIGNALS__; i++) {
+        debounce_t& debounce = _debounce[i];
+        if (debounce.enabled && debounce.pin == gpio) {
+            debounce.edge_time_us = _micros();
+            debounce.edge_count = debounce.edge_count + 1;  // publish after the time
+        }
+    }
+    __sev();  // wake up the core waiting in wait_for_event()
+}
+
+bool crp42602y_ctrl::_filter_signal(const filter_signal_t filter_signal, bool& filtered_signal)
+{
+    debounce_t& debounce = _debounce[filter_signal];
+    if (!debounce.enabled) return false;
+    // read the count before the time, the time could be newer than the count (only delays the change)
+    uint32_t edge_count = debounce.edge_count;
+    uint32_t edge_time_us = debounce.edge_time_us;
+    uint32_t now_us = _micros();  // not earlier than the edge time
+    bool raw_signal = !gpio_get(debounce.pin);
+    bool new_edge = edge_count != debounce.seen_edge_count;
+    debounce.seen_edge_count = edge_count;
+
+    if (raw_signal == filtered_signal) {
+        debounce.tracking = false;
+        return false;
+    }
+    if (new_edge) {
+        debounce.stable_since_us = edge_time_us;
+    } else if (!debounce.tracking) {
+        debounce.stable_since_us = now_us;  // the level differs without the edge seen (e.g. at start up)
+    }
+    debounce.tracking = true;
+
+    // Apply if stable for the settle time
+    if (_get_diff_time(debounce.stable_since_us, now_us) >= debounce.settle_us) {
+        filtered_signal = raw_signal;
+        debounce.change_time_us = debounce.stable_since_us;
+        debounce.tracking = false;
+        return true;
+    }
+    return false;
 }
 
 bool crp42602y_ctrl::_dispatch_callback(const callback_type_t callback_type)
@@ -240,9 +537,25 @@ bool crp42602y_ctrl::_dispatch_callback(const callback_type_t callback_type)
     return queue_try_add(&_callback_queue, &callback_type);
 }
 
+bool crp42602y_ctrl::_recover_power()
+{
+    bool power_enable = _power_enable;
+    _set_power_enable(true);
+    if (!power_enable) {
+        _dispatch_callback(ON_RECOVER_POWER_FROM_TIMEOUT);
+        return true;
+    }
+    return false;
+}
+
 void crp42602y_ctrl::_set_power_enable(const bool flag)
 {
     if (_pin_power_ctrl != 0) {
+        if (flag && !_power_enable) {
+            _power_on_time = _millis();
+            _prev_func_time = _power_on_time;  // the timeout counts from power on
+            _first_func_after_power_on = true;
+        }
         gpio_put(_pin_power_ctrl, flag);
         _power_enable = flag;
     }
@@ -253,9 +566,44 @@ bool crp42602y_ctrl::_get_power_enable() const
     return _power_enable;
 }
 
-void crp42602y_ctrl::_pull_solenoid(const bool flag) const
+uint32_t crp42602y_ctrl::_get_power_off_timeout_ms() const
 {
-    gpio_put(_pin_solenoid_ctrl, flag);
+    return _warm_standby ? _warm_standby_ms : _power_off_timeout_sec * 1000;
+}
+
+void crp42602y_ctrl::_pull_solenoid(const uint32_t level)
+{
+    uint32_t now_us = _micros();
+    _solenoid_drive_acc += (uint64_t) _solenoid_level * _get_diff_time(_solenoid_level_time_us, now_us);
+    _solenoid_level = level;
+    _solenoid_level_time_us = now_us;
+    if (_solenoid_pwm) {
+        pwm_set_gpio_level(_pin_solenoid_ctrl, level);
+    } else {
+        gpio_put(_pin_solenoid_ctrl, level > 0);
+    }
+}
+
+void crp42602y_ctrl::_enable_solenoid_pwm()
+{
+    // the whole slice is configured, the full level is constant high
+    _solenoid_pwm_clk_hz = clock_get_hz(clk_sys);
+    pwm_config config = pwm_get_default_config();
+    pwm_config_set_clkdiv(&config, (float) _solenoid_pwm_clk_hz / (SOLENOID_PWM_FREQ_HZ * SOLENOID_PWM_LEVEL_MAX));
+    pwm_config_set_wrap(&config, SOLENOID_PWM_LEVEL_MAX - 1);
+    pwm_init(pwm_gpio_to_slice_num(_pin_solenoid_ctrl), &config, true);
+    pwm_set_gpio_level(_pin_solenoid_ctrl, _solenoid_level);  // keep the current level before setting PWM function
+    gpio_set_function(_pin_solenoid_ctrl, GPIO_FUNC_PWM);
+    _solenoid_pwm = true;
+}
+
+void crp42602y_ctrl::_update_solenoid_pwm_clkdiv()
+{
+    // follow the change of clk_sys (e.g. lowered clock in standby) to keep SOLENOID_PWM_FREQ_HZ
+    uint32_t clk_hz = clock_get_hz(clk_sys);
+    if (!_solenoid_pwm || clk_hz == _solenoid_pwm_clk_hz) return;
+    _solenoid_pwm_clk_hz = clk_hz;
+    pwm_set_clkdiv(pwm_gpio_to_slice_num(_pin_solenoid_ctrl), (float) clk_hz / (SOLENOID_PWM_FREQ_HZ * SOLENOID_PWM_LEVEL_MAX));
 }
 
 bool crp42602y_ctrl::_is_playing_internal() const
@@ -268,6 +616,27 @@ bool crp42602y_ctrl::_gear_is_changing() const
     return _gear_changing;
 }
 
+void crp42602y_ctrl::_publish_transport_state()
+{
+    // pack all the flags into one word so that readers never see a mixed state during transition
+    critical_section_enter_blocking(&_transport_state_lock);
+    uint32_t flags =
+        (_playing               ? TS_PLAYING_BIT          : 0) |
+        (_ff_rew_ing            ? TS_FF_REW_BIT           : 0) |
+        (_cueing                ? TS_CUEING_BIT           : 0) |
+        (_is_playing_internal() ? TS_PLAYING_INTERNAL_BIT : 0) |
+        (_gear_changing         ? TS_GEAR_CHANGING_BIT    : 0) |
+        (_head_dir_is_a         ? TS_HEAD_DIR_A_BIT       : 0) |
+        (_cue_dir_is_a          ? TS_CUE_DIR_A_BIT        : 0);
+    uint32_t state = _transport_state;
+    if ((state & TS_FLAG_BITS) != flags) {
+        uint32_t generation = (state >> TS_GENERATION_SHIFT) + 1;
+        __mem_fence_release();
+        _transport_state = (generation << TS_GENERATION_SHIFT) | flags;
+    }
+    critical_section_exit(&_transport_state_lock);
+}
+
 bool crp42602y_ctrl::_gear_is_in_func() const
 {
     return !gpio_get(_pin_gear_status_sw);
@@ -287,16 +656,8 @@ bool crp42602y_ctrl::_gear_is_equal_status(const bool head_dir_is_a, const bool
         _cur_head_dir_is_a == head_dir_is_a && _cur_lift_head == lift_head && _cur_reel_fwd == reel_fwd;
 }
 
-bool crp42602y_ctrl::_gear_func_sequence(const bool head_dir_is_a, const bool lift_head, const bool reel_fwd)
+void crp42602y_ctrl::_gear_start_func_sequence(const bool head_dir_is_a, const bool lift_head, const bool reel_fwd)
 {
-    // recover power if disabled
-    if (!_power_enable) {
-        recover_power_from_timeout();
-        sleep_ms(WAIT_MOTOR_STABLE_MS);
-    }
-
-    _gear_last_time = _millis();
-
     // Function sequence has 190 degree of function gear to rotate in 400 ms
     // Timing definitions (milliseconds) (All values are set experimentally)
     constexpr uint32_t tInitS     = 0;           // Unhook the function gear
@@ -311,66 +672,174 @@ bool crp42602y_ctrl::_gear_func_sequence(const bool head_dir_is_a, const bool li
     // Be careful about the consistency of pinch roller direction and reel direction,
     //  otherwise they could pull to opposite directions and give unexpected extension stress to the tape
 
-    _pull_solenoid(true);
-    sleep_ms(tInitE);
-    _pull_solenoid(!head_dir_is_a);
-    sleep_ms(tHeadDirE - tInitE);
-    _pull_solenoid(false);
-    sleep_ms(tLiftHeadS - tHeadDirE);
-    _pull_solenoid(lift_head);
-    sleep_ms(tLiftHeadE - tLiftHeadS);
-    _pull_solenoid(reel_fwd);
-    sleep_ms(tReelE - tLiftHeadE);
-    _pull_solenoid(false);
-    sleep_ms(20);  // additional margin
-
-    // timeout for ON_GEAR_ERROR
-    uint32_t count = 0;
-    while (!_gear_is_in_func()) {
-        if (count++ > GEAR_ERROR_TIMEOUT_MS / 20) {
-            _dispatch_callback(ON_GEAR_ERROR);
-            return false;
-        }
-        sleep_ms(20);
-    }
+    _num_gear_steps = 0;
+    _add_gear_step(true,           tInitE - tInitS,         SOL_PHASE_UNHOOK);
+    _add_gear_step(!head_dir_is_a, tHeadDirE - tHeadDirS,   SOL_PHASE_HEAD_DIR);
+    _add_gear_step(false,          tLiftHeadS - tHeadDirE,  SOL_PHASE_HEAD_DIR);
+    _add_gear_step(lift_head,      tLiftHeadE - tLiftHeadS, SOL_PHASE_LIFT_HEAD);
+    _add_gear_step(reel_fwd,       tReelE - tReelS,         SOL_PHASE_REEL);
+    _add_gear_step(false,          20,                      SOL_PHASE_REEL);  // additional margin
+
+    _gear_expect_in_func = true;
+    _gear_target_head_dir_is_a = head_dir_is_a;
+    _gear_target_lift_head = lift_head;
+    _gear_target_reel_fwd = reel_fwd;
+    _gear_start_sequence();
+}
 
-    _gear_store_status(head_dir_is_a, lift_head, reel_fwd);
-    return true;
+void crp42602y_ctrl::_gear_start_return_sequence()
+{
+    // Return sequence has (360 - 190) degree of function gear,
+    //  which is needed to take another function when the gear is already in function position
+    //  it is supposed to take 360 ms
+    _num_gear_steps = 0;
+    _add_gear_step(true,  20,  SOL_PHASE_UNHOOK);
+    _add_gear_step(false, 340, SOL_PHASE_UNHOOK);
+    _add_gear_step(false, 20,  SOL_PHASE_UNHOOK);  // additional margin
+
+    _gear_expect_in_func = false;
+    _gear_start_sequence();
 }
 
-bool crp42602y_ctrl::_gear_return_sequence()
+void crp42602y_ctrl::_add_gear_step(const bool pull, const uint32_t duration_ms, const solenoid_phase_t phase)
 {
-    // recover power if disabled
-    if (!_power_enable) {
-        recover_power_from_timeout();
-        sleep_ms(WAIT_MOTOR_STABLE_MS);
+    // the pull is split into full drive for pull-in and PWM drive for hold by the profile of the phase
+    const solenoid_profile_t& profile = _solenoid_profiles[phase];
+    uint32_t hold_level = std::min(profile.hold_percent, (uint32_t) 100) * SOLENOID_PWM_LEVEL_MAX / 100;
+    if (pull && hold_level < SOLENOID_PWM_LEVEL_MAX && profile.pull_in_ms < duration_ms) {
+        if (profile.pull_in_ms > 0) {
+            _gear_steps[_num_gear_steps++] = {SOLENOID_PWM_LEVEL_MAX, profile.pull_in_ms};
+        }
+        _gear_steps[_num_gear_steps++] = {hold_level, duration_ms - profile.pull_in_ms};
+    } else {
+        _gear_steps[_num_gear_steps++] = {pull ? SOLENOID_PWM_LEVEL_MAX : 0, duration_ms};
     }
+}
 
+void crp42602y_ctrl::_gear_start_sequence()
+{
+    // recover power if disabled (the command in execution is not to be followed by STOP)
+    _recover_power();
+    _gear_seq_state = GEAR_SEQ_WAIT_MOTOR;
+}
+
+void crp42602y_ctrl::_gear_begin_steps(const uint32_t now_us)
+{
     _gear_last_time = _millis();
+    _gear_start_time_us = now_us;
+    _gear_step_time = now_us;
+    _gear_step_index = 0;
+    _gear_seq_state = GEAR_SEQ_STEP;
+    _solenoid_drive_acc = 0;
+    _solenoid_level_time_us = _micros();
+    _update_solenoid_pwm_clkdiv();
+    _pull_solenoid(_gear_steps[0].level);
+    _gear_drive_time_us = _micros();
+    _gear_begin_power_on_ms = (_pin_power_ctrl != 0) ? _get_diff_time(_power_on_time, _gear_last_time) : WAIT_MOTOR_STABLE_MS;
+    _gear_status_seen_edge_count = _gear_status_edge_count;
+}
 
-    // Return sequence has (360 - 190) degree of function gear,
-    //  which is needed to take another function when the gear is already in function position
-    //  it is supposed to take 360 ms
-    _pull_solenoid(true);
-    sleep_ms(20);
-    _pull_solenoid(false);
-    sleep_ms(340);
-    sleep_ms(20);  // additional margin
-
-    // timeout for ON_GEAR_ERROR
-    uint32_t count = 0;
-    while (_gear_is_in_func()) {
-        if (count++ > GEAR_ERROR_TIMEOUT_MS / 20) {
+void crp42602y_ctrl::_evaluate_motor_stable()
+{
+    // only the first function sequence after power on is the evidence of the wait
+    bool after_power_on = _first_func_after_power_on;
+    if (after_power_on) {
+        _first_command_latency_ms = _get_diff_time(_power_on_time, _millis());
+        _first_func_after_power_on = false;
+    }
+    if (_gear_status_edge_count == _gear_status_seen_edge_count) return;  // no arrival edge seen
+    uint32_t arrival_us = _get_diff_time(_gear_start_time_us, _gear_status_edge_time_us);
+    if (_gear_begin_power_on_ms >= WAIT_MOTOR_STABLE_MS) {
+        // reference with the motor surely stable
+        _gear_arrival_ref_us = (_gear_arrival_ref_us == 0) ? arrival_us : (_gear_arrival_ref_us * 3 + arrival_us) / 4;
+        return;
+    }
+    if (!after_power_on || _gear_arrival_ref_us == 0) return;
+    if (arrival_us > _gear_arrival_ref_us + MOTOR_STABLE_TOLERANCE_US) {
+        // the gear was delayed by the motor spinning up, thus the wait given is too short
+        _motor_stable_ms = WAIT_MOTOR_STABLE_MS;
+    }
+}
+
+crp42602y_ctrl::gear_seq_result_t crp42602y_ctrl::_process_gear_sequence()
+{
+    uint32_t now_us = _micros();
+    switch (_gear_seq_state) {
+    case GEAR_SEQ_WAIT_MOTOR:
+        if (_pin_power_ctrl != 0 && _get_diff_time(_power_on_time, _millis()) < _motor_stable_ms) break;
+        _gear_seq_state = GEAR_SEQ_HOLD;
+        // fallthrough
+    case GEAR_SEQ_HOLD:
+        // only function sequence is held to start synchronously with other mechanisms
+        if (_start_hold && _gear_expect_in_func) break;
+        _gear_begin_steps(now_us);
+        break;
+    case GEAR_SEQ_STEP:
+        // step times are accumulated from the beginning so that the delay of the loop is not piled up
+        while (_get_diff_time(_gear_step_time, now_us) >= _gear_steps[_gear_step_index].duration_ms * 1000) {
+            _gear_step_time += _gear_steps[_gear_step_index].duration_ms * 1000;
+            if (++_gear_step_index >= _num_gear_steps) {
+                _solenoid_drive_us = (uint32_t) (_solenoid_drive_acc / SOLENOID_PWM_LEVEL_MAX);
+                _gear_verify_count = 0;
+                _gear_seq_state = GEAR_SEQ_VERIFY;
+                break;
+            }
+            _pull_solenoid(_gear_steps[_gear_step_index].level);
+        }
+        if (_gear_seq_state != GEAR_SEQ_VERIFY) break;
+        // fallthrough
+    case GEAR_SEQ_VERIFY:
+        if (_get_diff_time(_gear_step_time, now_us) < _gear_verify_count * GEAR_STATUS_POLL_MS * 1000) break;
+        if (_gear_is_in_func() == _gear_expect_in_func) {
+            if (_gear_expect_in_func) {
+                _gear_store_status(_gear_target_head_dir_is_a, _gear_target_lift_head, _gear_target_reel_fwd);
+                _evaluate_motor_stable();
+            }
+            _gear_seq_state = GEAR_SEQ_IDLE;
+            return GEAR_SEQ_OK;
+        }
+        // timeout for ON_GEAR_ERROR
+        if (_gear_verify_count++ > GEAR_ERROR_TIMEOUT_MS / GEAR_STATUS_POLL_MS) {
+            if (_gear_begin_power_on_ms < WAIT_MOTOR_STABLE_MS) {
+                _motor_stable_ms = WAIT_MOTOR_STABLE_MS;  // fail-safe until evaluated again
+            }
             _dispatch_callback(ON_GEAR_ERROR);
-            return false;
+            _gear_seq_state = GEAR_SEQ_IDLE;
+            return GEAR_SEQ_ERROR;
         }
-        sleep_ms(20);
+        break;
+    default:
+        return GEAR_SEQ_ERROR;
     }
+    return GEAR_SEQ_BUSY;
+}
 
-    return true;
+void crp42602y_ctrl::_set_start_hold(const bool flag)
+{
+    _start_hold = flag;
 }
 
-bool crp42602y_ctrl::_get_dir_is_a(direction_t dir) const
+bool crp42602y_ctrl::_is_start_held() const
+{
+    return _gear_seq_state == GEAR_SEQ_HOLD;
+}
+
+bool crp42602y_ctrl::_release_start_hold(const uint32_t now_us)
+{
+    _start_hold = false;
+    if (_gear_seq_state == GEAR_SEQ_HOLD) {
+        _gear_begin_steps(now_us);
+        return true;
+    }
+    return false;
+}
+
+bool crp42602y_ctrl::_is_command_pending()
+{
+    return _command_executing || !queue_is_empty(&_command_queue) || !queue_is_empty(&_stop_queue);
+}
+
+bool crp42602y_ctrl::_get_dir_is_a(const direction_t dir) const
 {
     bool dir_is_a;
     switch(dir) {
@@ -393,64 +862,99 @@ bool crp42602y_ctrl::_get_dir_is_a(direction_t dir) const
     return dir_is_a;
 }
 
-bool crp42602y_ctrl::_stop(direction_t dir)
+crp42602y_ctrl::action_result_t crp42602y_ctrl::_gear_action(const bool head_dir_is_a, const bool lift_head, const bool reel_fwd)
 {
-    if (_gear_is_in_func()) {
-        _gear_changing = true;
-        bool flag = _gear_return_sequence();
-        if (!IGNORE_GEAR_SEQUENCE_CHECK && !flag) {
-            _gear_changing = false;
-            return false;
+    gear_seq_result_t result;
+    switch (_action_phase) {
+    case ACTION_PHASE_START:
+        if (_gear_is_in_func()) {
+            if (_gear_is_equal_status(head_dir_is_a, lift_head, reel_fwd)) return ACTION_FAILED;
+            _gear_changing = true;
+            _publish_transport_state();
+            _gear_start_return_sequence();
+            _action_phase = ACTION_PHASE_RETURN;
+            return ACTION_BUSY;
         }
-    }
-    if (dir == DIR_REVERSE) _head_dir_is_a = !_head_dir_is_a;
-    _gear_changing = false;
-    return true;
-}
-
-bool crp42602y_ctrl::_play(direction_t dir)
-{
-    _head_dir_is_a = _get_dir_is_a(dir);
-    if (_gear_is_in_func()) {
-        if (_gear_is_equal_status(_head_dir_is_a, true, _head_dir_is_a)) return false;
-        _gear_changing = true;
-        bool flag = _gear_return_sequence();
-        if (!IGNORE_GEAR_SEQUENCE_CHECK && !flag) {
+        break;
+    case ACTION_PHASE_RETURN:
+        result = _process_gear_sequence();
+        if (result == GEAR_SEQ_BUSY) return ACTION_BUSY;
+        if (!IGNORE_GEAR_SEQUENCE_CHECK && result != GEAR_SEQ_OK) {
             _gear_changing = false;
-            return false;
+            return ACTION_FAILED;
         }
+        break;
+    case ACTION_PHASE_FUNC:
+        result = _process_gear_sequence();
+        if (result == GEAR_SEQ_BUSY) return ACTION_BUSY;
+        _gear_changing = false;
+        return (IGNORE_GEAR_SEQUENCE_CHECK || result == GEAR_SEQ_OK) ? ACTION_DONE : ACTION_FAILED;
+    default:
+        return ACTION_FAILED;
     }
     if (!_has_cassette) {
         _gear_changing = false;
-        return false;
+        return ACTION_FAILED;
     }
     _gear_changing = true;
-    bool flag = _gear_func_sequence(_head_dir_is_a, true, _head_dir_is_a);
-    _gear_changing = false;
-    return (IGNORE_GEAR_SEQUENCE_CHECK || flag);
+    _publish_transport_state();
+    _gear_start_func_sequence(head_dir_is_a, lift_head, reel_fwd);
+    _action_phase = ACTION_PHASE_FUNC;
+    return ACTION_BUSY;
 }
 
-bool crp42602y_ctrl::_cue(direction_t dir)
+crp42602y_ctrl::action_result_t crp42602y_ctrl::_stop(const direction_t dir)
 {
-    _cue_dir_is_a = _get_dir_is_a(dir);
-    if (_gear_is_in_func()) {
-        if (_gear_is_equal_status(_head_dir_is_a, false, _cue_dir_is_a)) return false;
-        _gear_changing = true;
-        bool flag = _gear_return_sequence();
-        if (!IGNORE_GEAR_SEQUENCE_CHECK && !flag) {
+    gear_seq_result_t result;
+    switch (_action_phase) {
+    case ACTION_PHASE_START:
+        if (_gear_is_in_func()) {
+            _gear_changing = true;
+            _publish_transport_state();
+            _gear_start_return_sequence();
+            _action_phase = ACTION_PHASE_RETURN;
+            return ACTION_BUSY;
+        }
+        break;
+    case ACTION_PHASE_RETURN:
+        result = _process_gear_sequence();
+        if (result == GEAR_SEQ_BUSY) return ACTION_BUSY;
+        if (!IGNORE_GEAR_SEQUENCE_CHECK && result != GEAR_SEQ_OK) {
             _gear_changing = false;
-            return false;
+            return ACTION_FAILED;
         }
+        break;
+    default:
+        return ACTION_FAILED;
     }
-    if (!_has_cassette) {
-        _gear_changing = false;
-        return false;
+    if (dir == DIR_REVERSE) _head_dir_is_a = !_head_dir_is_a;
+    _gear_changing = false;
+    return ACTION_DONE;
+}
+
+crp42602y_ctrl::action_result_t crp42602y_ctrl::_play(const direction_t dir)
+{
+    if (_action_phase == ACTION_PHASE_START) {
+        _head_dir_is_a = _get_dir_is_a(dir);
+    }
+    return _gear_action(_head_dir_is_a, true, _head_dir_is_a);
+}
+
+crp42602y_ctrl::action_result_t crp42602y_ctrl::_cue(const direction_t dir)
+{
+    if (_action_phase == ACTION_PHASE_START) {
+        _cue_dir_is_a = _get_dir_is_a(dir);
     }
-    _gear_changing = true;
     // Evacuate head, however note that the head direction still matters for which side the head is tracing,
-    bool flag = _gear_func_sequence(_head_dir_is_a, false, _cue_dir_is_a);
-    _gear_changing = false;
-    return (IGNORE_GEAR_SEQUENCE_CHECK || flag);
+    return _gear_action(_head_dir_is_a, false, _cue_dir_is_a);
+}
+
+void crp42602y_ctrl::_push_command_history(const command_t& command)
+{
+    for (int i = NUM_COMMAND_HISTORY_ISSUED - 1; i >= 1; i--) {
+        _command_history_issued[i] = _command_history_issued[i - 1];
+    }
+    _command_history_issued[0] = command;
 }
 
 bool crp42602y_ctrl::_on_rotation_stop()
@@ -491,21 +995,19 @@ bool crp42602y_ctrl::_on_rotation_stop()
         return true;
     } else {
         send_command(STOP_COMMAND);
+        _dispatch_callback(ON_END_OF_TAPE);
         return false;
     }
 }
 
-bool crp42602y_ctrl::_process_filter(uint32_t now)
+bool crp42602y_ctrl::_process_filter()
 {
-    if (_get_diff_time(_prev_filter_time, now) >= SIGNAL_FILTER_MS) {
-        // Switch filters
-        _filter_signal(FILT_CASSETTE_DETECT, !gpio_get(_pin_cassette_detect), _has_cassette);
-        _filter_signal(FILT_REC_A_OK, ((_pin_rec_a_sw != 0) ? !gpio_get(_pin_rec_a_sw) : false), _rec_a_ok);
-        _filter_signal(FILT_REC_B_OK, ((_pin_rec_b_sw != 0) ? !gpio_get(_pin_rec_a_sw) : false), _rec_b_ok);
-        _prev_filter_time = now;
-        return true;
-    }
-    return false;
+    // Switch filters (the level is applied in the first loop after settled, not by periodic sampling)
+    bool flag = false;
+    flag |= _filter_signal(FILT_CASSETTE_DETECT, _has_cassette);
+    flag |= _filter_signal(FILT_REC_A_OK, _rec_a_ok);
+    flag |= _filter_signal(FILT_REC_B_OK, _rec_b_ok);
+    return flag;
 }
 
 bool crp42602y_ctrl::_process_set_eject_detection()
@@ -513,6 +1015,7 @@ bool crp42602y_ctrl::_process_set_eject_detection()
     bool flag = false;
     if (!_prev_has_cassette && _has_cassette) {
         _dispatch_callback(ON_CASSETTE_SET);
+        _warm_up_request = true;  // a command is expected after cassette set
         flag = true;
     } else if (_prev_has_cassette && !_has_cassette) {
         _dispatch_callback(ON_CASSETTE_EJECT);
@@ -529,14 +1032,29 @@ bool crp42602y_ctrl::_process_set_eject_detection()
     return flag;
 }
 
+bool crp42602y_ctrl::_process_warm_standby()
+{
+    // Warm standby: power on in advance of the command expected to come
+    if (!_warm_up_request) return false;
+    _warm_up_request = false;
+    if (_warm_standby_ms == 0 || _pin_power_ctrl == 0 || _get_power_enable() || !_has_cassette) return false;
+    _recover_power();
+    _warm_standby = true;
+    return true;
+}
+
 bool crp42602y_ctrl::_process_timeout_power_off(uint32_t now)
 {
     // Timeout power off (for mechanism)
-    if (_gear_is_in_func() || !_get_power_enable() || _pin_power_ctrl == 0 || _extend_timeout) {
+    if (_gear_is_in_func() || _command_executing || !_get_power_enable()) {
+        _warm_standby = false;  // the power on is not speculative any more
+    }
+    if (_gear_is_in_func() || _command_executing || !_get_power_enable() || _pin_power_ctrl == 0 || _extend_timeout) {
         _prev_func_time = now;
         _extend_timeout = false;
     }
-    if (_get_diff_time(_prev_func_time, now) >= _power_off_timeout_sec * 1000 && _get_power_enable()) {
+    if (_get_diff_time(_prev_func_time, now) >= _get_power_off_timeout_ms() && _get_power_enable()) {
+        _warm_standby = false;
         _set_power_enable(false);
         _dispatch_callback(ON_TIMEOUT_POWER_OFF);
         return true;
@@ -544,7 +1062,7 @@ bool crp42602y_ctrl::_process_timeout_power_off(uint32_t now)
     return false;
 }
 
-void crp42602y_ctrl::_process_stop_command()
+bool crp42602y_ctrl::_process_stop_command()
 {
     if (!queue_is_empty(&_stop_queue)) {
         command_t stop_command;
@@ -554,65 +1072,83 @@ void crp42602y_ctrl::_process_stop_command()
             queue_remove_blocking(&_command_queue, &dispose_command);
         }
         queue_try_add(&_command_queue, &stop_command);
+        return true;
     }
+    return false;
 }
 
 bool crp42602y_ctrl::_process_command()
 {
-    // Stop is first priority
-    _process_stop_command();
+    // Stop is first priority (command waiting without moving the gear is cancelled)
+    if (_process_stop_command() && _command_executing && _command_abortable) {
+        _command_executing = false;
+    }
 
-    bool flag = false;
-    // Process command
-    if (!queue_is_empty(&_command_queue)) {
-        flag = true;
-        command_t command;
-        queue_remove_blocking(&_command_queue, &command);
-        switch (command.type) {
-        case CMD_TYPE_STOP:
-            if (_stop(command.dir)) {
-                _playing = false;
-                _ff_rew_ing = false;
-                _cueing = false;
-                _dispatch_callback(ON_STOP);
-            }
-            break;
-        case CMD_TYPE_PLAY:
-            if (_play(command.dir)) {
-                _playing = true;
-                _ff_rew_ing = false;
-                _cueing = false;
-                if (command.dir == DIR_REVERSE) {
-                    _dispatch_callback(ON_REVERSE);
-                }
-                _dispatch_callback(ON_PLAY);
-            }
-            break;
-        case CMD_TYPE_FF_REW:
-            if (_cue(command.dir)) {
-                _playing = false;
-                _ff_rew_ing = true;
-                _cueing = false;
-                _dispatch_callback(ON_FF_REW);
-            }
-            break;
-        case CMD_TYPE_CUE:
-            if (_cue(command.dir)) {
-                _playing = false;
-                _ff_rew_ing = false;
-                _cueing = true;
-                _dispatch_callback(ON_CUE);
+    // Fetch command
+    if (!_command_executing) {
+        if (queue_is_empty(&_command_queue)) return false;
+        queue_remove_blocking(&_command_queue, &_exec_command);
+        _command_executing = true;
+        _command_abortable = false;
+        _action_phase = ACTION_PHASE_START;
+    }
+
+    // Process command (returns before completion while the gear sequence is in progress)
+    if (_execute_command(_exec_command)) {
+        _command_executing = false;
+    }
+    return true;
+}
+
+bool crp42602y_ctrl::_execute_command(const command_t& command)
+{
+    action_result_t result = ACTION_FAILED;
+    switch (command.type) {
+    case CMD_TYPE_STOP:
+        result = _stop(command.dir);
+        if (result == ACTION_DONE) {
+            _playing = false;
+            _ff_rew_ing = false;
+            _cueing = false;
+            _dispatch_callback(ON_STOP);
+        }
+        break;
+    case CMD_TYPE_PLAY:
+        result = _play(command.dir);
+        if (result == ACTION_DONE) {
+            _playing = true;
+            _ff_rew_ing = false;
+            _cueing = false;
+            if (command.dir == DIR_REVERSE) {
+                _dispatch_callback(ON_REVERSE);
             }
-            break;
-        default:
-            break;
+            _dispatch_callback(ON_PLAY);
         }
-        for (int i = NUM_COMMAND_HISTORY_ISSUED - 1; i >= 1; i--) {
-            _command_history_issued[i] = _command_history_issued[i - 1];
+        break;
+    case CMD_TYPE_FF_REW:
+        result = _cue(command.dir);
+        if (result == ACTION_DONE) {
+            _playing = false;
+            _ff_rew_ing = true;
+            _cueing = false;
+            _dispatch_callback(ON_FF_REW);
         }
-        _command_history_issued[0] = command;
+        break;
+    case CMD_TYPE_CUE:
+        result = _cue(command.dir);
+        if (result == ACTION_DONE) {
+            _playing = false;
+            _ff_rew_ing = false;
+            _cueing = true;
+            _dispatch_callback(ON_CUE);
+        }
+        break;
+    default:
+        break;
     }
-    return flag;
+    if (result == ACTION_BUSY) return false;
+    _push_command_history(command);
+    return true;
 }
 
 bool crp42602y_ctrl::_process_callbacks()
@@ -630,6 +1166,13 @@ bool crp42602y_ctrl::_process_callbacks()
     return flag;
 }
 
+bool crp42602y_ctrl::_has_pending_event()
+{
+    // queued commands behind the executing one are fetched when it completes
+    return !queue_is_empty(&_stop_queue) || !queue_is_empty(&_callback_queue) || _warm_up_request ||
+        (!_command_executing && !queue_is_empty(&_command_queue));
+}
+
 // -------------------------------------------------------------------------------
 
 crp42602y_ctrl_with_counter::crp42602y_ctrl_with_counter(
@@ -642,7 +1185,10 @@ crp42602y_ctrl_with_counter::crp42602y_ctrl_with_counter(
     const uint pin_rec_b_sw
 ) :
     crp42602y_ctrl(pin_cassette_detect, pin_gear_status_sw, pin_rotation_sens, pin_solenoid_ctrl, pin_power_ctrl, pin_rec_a_sw, pin_rec_b_sw), 
-    _playing_for_wait_ff_rew_cue(false)
+    _playing_for_wait_ff_rew_cue(false),
+    _exec_wait_for_counter(false),
+    _exec_head_dir_is_a(true),
+    _counter_updated(false)
 {
     for (int i = 0; i < __NUM_CALLBACK_TYPE_EXTEND__ - __NUM_CALLBACK_TYPE__; i++) {
         _callbacks[i] = nullptr;
@@ -678,12 +1224,21 @@ void crp42602y_ctrl_with_counter::register_callback_all(void (*func)(const callb
 void crp42602y_ctrl_with_counter::process_loop()
 {
     uint32_t now = _millis();
-    _process_filter(now);
+    _process_filter();
     _process_set_eject_detection();
+    _process_warm_standby();
     _process_timeout_power_off(now);
     _process_command();
+    _publish_transport_state();
     _process_callbacks();
-    _counter._process();
+    _counter_updated = _counter._process();
+}
+
+absolute_time_t crp42602y_ctrl_with_counter::get_next_deadline() const
+{
+    // commands waiting for the counter see the update in the next loop
+    if (_counter_updated && _command_executing) return get_absolute_time();
+    return crp42602y_ctrl::get_next_deadline();
 }
 
 bool crp42602y_ctrl_with_counter::_is_playing_internal() const
@@ -700,120 +1255,121 @@ bool crp42602y_ctrl_with_counter::_is_que_ready_for_counter(direction_t dir) con
 bool crp42602y_ctrl_with_counter::_on_rotation_stop()
 {
     bool reversed = crp42602y_ctrl::_on_rotation_stop();
-    if (reversed) { _counter.reset_other_side(); }
+    if (reversed && !_counter.reset_other_side()) {
+        _dispatch_callback((callback_type_t) ON_COUNTER_FIFO_OVERFLOW);
+    }
     return reversed;
 }
 
 bool crp42602y_ctrl_with_counter::_process_set_eject_detection()
 {
     if (crp42602y_ctrl::_process_set_eject_detection()) {
-        _counter.restart();
+        _counter._restart();
         return true;
     }
     return false;
 }
 
-bool crp42602y_ctrl_with_counter::_process_command()
+bool crp42602y_ctrl_with_counter::_execute_command(const command_t& command)
 {
-    // Stop is first priority
-    _process_stop_command();
-
-    bool flag = false;
-    // Process command
-    if (!queue_is_empty(&_command_queue)) {
-        flag = true;
-        command_t command;
-        queue_peek_blocking(&_command_queue, &command);
-        switch (command.type) {
-        case CMD_TYPE_STOP:
-            if (_stop(command.dir)) {
-                _playing = false;
-                _ff_rew_ing = false;
-                _cueing = false;
-                _playing_for_wait_ff_rew_cue = false;
-                _dispatch_callback(ON_STOP);
-            }
-            queue_remove_blocking(&_command_queue, &command);
-            break;
-        case CMD_TYPE_PLAY:
-            if (_play(command.dir)) {
-                _playing = true;
-                _ff_rew_ing = false;
-                _cueing = false;
-                _playing_for_wait_ff_rew_cue = false;
-                if (command.dir == DIR_REVERSE) {
-                    _dispatch_callback(ON_REVERSE);
-                }
-                _dispatch_callback(ON_PLAY);
+    action_result_t result = ACTION_FAILED;
+    switch ((int) command.type) {  // including the extended command types out of command_type_t
+    case CMD_TYPE_STOP:
+        result = _stop(command.dir);
+        if (result == ACTION_DONE) {
+            _playing = false;
+            _ff_rew_ing = false;
+            _cueing = false;
+            _playing_for_wait_ff_rew_cue = false;
+            _dispatch_callback(ON_STOP);
+        }
+        break;
+    case CMD_TYPE_PLAY:
+        result = _play(command.dir);
+        if (result == ACTION_DONE) {
+            _playing = true;
+            _ff_rew_ing = false;
+            _cueing = false;
+            _playing_for_wait_ff_rew_cue = false;
+            if (command.dir == DIR_REVERSE) {
+                _dispatch_callback(ON_REVERSE);
             }
-            queue_remove_blocking(&_command_queue, &command);
-            break;
-        case CMD_TYPE_FF_REW:  // fallthrough
-        case CMD_TYPE_CUE:
-        {
-            if (!_is_que_ready_for_counter(command.dir)) {
-                bool head_dir_is_a = _head_dir_is_a;
+            _dispatch_callback(ON_PLAY);
+        }
+        break;
+    case CMD_TYPE_FF_REW:  // fallthrough
+    case CMD_TYPE_CUE:
+        if (_action_phase == ACTION_PHASE_START) {
+            _exec_wait_for_counter = !_is_que_ready_for_counter(command.dir);
+            _exec_head_dir_is_a = _head_dir_is_a;
+            _command_abortable = false;
+            if (_exec_wait_for_counter) {
                 _cue_dir_is_a = _get_dir_is_a(command.dir);
-                if (_play(command.dir)) {
-                    _playing = false;
-                    _ff_rew_ing = command.type == CMD_TYPE_FF_REW;
-                    _cueing = command.type == CMD_TYPE_CUE;
-                    _playing_for_wait_ff_rew_cue = true;
-                    // remove CUE command
-                    queue_remove_blocking(&_command_queue, &command);
-                    // 1. add WAIT command
-                    const command_t* wait_command = (command.dir == DIR_FORWARD) ? &WAIT_FF_READY_COMMAND : &WAIT_REW_READY_COMMAND;
-                    if (!queue_try_add(&_command_queue, wait_command)) {
-                        _dispatch_callback(ON_COMMAND_FIFO_OVERFLOW);
-                    }
-                    // 2. add HEAD_DIR command
-                    const command_t* head_dir_command = (head_dir_is_a) ? &HEAD_DIR_A_COMMAND : &HEAD_DIR_B_COMMAND;
-                    if (!queue_try_add(&_command_queue, head_dir_command)) {
-                        _dispatch_callback(ON_COMMAND_FIFO_OVERFLOW);
-                    }
-                    // 3. add original CUE command
-                    if (!queue_try_add(&_command_queue, &command)) {
-                        _dispatch_callback(ON_COMMAND_FIFO_OVERFLOW);
-                    }
-                }
-            } else {
-                if (_cue(command.dir)) {
-                    _playing = false;
-                    _ff_rew_ing = command.type == CMD_TYPE_FF_REW;
-                    _cueing = command.type == CMD_TYPE_CUE;
-                    _playing_for_wait_ff_rew_cue = false;
-                    if (command.type == CMD_TYPE_FF_REW) {
-                        _dispatch_callback(ON_FF_REW);
-                    } else if (command.type == CMD_TYPE_CUE) {
-                        _dispatch_callback(ON_CUE);
-                    }
-                }
-                queue_remove_blocking(&_command_queue, &command);
             }
-            break;
         }
-        case CMD_TYPE_WAIT:
-            if (_is_que_ready_for_counter(command.dir)) {
-                queue_remove_blocking(&_command_queue, &command);
+        if (_exec_wait_for_counter) {
+            result = _play(command.dir);
+            if (result == ACTION_DONE) {
+                _playing = false;
+                _ff_rew_ing = command.type == CMD_TYPE_FF_REW;
+                _cueing = command.type == CMD_TYPE_CUE;
+                _playing_for_wait_ff_rew_cue = true;
+                // 1. add WAIT command
+                const command_t* wait_command = (command.dir == DIR_FORWARD) ? &WAIT_FF_READY_COMMAND : &WAIT_REW_READY_COMMAND;
+                if (!queue_try_add(&_command_queue, wait_command)) {
+                    _dispatch_callback(ON_COMMAND_FIFO_OVERFLOW);
+                }
+                // 2. add HEAD_DIR command
+                const command_t* head_dir_command = (_exec_head_dir_is_a) ? &HEAD_DIR_A_COMMAND : &HEAD_DIR_B_COMMAND;
+                if (!queue_try_add(&_command_queue, head_dir_command)) {
+                    _dispatch_callback(ON_COMMAND_FIFO_OVERFLOW);
+                }
+                // 3. add original CUE command
+                if (!queue_try_add(&_command_queue, &command)) {
+                    _dispatch_callback(ON_COMMAND_FIFO_OVERFLOW);
+                }
+            } else if (result == ACTION_FAILED && _has_cassette) {
+                // keep the command to retry until the counter gets ready (cancelled by STOP)
+                _action_phase = ACTION_PHASE_START;
+                _command_abortable = true;
+                return false;
             }
-            break;
-        case CMD_TYPE_HEAD_DIR:
-            if (command.dir == DIR_FORWARD) {
-                _head_dir_is_a = true;
-            } else if (command.dir == DIR_BACKWARD) {
-                _head_dir_is_a = false;
+        } else {
+            result = _cue(command.dir);
+            if (result == ACTION_DONE) {
+                _playing = false;
+                _ff_rew_ing = command.type == CMD_TYPE_FF_REW;
+                _cueing = command.type == CMD_TYPE_CUE;
+                _playing_for_wait_ff_rew_cue = false;
+                if (command.type == CMD_TYPE_FF_REW) {
+                    _dispatch_callback(ON_FF_REW);
+                } else if (command.type == CMD_TYPE_CUE) {
+                    _dispatch_callback(ON_CUE);
+                }
             }
-            queue_remove_blocking(&_command_queue, &command);
-            break;
-        default:
-            break;
         }
-        for (int i = NUM_COMMAND_HISTORY_ISSUED - 1; i >= 1; i--) {
-            _command_history_issued[i] = _command_history_issued[i - 1];
+        break;
+    case CMD_TYPE_WAIT:
+        if (_action_phase == ACTION_PHASE_START) {
+            _push_command_history(command);
+            _action_phase = ACTION_PHASE_WAIT;
+            _command_abortable = true;
+        }
+        return _is_que_ready_for_counter(command.dir);
+    case CMD_TYPE_HEAD_DIR:
+        if (command.dir == DIR_FORWARD) {
+            _head_dir_is_a = true;
+        } else if (command.dir == DIR_BACKWARD) {
+            _head_dir_is_a = false;
         }
-        _command_history_issued[0] = command;
+        result = ACTION_DONE;
+        break;
+    default:
+        break;
     }
-    return flag;
+    if (result == ACTION_BUSY) return false;
+    _push_command_history(command);
+    return true;
 }
 
 bool crp42602y_ctrl_with_counter::_process_callbacks()
@@ -835,4 +1391,10 @@ bool crp42602y_ctrl_with_counter::_process_callbacks()
         flag = true;
     }
     return flag;
-}
\ No newline at end of file
+}
+
+bool crp42602y_ctrl_with_counter::_has_pending_event()
+{
+    return crp42602y_ctrl::_has_pending_event() ||
+        !queue_is_empty(&_counter._rotation_event_queue) || !queue_is_empty(&_counter._command_queue);
+}
@@ -7,6 +7,7 @@
 #pragma once
 
 #include "pico/stdlib.h"
+#include "pico/sync.h"
 #include "pico/util/queue.h"
 
 #include "crp42602y_counter.h"
@@ -32,22 +33,59 @@ class crp42602y_ctrl {
         command_type_t type;
         direction_t    dir;
     } command_t;
-    typedef enum _filter_signal_t {
-        FILT_CASSETTE_DETECT = 0,
-        FILT_REC_A_OK,
-        FILT_REC_B_OK,
-        __NUM_FILTER_SIGNALS__
-    } filter_signal_t;
+    typedef enum _gear_seq_state_t {
+        GEAR_SEQ_IDLE = 0,
+        GEAR_SEQ_WAIT_MOTOR,  // wait for motor to be stable after power on
+        GEAR_SEQ_HOLD,        // wait for release of start hold (synchronized start)
+        GEAR_SEQ_STEP,        // drive solenoid by steps
+        GEAR_SEQ_VERIFY       // poll gear status switch
+    } gear_seq_state_t;
+    typedef enum _gear_seq_result_t {
+        GEAR_SEQ_BUSY = 0,
+        GEAR_SEQ_OK,
+        GEAR_SEQ_ERROR
+    } gear_seq_result_t;
+    typedef enum _action_phase_t {
+        ACTION_PHASE_START = 0,
+        ACTION_PHASE_RETURN,
+        ACTION_PHASE_FUNC,
+        ACTION_PHASE_WAIT
+    } action_phase_t;
+    typedef enum _action_result_t {
+        ACTION_BUSY = 0,
+        ACTION_DONE,
+        ACTION_FAILED
+    } action_result_t;
+    typedef struct _debounce_t {
+        uint     pin;
+        bool     enabled;             // false if the pin is not used
+        uint32_t settle_us;           // the level is applied after stable for this time
+        volatile uint32_t edge_count;    // incremented by GPIO IRQ
+        volatile uint32_t edge_time_us;  // time of the last edge by GPIO IRQ
+        uint32_t seen_edge_count;
+        bool     tracking;            // raw level differs from the filtered level
+        uint32_t stable_since_us;     // raw level is stable since this time
+        uint32_t change_time_us;      // time when the last applied level started
+    } debounce_t;
+    typedef struct _gear_step_t {
+        uint32_t level;        // PWM level of solenoid (0 ~ SOLENOID_PWM_LEVEL_MAX)
+        uint32_t duration_ms;
+    } gear_step_t;
 
     // Constants
     static constexpr uint32_t DEFAULT_POWER_OFF_TIMEOUT_SEC = 300;
-    static constexpr uint32_t WAIT_MOTOR_STABLE_MS = 500;
+    static constexpr uint32_t DEFAULT_WARM_STANDBY_MS = 0;  // warm standby disabled
+    static constexpr uint32_t WAIT_MOTOR_STABLE_MS = 500;  // upper bound of the wait for motor stable after power on
+    static constexpr uint32_t MIN_MOTOR_STABLE_MS = 100;
+    static constexpr uint32_t MOTOR_STABLE_TOLERANCE_US = 10000;  // allowed delay of the gear arrival against the reference
     static constexpr uint32_t GEAR_ERROR_TIMEOUT_MS = 300;
+    static constexpr uint32_t GEAR_STATUS_POLL_MS = 20;
+    static constexpr uint     MAX_GEAR_STEPS = 10;  // 6 steps + pull-in steps of solenoid profiles
+    static constexpr uint32_t SOLENOID_PWM_FREQ_HZ = 20000;
+    static constexpr uint32_t SOLENOID_PWM_LEVEL_MAX = 1000;  // full drive (constant high)
     static constexpr bool     IGNORE_GEAR_SEQUENCE_CHECK = true;
     static constexpr uint     COMMAND_QUEUE_LENGTH = 6;
     static constexpr uint     CALLBACK_QUEUE_LENGTH = 4;
-    static constexpr uint32_t SIGNAL_FILTER_MS = 100;
-    static constexpr uint32_t SIGNAL_FILTER_TIMES = 3;
     static constexpr int      NUM_COMMAND_HISTORY_REGISTERED = 1;
     static constexpr int      NUM_COMMAND_HISTORY_ISSUED = 2;
     // Internal commands
@@ -64,6 +102,23 @@ class crp42602y_ctrl {
         RVS_INFINITE_ROUND,
         __NUM_RVS_MODES__
     } reverse_mode_t;
+    typedef enum _filter_signal_t {
+        FILT_CASSETTE_DETECT = 0,
+        FILT_REC_A_OK,
+        FILT_REC_B_OK,
+        __NUM_FILTER_SIGNALS__
+    } filter_signal_t;
+    typedef enum _solenoid_phase_t {
+        SOL_PHASE_UNHOOK = 0,   // unhook the function gear
+        SOL_PHASE_HEAD_DIR,     // term to determine head direction (pull: B)
+        SOL_PHASE_LIFT_HEAD,    // term to lift head (pull: lift)
+        SOL_PHASE_REEL,         // term to determine reel direction (pull: A)
+        __NUM_SOLENOID_PHASES__
+    } solenoid_phase_t;
+    typedef struct _solenoid_profile_t {
+        uint32_t pull_in_ms;    // full drive from the start of the pull
+        uint32_t hold_percent;  // PWM duty after pull_in_ms (100: full drive)
+    } solenoid_profile_t;
     typedef enum _callback_type_t {
         ON_GEAR_ERROR = 0,
         ON_COMMAND_FIFO_OVERFLOW,
@@ -76,8 +131,22 @@ class crp42602y_ctrl {
         ON_REVERSE,
         ON_TIMEOUT_POWER_OFF,
         ON_RECOVER_POWER_FROM_TIMEOUT,
+        ON_END_OF_TAPE,
         __NUM_CALLBACK_TYPE__
     } callback_type_t;
+    typedef enum _transport_state_bit_t {
+        TS_PLAYING_BIT          = (1 << 0),
+        TS_FF_REW_BIT           = (1 << 1),
+        TS_CUEING_BIT           = (1 << 2),
+        TS_PLAYING_INTERNAL_BIT = (1 << 3),  // playing internally to wait for FF/REW/CUE (crp42602y_ctrl_with_counter)
+        TS_GEAR_CHANGING_BIT    = (1 << 4),
+        TS_HEAD_DIR_A_BIT       = (1 << 5),
+        TS_CUE_DIR_A_BIT        = (1 << 6),
+        TS_FLAG_BITS            = 0xffff
+    } transport_state_bit_t;
+    static constexpr uint32_t TS_GENERATION_SHIFT = 16;  // upper bits of transport state are generation counter
+    static constexpr uint32_t DEFAULT_SIGNAL_SETTLE_MS = 20;  // settle time of switch inputs (cassette detect, rec switches)
+    static constexpr solenoid_profile_t FULL_DRIVE_PROFILE = {0, 100};  // default for all phases
 
     /**
      * Constatns - User commands
@@ -127,6 +196,15 @@ class crp42602y_ctrl {
      */
     bool is_operating() const;
 
+    /**
+     * get is idle
+     *   not operating, no gear sequence in progress and no command pending,
+     *   which is the window to pause the core running process_loop() (e.g. for flash programming)
+     *
+     * @return true if idle
+     */
+    bool is_idle();
+
     /**
      * get is playing
      *
@@ -148,6 +226,14 @@ class crp42602y_ctrl {
      */
     bool is_cueing() const;
 
+    /**
+     * get transport state
+     *   all the transport flags are published at once, which can be read lock-free from any core or IRQ
+     *
+     * @return transport state (TS_xxx_BIT flags and generation counter above TS_GENERATION_SHIFT)
+     */
+    uint32_t get_transport_state() const;
+
     /**
      * set head direction
      *   setting value can be ignored if control has not stopped
@@ -192,6 +278,90 @@ class crp42602y_ctrl {
      */
     void set_power_off_timeout_sec(uint32_t sec);
 
+    /**
+     * set idle budget of warm standby
+     *   the power is turned on in advance of the command expected by cassette set or warm_up()
+     *   and turned off again when no command is executed within the idle budget
+     *
+     * @param[in] ms idle budget in milliseconds (0: disable warm standby)
+     */
+    void set_warm_standby_ms(const uint32_t ms);
+
+    /**
+     * warm up the motor in advance of the command expected to come (e.g. button press while power off)
+     *   no effect when warm standby is disabled, the power is already on or no cassette is set
+     */
+    void warm_up();
+
+    /**
+     * get warm standby status
+     *
+     * @return true if the power is on by warm standby and no command is executed yet
+     */
+    bool is_warm_standby() const;
+
+    /**
+     * set settle time of switch input
+     *   the level change is applied when the input is stable for settle_ms after the last edge
+     *
+     * @param[in] filter_signal switch input (see filter_signal_t)
+     * @param[in] settle_ms settle time in milliseconds
+     */
+    void set_signal_settle_ms(const filter_signal_t filter_signal, const uint32_t settle_ms);
+
+    /**
+     * get change time of switch input
+     *
+     * @param[in] filter_signal switch input (see filter_signal_t)
+     * @return time_us_32() of the edge where the current level of the input started
+     */
+    uint32_t get_signal_change_time_us(const filter_signal_t filter_signal) const;
+
+    /**
+     * set drive profile of solenoid
+     *   the solenoid is pulled in by full drive and held by PWM of hardware
+     *   the solenoid pin stays plain GPIO output until a profile with hold_percent below 100 is set,
+     *   then the PWM slice of the pin is claimed, thus the other pin of the slice (pin ^ 1) cannot be used for PWM at another frequency
+     *   note that too short pull_in_ms or too low hold_percent could fail to engage the function gear
+     *
+     * @param[in] phase phase of the gear sequence (see solenoid_phase_t)
+     * @param[in] profile drive profile (FULL_DRIVE_PROFILE by default)
+     */
+    void set_solenoid_profile(const solenoid_phase_t phase, const solenoid_profile_t& profile);
+
+    /**
+     * get solenoid drive of the last gear sequence
+     *   energy per gear transition is this time multiplied by the power of the solenoid at full drive
+     *
+     * @return full drive equivalent time in microseconds
+     */
+    uint32_t get_solenoid_drive_us() const;
+
+    /**
+     * set wait for motor stable
+     *   the wait from power on to the first gear sequence, to be given by the spin-up time measured on the mechanism
+     *   the wait is never shortened by the controller itself, it is raised to WAIT_MOTOR_STABLE_MS
+     *   when the function gear of the first sequence arrives later than the arrival time with the motor surely stable
+     *   (gear sequence WAIT_MOTOR_STABLE_MS or more after power on) or when the first sequence fails
+     *
+     * @param[in] ms wait in milliseconds (clamped to MIN_MOTOR_STABLE_MS ~ WAIT_MOTOR_STABLE_MS, default: WAIT_MOTOR_STABLE_MS)
+     */
+    void set_motor_stable_ms(const uint32_t ms);
+
+    /**
+     * get wait for motor stable
+     *
+     * @return wait in milliseconds (MIN_MOTOR_STABLE_MS ~ WAIT_MOTOR_STABLE_MS)
+     */
+    uint32_t get_motor_stable_ms() const;
+
+    /**
+     * get first command latency
+     *
+     * @return milliseconds from the last power on to the arrival of the function gear of the first command (0 if not yet)
+     */
+    uint32_t get_first_command_latency_ms() const;
+
     /**
      * extend timeout for  power off
      */
@@ -234,10 +404,33 @@ class crp42602y_ctrl {
     /**
      * process loop
      *   call this function from upper program repeatedly to process control
+     *   gear sequences proceed by steps without blocking, thus several instances can share one loop
      */
     virtual void process_loop();
 
+    /**
+     * get next deadline of process_loop()
+     *   the earliest time when process_loop() has something to do by time (input settle, power off timeout, warm standby, gear sequence step)
+     *   edges of switch inputs are notified by GPIO IRQ, thus no deadline is needed to poll them
+     *
+     * @return absolute time of the next deadline (now if process_loop() should be called immediately)
+     */
+    virtual absolute_time_t get_next_deadline() const;
+
+    /**
+     * wait for event
+     *   sleep the core by WFE until the next deadline of process_loop(), a command, callback or counter event queued
+     *   from the other core (notified by SEV), or an interrupt to this core
+     *   call this function after process_loop() only from the core running process_loop()
+     *
+     * @param[in] limit time to return at the latest (for other tasks on the same core)
+     * @return true if woken up before the deadline
+     */
+    bool wait_for_event(const absolute_time_t limit = at_the_end_of_time);
+
     protected:
+    static crp42602y_ctrl* _gpio_inst_map[NUM_BANK0_GPIOS];
+    static uint32_t _gpio_irq_mask;
     crp42602y_counter _counter;
     const uint _pin_cassette_detect;
     const uint _pin_gear_status_sw;
@@ -255,7 +448,6 @@ class crp42602y_ctrl {
     bool _playing;
     bool _ff_rew_ing;
     bool _cueing;
-    uint32_t _prev_filter_time;
     uint32_t _prev_func_time;
     bool _has_cur_gear_status;
     bool _cur_head_dir_is_a;
@@ -263,10 +455,48 @@ class crp42602y_ctrl {
     bool _cur_reel_fwd;
     bool _gear_changing;
     uint32_t _gear_last_time;
+    gear_seq_state_t _gear_seq_state;
+    gear_step_t _gear_steps[MAX_GEAR_STEPS];
+    uint _num_gear_steps;
+    solenoid_profile_t _solenoid_profiles[__NUM_SOLENOID_PHASES__];
+    bool _solenoid_pwm;            // PWM slice claimed by a hold profile
+    uint32_t _solenoid_pwm_clk_hz;  // clk_sys for the current clkdiv
+    uint32_t _solenoid_level;
+    uint32_t _solenoid_level_time_us;
+    uint64_t _solenoid_drive_acc;  // sum of level * microseconds in the current gear sequence
+    uint32_t _solenoid_drive_us;
+    uint _gear_step_index;
+    uint32_t _gear_step_time;  // microseconds
+    uint32_t _gear_verify_count;
+    bool _gear_expect_in_func;
+    bool _gear_target_head_dir_is_a;
+    bool _gear_target_lift_head;
+    bool _gear_target_reel_fwd;
+    bool _start_hold;
+    uint32_t _gear_start_time_us;
+    uint32_t _gear_drive_time_us;
+    command_t _exec_command;
+    bool _command_executing;
+    bool _command_abortable;
+    action_phase_t _action_phase;
     uint32_t _power_off_timeout_sec;
     bool _power_enable;
+    uint32_t _power_on_time;
+    uint32_t _warm_standby_ms;
+    bool _warm_standby;
+    volatile bool _warm_up_request;
+    uint32_t _motor_stable_ms;
+    uint32_t _gear_begin_power_on_ms;    // elapsed time from power on at the beginning of the gear sequence
+    uint32_t _gear_arrival_ref_us;       // arrival time of the function gear with the motor stable
+    bool _first_func_after_power_on;
+    uint32_t _first_command_latency_ms;
+    volatile uint32_t _gear_status_edge_count;    // incremented by GPIO IRQ at the arrival of function gear
+    volatile uint32_t _gear_status_edge_time_us;
+    uint32_t _gear_status_seen_edge_count;
     bool _extend_timeout;
-    uint32_t _signal_filter[__NUM_FILTER_SIGNALS__];
+    debounce_t _debounce[__NUM_FILTER_SIGNALS__];
+    volatile uint32_t _transport_state;
+    critical_section_t _transport_state_lock;
 
     command_t _command_history_registered[NUM_COMMAND_HISTORY_REGISTERED];
     command_t _command_history_issued[NUM_COMMAND_HISTORY_ISSUED];
@@ -275,32 +505,59 @@ class crp42602y_ctrl {
     queue_t   _command_queue;
     queue_t   _callback_queue;
 
-    void _gpio_callback(uint gpio, uint32_t events);
-    void _filter_signal(const filter_signal_t filter_signal, const bool raw_signal, bool& filtered_signal);
+    static bool _wait_until(const absolute_time_t deadline);
+    static void _set_gpio_irq_mask(const uint32_t mask);
+    void _enable_gpio_irq(const uint pin, const uint32_t events);
+    void _disable_gpio_irq(const uint pin);
+    void _init_debounce(const filter_signal_t filter_signal, const uint pin, const bool enabled);
+    void _deinit_debounce(const filter_signal_t filter_signal);
+    void _gpio_callback(uint gpio);
+    bool _filter_signal(const filter_signal_t filter_signal, bool& filtered_signal);
     bool _dispatch_callback(const callback_type_t callback_type);
+    bool _recover_power();
     void _set_power_enable(const bool flag);
     bool _get_power_enable() const;
-    void _pull_solenoid(const bool flag) const;
+    uint32_t _get_power_off_timeout_ms() const;
+    void _pull_solenoid(const uint32_t level);
+    void _enable_solenoid_pwm();
+    void _update_solenoid_pwm_clkdiv();
+    void _add_gear_step(const bool pull, const uint32_t duration_ms, const solenoid_phase_t phase);
     virtual bool _is_playing_internal() const;
     bool _gear_is_changing() const;
+    void _publish_transport_state();
     bool _gear_is_in_func() const;
     void _gear_store_status(const bool head_dir_is_a, const bool lift_head, const bool reel_fwd);
     bool _gear_is_equal_status(const bool head_dir_is_a, const bool lift_head, const bool reel_fwd) const;
-    bool _gear_func_sequence(const bool head_dir_is_a, const bool lift_head, const bool reel_fwd);
-    bool _gear_return_sequence();
+    void _gear_start_func_sequence(const bool head_dir_is_a, const bool lift_head, const bool reel_fwd);
+    void _gear_start_return_sequence();
+    void _gear_start_sequence();
+    void _gear_begin_steps(const uint32_t now_us);
+    gear_seq_result_t _process_gear_sequence();
+    void _evaluate_motor_stable();
+    void _set_start_hold(const bool flag);
+    bool _is_start_held() const;
+    bool _release_start_hold(const uint32_t now_us);
+    bool _is_command_pending();
     bool _get_dir_is_a(const direction_t dir) const;
-    bool _stop(const direction_t dir);
-    bool _play(const direction_t dir);
-    bool _cue(const direction_t dir);
-    void _process_stop_command();
+    action_result_t _gear_action(const bool head_dir_is_a, const bool lift_head, const bool reel_fwd);
+    action_result_t _stop(const direction_t dir);
+    action_result_t _play(const direction_t dir);
+    action_result_t _cue(const direction_t dir);
+    void _push_command_history(const command_t& command);
+    bool _process_stop_command();
     virtual bool _on_rotation_stop();
-    virtual bool _process_filter(uint32_t now);
+    virtual bool _process_filter();
     virtual bool _process_set_eject_detection();
+    bool _process_warm_standby();
     virtual bool _process_timeout_power_off(uint32_t now);
     virtual bool _process_command();
+    virtual bool _execute_command(const command_t& command);
     virtual bool _process_callbacks();
+    virtual bool _has_pending_event();
 
     friend crp42602y_counter;
+    friend class crp42602y_multi_deck;
+    friend void crp42602y_ctrl_gpio_irq_handler();
 };
 
 class crp42602y_ctrl_with_counter : public crp42602y_ctrl {
@@ -367,8 +624,17 @@ class crp42602y_ctrl_with_counter : public crp42602y_ctrl {
      */
     virtual void process_loop();
 
+    /**
+     * get next deadline of process_loop()
+     * @copydoc crp42602y_ctrl::get_next_deadline
+     */
+    virtual absolute_time_t get_next_deadline() const;
+
     protected:
     bool _playing_for_wait_ff_rew_cue;
+    bool _exec_wait_for_counter;
+    bool _exec_head_dir_is_a;
+    bool _counter_updated;
 
     void (*_callbacks[__NUM_CALLBACK_TYPE_EXTEND__ - __NUM_CALLBACK_TYPE__])(const callback_type_t callback_type);
 
@@ -376,6 +642,7 @@ class crp42602y_ctrl_with_counter : public crp42602y_ctrl {
     bool _is_que_ready_for_counter(direction_t dir) const;
     virtual bool _on_rotation_stop();
     virtual bool _process_set_eject_detection();
-    virtual bool _process_command();
+    virtual bool _execute_command(const command_t& command);
     virtual bool _process_callbacks();
+    virtual bool _has_pending_event();
 };
\ No newline at end of file
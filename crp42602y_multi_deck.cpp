@@ -0,0 +1,232 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include "crp42602y_multi_deck.h"
+
+static inline uint32_t _millis()
+{
+    return to_ms_since_boot(get_absolute_time());
+}
+
+static inline uint32_t _get_diff_time(uint32_t prev, uint32_t now)
+{
+    uint32_t diff_time;
+    if (now < prev) {
+        diff_time = 0xffffffffUL - prev + now + 1;
+    } else {
+        diff_time = now - prev;
+    }
+    return diff_time;
+}
+
+crp42602y_multi_deck* crp42602y_multi_deck::_inst = nullptr;
+
+crp42602y_multi_deck::crp42602y_multi_deck(crp42602y_ctrl* const decks[], const uint num_decks) :
+    _decks{},
+    _num_decks((num_decks <= MAX_NUM_DECKS) ? num_decks : MAX_NUM_DECKS),
+    _deck_playing{},
+    _sync_active(false),
+    _sync_start_time(0),
+    _sync_skew_us(-1),
+    _relay_from(NO_DECK),
+    _relay_to(NO_DECK),
+    _callback(nullptr)
+{
+    // callback trampolines to identify the deck
+    static void (* const deck_callbacks[MAX_NUM_DECKS])(const crp42602y_ctrl::callback_type_t callback_type) = {
+        _deck_callback<0>, _deck_callback<1>, _deck_callback<2>, _deck_callback<3>
+    };
+    _inst = this;
+    queue_init(&_sync_queue, sizeof(command_t), SYNC_QUEUE_LENGTH);
+    for (uint i = 0; i < _num_decks; i++) {
+        _decks[i] = decks[i];
+        _decks[i]->register_callback_all(deck_callbacks[i]);
+    }
+}
+
+crp42602y_multi_deck::~crp42602y_multi_deck()
+{
+    for (uint i = 0; i < _num_decks; i++) {
+        _decks[i]->register_callback_all(nullptr);
+    }
+    queue_free(&_sync_queue);
+    _inst = nullptr;
+}
+
+uint crp42602y_multi_deck::get_num_decks() const
+{
+    return _num_decks;
+}
+
+crp42602y_ctrl* crp42602y_multi_deck::get_deck(const uint deck) const
+{
+    return (deck < _num_decks) ? _decks[deck] : nullptr;
+}
+
+bool crp42602y_multi_deck::send_command(const uint deck, const command_t& command)
+{
+    if (deck >= _num_decks) return false;
+    return _decks[deck]->send_command(command);
+}
+
+bool crp42602y_multi_deck::send_command_sync(const command_t& command)
+{
+    return queue_try_add(&_sync_queue, &command);
+}
+
+bool crp42602y_multi_deck::is_sync_pending() const
+{
+    return _sync_active;
+}
+
+int32_t crp42602y_multi_deck::get_sync_skew_us() const
+{
+    return _sync_skew_us;
+}
+
+void crp42602y_multi_deck::set_relay(const uint from_deck, const uint to_deck)
+{
+    if (from_deck >= _num_decks || to_deck >= _num_decks || from_deck == to_deck) return;
+    _relay_to = to_deck;
+    _relay_from = from_deck;
+}
+
+void crp42602y_multi_deck::clear_relay()
+{
+    _relay_from = NO_DECK;
+    _relay_to = NO_DECK;
+}
+
+void crp42602y_multi_deck::register_callback_all(void (*func)(const uint deck, const crp42602y_ctrl::callback_type_t callback_type))
+{
+    _callback = func;
+}
+
+void crp42602y_multi_deck::process_loop()
+{
+    _process_sync_command();
+    for (uint i = 0; i < _num_decks; i++) {
+        _decks[i]->process_loop();
+    }
+    _process_sync_release();
+}
+
+absolute_time_t crp42602y_multi_deck::get_next_deadline() const
+{
+    absolute_time_t deadline = at_the_end_of_time;
+    for (uint i = 0; i < _num_decks; i++) {
+        deadline = absolute_time_min(deadline, _decks[i]->get_next_deadline());
+    }
+    if (_sync_active) {
+        uint32_t elapsed_ms = _get_diff_time(_sync_start_time, _millis());
+        uint32_t remaining_ms = (elapsed_ms < SYNC_TIMEOUT_MS) ? SYNC_TIMEOUT_MS - elapsed_ms : 0;
+        deadline = absolute_time_min(deadline, make_timeout_time_ms(remaining_ms));
+    }
+    return deadline;
+}
+
+bool crp42602y_multi_deck::wait_for_event(const absolute_time_t limit)
+{
+    if (!queue_is_empty(&_sync_queue)) return true;
+    for (uint i = 0; i < _num_decks; i++) {
+        if (_decks[i]->_has_pending_event()) return true;
+    }
+    return crp42602y_ctrl::_wait_until(absolute_time_min(get_next_deadline(), limit));
+}
+
+template <uint N>
+void crp42602y_multi_deck::_deck_callback(const crp42602y_ctrl::callback_type_t callback_type)
+{
+    if (_inst != nullptr) {
+        _inst->_on_deck_callback(N, callback_type);
+    }
+}
+
+void crp42602y_multi_deck::_on_deck_callback(const uint deck, const crp42602y_ctrl::callback_type_t callback_type)
+{
+    switch (callback_type) {
+    case crp42602y_ctrl::ON_PLAY:  // fallthrough
+    case crp42602y_ctrl::ON_REVERSE:
+        _deck_playing[deck] = true;
+        break;
+    case crp42602y_ctrl::ON_STOP:  // fallthrough
+    case crp42602y_ctrl::ON_CUE:  // fallthrough
+    case crp42602y_ctrl::ON_FF_REW:
+        _deck_playing[deck] = false;
+        break;
+    case crp42602y_ctrl::ON_END_OF_TAPE:
+        // ON_END_OF_TAPE comes before ON_STOP, therefore _deck_playing still shows the status before stop
+        if (deck == _relay_from && _relay_to < _num_decks && _deck_playing[deck]) {
+            _prepare_deck(_relay_to);
+            _decks[_relay_to]->send_command(crp42602y_ctrl::PLAY_COMMAND);
+        }
+        break;
+    default:
+        break;
+    }
+    if (_callback != nullptr) {
+        _callback(deck, callback_type);
+    }
+}
+
+void crp42602y_multi_deck::_prepare_deck(const uint deck)
+{
+    // recover power in advance (the STOP command issued by the recovery doesn't cancel the command to be sent next)
+    _decks[deck]->recover_power_from_timeout();
+}
+
+void crp42602y_multi_deck::_process_sync_command()
+{
+    if (_sync_active || queue_is_empty(&_sync_queue)) return;
+    command_t command;
+    queue_remove_blocking(&_sync_queue, &command);
+    for (uint i = 0; i < _num_decks; i++) {
+        _prepare_deck(i);
+        _decks[i]->_set_start_hold(true);
+        _decks[i]->send_command(command);
+    }
+    _sync_start_time = _millis();
+    _sync_active = true;
+}
+
+void crp42602y_multi_deck::_process_sync_release()
+{
+    if (!_sync_active) return;
+
+    // ready when every deck is either held at the start of function gear sequence or has nothing to do
+    bool ready = true;
+    for (uint i = 0; i < _num_decks; i++) {
+        if (!_decks[i]->_is_start_held() && _decks[i]->_is_command_pending()) {
+            ready = false;
+            break;
+        }
+    }
+    if (!ready && _get_diff_time(_sync_start_time, _millis()) < SYNC_TIMEOUT_MS) return;
+
+    // release all the decks with common start time
+    uint32_t now_us = time_us_32();
+    for (uint i = 0; i < _num_decks; i++) {
+        _decks[i]->_release_start_hold(now_us);
+    }
+    // measure the skew of actual solenoid drive
+    bool measured = false;
+    uint32_t first_us = 0;
+    uint32_t skew_us = 0;
+    for (uint i = 0; i < _num_decks; i++) {
+        if (_decks[i]->_gear_seq_state != crp42602y_ctrl::GEAR_SEQ_STEP || _decks[i]->_gear_start_time_us != now_us) continue;
+        uint32_t drive_us = _decks[i]->_gear_drive_time_us;
+        if (!measured) {
+            first_us = drive_us;
+            measured = true;
+        } else if (drive_us - first_us > skew_us && drive_us - first_us < 0x80000000UL) {
+            skew_us = drive_us - first_us;
+        }
+    }
+    if (measured) {
+        _sync_skew_us = (int32_t) skew_us;
+    }
+    _sync_active = false;
+}
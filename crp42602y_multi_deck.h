@@ -0,0 +1,163 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico/stdlib.h"
+#include "pico/util/queue.h"
+
+#include "crp42602y_ctrl.h"
+
+// Multi-deck coordinator
+//   processes several crp42602y_ctrl instances in one control loop
+//   Synchronized command: function gear sequences of all the decks are held until every deck is ready to start,
+//                         then released at once (for dubbing)
+//   Relay play:           play of the next deck is issued when the previous deck stops at the end of tape
+//   Callbacks:            callbacks from all the decks are routed to a single function with deck number
+
+class crp42602y_multi_deck {
+    protected:
+    // Definitions
+    typedef crp42602y_ctrl::command_t command_t;
+
+    // Constants
+    static constexpr uint     SYNC_QUEUE_LENGTH = 2;
+    static constexpr uint32_t SYNC_TIMEOUT_MS = 3000;
+
+    public:
+    /**
+     * Constants
+     */
+    static constexpr uint MAX_NUM_DECKS = 4;
+    static constexpr uint NO_DECK = MAX_NUM_DECKS;
+
+    /**
+     * crp42602y_multi_deck class constructor
+     *   only single instance is supported because of callback routing
+     *
+     * @param[in] decks array of crp42602y_ctrl instances
+     * @param[in] num_decks number of decks (up to MAX_NUM_DECKS)
+     */
+    crp42602y_multi_deck(crp42602y_ctrl* const decks[], const uint num_decks);
+
+    /**
+     * crp42602y_multi_deck class destructor
+     */
+    virtual ~crp42602y_multi_deck();
+
+    /**
+     * get number of decks
+     *
+     * @return number of decks
+     */
+    uint get_num_decks() const;
+
+    /**
+     * get deck instance
+     *
+     * @param[in] deck deck number
+     * @return crp42602y_ctrl instance (nullptr if deck is out of range)
+     */
+    crp42602y_ctrl* get_deck(const uint deck) const;
+
+    /**
+     * send command to a deck
+     *
+     * @param[in] deck deck number
+     * @param[in] command command (see crp42602y_ctrl command constants)
+     * @return true if command is accepted
+     */
+    bool send_command(const uint deck, const command_t& command);
+
+    /**
+     * send command to all the decks with synchronized start
+     *   function gear sequence of each deck is held until all the decks get ready,
+     *   then all the sequences are started at once
+     *
+     * @param[in] command command (see crp42602y_ctrl command constants)
+     * @return true if command is accepted
+     */
+    bool send_command_sync(const command_t& command);
+
+    /**
+     * get is synchronized command in progress
+     *
+     * @return true if synchronized command has not been released yet
+     */
+    bool is_sync_pending() const;
+
+    /**
+     * get start skew of the last synchronized command
+     *
+     * @return maximum difference of gear sequence start time among decks in microseconds (-1 if not measured yet)
+     */
+    int32_t get_sync_skew_us() const;
+
+    /**
+     * set relay play
+     *   from_deck stopping at the end of tape during play starts play of to_deck
+     *
+     * @param[in] from_deck deck number to watch
+     * @param[in] to_deck deck number to start play
+     */
+    void set_relay(const uint from_deck, const uint to_deck);
+
+    /**
+     * clear relay play
+     */
+    void clear_relay();
+
+    /**
+     * register callback for all the decks
+     *
+     * @param[in] func callback function pointer (deck: deck number which the callback comes from)
+     */
+    void register_callback_all(void (*func)(const uint deck, const crp42602y_ctrl::callback_type_t callback_type));
+
+    /**
+     * process loop
+     *   call this function from upper program repeatedly instead of process_loop() of each deck
+     */
+    void process_loop();
+
+    /**
+     * get next deadline of process_loop()
+     *   the earliest deadline among the decks and the timeout of synchronized command
+     *
+     * @return absolute time of the next deadline
+     */
+    absolute_time_t get_next_deadline() const;
+
+    /**
+     * wait for event
+     *   sleep the core by WFE until the next deadline or any event of the decks (see crp42602y_ctrl::wait_for_event())
+     *   call this function after process_loop() only from the core running process_loop()
+     *
+     * @param[in] limit time to return at the latest (for other tasks on the same core)
+     * @return true if woken up before the deadline
+     */
+    bool wait_for_event(const absolute_time_t limit = at_the_end_of_time);
+
+    protected:
+    static crp42602y_multi_deck* _inst;
+    crp42602y_ctrl* _decks[MAX_NUM_DECKS];
+    const uint _num_decks;
+    bool _deck_playing[MAX_NUM_DECKS];
+    bool _sync_active;
+    uint32_t _sync_start_time;
+    int32_t _sync_skew_us;
+    uint _relay_from;
+    uint _relay_to;
+    void (*_callback)(const uint deck, const crp42602y_ctrl::callback_type_t callback_type);
+    queue_t _sync_queue;
+
+    template <uint N>
+    static void _deck_callback(const crp42602y_ctrl::callback_type_t callback_type);
+    void _on_deck_callback(const uint deck, const crp42602y_ctrl::callback_type_t callback_type);
+    void _prepare_deck(const uint deck);
+    void _process_sync_command();
+    void _process_sync_release();
+};
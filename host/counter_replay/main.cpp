@@ -0,0 +1,87 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+// Replay a counter trace through crp42602y_counter
+//   the counter is detached from crp42602y_ctrl and its PIO, then the recorded inputs are fed in the recorded order
+//   so that the same code path as process_loop() computes the counter values
+
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "crp42602y_replay.h"
+
+static void _usage(const char* name)
+{
+    fprintf(stderr, "usage: %s [-v] [-d] [-e max_error_sec] trace.bin\n", name);
+    fprintf(stderr, "  -v  print the counter at each ground truth record\n");
+    fprintf(stderr, "  -d  print the debug log of the counter algorithm\n");
+    fprintf(stderr, "  -e  exit with 1 if the counter error exceeds max_error_sec\n");
+}
+
+static void _print_log(const char* fmt, va_list args)
+{
+    vprintf(fmt, args);
+}
+
+int main(int argc, char* argv[])
+{
+    bool verbose = false;
+    bool debug_log = false;
+    float max_error_limit = NAN;
+    const char* filename = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            verbose = true;
+        } else if (strcmp(argv[i], "-d") == 0) {
+            debug_log = true;
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc) {
+            max_error_limit = atof(argv[++i]);
+        } else if (filename == nullptr) {
+            filename = argv[i];
+        } else {
+            _usage(argv[0]);
+            return 2;
+        }
+    }
+    if (filename == nullptr) {
+        _usage(argv[0]);
+        return 2;
+    }
+    std::vector<trace_record_t> records;
+    std::string error;
+    if (!load_trace(filename, records, error)) {
+        fprintf(stderr, "ERROR: %s\n", error.c_str());
+        return 2;
+    }
+
+    replay_result_t result = replay_trace(records, crp42602y_counter::DEFAULT_CONFIG,
+        [verbose](const float truth_sec, const counter_snapshot_t& snapshot) {
+            if (!verbose) return;
+            printf("truth %8.2f sec, counter %8.2f sec, error %+6.2f sec, thickness %4.1f um, state %d\n",
+                truth_sec, snapshot.playing_sec[0], snapshot.playing_sec[0] - truth_sec, snapshot.tape_thickness_um, snapshot.state);
+        }, debug_log ? _print_log : nullptr);
+
+    printf("records: %u (rotation %u, transport %u, truth %u)\n", result.num_records, result.num_rotations, result.num_transports, result.num_truths);
+    printf("final counter: A %8.2f sec, B %8.2f sec, thickness %4.1f um, state %d\n",
+        result.snapshot.playing_sec[0], result.snapshot.playing_sec[1], result.snapshot.tape_thickness_um, result.snapshot.state);
+    if (result.num_compared > 0) {
+        printf("counter error: max %5.2f sec, final %+5.2f sec (%u points)\n", result.max_error_sec, result.last_error_sec, result.num_compared);
+    } else {
+        printf("counter error: no ground truth\n");
+    }
+    printf("time to FULL_READY: %.1f sec of transport\n", result.full_ready_sec);
+    if (result.num_rotations > 0) {
+        printf("compute cost per rotation event (host): mean %.0f ns, max %.0f ns\n", result.total_ns / result.num_rotations, result.max_ns);
+    }
+    if (!std::isnan(max_error_limit) && result.num_compared > 0 && result.max_error_sec > max_error_limit) {
+        printf("FAILED: counter error exceeds %.2f sec\n", max_error_limit);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,243 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+// Parameter sweep of counter_config_t over recorded counter traces
+//   every combination of the given parameter values is replayed on all traces by worker threads,
+//   then the configurations are ranked by the counter error and the time to FULL_READY
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "crp42602y_replay.h"
+
+// transport time added as penalty for each trace not reaching FULL_READY
+static constexpr float NOT_READY_PENALTY_SEC = 600.0f;
+
+typedef struct _param_t {
+    const char* name;
+    const char* desc;
+    void (*set)(counter_config_t& config, double value);
+    double (*get)(const counter_config_t& config);
+} param_t;
+
+#define PARAM_U32(field, desc) \
+    {#field, desc, \
+     [](counter_config_t& c, double v) { c.field = (uint32_t) v; }, \
+     [](const counter_config_t& c) { return (double) c.field; }}
+#define PARAM_FLOAT(name, field, desc) \
+    {name, desc, \
+     [](counter_config_t& c, double v) { c.field = (float) v; }, \
+     [](const counter_config_t& c) { return (double) c.field; }}
+
+static const param_t PARAMS[] = {
+    PARAM_FLOAT("rotation_gear_ratio", rotation_gear_ratio, "rotations of sensor obstacle per hub rotation"),
+    PARAM_U32(additional_us, "added to each measured interval"),
+    PARAM_U32(num_to_average, "window to average hub radius"),
+    PARAM_U32(ref_count, "count to take reference hub radius"),
+    PARAM_U32(thickness_count, "count to start thickness measurement"),
+    PARAM_U32(thickness_interval, "interval count of thickness measurement"),
+    PARAM_U32(update_count, "count to start periodic thickness update"),
+    PARAM_U32(update_interval, "interval count of periodic thickness update"),
+    PARAM_FLOAT("th0", thickness_threshold_um[0], "thickness boundary 6/9 um"),
+    PARAM_FLOAT("th1", thickness_threshold_um[1], "thickness boundary 9/12 um"),
+    PARAM_FLOAT("th2", thickness_threshold_um[2], "thickness boundary 12/18 um"),
+};
+static constexpr size_t NUM_PARAMS = sizeof(PARAMS) / sizeof(PARAMS[0]);
+
+typedef struct _trace_t {
+    std::string filename;
+    std::vector<trace_record_t> records;
+} trace_t;
+
+typedef struct _score_t {
+    float mean_max_error_sec;  // mean of max counter error over traces with ground truth
+    float mean_ready_sec;      // mean of transport time to FULL_READY (with penalty)
+    uint32_t num_not_ready;
+    double ns_per_rotation;
+} score_t;
+
+static const param_t* _find_param(const char* name)
+{
+    for (const auto& param : PARAMS) {
+        if (strcmp(param.name, name) == 0) return &param;
+    }
+    return nullptr;
+}
+
+static void _usage(const char* name)
+{
+    fprintf(stderr, "usage: %s [-j threads] [-n top] [-p name=v1,v2,...]... trace.bin...\n", name);
+    fprintf(stderr, "  -j  number of worker threads (default: number of hardware threads)\n");
+    fprintf(stderr, "  -n  number of configurations to print (default: 10)\n");
+    fprintf(stderr, "  -p  values to sweep for the parameter (default: DEFAULT_CONFIG only)\n");
+    fprintf(stderr, "parameters:\n");
+    for (const auto& param : PARAMS) {
+        fprintf(stderr, "  %-20s %s (default: %g)\n", param.name, param.desc, param.get(crp42602y_counter::DEFAULT_CONFIG));
+    }
+}
+
+static score_t _evaluate(const std::vector<trace_t>& traces, const counter_config_t& config)
+{
+    score_t score = {};
+    uint32_t num_error = 0;
+    uint32_t num_rotations = 0;
+    double total_ns = 0.0;
+    for (const auto& trace : traces) {
+        replay_result_t result = replay_trace(trace.records, config);
+        if (result.num_compared > 0) {
+            score.mean_max_error_sec += result.max_error_sec;
+            num_error++;
+        }
+        if (std::isnan(result.full_ready_sec)) {
+            score.mean_ready_sec += NOT_READY_PENALTY_SEC;
+            score.num_not_ready++;
+        } else {
+            score.mean_ready_sec += result.full_ready_sec;
+        }
+        num_rotations += result.num_rotations;
+        total_ns += result.total_ns;
+    }
+    score.mean_max_error_sec = (num_error > 0) ? score.mean_max_error_sec / num_error : NAN;
+    score.mean_ready_sec /= traces.size();
+    score.ns_per_rotation = (num_rotations > 0) ? total_ns / num_rotations : 0.0;
+    return score;
+}
+
+static bool _is_better(const score_t& a, const score_t& b)
+{
+    // NAN error (no ground truth) is ranked by the time to FULL_READY only
+    if (!std::isnan(a.mean_max_error_sec) && !std::isnan(b.mean_max_error_sec) && a.mean_max_error_sec != b.mean_max_error_sec) {
+        return a.mean_max_error_sec < b.mean_max_error_sec;
+    }
+    return a.mean_ready_sec < b.mean_ready_sec;
+}
+
+static void _print_config(const counter_config_t& config, const std::vector<size_t>& swept)
+{
+    for (size_t i : swept) {
+        printf(" %s=%g", PARAMS[i].name, PARAMS[i].get(config));
+    }
+}
+
+static void _print_score(const score_t& score)
+{
+    printf("error %6.2f sec, ready %7.1f sec", score.mean_max_error_sec, score.mean_ready_sec);
+    if (score.num_not_ready > 0) printf(" (%u not ready)", score.num_not_ready);
+}
+
+int main(int argc, char* argv[])
+{
+    unsigned int num_threads = std::thread::hardware_concurrency();
+    size_t num_top = 10;
+    std::vector<std::vector<double>> values(NUM_PARAMS);
+    std::vector<size_t> swept;
+    std::vector<trace_t> traces;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            num_threads = (unsigned int) atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            num_top = (size_t) atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            std::string arg = argv[++i];
+            size_t eq = arg.find('=');
+            const param_t* param = (eq != std::string::npos) ? _find_param(arg.substr(0, eq).c_str()) : nullptr;
+            if (param == nullptr) {
+                fprintf(stderr, "ERROR: unknown parameter: %s\n", arg.c_str());
+                _usage(argv[0]);
+                return 2;
+            }
+            size_t index = param - PARAMS;
+            const char* p = arg.c_str() + eq + 1;
+            while (*p != '\0') {
+                char* end;
+                values[index].push_back(strtod(p, &end));
+                if (end == p) {
+                    fprintf(stderr, "ERROR: illegal value: %s\n", arg.c_str());
+                    return 2;
+                }
+                p = (*end == ',') ? end + 1 : end;
+            }
+            if (std::find(swept.begin(), swept.end(), index) == swept.end()) swept.push_back(index);
+        } else if (argv[i][0] == '-') {
+            _usage(argv[0]);
+            return 2;
+        } else {
+            trace_t trace = {argv[i], {}};
+            std::string error;
+            if (!load_trace(trace.filename, trace.records, error)) {
+                fprintf(stderr, "ERROR: %s\n", error.c_str());
+                return 2;
+            }
+            traces.push_back(std::move(trace));
+        }
+    }
+    if (traces.empty()) {
+        _usage(argv[0]);
+        return 2;
+    }
+    if (num_threads == 0) num_threads = 1;
+
+    // Cartesian product of the swept values on top of DEFAULT_CONFIG
+    std::vector<counter_config_t> configs(1, crp42602y_counter::DEFAULT_CONFIG);
+    for (size_t i : swept) {
+        std::vector<counter_config_t> expanded;
+        for (const auto& config : configs) {
+            for (double value : values[i]) {
+                counter_config_t c = config;
+                PARAMS[i].set(c, value);
+                expanded.push_back(c);
+            }
+        }
+        configs.swap(expanded);
+    }
+    num_threads = std::min<size_t>(num_threads, configs.size());
+    printf("%zu traces, %zu configurations, %u threads\n", traces.size(), configs.size(), num_threads);
+
+    // each worker takes the next configuration and replays it with its own counter instances
+    //   traces are shared read-only, each score is written by only one worker
+    std::vector<score_t> scores(configs.size());
+    std::atomic<size_t> next_index(0);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < num_threads; t++) {
+        workers.emplace_back([&]() {
+            size_t index;
+            while ((index = next_index.fetch_add(1)) < configs.size()) {
+                scores[index] = _evaluate(traces, configs[index]);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    double elapsed_sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<size_t> order(configs.size());
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return _is_better(scores[a], scores[b]); });
+
+    for (size_t rank = 0; rank < std::min(num_top, order.size()); rank++) {
+        size_t i = order[rank];
+        printf("#%-3zu ", rank + 1);
+        _print_score(scores[i]);
+        printf(" :");
+        _print_config(configs[i], swept);
+        printf("\n");
+    }
+    score_t score = _evaluate(traces, crp42602y_counter::DEFAULT_CONFIG);
+    printf("default ");
+    _print_score(score);
+    printf("\n");
+    printf("elapsed %.2f sec (%.0f ns per rotation event)\n", elapsed_sec, score.ns_per_rotation);
+    return 0;
+}
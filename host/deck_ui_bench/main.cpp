@@ -0,0 +1,264 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+// Render the UI of single_pb_deck (deck_ui) for each UI state against SSD1306 framebuffer emulator
+//   reports render time, show time and bytes on I2C bus per frame,
+//   dumps the panel image of each state as PBM or compares it with the golden images
+//   exit code is non-zero if the panel differs from the framebuffer after show() or from the golden images
+//   usage: deck_ui_bench [-n num_loops] [-f] [-d dump_dir] [-c golden_dir]
+//     -f: full refresh of ssd1306_canvas
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+#include "pico_host.h"
+#include "ssd1306_emu.h"
+#include "deck_ui.h"
+
+static constexpr uint32_t NUM_FRAMES = 64;  // frames per state at DISP_INTERVAL_MS of single_pb_deck (4 cycles of play arrow)
+static constexpr float FRAME_SEC = 0.05;
+
+typedef struct _ui_state_t {
+    const char* name;
+    void (*enter)(deck_ui& ui);                       // contents changed at the entry (callbacks and buttons)
+    void (*frame)(deck_ui& ui, const uint32_t frame);  // periodic display
+} ui_state_t;
+
+static void _default_settings(deck_ui& ui)
+{
+    ui.draw_reverse_mode(crp42602y_ctrl::RVS_ONE_WAY);
+    ui.draw_eq(eq_nr::EQ_120US);
+    ui.draw_nr(eq_nr::NR_OFF);
+}
+
+static const ui_state_t UI_STATES[] = {
+    {
+        "no_cassette",
+        [](deck_ui& ui) {
+            ui.clear();
+            ui.draw_default(false, true);
+            _default_settings(ui);
+        },
+        [](deck_ui& ui, const uint32_t frame) {
+            ui.draw_image(deck_ui::IMAGE_NO_CASSETTE);
+            ui.draw_counter(false, true, 0);
+            ui.draw_bluetooth(false);
+        }
+    },
+    {
+        "stop",
+        [](deck_ui& ui) {
+            ui.draw_default(true, true);
+        },
+        [](deck_ui& ui, const uint32_t frame) {
+            ui.draw_image(deck_ui::IMAGE_STOP, true);
+            ui.draw_counter(true, true, 0);
+            ui.draw_bluetooth(false);
+        }
+    },
+    {
+        "play_a",
+        [](deck_ui& ui) {
+            ui.draw_mode(deck_ui::MODE_PLAY_A);
+        },
+        [](deck_ui& ui, const uint32_t frame) {
+            ui.draw_image(deck_ui::IMAGE_PLAY, true, frame / 4 % deck_ui::NUM_POSITIONS);
+            ui.draw_counter(true, true, 600 + frame * FRAME_SEC);
+            ui.draw_bluetooth(false);
+        }
+    },
+    {
+        "play_b_bt",
+        [](deck_ui& ui) {
+            ui.draw_mode(deck_ui::MODE_PLAY_B);
+        },
+        [](deck_ui& ui, const uint32_t frame) {
+            ui.draw_image(deck_ui::IMAGE_PLAY, false, frame / 4 % deck_ui::NUM_POSITIONS);
+            ui.draw_counter(true, true, 1200 + frame * FRAME_SEC);
+            ui.draw_bluetooth(frame % 8 < 4);  // blink at connect request
+        }
+    },
+    {
+        "ff",
+        [](deck_ui& ui) {
+            ui.draw_mode(deck_ui::MODE_FF);
+        },
+        [](deck_ui& ui, const uint32_t frame) {
+            ui.draw_image(deck_ui::IMAGE_CUE, true, frame % deck_ui::NUM_POSITIONS);
+            ui.draw_counter(true, true, 1200 + frame * 1.0);
+            ui.draw_bluetooth(true);
+        }
+    },
+    {
+        "rew_cue",
+        [](deck_ui& ui) {
+            ui.draw_mode(deck_ui::MODE_REW_CUE);
+        },
+        [](deck_ui& ui, const uint32_t frame) {
+            ui.draw_image(deck_ui::IMAGE_CUE, false, frame % deck_ui::NUM_POSITIONS);
+            ui.draw_counter(true, frame % 20 > 2, 1264 - frame * 0.5);  // blink during estimation
+            ui.draw_bluetooth(true);
+        }
+    },
+    {
+        "settings",
+        [](deck_ui& ui) {
+            ui.draw_mode(deck_ui::MODE_STOP);
+        },
+        [](deck_ui& ui, const uint32_t frame) {
+            ui.draw_image(deck_ui::IMAGE_STOP, false);
+            ui.draw_counter(true, true, -5);
+            ui.draw_bluetooth(true);
+            // a setting changed by button at every 4 frames
+            if (frame % 4 == 0) {
+                uint32_t n = frame / 4 + 1;
+                ui.draw_reverse_mode((crp42602y_ctrl::reverse_mode_t) (n % crp42602y_ctrl::__NUM_RVS_MODES__));
+                ui.draw_eq((eq_nr::eq_type_t) (n % eq_nr::__NUM_EQ_TYPES__));
+                ui.draw_nr((eq_nr::nr_type_t) (n % eq_nr::__NUM_NR_TYPES__));
+            }
+        }
+    },
+    {
+        "setting_saved",
+        [](deck_ui& ui) {
+        },
+        [](deck_ui& ui, const uint32_t frame) {
+            ui.draw_image(deck_ui::IMAGE_SETTING_SAVED);
+            ui.draw_counter(true, true, -5);
+            ui.draw_bluetooth(true);
+        }
+    },
+    {
+        "play_meter",
+        [](deck_ui& ui) {
+            ui.draw_mode(deck_ui::MODE_PLAY_A);
+        },
+        [](deck_ui& ui, const uint32_t frame) {
+            // levels of level_meter: RMS moving in every frame, the peak held
+            const int32_t rms_db10[2] = {-120 - (int32_t) (frame % 16) * 15, -240 + (int32_t) (frame % 8) * 15};
+            const int32_t peak_db10[2] = {-60, -150};
+            ui.draw_image(deck_ui::IMAGE_PLAY, true, frame / 4 % deck_ui::NUM_POSITIONS);
+            ui.draw_counter(true, true, 600 + frame * FRAME_SEC);
+            ui.draw_bluetooth(false);
+            ui.draw_level_meter(rms_db10, peak_db10);
+        }
+    }
+};
+static constexpr size_t NUM_UI_STATES = sizeof(UI_STATES) / sizeof(ui_state_t);
+
+typedef struct _result_t {
+    uint32_t frames;
+    double render_ns;
+    double show_ns;
+    uint64_t bytes;
+} result_t;
+
+template <typename F>
+static double _elapsed_ns(F func)
+{
+    auto start = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t num_loops = 100;
+    bool full_refresh = false;
+    const char* dump_dir = nullptr;
+    const char* golden_dir = nullptr;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:fd:c:")) != -1) {
+        switch (opt) {
+        case 'n':
+            num_loops = strtoul(optarg, nullptr, 0);
+            break;
+        case 'f':
+            full_refresh = true;
+            break;
+        case 'd':
+            dump_dir = optarg;
+            break;
+        case 'c':
+            golden_dir = optarg;
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n num_loops] [-f] [-d dump_dir] [-c golden_dir]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (num_loops == 0) num_loops = 1;
+
+    pico_host::reset();
+    ssd1306_emu emu(i2c0, 0x3c, 64);
+    ssd1306_t disp = {};
+    disp.external_vcc = false;
+    ssd1306_init(&disp, 128, 64, 0x3c, i2c0);
+    ssd1306_canvas canvas(&disp);  // no DMA on the host, blocking I2C writes go to the emulator
+    canvas.set_full_refresh(full_refresh);
+    deck_ui ui(&canvas);
+
+    int num_failures = 0;
+    result_t results[NUM_UI_STATES] = {};
+    for (uint32_t loop = 0; loop < num_loops; loop++) {
+        for (size_t i = 0; i < NUM_UI_STATES; i++) {
+            const ui_state_t& state = UI_STATES[i];
+            result_t& result = results[i];
+            // the entry is shown by itself as the callbacks do
+            state.enter(ui);
+            canvas.show();
+            for (uint32_t frame = 0; frame < NUM_FRAMES; frame++) {
+                result.render_ns += _elapsed_ns([&]() { state.frame(ui, frame); });
+                uint32_t bytes = 0;
+                result.show_ns += _elapsed_ns([&]() { bytes = canvas.show(); });
+                result.bytes += bytes;
+                result.frames++;
+                if (loop > 0) continue;
+                // the panel must be the same as the framebuffer after each show
+                if (memcmp(emu.get_gddram(), disp.buffer, disp.bufsize) != 0) {
+                    printf("ERROR: %s frame %u: panel differs from framebuffer\n", state.name, frame);
+                    num_failures++;
+                }
+                if (frame != 0) continue;
+                std::string filename = std::string(state.name) + ".pbm";
+                if (dump_dir != nullptr && !emu.write_pbm((std::string(dump_dir) + "/" + filename).c_str())) {
+                    printf("ERROR: failed to write %s/%s\n", dump_dir, filename.c_str());
+                    num_failures++;
+                }
+                if (golden_dir != nullptr) {
+                    int num_diffs = emu.compare_pbm((std::string(golden_dir) + "/" + filename).c_str());
+                    if (num_diffs != 0) {
+                        if (num_diffs < 0) {
+                            printf("ERROR: %s: failed to read %s/%s\n", state.name, golden_dir, filename.c_str());
+                        } else {
+                            printf("ERROR: %s: %d pixels differ from %s/%s\n", state.name, num_diffs, golden_dir, filename.c_str());
+                        }
+                        num_failures++;
+                    }
+                }
+            }
+        }
+    }
+
+    printf("Deck UI per frame (%s, %u frames x %u loops per state)\n", full_refresh ? "full refresh" : "dirty columns", NUM_FRAMES, num_loops);
+    printf("  %-14s %10s %10s %12s\n", "state", "render ns", "show ns", "bytes/frame");
+    for (size_t i = 0; i < NUM_UI_STATES; i++) {
+        const result_t& result = results[i];
+        printf("  %-14s %10.1f %10.1f %12.1f\n", UI_STATES[i].name,
+            result.render_ns / result.frames, result.show_ns / result.frames, (double) result.bytes / result.frames);
+    }
+    if (golden_dir != nullptr) {
+        printf("Golden images: %s\n", (num_failures == 0) ? "PASS" : "FAIL");
+    }
+
+    ssd1306_deinit(&disp);
+    return (num_failures > 0) ? 1 : 0;
+}
@@ -0,0 +1,437 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+// Replay pulse timings of IR remote controls through the PIO models of ir_remote in virtual time
+//   decode: NEC (standard and extended) and RC-5 (with RC-5X) frames with the jitter of IR receiver and noise spikes
+//           between the frames, both state machines receive all the frames, compared with the keys sent
+//   hold:   FF key held in play cues while held (repeat codes) and returns to play at the release,
+//           RC-5 STOP, crp42602y_ctrl_with_counter runs against crp42602y_sim beside the programs
+//   alloc:  two receivers share the programs on PIO1, the programs stay loaded until the last receiver is deleted
+//   -f:     recorded pulse timings (LIRC mode2 text: "pulse N" / "space N" in us) are decoded and printed
+//   exit code is non-zero if any check fails
+//   usage: ir_replay [-f mode2.txt] [-j jitter_us] [-n num_frames] [-s seed]
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+#include "pico_host.h"
+#include "crp42602y_ctrl.h"
+#include "crp42602y_sim.h"
+#include "ir_remote.h"
+
+// CRP42602Y control pins (the same as samples)
+static constexpr uint PIN_SOLENOID_CTRL   = 2;
+static constexpr uint PIN_CASSETTE_DETECT = 3;
+static constexpr uint PIN_GEAR_STATUS_SW  = 4;
+static constexpr uint PIN_ROTATION_SENS   = 5;
+static constexpr uint PIN_POWER_CTRL      = 6;
+static constexpr uint PIN_IR_RECEIVER     = 17;
+static constexpr uint PIN_IR_RECEIVER2    = 18;  // alloc check
+
+static constexpr uint64_t LOOP_INTERVAL_US = 1000;  // UI loop of the samples
+static constexpr uint32_t NEC_UNIT_US = 562;
+static constexpr uint32_t RC5_HALF_BIT_US = 889;
+static constexpr uint32_t NEC_REPEAT_PERIOD_US = 108000;
+static constexpr uint32_t RC5_REPEAT_PERIOD_US = 113778;
+
+// keymap of the hold check
+static constexpr uint16_t NEC_ADDRESS = 0x04;
+static constexpr uint8_t NEC_PLAY = 0x10;
+static constexpr uint8_t NEC_FF = 0x11;
+static constexpr uint16_t RC5_ADDRESS = 0x05;
+static constexpr uint8_t RC5_STOP = 0x36;
+static const ir_remote::keymap_entry_t KEYMAP[] = {
+    {ir_decoder::PROTOCOL_NEC, NEC_ADDRESS, NEC_PLAY, ir_remote::ACT_PLAY},
+    {ir_decoder::PROTOCOL_NEC, NEC_ADDRESS, NEC_FF,   ir_remote::ACT_FF},
+    {ir_decoder::PROTOCOL_RC5, RC5_ADDRESS, RC5_STOP, ir_remote::ACT_STOP},
+};
+
+// segment of the receiver output: low during the burst
+typedef struct _segment_t {
+    bool burst;
+    uint32_t us;
+} segment_t;
+typedef std::vector<segment_t> pulses_t;
+
+typedef struct _edge_t {
+    uint64_t time_us;
+    bool level;
+} edge_t;
+
+static std::deque<edge_t> _edges;
+static std::vector<ir_decoder::key_event_t> _events;
+static std::mt19937 _rng(1);
+static uint32_t _jitter_us = 100;
+static int _num_failures = 0;
+
+static void _check(const char* name, const bool pass)
+{
+    printf("  %s: %s\n", name, pass ? "PASS" : "FAIL");
+    if (!pass) _num_failures++;
+}
+
+static const char* _type_name(const ir_decoder::event_type_t type)
+{
+    static const char* const names[] = {"PRESS", "REPEAT", "RELEASE"};
+    return names[type];
+}
+
+static void _on_key(const ir_decoder::key_event_t& event, const ir_remote::action_t action)
+{
+    _events.push_back(event);
+}
+
+static void _print_key(const ir_decoder::key_event_t& event, const ir_remote::action_t action)
+{
+    printf("  %8.3f sec: %-4s %-7s address 0x%04x command 0x%02x hold %lu ms (action %d)\n", pico_host::now_us() / 1e6,
+        (event.protocol == ir_decoder::PROTOCOL_NEC) ? "NEC" : "RC-5", _type_name(event.type), event.address, event.command,
+        (unsigned long) event.hold_ms, (int) action);
+}
+
+static void _append(pulses_t& pulses, const bool burst, const uint32_t us)
+{
+    if (!pulses.empty() && pulses.back().burst == burst) {
+        pulses.back().us += us;
+    } else {
+        pulses.push_back({burst, us});
+    }
+}
+
+static pulses_t _nec_frame(const uint16_t address, const uint8_t command, const bool extended)
+{
+    uint32_t word = extended ? address : (uint32_t) (address & 0xff) | (uint32_t) (~address & 0xff) << 8;
+    word |= (uint32_t) command << 16 | (uint32_t) (~command & 0xff) << 24;
+    pulses_t pulses;
+    _append(pulses, true, NEC_UNIT_US * 16);
+    _append(pulses, false, NEC_UNIT_US * 8);
+    for (int i = 0; i < 32; i++) {
+        _append(pulses, true, NEC_UNIT_US);
+        _append(pulses, false, ((word >> i) & 1) ? NEC_UNIT_US * 3 : NEC_UNIT_US);
+    }
+    _append(pulses, true, NEC_UNIT_US);
+    return pulses;
+}
+
+static pulses_t _nec_repeat()
+{
+    return {{true, NEC_UNIT_US * 16}, {false, NEC_UNIT_US * 4}, {true, NEC_UNIT_US}};
+}
+
+static pulses_t _rc5_frame(const bool toggle, const uint16_t address, const uint8_t command)
+{
+    uint32_t bits = 1UL << 13 | (uint32_t) !(command & 0x40) << 12 | (uint32_t) toggle << 11 | (uint32_t) (address & 0x1f) << 6 | (command & 0x3f);
+    pulses_t pulses;
+    for (int i = 13; i >= 0; i--) {
+        // Manchester: 1 is space then burst, 0 is burst then space
+        bool bit = (bits >> i) & 1;
+        _append(pulses, !bit, RC5_HALF_BIT_US);
+        _append(pulses, bit, RC5_HALF_BIT_US);
+    }
+    return pulses;
+}
+
+/**
+ * schedule the edges of the pulses with the jitter of IR receiver
+ *   the bursts are stretched by jitter/2 on average, each edge moves by +/- jitter/2
+ *
+ * @return time of the end of the pulses
+ */
+static uint64_t _schedule(const pulses_t& pulses, const uint64_t start_us, const bool jitter = true)
+{
+    std::uniform_int_distribution<int> noise(-(int) _jitter_us / 2, (int) _jitter_us / 2);
+    uint64_t time_us = start_us;
+    for (const auto& segment : pulses) {
+        int64_t offset = 0;
+        if (jitter) offset = noise(_rng) + (segment.burst ? 0 : (int) _jitter_us / 2);  // the end of burst is delayed
+        _edges.push_back({(uint64_t) ((int64_t) time_us + offset), !segment.burst});
+        time_us += segment.us;
+    }
+    _edges.push_back({time_us + (jitter ? _jitter_us / 2 : 0), true});
+    return time_us;
+}
+
+// noise spikes of the receiver (e.g. by fluorescent lights) between the frames
+static void _schedule_spikes(const uint64_t start_us, const uint64_t end_us, const uint num)
+{
+    std::uniform_int_distribution<uint64_t> when(start_us, end_us - 200);
+    std::uniform_int_distribution<uint32_t> width(20, 150);
+    std::vector<uint64_t> times;
+    for (uint i = 0; i < num; i++) times.push_back(when(_rng));
+    std::sort(times.begin(), times.end());
+    for (uint64_t time_us : times) {
+        _edges.push_back({time_us, false});
+        _edges.push_back({time_us + width(_rng), true});
+    }
+}
+
+/**
+ * run the UI loop (ir_remote) and core1 (process_loop) while driving the edges scheduled
+ */
+static void _run_until(const uint64_t end_us, crp42602y_ctrl* ctrl, ir_remote* remote, const uint pin = PIN_IR_RECEIVER)
+{
+    while (pico_host::now_us() < end_us) {
+        if (ctrl != nullptr) ctrl->process_loop();
+        remote->process();
+        uint64_t next_us = std::min(pico_host::now_us() + LOOP_INTERVAL_US, end_us);
+        while (!_edges.empty() && _edges.front().time_us <= next_us) {
+            pico_host::advance_to_us(_edges.front().time_us);
+            pico_host::gpio_drive(pin, _edges.front().level);
+            _edges.pop_front();
+        }
+        pico_host::advance_to_us(next_us);
+    }
+}
+
+static void _check_decode(const uint num_frames)
+{
+    printf("[decode] %u frames of each protocol, jitter %u us, noise spikes between the frames\n", num_frames, _jitter_us);
+    pico_host::reset();
+    pico_host::gpio_drive(PIN_IR_RECEIVER, true);
+    crp42602y_ctrl* ctrl = new crp42602y_ctrl(PIN_CASSETTE_DETECT, PIN_GEAR_STATUS_SW, PIN_ROTATION_SENS, PIN_SOLENOID_CTRL, PIN_POWER_CTRL);
+    ir_remote* remote = new ir_remote(ctrl, PIN_IR_RECEIVER);
+    remote->register_callback(_on_key);
+    _events.clear();
+
+    typedef struct _sent_t {
+        ir_decoder::protocol_t protocol;
+        uint16_t address;
+        uint8_t command;
+    } sent_t;
+    std::vector<sent_t> sent;
+    std::uniform_int_distribution<uint32_t> random_u16(0, 0xffff);
+    uint64_t time_us = 10000;
+    bool toggle = false;
+    for (uint i = 0; i < num_frames * 2; i++) {
+        uint32_t value = random_u16(_rng);
+        uint64_t end_us;
+        if (i % 2 == 0) {
+            // every 4th NEC frame has 16-bit address (extended NEC) unless its 2nd byte happens to be ~address
+            bool extended = (i % 8 == 0) && ((value ^ (value >> 8)) & 0xff) != 0xff;
+            uint16_t address = extended ? (uint16_t) value : (uint16_t) (value & 0xff);
+            uint8_t command = (uint8_t) (value >> 8);
+            end_us = _schedule(_nec_frame(address, command, extended), time_us);
+            sent.push_back({ir_decoder::PROTOCOL_NEC, address, command});
+        } else {
+            uint16_t address = value & 0x1f;
+            uint8_t command = (value >> 5) & 0x7f;
+            toggle = !toggle;
+            end_us = _schedule(_rc5_frame(toggle, address, command), time_us);
+            sent.push_back({(ir_decoder::protocol_t) ir_decoder::PROTOCOL_RC5, address, command});
+        }
+        // the next key after the release
+        uint64_t next_us = end_us + ir_decoder::RELEASE_TIMEOUT_MS * 1000 + 50000;
+        _schedule_spikes(end_us + 5000, next_us - 10000, 3);  // RC-5 needs the idle of 7.1 ms before the frame
+        time_us = next_us;
+    }
+    _run_until(time_us + 500000, nullptr, remote);
+
+    // each key is a pair of PRESS and RELEASE, a key missed is searched within the next PRESS events not to miss the following keys
+    static constexpr size_t MAX_LOOKAHEAD = 4;
+    std::vector<size_t> presses;
+    for (size_t i = 0; i < _events.size(); i++) {
+        if (_events[i].type == ir_decoder::EVT_PRESS) presses.push_back(i);
+    }
+    uint matched = 0;
+    uint spurious = 0;
+    size_t index = 0;
+    for (const auto& key : sent) {
+        for (size_t i = index; i < presses.size() && i < index + MAX_LOOKAHEAD; i++) {
+            const ir_decoder::key_event_t& event = _events[presses[i]];
+            if (event.protocol == key.protocol && event.address == key.address && event.command == key.command) {
+                matched++;
+                spurious += i - index;
+                index = i + 1;
+                break;
+            }
+        }
+    }
+    spurious += presses.size() - index;
+    const ir_decoder::decoder_stats_t& stats = remote->get_stats();
+    printf("  %u / %zu keys decoded, %u spurious keys, %lu frames, %lu errors\n",
+        matched, sent.size(), spurious, (unsigned long) stats.frames, (unsigned long) stats.errors);
+    _check("all keys decoded", matched == sent.size());
+    _check("no spurious key", spurious == 0);
+    delete remote;
+    delete ctrl;
+}
+
+static void _check_hold()
+{
+    printf("[hold] NEC FF held in play, RC-5 STOP (crp42602y_counter beside the programs)\n");
+    pico_host::reset();
+    pico_host::gpio_drive(PIN_IR_RECEIVER, true);
+    crp42602y_sim::pins_t pins = {PIN_CASSETTE_DETECT, PIN_GEAR_STATUS_SW, PIN_ROTATION_SENS, PIN_SOLENOID_CTRL, PIN_POWER_CTRL, 0, 0};
+    crp42602y_ctrl* ctrl = new crp42602y_ctrl_with_counter(PIN_CASSETTE_DETECT, PIN_GEAR_STATUS_SW, PIN_ROTATION_SENS, PIN_SOLENOID_CTRL, PIN_POWER_CTRL);
+    crp42602y_sim* sim = new crp42602y_sim(pins);
+    ctrl->recover_power_from_timeout();
+    ir_remote* remote = new ir_remote(ctrl, PIN_IR_RECEIVER);
+    remote->set_keymap(KEYMAP, sizeof(KEYMAP) / sizeof(KEYMAP[0]));
+    remote->register_callback(_on_key);
+    _events.clear();
+    bool separate_pio = pio_sm_is_claimed(pio0, 0) && pio_sm_is_claimed(pio1, 0) && pio_sm_is_claimed(pio1, 1);
+    sim->insert_cassette(crp42602y_sim::make_tape(30.0, 18.0));
+    _run_until(pico_host::now_us() + 1000000, ctrl, remote);
+
+    // PLAY
+    uint64_t end_us = _schedule(_nec_frame(NEC_ADDRESS, NEC_PLAY, false), pico_host::now_us());
+    _run_until(end_us + 3000000, ctrl, remote);
+    bool played = ctrl->is_playing();
+    float position_sec = sim->get_position_sec();
+
+    // FF held for 3 sec: the frame and repeat codes
+    uint64_t start_us = pico_host::now_us();
+    _schedule(_nec_frame(NEC_ADDRESS, NEC_FF, false), start_us);
+    uint num_repeats = 0;
+    for (uint64_t time_us = start_us + NEC_REPEAT_PERIOD_US; time_us < start_us + 3000000; time_us += NEC_REPEAT_PERIOD_US) {
+        _schedule(_nec_repeat(), time_us);
+        num_repeats++;
+    }
+    bool cueing = false;
+    while (pico_host::now_us() < start_us + 3000000) {
+        _run_until(pico_host::now_us() + 100000, ctrl, remote);
+        if (ctrl->is_cueing()) cueing = true;
+    }
+    bool cue_held = ctrl->is_cueing();
+    float cued_sec = sim->get_position_sec() - position_sec;
+    _run_until(pico_host::now_us() + 3000000, ctrl, remote);
+    bool played_after = ctrl->is_playing();
+    uint repeats = 0;
+    uint32_t hold_ms = 0;
+    for (const auto& event : _events) {
+        if (event.command == NEC_FF && event.type == ir_decoder::EVT_REPEAT) repeats++;
+        if (event.command == NEC_FF && event.type == ir_decoder::EVT_RELEASE) hold_ms = event.hold_ms;
+    }
+
+    // RC-5 STOP: the frame is repeated while held
+    start_us = pico_host::now_us();
+    for (uint i = 0; i < 3; i++) {
+        _schedule(_rc5_frame(true, RC5_ADDRESS, RC5_STOP), start_us + i * RC5_REPEAT_PERIOD_US);
+    }
+    _run_until(start_us + 3000000, ctrl, remote);
+    bool stopped = !ctrl->is_playing() && sim->get_mode() == crp42602y_sim::MODE_NO_FUNC;
+    crp42602y_counter::counter_snapshot_t snapshot;
+    ctrl->get_counter_inst()->get_snapshot(snapshot);
+    float counter_error = std::fabs(snapshot.playing_sec[0] - sim->get_position_sec());
+
+    printf("  cued %.1f sec of tape while held, %u / %u repeat codes, released after %lu ms, counter error %.2f sec\n",
+        cued_sec, repeats, num_repeats, (unsigned long) hold_ms, counter_error);
+    _check("programs on the other PIO than the counter", separate_pio);
+    _check("play", played);
+    _check("cue while held", cueing && cue_held && cued_sec > 10.0);
+    _check("repeat codes", repeats == num_repeats);
+    _check("play after release", played_after);
+    _check("stop by RC-5", stopped);
+    _check("counter beside the programs", counter_error < 2.0);
+    delete remote;
+    delete sim;
+    delete ctrl;
+}
+
+static void _check_alloc()
+{
+    printf("[alloc] two receivers share the programs on PIO1 (crp42602y_counter on PIO0)\n");
+    pico_host::reset();
+    pico_host::gpio_drive(PIN_IR_RECEIVER, true);
+    pico_host::gpio_drive(PIN_IR_RECEIVER2, true);
+    crp42602y_ctrl* ctrl = new crp42602y_ctrl(PIN_CASSETTE_DETECT, PIN_GEAR_STATUS_SW, PIN_ROTATION_SENS, PIN_SOLENOID_CTRL, PIN_POWER_CTRL);
+    ir_remote* remote = new ir_remote(ctrl, PIN_IR_RECEIVER);
+    ir_remote* remote2 = new ir_remote(ctrl, PIN_IR_RECEIVER2, 1UL << ir_decoder::PROTOCOL_RC5);
+    remote2->register_callback(_on_key);
+    _events.clear();
+    bool on_pio1 = pio_sm_is_claimed(pio1, 0) && pio_sm_is_claimed(pio1, 1) && pio_sm_is_claimed(pio1, 2) && !pio_sm_is_claimed(pio1, 3);
+    uint64_t end_us = _schedule(_rc5_frame(false, RC5_ADDRESS, RC5_STOP), pico_host::now_us() + 10000);
+    _run_until(end_us + 500000, nullptr, remote2, PIN_IR_RECEIVER2);
+    bool decoded = _events.size() == 2 && _events[0].command == RC5_STOP;
+    // the program stays loaded for the other receiver
+    delete remote;
+    _events.clear();
+    end_us = _schedule(_rc5_frame(true, RC5_ADDRESS, RC5_STOP), pico_host::now_us() + 10000);
+    _run_until(end_us + 500000, nullptr, remote2, PIN_IR_RECEIVER2);
+    bool decoded_after = _events.size() == 2 && _events[0].command == RC5_STOP;
+    delete remote2;
+    bool freed = !pio_sm_is_claimed(pio1, 0) && !pio_sm_is_claimed(pio1, 1) && !pio_sm_is_claimed(pio1, 2);
+    _check("state machines on PIO1", on_pio1);
+    _check("decoded by the 2nd receiver", decoded);
+    _check("decoded after deleting the 1st receiver", decoded_after);
+    _check("state machines freed", freed);
+    delete ctrl;
+}
+
+static bool _replay_file(const char* path)
+{
+    FILE* fp = fopen(path, "r");
+    if (fp == nullptr) {
+        fprintf(stderr, "ERROR: cannot open %s\n", path);
+        return false;
+    }
+    pulses_t pulses;
+    char name[16];
+    unsigned long us;
+    char line[128];
+    while (fgets(line, sizeof(line), fp) != nullptr) {
+        if (sscanf(line, "%15s %lu", name, &us) != 2) continue;
+        if (strcmp(name, "pulse") == 0) {
+            _append(pulses, true, (uint32_t) us);
+        } else if (strcmp(name, "space") == 0 || strcmp(name, "timeout") == 0) {
+            _append(pulses, false, (uint32_t) us);
+        }
+    }
+    fclose(fp);
+    printf("[replay] %s: %zu segments\n", path, pulses.size());
+    pico_host::reset();
+    pico_host::gpio_drive(PIN_IR_RECEIVER, true);
+    crp42602y_ctrl* ctrl = new crp42602y_ctrl(PIN_CASSETTE_DETECT, PIN_GEAR_STATUS_SW, PIN_ROTATION_SENS, PIN_SOLENOID_CTRL, PIN_POWER_CTRL);
+    ir_remote* remote = new ir_remote(ctrl, PIN_IR_RECEIVER);
+    remote->register_callback(_print_key);
+    uint64_t end_us = _schedule(pulses, 10000, false);
+    _run_until(end_us + 500000, nullptr, remote);
+    const ir_decoder::decoder_stats_t& stats = remote->get_stats();
+    printf("  %lu frames, %lu repeats, %lu errors\n", (unsigned long) stats.frames, (unsigned long) stats.repeats, (unsigned long) stats.errors);
+    delete remote;
+    delete ctrl;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    const char* path = nullptr;
+    uint num_frames = 100;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:j:n:s:")) != -1) {
+        switch (opt) {
+        case 'f':
+            path = optarg;
+            break;
+        case 'j':
+            _jitter_us = strtoul(optarg, nullptr, 0);
+            break;
+        case 'n':
+            num_frames = strtoul(optarg, nullptr, 0);
+            break;
+        case 's':
+            _rng.seed(strtoul(optarg, nullptr, 0));
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-f mode2.txt] [-j jitter_us] [-n num_frames] [-s seed]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (path != nullptr) {
+        return _replay_file(path) ? 0 : 2;
+    }
+    _check_decode(num_frames);
+    _check_hold();
+    _check_alloc();
+    printf("%s\n", (_num_failures == 0) ? "ALL PASS" : "FAILED");
+    return (_num_failures == 0) ? 0 : 1;
+}
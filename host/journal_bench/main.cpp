@@ -0,0 +1,188 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+// Run flash_journal against the flash model of pico_host with power loss
+//   each session updates a few keys (tape position and lifetime statistics as single_pb_deck),
+//   the records are flushed in a batch at the end of the session (safe point) and a stale sector is erased after that
+//   power is cut at a random byte of the flash writes of some sessions, then the journal is restored by a new instance as at boot
+//   reports restore time and records read at boot, flash busy time per flush, write amplification and erase counts per sector
+//   exit code is non-zero if a restored value is neither the value committed nor the value being flushed
+//   usage: journal_bench [-n num_sessions] [-s num_sectors] [-p power_loss_per_mille] [-r seed]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <unistd.h>
+
+#include "pico_host.h"
+#include "flash_journal.h"
+
+static constexpr uint NUM_KEYS = 8;
+static constexpr uint MAX_PUTS_PER_SESSION = 6;
+static constexpr uint64_t MAX_POWER_LOSS_BYTES = FLASH_SECTOR_SIZE + FLASH_PAGE_SIZE * 3;  // erase and program of a sector switch
+
+typedef struct _boot_stats_t {
+    uint32_t boots;
+    uint64_t restore_ns;
+    uint64_t max_restore_ns;
+    uint64_t scanned;
+    uint32_t max_scanned;
+    uint32_t torn;
+} boot_stats_t;
+
+typedef struct _expected_t {
+    bool valid;
+    uint64_t value;
+} expected_t;
+
+static uint64_t _elapsed_ns(const std::function<void()>& func)
+{
+    auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::unique_ptr<flash_journal> _boot(const uint32_t flash_offs, const uint num_sectors, boot_stats_t& boot_stats)
+{
+    std::unique_ptr<flash_journal> journal(new flash_journal(flash_offs, num_sectors));
+    uint64_t ns = _elapsed_ns([&]() { journal->open(); });
+    const flash_journal::journal_stats_t& stats = journal->get_stats();
+    boot_stats.boots++;
+    boot_stats.restore_ns += ns;
+    boot_stats.max_restore_ns = std::max(boot_stats.max_restore_ns, ns);
+    boot_stats.scanned += stats.scanned;
+    boot_stats.max_scanned = std::max(boot_stats.max_scanned, stats.scanned);
+    boot_stats.torn += stats.torn;
+    return journal;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t num_sessions = 100000;
+    uint num_sectors = 8;
+    uint32_t power_loss_per_mille = 10;
+    uint32_t seed = 1;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:p:r:")) != -1) {
+        switch (opt) {
+        case 'n':
+            num_sessions = strtoul(optarg, nullptr, 0);
+            break;
+        case 's':
+            num_sectors = strtoul(optarg, nullptr, 0);
+            break;
+        case 'p':
+            power_loss_per_mille = strtoul(optarg, nullptr, 0);
+            break;
+        case 'r':
+            seed = strtoul(optarg, nullptr, 0);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n num_sessions] [-s num_sectors] [-p power_loss_per_mille] [-r seed]\n", argv[0]);
+            return 1;
+        }
+    }
+    num_sectors = std::min(std::max(num_sectors, 2u), flash_journal::MAX_SECTORS);
+    const uint32_t flash_offs = PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE * (num_sectors + 4);
+
+    pico_host::reset();
+    pico_host::flash_erase_all();
+    std::mt19937 rng(seed);
+    boot_stats_t boot_stats = {};
+    flash_journal::journal_stats_t total = {};
+    expected_t committed[NUM_KEYS] = {};
+    uint32_t num_power_losses = 0;
+    uint32_t num_failures = 0;
+    uint32_t num_flushes = 0;
+    uint64_t flush_us = 0;
+    uint64_t max_flush_us = 0;
+    uint64_t counters[NUM_KEYS] = {};
+
+    std::unique_ptr<flash_journal> journal = _boot(flash_offs, num_sectors, boot_stats);
+    auto accumulate = [&]() {
+        const flash_journal::journal_stats_t& stats = journal->get_stats();
+        total.flushes += stats.flushes;
+        total.switches += stats.switches;
+        total.erases += stats.erases;
+        total.put_bytes += stats.put_bytes;
+        total.record_bytes += stats.record_bytes;
+        total.programmed_bytes += stats.programmed_bytes;
+    };
+
+    for (uint32_t session = 0; session < num_sessions; session++) {
+        // keys 0 and 1 (tape position) change every session, the others by chance
+        expected_t batch[NUM_KEYS] = {};
+        uint num_puts = 2 + rng() % (MAX_PUTS_PER_SESSION - 1);
+        for (uint i = 0; i < num_puts; i++) {
+            uint key = (i < 2) ? i : rng() % NUM_KEYS;
+            uint64_t value = (key < 2) ? rng() : ++counters[key];
+            if (!journal->put(key, value)) {
+                printf("ERROR: session %u: put failed\n", session);
+                num_failures++;
+                continue;
+            }
+            batch[key] = {true, value};
+        }
+
+        bool cut = (rng() % 1000) < power_loss_per_mille;
+        if (cut) pico_host::flash_cut_power_after(rng() % MAX_POWER_LOSS_BYTES);
+        uint64_t start_us = pico_host::now_us();
+        bool flushed = journal->flush();
+        uint64_t us = pico_host::now_us() - start_us;
+        if (flushed) {
+            num_flushes++;
+            flush_us += us;
+            max_flush_us = std::max(max_flush_us, us);
+            for (uint key = 0; key < NUM_KEYS; key++) {
+                if (batch[key].valid) committed[key] = batch[key];
+            }
+            journal->compact();
+        }
+        if (!pico_host::flash_restore_power()) continue;
+
+        // power loss: boot again and check the values restored
+        num_power_losses++;
+        accumulate();
+        journal = _boot(flash_offs, num_sectors, boot_stats);
+        for (uint key = 0; key < NUM_KEYS; key++) {
+            uint64_t value;
+            bool valid = journal->get(key, value);
+            bool ok = (valid == committed[key].valid && (!valid || value == committed[key].value)) ||
+                      (batch[key].valid && valid && value == batch[key].value);
+            if (!ok) {
+                printf("ERROR: session %u: key %u restored %s\n", session, key, valid ? "with wrong value" : "without value");
+                num_failures++;
+            }
+            committed[key] = {valid, value};
+            if (valid && key >= 2) counters[key] = value;
+        }
+    }
+    accumulate();
+
+    uint32_t min_erases = UINT32_MAX;
+    uint32_t max_erases = 0;
+    for (uint sector = 0; sector < num_sectors; sector++) {
+        uint32_t erases = pico_host::flash_get_erase_count(flash_offs + sector * FLASH_SECTOR_SIZE);
+        min_erases = std::min(min_erases, erases);
+        max_erases = std::max(max_erases, erases);
+    }
+    float put_bytes = (total.put_bytes > 0) ? (float) total.put_bytes : 1.0f;
+    printf("sessions: %u, sectors: %u, record size: %u bytes, power losses: %u\n", num_sessions, num_sectors, flash_journal::RECORD_SIZE, num_power_losses);
+    printf("restore at boot: %u boots, avg %.1f us, max %.1f us, records read avg %.1f, max %u, torn records %u\n",
+        boot_stats.boots, boot_stats.restore_ns / 1e3 / boot_stats.boots, boot_stats.max_restore_ns / 1e3,
+        (float) boot_stats.scanned / boot_stats.boots, boot_stats.max_scanned, boot_stats.torn);
+    printf("flush: %u flushes, %u sector switches, flash busy avg %.1f us, max %.1f us (virtual time)\n",
+        num_flushes, total.switches, (num_flushes > 0) ? (float) flush_us / num_flushes : 0.0f, (float) max_flush_us);
+    printf("write amplification: %.2f (pages programmed), %.2f (records incl. headers and checkpoints)\n",
+        total.programmed_bytes / put_bytes, total.record_bytes / put_bytes);
+    printf("erases: %u in total, per sector min %u, max %u (wholesale rewrite of a sector per flush: %u erases of one sector)\n",
+        total.erases, min_erases, max_erases, num_flushes);
+    printf("%s\n", (num_failures == 0) ? "PASS" : "FAIL");
+    return (num_failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,284 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+// Run the DSP kernels of level_meter with synthetic signals of 12-bit ADC (bias 2048, quantized with noise)
+//   levels: RMS and peak of sine and square waves (20 Hz ~ 10 kHz, 0 ~ -40 dB) compared with the reference in double
+//   silence, DC step: noise floor and recovery after the step of the bias
+//   peak hold: hold and decay of the peak over windows
+//   conversion: to_db10() over all the amplitudes and isqrt() compared with the reference
+//   chunks: same levels for the interleaved samples split into random chunks (as the ring buffer of DMA)
+//   cost: host time per sample of process()
+//   exit code is non-zero if any check fails
+//   usage: level_bench [-n num_samples]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+#include "level_dsp.h"
+
+static constexpr uint32_t SAMPLE_RATE = 24000;  // per channel
+static constexpr uint32_t WINDOW = 1200;  // 50 ms
+static constexpr uint32_t BIAS = 2048;
+static constexpr uint32_t WARMUP_WINDOWS = 40;  // for the DC level to settle
+
+static int _failures = 0;
+static std::mt19937 _rng(42);
+
+static void _check(const bool ok, const char* name)
+{
+    printf("  %-40s %s\n", name, ok ? "PASS" : "FAIL");
+    if (!ok) _failures++;
+}
+
+static uint64_t _now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double _db10(const double amplitude)
+{
+    return (amplitude > 0.0) ? 200.0 * log10(amplitude / (1 << (level_dsp::ADC_BITS - 1))) : level_dsp::DB10_MIN;
+}
+
+typedef enum _wave_t {
+    SINE = 0,
+    SQUARE
+} wave_t;
+
+// samples of 12-bit ADC: bias + amplitude (dB of full scale) with gaussian noise (LSB), quantized and clipped
+static std::vector<uint16_t> _generate(const wave_t wave, const double freq, const double db, const uint32_t count,
+    const double bias = BIAS, const double noise = 0.5, const double phase = 0.0)
+{
+    std::normal_distribution<double> dist(0.0, noise);
+    const double amplitude = (1 << (level_dsp::ADC_BITS - 1)) * pow(10.0, db / 20.0);
+    std::vector<uint16_t> samples(count);
+    for (uint32_t i = 0; i < count; i++) {
+        double t = 2.0 * M_PI * freq * i / SAMPLE_RATE + phase;
+        double v = (wave == SINE) ? sin(t) : ((sin(t) >= 0.0) ? 1.0 : -1.0);
+        double x = round(bias + amplitude * v + ((noise > 0.0) ? dist(_rng) : 0.0));
+        samples[i] = (uint16_t) std::min(std::max(x, 0.0), 4095.0);
+    }
+    return samples;
+}
+
+// RMS and peak of the last window from the bias in dB (0.1 dB)
+static void _reference(const std::vector<uint16_t>& samples, const double bias, double& rms_db10, double& peak_db10)
+{
+    double sum_sq = 0.0;
+    double peak = 0.0;
+    for (size_t i = samples.size() - WINDOW; i < samples.size(); i++) {
+        double d = samples[i] - bias;
+        sum_sq += d * d;
+        peak = std::max(peak, fabs(d));
+    }
+    rms_db10 = _db10(sqrt(sum_sq / WINDOW));
+    peak_db10 = _db10(peak);
+}
+
+static void _check_levels()
+{
+    printf("levels (window %u samples at %u Hz, tolerance 0.2 dB)\n", WINDOW, SAMPLE_RATE);
+    typedef struct _case_t {
+        wave_t wave;
+        double freq;
+        double db;
+    } case_t;
+    static const case_t CASES[] = {
+        {SINE, 997.0, -0.1}, {SINE, 997.0, -6.0}, {SINE, 997.0, -20.0}, {SINE, 997.0, -40.0},
+        {SINE, 20.0, -6.0}, {SINE, 31.0, -20.0}, {SINE, 10000.0, -12.0}, {SINE, 4410.0, -3.0},
+        {SQUARE, 440.0, -6.0}, {SQUARE, 50.0, -20.0}
+    };
+    double max_error = 0.0;
+    bool ok = true;
+    for (const case_t& c : CASES) {
+        std::vector<uint16_t> samples = _generate(c.wave, c.freq, c.db, WINDOW * WARMUP_WINDOWS);
+        level_dsp dsp(WINDOW);
+        dsp.process(samples.data(), (uint32_t) samples.size());
+        double ref_rms, ref_peak;
+        _reference(samples, BIAS, ref_rms, ref_peak);
+        double rms_error = fabs(dsp.get_rms_db10() - ref_rms);
+        double peak_error = fabs(dsp.get_peak_db10() - ref_peak);
+        printf("  %-6s %7.1f Hz %5.1f dB: rms %6.1f dB (ref %6.1f), peak %6.1f dB (ref %6.1f)\n",
+            (c.wave == SINE) ? "sine" : "square", c.freq, c.db,
+            dsp.get_rms_db10() / 10.0, ref_rms / 10.0, dsp.get_peak_db10() / 10.0, ref_peak / 10.0);
+        max_error = std::max(max_error, std::max(rms_error, peak_error));
+        ok = ok && rms_error <= 2.0 && peak_error <= 2.0;
+    }
+    printf("  max error %.2f dB\n", max_error / 10.0);
+    _check(ok, "rms and peak within 0.2 dB");
+}
+
+static void _check_silence_dc_step()
+{
+    printf("silence and DC step\n");
+    // no signal: only the noise of ADC (0.5 LSB) is left, exact bias without noise gives the floor
+    std::vector<uint16_t> samples = _generate(SINE, 997.0, -200.0, WINDOW * 4);
+    level_dsp dsp(WINDOW);
+    dsp.process(samples.data(), (uint32_t) samples.size());
+    printf("  noise 0.5 LSB: rms %.1f dB, peak %.1f dB\n", dsp.get_rms_db10() / 10.0, dsp.get_peak_db10() / 10.0);
+    _check(dsp.get_rms_db10() < -600 && dsp.get_peak_db10() < -500, "noise floor");
+    samples = _generate(SINE, 997.0, -200.0, WINDOW * 4, BIAS, 0.0);
+    dsp.reset();
+    dsp.process(samples.data(), (uint32_t) samples.size());
+    _check(dsp.get_rms_db10() == level_dsp::DB10_MIN && dsp.get_peak_db10() == level_dsp::DB10_MIN, "DB10_MIN for exact bias");
+
+    // the bias steps by 250 LSB (e.g. by the coupling capacitor at power on): the levels recover as the DC level follows
+    const double bias2 = BIAS + 250;
+    samples = _generate(SINE, 997.0, -20.0, WINDOW * WARMUP_WINDOWS);
+    dsp.reset();
+    dsp.process(samples.data(), (uint32_t) samples.size());
+    double ref_rms, ref_peak;
+    uint32_t recover_windows = 0;
+    for (uint32_t w = 1; w <= WARMUP_WINDOWS && recover_windows == 0; w++) {
+        samples = _generate(SINE, 997.0, -20.0, WINDOW, bias2, 0.5, 2.0 * M_PI * 997.0 * (w * WINDOW) / SAMPLE_RATE);
+        dsp.process(samples.data(), (uint32_t) samples.size());
+        _reference(samples, bias2, ref_rms, ref_peak);
+        if (fabs(dsp.get_rms_db10() - ref_rms) <= 2.0) recover_windows = w;
+    }
+    printf("  step of %u LSB: rms within 0.2 dB after %u windows, DC level %.2f LSB\n", (uint32_t) (bias2 - BIAS), recover_windows, dsp.get_dc() / 16.0);
+    _check(recover_windows > 0 && recover_windows <= 24, "recovery from DC step");
+}
+
+static void _check_peak_hold()
+{
+    printf("peak hold (hold 3 windows, decay 1 dB per window)\n");
+    level_dsp dsp(WINDOW);
+    dsp.set_peak_hold(3, 10);
+    std::vector<uint16_t> loud = _generate(SQUARE, 440.0, -6.0, WINDOW, BIAS, 0.0);
+    std::vector<uint16_t> quiet = _generate(SQUARE, 440.0, -20.0, WINDOW, BIAS, 0.0);
+    for (uint32_t i = 0; i < 4; i++) dsp.process(quiet.data(), WINDOW);
+    dsp.process(loud.data(), WINDOW);
+    const int32_t loud_db10 = dsp.get_peak_db10();
+    bool ok = dsp.get_peak_hold_db10() == loud_db10;
+    int32_t quiet_db10 = 0;
+    for (uint32_t w = 1; w <= 20; w++) {
+        dsp.process(quiet.data(), WINDOW);
+        quiet_db10 = dsp.get_peak_db10();
+        int32_t expected = (w <= 3) ? loud_db10 : std::max(loud_db10 - (int32_t) (w - 3) * 10, quiet_db10);
+        ok = ok && dsp.get_peak_hold_db10() == expected;
+    }
+    printf("  peak %.1f dB -> %.1f dB, held %.1f dB at the end\n", loud_db10 / 10.0, quiet_db10 / 10.0, dsp.get_peak_hold_db10() / 10.0);
+    _check(ok, "hold then decay to the peak");
+}
+
+static void _check_conversion()
+{
+    printf("conversion\n");
+    int32_t max_error = 0;
+    for (uint32_t a = 1; a <= 0xffff; a++) {
+        int32_t ref = (int32_t) lround(200.0 * log10(a / (double) level_dsp::FULL_SCALE));
+        if (ref < level_dsp::DB10_MIN) ref = level_dsp::DB10_MIN;
+        max_error = std::max(max_error, abs(level_dsp::to_db10(a) - ref));
+    }
+    printf("  to_db10() max error %d (0.1 dB) for amplitude 1 ~ 65535\n", max_error);
+    _check(max_error <= 1 && level_dsp::to_db10(0) == level_dsp::DB10_MIN && level_dsp::to_db10(level_dsp::FULL_SCALE) == 0, "to_db10 within 0.1 dB");
+
+    std::uniform_int_distribution<uint64_t> dist;
+    bool ok = true;
+    static const uint64_t EDGES[] = {0, 1, 2, 3, 4, 15, 16, 17, 0xfffffffeULL * 0xfffffffeULL, 0xffffffffULL * 0xffffffffULL, ~0ULL};
+    for (uint64_t v : EDGES) {
+        uint64_t r = level_dsp::isqrt(v);
+        ok = ok && r * r <= v && (r == 0xffffffffULL || (r + 1) * (r + 1) > v);
+    }
+    for (uint32_t i = 0; i < 100000; i++) {
+        uint64_t v = dist(_rng) >> (i % 64);
+        uint64_t r = level_dsp::isqrt(v);
+        ok = ok && r * r <= v && (r == 0xffffffffULL || (r + 1) * (r + 1) > v);
+    }
+    _check(ok, "isqrt is floor of sqrt");
+
+    // largest window of full scale square: the sums must not overflow
+    std::vector<uint16_t> samples(level_dsp::MAX_WINDOW);
+    for (uint32_t i = 0; i < samples.size(); i++) samples[i] = ((i / 8) % 2) ? 4095 : 0;
+    level_dsp dsp(level_dsp::MAX_WINDOW);
+    dsp.process(samples.data(), (uint32_t) samples.size());
+    printf("  full scale square in %u samples: rms %.1f dB, peak %.1f dB\n", level_dsp::MAX_WINDOW, dsp.get_rms_db10() / 10.0, dsp.get_peak_db10() / 10.0);
+    _check(abs(dsp.get_rms_db10()) <= 1 && abs(dsp.get_peak_db10()) <= 1, "no overflow at MAX_WINDOW");
+}
+
+static void _check_chunks()
+{
+    printf("chunks (interleaved 2 channels split at random)\n");
+    std::vector<uint16_t> left = _generate(SINE, 997.0, -10.0, WINDOW * 20);
+    std::vector<uint16_t> right = _generate(SINE, 60.0, -30.0, WINDOW * 20);
+    std::vector<uint16_t> ring(left.size() * 2);
+    for (size_t i = 0; i < left.size(); i++) {
+        ring[i * 2 + 0] = left[i];
+        ring[i * 2 + 1] = right[i];
+    }
+    level_dsp whole[2] = {level_dsp(WINDOW), level_dsp(WINDOW)};
+    level_dsp split[2] = {level_dsp(WINDOW), level_dsp(WINDOW)};
+    std::uniform_int_distribution<uint32_t> dist(1, 700);
+    bool ok = true;
+    uint32_t chunks = 0;
+    for (size_t pos = 0; pos < left.size(); ) {
+        uint32_t n = std::min(dist(_rng), (uint32_t) (left.size() - pos));
+        for (uint ch = 0; ch < 2; ch++) {
+            uint32_t windows = split[ch].process(&ring[pos * 2 + ch], n, 2);
+            whole[ch].process((ch == 0) ? &left[pos] : &right[pos], n);
+            if (windows > 0) {
+                ok = ok && split[ch].get_level().rms == whole[ch].get_level().rms && split[ch].get_level().peak == whole[ch].get_level().peak && split[ch].get_dc() == whole[ch].get_dc();
+            }
+        }
+        pos += n;
+        chunks++;
+    }
+    printf("  %u chunks, %u windows: L rms %.1f dB, R rms %.1f dB\n", chunks, split[0].get_num_windows(), split[0].get_rms_db10() / 10.0, split[1].get_rms_db10() / 10.0);
+    _check(ok && split[0].get_num_windows() == 20 && split[1].get_num_windows() == 20, "same levels as contiguous samples");
+}
+
+static void _bench_cost(const uint32_t num_samples)
+{
+    printf("cost (host time, %u samples per channel)\n", num_samples);
+    std::vector<uint16_t> left = _generate(SINE, 997.0, -10.0, 4096);
+    std::vector<uint16_t> ring(left.size() * 2);
+    for (size_t i = 0; i < left.size(); i++) ring[i * 2] = ring[i * 2 + 1] = left[i];
+    level_dsp dsp[2] = {level_dsp(WINDOW), level_dsp(WINDOW)};
+    uint64_t start_ns = _now_ns();
+    for (uint32_t i = 0; i < num_samples; i += (uint32_t) left.size()) {
+        dsp[0].process(left.data(), (uint32_t) left.size());
+    }
+    uint64_t mono_ns = _now_ns() - start_ns;
+    start_ns = _now_ns();
+    for (uint32_t i = 0; i < num_samples; i += (uint32_t) left.size()) {
+        for (uint ch = 0; ch < 2; ch++) dsp[ch].process(&ring[ch], (uint32_t) left.size(), 2);
+    }
+    uint64_t stereo_ns = _now_ns() - start_ns;
+    uint32_t processed = (num_samples + (uint32_t) left.size() - 1) / (uint32_t) left.size() * (uint32_t) left.size();
+    printf("  process() per sample:    %7.2f ns (1 channel)\n", (double) mono_ns / processed);
+    printf("  process() per sample:    %7.2f ns (2 channels interleaved)\n", (double) stereo_ns / processed / 2);
+    _check(dsp[0].get_num_windows() > 0 && dsp[1].get_num_windows() > 0, "windows completed");
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t num_samples = 10000000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+        case 'n':
+            num_samples = strtoul(optarg, nullptr, 0);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n num_samples]\n", argv[0]);
+            return 1;
+        }
+    }
+    _check_levels();
+    _check_silence_dc_step();
+    _check_peak_hold();
+    _check_conversion();
+    _check_chunks();
+    _bench_cost(std::max(num_samples, 1u));
+    printf("%s\n", (_failures == 0) ? "ALL PASS" : "FAILED");
+    return (_failures == 0) ? 0 : 1;
+}
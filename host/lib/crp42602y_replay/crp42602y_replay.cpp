@@ -0,0 +1,143 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+#include "crp42602y_replay.h"
+
+crp42602y_counter_probe::crp42602y_counter_probe(const counter_config_t& config) :
+    crp42602y_counter(nullptr, config)
+{
+    set_config(config);
+}
+
+bool crp42602y_counter_probe::feed(const trace_record_t& record)
+{
+    switch (record.type) {
+    case TRACE_ROTATION: {
+        rotation_event_t event = {
+            record.value,
+            (record.flags & TRACE_FLAG_CUE) ? CUE : PLAY,
+            (record.flags & TRACE_FLAG_DIR_A) != 0,
+            (int) record.arg
+        };
+        if (!queue_try_add(&_rotation_event_queue, &event)) return false;
+        _process();
+        return true;
+    }
+    case TRACE_RESTART:
+        _restart();
+        return true;
+    case TRACE_RESET_SIDE: {
+        counter_command_t command = {CMD_RESET_SIDE, (int) record.arg};
+        if (!queue_try_add(&_command_queue, &command)) return false;
+        _process();
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+crp42602y_counter& crp42602y_counter_probe::get_counter()
+{
+    return *this;
+}
+
+bool load_trace(const std::string& filename, std::vector<trace_record_t>& records, std::string& error)
+{
+    FILE* fp = fopen(filename.c_str(), "rb");
+    if (fp == nullptr) {
+        error = "cannot open " + filename;
+        return false;
+    }
+    trace_record_t record;
+    if (fread(&record, sizeof(record), 1, fp) != 1 || record.type != crp42602y_counter::TRACE_HEADER ||
+            record.value != crp42602y_counter::TRACE_MAGIC || record.arg != crp42602y_counter::TRACE_VERSION) {
+        error = filename + " is not a counter trace (version " + std::to_string(crp42602y_counter::TRACE_VERSION) + ")";
+        fclose(fp);
+        return false;
+    }
+    records.clear();
+    while (fread(&record, sizeof(record), 1, fp) == 1) {
+        if (record.type > crp42602y_counter::TRACE_TRUTH) {
+            error = "unknown record type " + std::to_string(record.type) + " at record " + std::to_string(records.size() + 1) + " of " + filename;
+            fclose(fp);
+            return false;
+        }
+        records.push_back(record);
+    }
+    fclose(fp);
+    return true;
+}
+
+replay_result_t replay_trace(const std::vector<trace_record_t>& records, const counter_config_t& config, const truth_callback_t& on_truth,
+                             void (*on_log)(const char* fmt, va_list args))
+{
+    crp42602y_counter_probe probe(config);
+    crp42602y_counter& counter = probe.get_counter();
+    counter.set_log_callback(on_log);
+    replay_result_t result = {};
+    result.last_error_sec = NAN;
+    result.full_ready_sec = NAN;
+    float origin_sec = NAN;  // actual position where the counter value is zero
+    bool need_origin = true;
+    double transport_sec = 0.0;
+    counter_snapshot_t snapshot;
+
+    for (const auto& record : records) {
+        result.num_records++;
+        switch (record.type) {
+        case crp42602y_counter::TRACE_ROTATION: {
+            auto start = std::chrono::steady_clock::now();
+            probe.feed(record);
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            result.total_ns += ns;
+            if (ns > result.max_ns) result.max_ns = ns;
+            result.num_rotations++;
+            transport_sec += record.value / 1e6;
+            if (std::isnan(result.full_ready_sec)) {
+                counter.get_snapshot(snapshot);
+                if (snapshot.state == crp42602y_counter::FULL_READY) result.full_ready_sec = (float) transport_sec;
+            }
+            break;
+        }
+        case crp42602y_counter::TRACE_TRANSPORT:
+            result.num_transports++;
+            break;
+        case crp42602y_counter::TRACE_RESTART:
+            probe.feed(record);
+            need_origin = true;
+            break;
+        case crp42602y_counter::TRACE_RESET_SIDE:
+            probe.feed(record);
+            if (record.arg == 0) need_origin = true;
+            break;
+        case crp42602y_counter::TRACE_TRUTH: {
+            float truth_sec = (float) record.value / 1000.0f;
+            result.num_truths++;
+            if (need_origin) {
+                origin_sec = truth_sec;
+                need_origin = false;
+            }
+            counter.get_snapshot(snapshot);
+            if (std::isnan(snapshot.playing_sec[0])) break;
+            float error = snapshot.playing_sec[0] - (truth_sec - origin_sec);
+            if (std::fabs(error) > result.max_error_sec) result.max_error_sec = std::fabs(error);
+            result.last_error_sec = error;
+            result.num_compared++;
+            if (on_truth) on_truth(truth_sec - origin_sec, snapshot);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    counter.get_snapshot(result.snapshot);
+    return result;
+}
@@ -0,0 +1,86 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "crp42602y_counter.h"
+
+// Replay of counter traces
+//   the counter is created without crp42602y_ctrl and rotation sensor,
+//   then the recorded inputs are fed in the recorded order so that the same code as process_loop() computes the counter values.
+//   Replays don't share any state, thus they can run on multiple threads with each own instance.
+
+typedef crp42602y_counter::trace_record_t trace_record_t;
+typedef crp42602y_counter::counter_config_t counter_config_t;
+typedef crp42602y_counter::counter_snapshot_t counter_snapshot_t;
+
+/**
+ * counter fed by trace records instead of its PIO
+ */
+class crp42602y_counter_probe : public crp42602y_counter {
+    public:
+    /**
+     * crp42602y_counter_probe class constructor
+     *
+     * @param[in] config counter configuration
+     */
+    crp42602y_counter_probe(const counter_config_t& config = crp42602y_counter::DEFAULT_CONFIG);
+
+    /**
+     * feed a trace record to the counter
+     *
+     * @param[in] record trace record
+     * @return true if the counter processed the record
+     */
+    bool feed(const trace_record_t& record);
+
+    /**
+     * get the counter instance
+     */
+    crp42602y_counter& get_counter();
+};
+
+typedef struct _replay_result_t {
+    uint32_t num_records;
+    uint32_t num_rotations;
+    uint32_t num_transports;
+    uint32_t num_truths;
+    uint32_t num_compared;    // truth records compared with the counter
+    float max_error_sec;      // max of absolute counter error
+    float last_error_sec;     // counter error at the last truth record (NAN if not compared)
+    float full_ready_sec;     // transport time until FULL_READY (NAN if not reached)
+    double total_ns;          // compute time of rotation events on the host
+    double max_ns;
+    counter_snapshot_t snapshot;  // final counter values
+} replay_result_t;
+
+typedef std::function<void(const float truth_sec, const counter_snapshot_t& snapshot)> truth_callback_t;
+
+/**
+ * load a counter trace
+ *
+ * @param[in] filename trace file
+ * @param[out] records trace records (TRACE_HEADER excluded)
+ * @param[out] error error message if failed
+ * @return true if succeeded
+ */
+bool load_trace(const std::string& filename, std::vector<trace_record_t>& records, std::string& error);
+
+/**
+ * replay a counter trace
+ *
+ * @param[in] records trace records
+ * @param[in] config counter configuration
+ * @param[in] on_truth called at each truth record where the counter is determined (truth_sec is relative to the counter origin)
+ * @param[in] on_log log callback of the counter (see crp42602y_counter::set_log_callback)
+ * @return replay result
+ */
+replay_result_t replay_trace(const std::vector<trace_record_t>& records, const counter_config_t& config, const truth_callback_t& on_truth = nullptr,
+                             void (*on_log)(const char* fmt, va_list args) = nullptr);
@@ -0,0 +1,461 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include <cmath>
+
+#include "crp42602y_sim.h"
+#include "pico/stdlib.h"
+
+namespace {
+constexpr double EPSILON_MS = 1e-6;  // tolerance of the gear position
+constexpr double EPSILON_CM = 1e-6;  // tolerance of the tape end
+}
+
+const crp42602y_sim::config_t crp42602y_sim::DEFAULT_CONFIG = {
+    4.75,         // tape_speed_cm_per_sec
+    6.0,          // wind_hub_rps
+    300,          // motor_spinup_ms
+    400,          // func_rotation_ms
+    360,          // return_rotation_ms
+    60,           // head_dir_sample_ms
+    225,          // lift_head_sample_ms
+    350,          // reel_sample_ms
+    10,           // solenoid_pull_in_ms
+    0.3,          // solenoid_hold_duty
+    2,            // sensor_wings
+    43.0 / 23.0,  // sensor_gear_ratio
+    0.5,          // sensor_duty
+    0,            // sensor_jitter_us
+    1             // seed
+};
+
+crp42602y_sim::tape_t crp42602y_sim::make_tape(const float minutes_per_side, const float thickness_um)
+{
+    return {minutes_per_side * 60.0f * DEFAULT_CONFIG.tape_speed_cm_per_sec, thickness_um, 1.1f};
+}
+
+crp42602y_sim::crp42602y_sim(const pins_t& pins, const config_t& config) :
+    _pins(pins), _config(config),
+    _motor_on(pins.power_ctrl == 0), _motor_on_us(0),
+    _cam(CAM_STOP), _cam_pos_ms(0.0), _cam_time_us(pico_host::now_us()), _next_sample(0), _jammed(false),
+    _head_dir_is_a(true), _lift_head(false), _reel_fwd(false), _gear_start_us(0), _func_arrival_us(0), _solenoid_on_us(0),
+    _has_cassette(false), _tape{0.0f, 0.0f, 0.0f}, _hub_a_cm(0.0), _tape_time_us((double) pico_host::now_us()),
+    _tape_end_us(0), _num_reel_mismatch(0),
+    _sensor_pos(0.0), _next_boundary(1), _next_edge_us(NO_EVENT), _num_sensor_pulses(0), _rand(config.seed),
+    _solenoid_listener(0), _power_listener(0)
+{
+    pico_host::gpio_drive(_pins.cassette_detect, true);
+    pico_host::gpio_drive(_pins.gear_status_sw, true);
+    pico_host::gpio_drive(_pins.rotation_sens, true);  // position 0 is in the high term of the wing
+    if (_pins.rec_a_sw != 0) pico_host::gpio_drive(_pins.rec_a_sw, true);
+    if (_pins.rec_b_sw != 0) pico_host::gpio_drive(_pins.rec_b_sw, true);
+    _solenoid_listener = pico_host::gpio_add_listener(_pins.solenoid_ctrl, [this](uint pin, bool level) {
+        _on_solenoid(level);
+    });
+    if (_pins.power_ctrl != 0) {
+        _power_listener = pico_host::gpio_add_listener(_pins.power_ctrl, [this](uint pin, bool level) {
+            _on_power(level);
+        });
+        _motor_on = gpio_get(_pins.power_ctrl);
+        _motor_on_us = pico_host::now_us();
+    }
+    pico_host::add_device(this);
+}
+
+crp42602y_sim::~crp42602y_sim()
+{
+    pico_host::gpio_remove_listener(_pins.solenoid_ctrl, _solenoid_listener);
+    if (_pins.power_ctrl != 0) {
+        pico_host::gpio_remove_listener(_pins.power_ctrl, _power_listener);
+    }
+    pico_host::remove_device(this);
+}
+
+void crp42602y_sim::insert_cassette(const tape_t& tape, const float position_sec, const bool rec_a_ok, const bool rec_b_ok)
+{
+    uint64_t now = pico_host::now_us();
+    _advance_tape(now);
+    _has_cassette = true;
+    _tape = tape;
+    _hub_a_cm = (double) position_sec * _config.tape_speed_cm_per_sec;
+    if (_hub_a_cm < 0.0) _hub_a_cm = 0.0;
+    if (_hub_a_cm > _tape.length_cm) _hub_a_cm = _tape.length_cm;
+    _tape_end_us = 0;
+    pico_host::gpio_drive(_pins.cassette_detect, false);
+    if (_pins.rec_a_sw != 0) pico_host::gpio_drive(_pins.rec_a_sw, !rec_a_ok);
+    if (_pins.rec_b_sw != 0) pico_host::gpio_drive(_pins.rec_b_sw, !rec_b_ok);
+    _schedule_edge(now);
+}
+
+void crp42602y_sim::eject_cassette()
+{
+    uint64_t now = pico_host::now_us();
+    _advance_tape(now);
+    _has_cassette = false;
+    pico_host::gpio_drive(_pins.cassette_detect, true);
+    if (_pins.rec_a_sw != 0) pico_host::gpio_drive(_pins.rec_a_sw, true);
+    if (_pins.rec_b_sw != 0) pico_host::gpio_drive(_pins.rec_b_sw, true);
+    _schedule_edge(now);
+}
+
+void crp42602y_sim::set_gear_jammed(const bool jammed)
+{
+    _advance_cam(pico_host::now_us());
+    _jammed = jammed;
+}
+
+crp42602y_sim::mode_t crp42602y_sim::get_mode() const
+{
+    switch (_cam) {
+    case CAM_STOP:
+        return MODE_NO_FUNC;
+    case CAM_FUNC:
+        if (!_is_transporting()) return MODE_STALL;
+        return _lift_head ? MODE_PLAY : MODE_WIND;
+    default:
+        return MODE_GEAR_MOVING;
+    }
+}
+
+bool crp42602y_sim::is_in_func() const
+{
+    return _cam == CAM_FUNC;
+}
+
+bool crp42602y_sim::is_gear_moving() const
+{
+    return _cam == CAM_TO_FUNC || _cam == CAM_TO_STOP;
+}
+
+bool crp42602y_sim::get_head_dir_is_a() const
+{
+    return _head_dir_is_a;
+}
+
+bool crp42602y_sim::get_reel_fwd() const
+{
+    return _reel_fwd;
+}
+
+float crp42602y_sim::get_position_sec() const
+{
+    // tape is advanced lazily, estimate up to now
+    double hub_a_cm = _hub_a_cm;
+    if (_is_transporting()) {
+        double dt = ((double) pico_host::now_us() - _tape_time_us) / 1e6;
+        double takeup = _takeup_cm();
+        double wound;
+        if (_lift_head) {
+            wound = takeup + _config.tape_speed_cm_per_sec * dt;
+        } else {
+            wound = _wound_of(_rot_of(takeup) + _config.wind_hub_rps * dt);
+        }
+        if (wound > _tape.length_cm) wound = _tape.length_cm;
+        hub_a_cm = _takeup_is_a() ? wound : _tape.length_cm - wound;
+    }
+    return (float) (hub_a_cm / _config.tape_speed_cm_per_sec);
+}
+
+float crp42602y_sim::get_tape_length_sec() const
+{
+    return _tape.length_cm / _config.tape_speed_cm_per_sec;
+}
+
+float crp42602y_sim::get_hub_radius_cm(const int hub) const
+{
+    double wound = (hub == 0) ? _hub_a_cm : _tape.length_cm - _hub_a_cm;
+    double r0 = _tape.hub_core_radius_cm;
+    return (float) std::sqrt(r0 * r0 + wound * (_tape.thickness_um * 1e-4) / M_PI);
+}
+
+uint64_t crp42602y_sim::get_gear_start_us() const
+{
+    return _gear_start_us;
+}
+
+uint64_t crp42602y_sim::get_func_arrival_us() const
+{
+    return _func_arrival_us;
+}
+
+uint64_t crp42602y_sim::get_tape_end_us() const
+{
+    return _tape_end_us;
+}
+
+uint32_t crp42602y_sim::get_num_sensor_pulses() const
+{
+    return _num_sensor_pulses;
+}
+
+uint32_t crp42602y_sim::get_num_reel_mismatch() const
+{
+    return _num_reel_mismatch;
+}
+
+uint64_t crp42602y_sim::next_event_us() const
+{
+    uint64_t next = _cam_event_us();
+    if (_next_edge_us < next) next = _next_edge_us;
+    uint64_t tape_end = _tape_end_event_us();
+    if (tape_end < next) next = tape_end;
+    return next;
+}
+
+void crp42602y_sim::on_event(uint64_t now_us)
+{
+    _advance_cam(now_us);
+    _advance_tape(now_us);
+
+    // function gear
+    if (_cam == CAM_TO_FUNC) {
+        const uint32_t samples[3] = {_config.head_dir_sample_ms, _config.lift_head_sample_ms, _config.reel_sample_ms};
+        while (_next_sample < 3 && _cam_pos_ms >= samples[_next_sample] - EPSILON_MS) {
+            bool solenoid = _is_solenoid_pulled();
+            switch (_next_sample) {
+            case 0:
+                _head_dir_is_a = !solenoid;
+                break;
+            case 1:
+                _lift_head = solenoid;
+                break;
+            default:
+                _reel_fwd = solenoid;
+                break;
+            }
+            _next_sample++;
+        }
+        if (_next_sample >= 3 && !_jammed && _cam_pos_ms >= _config.func_rotation_ms - EPSILON_MS) {
+            _cam = CAM_FUNC;
+            _func_arrival_us = now_us;
+            if (_lift_head && _reel_fwd != _head_dir_is_a) {
+                _num_reel_mismatch++;
+            }
+            pico_host::gpio_drive(_pins.gear_status_sw, false);
+            _schedule_edge(now_us);
+        }
+    } else if (_cam == CAM_TO_STOP) {
+        if (!_jammed && _cam_pos_ms >= _config.return_rotation_ms - EPSILON_MS) {
+            _cam = CAM_STOP;
+        }
+    }
+
+    // rotation sensor
+    if (_next_edge_us != NO_EVENT && now_us >= _next_edge_us) {
+        bool level = (_next_boundary % 2) == 0;
+        double boundary = _boundary_pos(_next_boundary);
+        if (_sensor_pos < boundary) _sensor_pos = boundary;
+        _next_boundary++;
+        if (level) _num_sensor_pulses++;
+        pico_host::gpio_drive(_pins.rotation_sens, level);
+        _schedule_edge(now_us);
+    }
+}
+
+void crp42602y_sim::_on_solenoid(const bool level)
+{
+    uint64_t now = pico_host::now_us();
+    _advance_cam(now);
+    _advance_tape(now);
+    if (level) _solenoid_on_us = now;
+    if (!level || _cam_rate(now) <= 0.0) return;
+    // the rising edge unhooks the gear only at the resting positions
+    if (_cam == CAM_STOP) {
+        _cam = CAM_TO_FUNC;
+        _next_sample = 0;
+    } else if (_cam == CAM_FUNC) {
+        _cam = CAM_TO_STOP;
+        pico_host::gpio_drive(_pins.gear_status_sw, true);
+    } else {
+        return;
+    }
+    _cam_pos_ms = 0.0;
+    _cam_time_us = now;
+    _gear_start_us = now;
+    _schedule_edge(now);
+}
+
+bool crp42602y_sim::_is_solenoid_pulled() const
+{
+    // the duty is reduced to hold only once in a pull, thus the last duty change is the end of full drive
+    if (!gpio_get(_pins.solenoid_ctrl)) return false;
+    float duty = pico_host::gpio_get_duty(_pins.solenoid_ctrl);
+    if (duty >= 1.0f) return true;
+    if (duty < _config.solenoid_hold_duty) return false;
+    return pico_host::gpio_get_duty_change_us(_pins.solenoid_ctrl) >= _solenoid_on_us + (uint64_t) _config.solenoid_pull_in_ms * 1000;
+}
+
+void crp42602y_sim::_on_power(const bool level)
+{
+    uint64_t now = pico_host::now_us();
+    _advance_cam(now);
+    _advance_tape(now);
+    if (level && !_motor_on) _motor_on_us = now;
+    _motor_on = level;
+    _schedule_edge(now);
+}
+
+double crp42602y_sim::_cam_rate(const uint64_t t) const
+{
+    if (!_motor_on) return 0.0;
+    if (_pins.power_ctrl != 0 && t < _motor_on_us + (uint64_t) _config.motor_spinup_ms * 1000) return 0.5;
+    return 1.0;
+}
+
+void crp42602y_sim::_advance_cam(const uint64_t now_us)
+{
+    if ((_cam == CAM_TO_FUNC || _cam == CAM_TO_STOP) && now_us > _cam_time_us) {
+        // integrate the gear rotation over the spin-up boundary
+        uint64_t spun_up_us = _motor_on_us + (uint64_t) _config.motor_spinup_ms * 1000;
+        uint64_t t = _cam_time_us;
+        if (t < spun_up_us && now_us > spun_up_us) {
+            _cam_pos_ms += _cam_rate(t) * (double) (spun_up_us - t) / 1000.0;
+            t = spun_up_us;
+        }
+        _cam_pos_ms += _cam_rate(t) * (double) (now_us - t) / 1000.0;
+    }
+    _cam_time_us = now_us;
+}
+
+uint64_t crp42602y_sim::_cam_event_us() const
+{
+    double target_ms;
+    if (_cam == CAM_TO_FUNC) {
+        if (_next_sample == 0) {
+            target_ms = _config.head_dir_sample_ms;
+        } else if (_next_sample == 1) {
+            target_ms = _config.lift_head_sample_ms;
+        } else if (_next_sample == 2) {
+            target_ms = _config.reel_sample_ms;
+        } else if (!_jammed) {
+            target_ms = _config.func_rotation_ms;
+        } else {
+            return NO_EVENT;
+        }
+    } else if (_cam == CAM_TO_STOP && !_jammed) {
+        target_ms = _config.return_rotation_ms;
+    } else {
+        return NO_EVENT;
+    }
+    double rate = _cam_rate(_cam_time_us);
+    if (rate <= 0.0) return NO_EVENT;
+    double remaining_ms = target_ms - _cam_pos_ms;
+    if (remaining_ms < 0.0) remaining_ms = 0.0;
+    uint64_t t = _cam_time_us + (uint64_t) std::ceil(remaining_ms / rate * 1000.0);
+    // re-evaluate at the end of spin-up since the rate changes
+    uint64_t spun_up_us = _motor_on_us + (uint64_t) _config.motor_spinup_ms * 1000;
+    if (rate < 1.0 && _pins.power_ctrl != 0 && t > spun_up_us) return spun_up_us;
+    return t;
+}
+
+bool crp42602y_sim::_is_transporting() const
+{
+    if (_cam != CAM_FUNC || !_has_cassette || !_motor_on) return false;
+    if (_lift_head && _reel_fwd != _head_dir_is_a) return false;  // the pinch roller and the reel pull to opposite directions
+    return _takeup_cm() < _tape.length_cm - EPSILON_CM;
+}
+
+bool crp42602y_sim::_takeup_is_a() const
+{
+    return _lift_head ? _head_dir_is_a : _reel_fwd;
+}
+
+double crp42602y_sim::_takeup_cm() const
+{
+    return _takeup_is_a() ? _hub_a_cm : _tape.length_cm - _hub_a_cm;
+}
+
+double crp42602y_sim::_rot_of(const double wound_cm) const
+{
+    double r0 = _tape.hub_core_radius_cm;
+    double h = _tape.thickness_um * 1e-4;
+    return (std::sqrt(r0 * r0 + wound_cm * h / M_PI) - r0) / h;
+}
+
+double crp42602y_sim::_wound_of(const double rot) const
+{
+    double r0 = _tape.hub_core_radius_cm;
+    double h = _tape.thickness_um * 1e-4;
+    double r = r0 + h * rot;
+    return M_PI * (r * r - r0 * r0) / h;
+}
+
+void crp42602y_sim::_advance_tape(const uint64_t now_us)
+{
+    if (!_is_transporting() || (double) now_us <= _tape_time_us) {
+        if ((double) now_us > _tape_time_us) _tape_time_us = (double) now_us;
+        return;
+    }
+    double dt = ((double) now_us - _tape_time_us) / 1e6;
+    double takeup = _takeup_cm();
+    double rot = _rot_of(takeup);
+    double new_takeup;
+    double new_rot;
+    if (_lift_head) {
+        new_takeup = takeup + _config.tape_speed_cm_per_sec * dt;
+        if (new_takeup > _tape.length_cm) new_takeup = _tape.length_cm;
+        new_rot = _rot_of(new_takeup);
+    } else {
+        new_rot = rot + _config.wind_hub_rps * dt;
+        new_takeup = _wound_of(new_rot);
+        if (new_takeup > _tape.length_cm) {
+            new_takeup = _tape.length_cm;
+            new_rot = _rot_of(new_takeup);
+        }
+    }
+    _hub_a_cm = _takeup_is_a() ? new_takeup : _tape.length_cm - new_takeup;
+    _sensor_pos += (new_rot - rot) * _config.sensor_gear_ratio * _config.sensor_wings;
+    _tape_time_us = (double) now_us;
+    if (new_takeup >= _tape.length_cm - EPSILON_CM) {
+        _tape_end_us = now_us;
+        _next_edge_us = NO_EVENT;
+    }
+}
+
+double crp42602y_sim::_boundary_pos(const int64_t index) const
+{
+    // even: rising edge at the start of a wing, odd: falling edge after the high term
+    double wing = (double) (index / 2);
+    return (index % 2 == 0) ? wing : wing + _config.sensor_duty;
+}
+
+void crp42602y_sim::_schedule_edge(const uint64_t now_us)
+{
+    _next_edge_us = NO_EVENT;
+    if (!_is_transporting()) return;
+    double delta_rot = (_boundary_pos(_next_boundary) - _sensor_pos) / (_config.sensor_gear_ratio * _config.sensor_wings);
+    if (delta_rot < 0.0) delta_rot = 0.0;
+    double takeup = _takeup_cm();
+    double dt;
+    if (_lift_head) {
+        double target = _wound_of(_rot_of(takeup) + delta_rot);
+        if (target > _tape.length_cm) return;  // tape end comes first
+        dt = (target - takeup) / _config.tape_speed_cm_per_sec;
+    } else {
+        if (_rot_of(takeup) + delta_rot > _rot_of(_tape.length_cm)) return;
+        dt = delta_rot / _config.wind_hub_rps;
+    }
+    int64_t t = (int64_t) std::ceil(_tape_time_us + dt * 1e6);
+    if (_config.sensor_jitter_us > 0) {
+        _rand = _rand * 1103515245UL + 12345UL;
+        t += (int64_t) ((_rand >> 8) % (2 * _config.sensor_jitter_us + 1)) - (int64_t) _config.sensor_jitter_us;
+    }
+    if (t < (int64_t) now_us) t = (int64_t) now_us;
+    _next_edge_us = (uint64_t) t;
+}
+
+uint64_t crp42602y_sim::_tape_end_event_us() const
+{
+    if (!_is_transporting()) return NO_EVENT;
+    double takeup = _takeup_cm();
+    double dt;
+    if (_lift_head) {
+        dt = (_tape.length_cm - takeup) / _config.tape_speed_cm_per_sec;
+    } else {
+        dt = (_rot_of(_tape.length_cm) - _rot_of(takeup)) / _config.wind_hub_rps;
+    }
+    return (uint64_t) std::ceil(_tape_time_us + dt * 1e6);
+}
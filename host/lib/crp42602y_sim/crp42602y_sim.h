@@ -0,0 +1,191 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico_host.h"
+
+// CRP42602Y mechanism model for pico_host world
+//   Function gear: solenoid pull unhooks the gear, then the gear rotates by the motor
+//                  and the solenoid level at each cam window selects head direction, head lift and reel direction.
+//                  Gear status switch turns on (0) at the arrival of function position.
+//   Solenoid:      the armature is pulled in by full drive and held by PWM duty above the threshold
+//   Motor:         the gear rotates at half speed until the motor spins up after power on
+//   Reels:         tape wound on each hub gives radius r = sqrt(r0^2 + L * h / pi),
+//                  the hub rolling up rotates by (r - r0) / h turns from empty.
+//                  Play moves the tape at constant speed, FF/REW rotates the hub rolling up at constant speed.
+//   Rotation sensor: pulses from the hub rolling up through the sensor gear (the same as the actual mechanism)
+
+class crp42602y_sim : public pico_host::device {
+    public:
+    /**
+     * Definitions
+     */
+    typedef struct _pins_t {
+        uint cassette_detect;
+        uint gear_status_sw;
+        uint rotation_sens;
+        uint solenoid_ctrl;
+        uint power_ctrl;  // 0 for not use (motor is always powered)
+        uint rec_a_sw;    // 0 for not use
+        uint rec_b_sw;    // 0 for not use
+    } pins_t;
+    typedef struct _tape_t {
+        float length_cm;
+        float thickness_um;
+        float hub_core_radius_cm;
+    } tape_t;
+    typedef struct _config_t {
+        float    tape_speed_cm_per_sec;
+        float    wind_hub_rps;          // rotation speed of the hub rolling up in FF/REW
+        uint32_t motor_spinup_ms;       // the gear rotates at half speed until this time after power on
+        uint32_t func_rotation_ms;      // rotation time to function position
+        uint32_t return_rotation_ms;    // rotation time to stop position
+        uint32_t head_dir_sample_ms;    // timing when head direction is determined (solenoid on: B)
+        uint32_t lift_head_sample_ms;   // timing when head lift is determined (solenoid on: lift = play)
+        uint32_t reel_sample_ms;        // timing when reel direction is determined (solenoid on: A)
+        uint32_t solenoid_pull_in_ms;   // full drive time needed to pull in the armature
+        float    solenoid_hold_duty;    // minimum PWM duty to hold the armature pulled in
+        uint32_t sensor_wings;          // number of wings of rotation sensor obstacle
+        float    sensor_gear_ratio;     // rotations of the obstacle per hub rotation
+        float    sensor_duty;           // ratio of high level in a wing
+        uint32_t sensor_jitter_us;      // random jitter of each sensor edge (+/-)
+        uint32_t seed;                  // seed of the jitter
+    } config_t;
+    typedef enum _mode_t {
+        MODE_NO_FUNC = 0,   // gear at stop position
+        MODE_GEAR_MOVING,   // gear rotating
+        MODE_PLAY,
+        MODE_WIND,          // FF/REW/CUE
+        MODE_STALL          // gear in function position but tape doesn't run (end of tape, no cassette, no power or mismatch)
+    } mode_t;
+
+    static const config_t DEFAULT_CONFIG;
+
+    /**
+     * get tape definition of cassette
+     *
+     * @param[in] minutes_per_side playing time of a side (e.g. 45 for C-90)
+     * @param[in] thickness_um tape thickness (e.g. 12 for C-90)
+     * @return tape definition (nominal hub core radius)
+     */
+    static tape_t make_tape(const float minutes_per_side, const float thickness_um);
+
+    /**
+     * crp42602y_sim class constructor
+     *   call after pico_host::reset()
+     *
+     * @param[in] pins GPIO numbers connected to the program (the same as crp42602y_ctrl)
+     * @param[in] config mechanism configuration
+     */
+    crp42602y_sim(const pins_t& pins, const config_t& config = DEFAULT_CONFIG);
+
+    /**
+     * crp42602y_sim class destructor
+     */
+    virtual ~crp42602y_sim();
+
+    /**
+     * insert cassette
+     *
+     * @param[in] tape tape definition
+     * @param[in] position_sec tape position as elapsed playing time of side A
+     * @param[in] rec_a_ok rec tab of side A exists
+     * @param[in] rec_b_ok rec tab of side B exists
+     */
+    void insert_cassette(const tape_t& tape, const float position_sec = 0.0, const bool rec_a_ok = false, const bool rec_b_ok = false);
+
+    /**
+     * eject cassette
+     */
+    void eject_cassette();
+
+    /**
+     * jam the function gear (the gear doesn't reach the target position)
+     */
+    void set_gear_jammed(const bool jammed);
+
+    mode_t get_mode() const;
+    bool is_in_func() const;
+    bool is_gear_moving() const;
+    bool get_head_dir_is_a() const;
+    bool get_reel_fwd() const;
+    /**
+     * get tape position
+     *
+     * @return elapsed playing time of side A (the remaining time of side B is the same)
+     */
+    float get_position_sec() const;
+    float get_tape_length_sec() const;
+    float get_hub_radius_cm(const int hub) const;  // hub 0: rolling up in side A play, hub 1: in side B play
+    uint64_t get_gear_start_us() const;     // time when the last gear rotation started
+    uint64_t get_func_arrival_us() const;   // time when the gear arrived at function position last time
+    uint64_t get_tape_end_us() const;       // time when the tape reached the end last time (0 if not yet)
+    uint32_t get_num_sensor_pulses() const;
+    uint32_t get_num_reel_mismatch() const;  // play with opposite reel direction (tape stress)
+
+    // pico_host::device
+    uint64_t next_event_us() const override;
+    void on_event(uint64_t now_us) override;
+
+    protected:
+    typedef enum _cam_state_t {
+        CAM_STOP = 0,
+        CAM_TO_FUNC,
+        CAM_FUNC,
+        CAM_TO_STOP
+    } cam_state_t;
+
+    const pins_t _pins;
+    const config_t _config;
+    // motor
+    bool _motor_on;
+    uint64_t _motor_on_us;
+    // gear
+    cam_state_t _cam;
+    double _cam_pos_ms;
+    uint64_t _cam_time_us;
+    int _next_sample;
+    bool _jammed;
+    bool _head_dir_is_a;
+    bool _lift_head;
+    bool _reel_fwd;
+    uint64_t _gear_start_us;
+    uint64_t _func_arrival_us;
+    uint64_t _solenoid_on_us;
+    // tape
+    bool _has_cassette;
+    tape_t _tape;
+    double _hub_a_cm;  // tape length wound on hub 0
+    double _tape_time_us;
+    uint64_t _tape_end_us;
+    uint32_t _num_reel_mismatch;
+    // rotation sensor
+    double _sensor_pos;  // in wings
+    int64_t _next_boundary;  // index of next sensor edge (even: rising, odd: falling)
+    uint64_t _next_edge_us;
+    uint32_t _num_sensor_pulses;
+    uint32_t _rand;
+    // listeners
+    uint _solenoid_listener;
+    uint _power_listener;
+
+    void _on_solenoid(const bool level);
+    bool _is_solenoid_pulled() const;
+    void _on_power(const bool level);
+    double _cam_rate(const uint64_t t) const;
+    void _advance_cam(const uint64_t now_us);
+    uint64_t _cam_event_us() const;
+    bool _is_transporting() const;
+    bool _takeup_is_a() const;
+    double _takeup_cm() const;
+    double _rot_of(const double wound_cm) const;
+    double _wound_of(const double rot) const;
+    void _advance_tape(const uint64_t now_us);
+    double _boundary_pos(const int64_t index) const;
+    void _schedule_edge(const uint64_t now_us);
+    uint64_t _tape_end_event_us() const;
+};
@@ -0,0 +1,211 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include "deck_proto_client.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+deck_proto_client::deck_proto_client() :
+    _fd(-1),
+    _parser(),
+    _next_ticket(1),
+    _responses(),
+    _telemetry_callback(nullptr),
+    _event_callback(nullptr)
+{
+}
+
+deck_proto_client::~deck_proto_client()
+{
+    close();
+}
+
+bool deck_proto_client::open(const char* path, const int baud)
+{
+    close();
+    _fd = ::open(path, O_RDWR | O_NOCTTY);
+    if (_fd < 0) return false;
+    struct termios tio;
+    if (tcgetattr(_fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        speed_t speed = (baud == 9600) ? B9600 : (baud == 57600) ? B57600 : (baud == 230400) ? B230400 : B115200;
+        cfsetispeed(&tio, speed);
+        cfsetospeed(&tio, speed);
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(_fd, TCSANOW, &tio);
+    }
+    _parser.reset();
+    _responses.clear();
+    return true;
+}
+
+void deck_proto_client::close()
+{
+    if (_fd >= 0) ::close(_fd);
+    _fd = -1;
+}
+
+int deck_proto_client::request(const uint8_t type, const uint8_t* params, const size_t len)
+{
+    if (len > deck_proto::MAX_PAYLOAD - deck_proto::TICKET_SIZE) return -1;
+    uint16_t ticket = _next_ticket++;
+    if (_next_ticket == 0) _next_ticket = 1;  // 0 is for the requests without ticket
+    uint8_t payload[deck_proto::MAX_PAYLOAD];
+    deck_proto::put_u16(&payload[0], ticket);
+    if (len > 0) memcpy(&payload[deck_proto::TICKET_SIZE], params, len);
+    uint8_t frame[deck_proto::MAX_FRAME];
+    size_t frame_len = deck_proto::encode(frame, type, payload, deck_proto::TICKET_SIZE + len);
+    if (!write_raw(frame, frame_len)) return -1;
+    return ticket;
+}
+
+bool deck_proto_client::write_raw(const uint8_t* data, const size_t len)
+{
+    if (_fd < 0) return false;
+    size_t pos = 0;
+    while (pos < len) {
+        ssize_t n = ::write(_fd, &data[pos], len - pos);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            return false;
+        }
+        pos += n;
+    }
+    return true;
+}
+
+bool deck_proto_client::wait_response(const uint16_t ticket, deck_proto::frame_t& frame, const int timeout_ms)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (true) {
+        auto it = _responses.find(ticket);
+        if (it != _responses.end()) {
+            frame = it->second;
+            _responses.erase(it);
+            return true;
+        }
+        int remaining_ms = (int) std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (remaining_ms < 0 || !_receive(remaining_ms)) return false;
+    }
+}
+
+void deck_proto_client::poll(const int timeout_ms)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    do {
+        int remaining_ms = (int) std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (!_receive((remaining_ms > 0) ? remaining_ms : 0)) break;
+    } while (std::chrono::steady_clock::now() < deadline);
+}
+
+bool deck_proto_client::send_commands(const uint8_t* codes, const size_t num_codes, deck_proto::status_t& status, uint8_t& accepted)
+{
+    return _request_ack(deck_proto::MSG_COMMANDS, codes, num_codes, status, accepted);
+}
+
+bool deck_proto_client::get_state(deck_proto::state_t& state)
+{
+    int ticket = request(deck_proto::MSG_GET_STATE, nullptr, 0);
+    deck_proto::frame_t frame;
+    if (ticket < 0 || !wait_response(ticket, frame)) return false;
+    if (frame.type != deck_proto::MSG_STATE || frame.len != deck_proto::TICKET_SIZE + deck_proto::STATE_SIZE) return false;
+    deck_proto::get_state(&frame.payload[deck_proto::TICKET_SIZE], state);
+    return true;
+}
+
+bool deck_proto_client::get_counter(deck_proto::counter_t& counter)
+{
+    int ticket = request(deck_proto::MSG_GET_COUNTER, nullptr, 0);
+    deck_proto::frame_t frame;
+    if (ticket < 0 || !wait_response(ticket, frame)) return false;
+    if (frame.type != deck_proto::MSG_COUNTER || frame.len != deck_proto::TICKET_SIZE + deck_proto::COUNTER_SIZE) return false;
+    deck_proto::get_counter(&frame.payload[deck_proto::TICKET_SIZE], counter);
+    return true;
+}
+
+bool deck_proto_client::subscribe(const uint16_t interval_ms, const bool events)
+{
+    uint8_t params[3];
+    deck_proto::put_u16(&params[0], interval_ms);
+    params[2] = events ? 1 : 0;
+    deck_proto::status_t status;
+    uint8_t accepted;
+    return _request_ack(deck_proto::MSG_SUBSCRIBE, params, sizeof(params), status, accepted) && status == deck_proto::STATUS_OK;
+}
+
+bool deck_proto_client::ping(const uint8_t* data, const size_t len)
+{
+    int ticket = request(deck_proto::MSG_PING, data, len);
+    deck_proto::frame_t frame;
+    if (ticket < 0 || !wait_response(ticket, frame)) return false;
+    return frame.type == deck_proto::MSG_PONG && frame.len == deck_proto::TICKET_SIZE + len &&
+           (len == 0 || memcmp(&frame.payload[deck_proto::TICKET_SIZE], data, len) == 0);
+}
+
+void deck_proto_client::set_telemetry_callback(const telemetry_callback_t& callback)
+{
+    _telemetry_callback = callback;
+}
+
+void deck_proto_client::set_event_callback(const event_callback_t& callback)
+{
+    _event_callback = callback;
+}
+
+const deck_proto::parser_stats_t& deck_proto_client::get_parser_stats() const
+{
+    return _parser.get_stats();
+}
+
+bool deck_proto_client::_receive(const int timeout_ms)
+{
+    if (_fd < 0) return false;
+    struct pollfd pfd = {_fd, POLLIN, 0};
+    int ret = ::poll(&pfd, 1, timeout_ms);
+    if (ret <= 0) return false;
+    uint8_t buf[256];
+    ssize_t n = ::read(_fd, buf, sizeof(buf));
+    if (n <= 0) return false;
+    for (ssize_t i = 0; i < n; i++) {
+        if (_parser.feed(buf[i]) == deck_proto::FEED_FRAME) {
+            _dispatch(_parser.get_frame());
+        }
+    }
+    return true;
+}
+
+void deck_proto_client::_dispatch(const deck_proto::frame_t& frame)
+{
+    if (frame.type == deck_proto::MSG_TELEMETRY) {
+        if (frame.len != deck_proto::TELEMETRY_SIZE || !_telemetry_callback) return;
+        deck_proto::telemetry_t telemetry;
+        deck_proto::get_telemetry(frame.payload, telemetry);
+        _telemetry_callback(telemetry);
+    } else if (frame.type == deck_proto::MSG_EVENT) {
+        if (frame.len != deck_proto::EVENT_SIZE || !_event_callback) return;
+        _event_callback(frame.payload[0], deck_proto::get_u32(&frame.payload[1]));
+    } else if ((frame.type & 0x80) && frame.len >= deck_proto::TICKET_SIZE) {
+        _responses[deck_proto::get_u16(&frame.payload[0])] = frame;
+    }
+}
+
+bool deck_proto_client::_request_ack(const uint8_t type, const uint8_t* params, const size_t len, deck_proto::status_t& status, uint8_t& accepted)
+{
+    int ticket = request(type, params, len);
+    deck_proto::frame_t frame;
+    if (ticket < 0 || !wait_response(ticket, frame)) return false;
+    if (frame.type != deck_proto::MSG_ACK || frame.len != deck_proto::TICKET_SIZE + 2) return false;
+    status = (deck_proto::status_t) frame.payload[2];
+    accepted = frame.payload[3];
+    return true;
+}
@@ -0,0 +1,150 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+
+#include "deck_proto.h"
+
+// Host side of deck_proto over a serial port (POSIX)
+//   request() sends a request and returns its ticket at once, thus requests can be pipelined,
+//   wait_response() takes the response of the ticket (the responses of the other tickets are kept)
+//   notifications are dispatched to the callbacks while waiting or by poll(),
+//   the text output of the device on the same serial is skipped by the parser
+class deck_proto_client {
+    public:
+    /**
+     * Definitions
+     */
+    typedef std::function<void(const deck_proto::telemetry_t& telemetry)> telemetry_callback_t;
+    typedef std::function<void(const uint8_t callback_type, const uint32_t time_ms)> event_callback_t;
+
+    // Constants
+    static constexpr int DEFAULT_TIMEOUT_MS = 1000;
+
+    /**
+     * deck_proto_client class constructor
+     */
+    deck_proto_client();
+
+    /**
+     * deck_proto_client class destructor
+     */
+    virtual ~deck_proto_client();
+
+    /**
+     * open serial port in raw mode
+     *
+     * @param[in] path device path (e.g. /dev/ttyACM0)
+     * @param[in] baud baud rate (ignored by USB CDC)
+     * @return true if opened
+     */
+    bool open(const char* path, const int baud = 115200);
+
+    /**
+     * close serial port
+     */
+    void close();
+
+    /**
+     * send request
+     *
+     * @param[in] type message type of request (deck_proto::MSG_xxx)
+     * @param[in] params parameters following the ticket
+     * @param[in] len length of parameters (~ MAX_PAYLOAD - TICKET_SIZE)
+     * @return ticket (-1 if failed)
+     */
+    int request(const uint8_t type, const uint8_t* params, const size_t len);
+
+    /**
+     * write bytes as they are (e.g. single character commands of the samples)
+     *
+     * @return true if written
+     */
+    bool write_raw(const uint8_t* data, const size_t len);
+
+    /**
+     * wait for the response of the ticket
+     *
+     * @param[in] ticket ticket returned by request()
+     * @param[out] frame response frame (payload starts with the ticket)
+     * @param[in] timeout_ms timeout in milliseconds
+     * @return true if received
+     */
+    bool wait_response(const uint16_t ticket, deck_proto::frame_t& frame, const int timeout_ms = DEFAULT_TIMEOUT_MS);
+
+    /**
+     * receive and dispatch the frames until timeout
+     *
+     * @param[in] timeout_ms timeout in milliseconds (0: only the bytes already received)
+     */
+    void poll(const int timeout_ms = 0);
+
+    /**
+     * send command codes executed in order (MSG_COMMANDS)
+     *
+     * @param[in] codes command codes (deck_proto::CODE_xxx)
+     * @param[in] num_codes number of codes (1 ~ MAX_BATCH)
+     * @param[out] status status of ACK
+     * @param[out] accepted number of codes accepted from the first one
+     * @return true if ACK received
+     */
+    bool send_commands(const uint8_t* codes, const size_t num_codes, deck_proto::status_t& status, uint8_t& accepted);
+
+    /**
+     * get state (MSG_GET_STATE)
+     *
+     * @return true if received
+     */
+    bool get_state(deck_proto::state_t& state);
+
+    /**
+     * get counter snapshot (MSG_GET_COUNTER)
+     *
+     * @return true if received (false also without counter)
+     */
+    bool get_counter(deck_proto::counter_t& counter);
+
+    /**
+     * subscribe telemetry and events (MSG_SUBSCRIBE)
+     *
+     * @param[in] interval_ms telemetry interval in milliseconds (0: stop)
+     * @param[in] events true to notify callbacks of the device
+     * @return true if accepted
+     */
+    bool subscribe(const uint16_t interval_ms, const bool events);
+
+    /**
+     * ping (MSG_PING)
+     *
+     * @param[in] data data to be echoed
+     * @param[in] len length of data (~ MAX_PAYLOAD - TICKET_SIZE)
+     * @return true if echoed correctly
+     */
+    bool ping(const uint8_t* data, const size_t len);
+
+    void set_telemetry_callback(const telemetry_callback_t& callback);
+    void set_event_callback(const event_callback_t& callback);
+
+    /**
+     * get statistics of the parser
+     */
+    const deck_proto::parser_stats_t& get_parser_stats() const;
+
+    protected:
+    int _fd;
+    deck_proto _parser;
+    uint16_t _next_ticket;
+    std::unordered_map<uint16_t, deck_proto::frame_t> _responses;
+    telemetry_callback_t _telemetry_callback;
+    event_callback_t _event_callback;
+
+    bool _receive(const int timeout_ms);
+    void _dispatch(const deck_proto::frame_t& frame);
+    bool _request_ack(const uint8_t type, const uint8_t* params, const size_t len, deck_proto::status_t& status, uint8_t& accepted);
+};
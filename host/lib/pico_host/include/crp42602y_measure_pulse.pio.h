@@ -0,0 +1,39 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+// Host substitute of the header generated from crp42602y_measure_pulse.pio
+//   program_init binds the behavioral model of crp42602y_measure_pulse to the state machine
+
+#pragma once
+
+#include "hardware/pio.h"
+#include "pico_host.h"
+
+#define crp42602y_measure_pulse_offset_entry_point 2u
+
+// instruction words are not interpreted, only the length matters for instruction memory allocation
+static const uint16_t crp42602y_measure_pulse_program_instructions[19] = {};
+
+static const pio_program_t crp42602y_measure_pulse_program = {
+    crp42602y_measure_pulse_program_instructions,
+    19,
+    -1
+};
+
+static inline pio_sm_config crp42602y_measure_pulse_program_get_default_config(uint offset)
+{
+    pio_sm_config c = {0};
+    (void) offset;
+    return c;
+}
+
+static inline void crp42602y_measure_pulse_program_init(PIO pio, uint sm, uint offset, uint entry_point, pio_sm_config (*get_default_config)(uint), uint pin)
+{
+    (void) offset;
+    (void) entry_point;
+    (void) get_default_config;
+    pico_host::pio_bind_measure_pulse(pio, sm, pin);
+}
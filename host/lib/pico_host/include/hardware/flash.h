@@ -0,0 +1,24 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico.h"
+
+// Flash is modeled as a NOR array (erase sets bits, program only clears bits) kept across pico_host::reset() as nonvolatile,
+// read through XIP_BASE as on device
+#define FLASH_PAGE_SIZE       (1u << 8)
+#define FLASH_SECTOR_SIZE     (1u << 12)
+#define PICO_FLASH_SIZE_BYTES (2 * 1024 * 1024)
+
+namespace pico_host {
+uintptr_t flash_xip_base();
+}
+
+#define XIP_BASE (pico_host::flash_xip_base())
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count);
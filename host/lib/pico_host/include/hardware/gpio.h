@@ -0,0 +1,61 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico.h"
+#include "hardware/irq.h"
+
+#define GPIO_OUT 1
+#define GPIO_IN  0
+
+typedef enum gpio_function {
+    GPIO_FUNC_PWM  = 4,
+    GPIO_FUNC_SIO  = 5,
+    GPIO_FUNC_PIO0 = 6,
+    GPIO_FUNC_PIO1 = 7,
+    GPIO_FUNC_NULL = 0x1f,
+} gpio_function_t;
+
+enum gpio_irq_level {
+    GPIO_IRQ_LEVEL_LOW  = 0x1u,
+    GPIO_IRQ_LEVEL_HIGH = 0x2u,
+    GPIO_IRQ_EDGE_FALL  = 0x4u,
+    GPIO_IRQ_EDGE_RISE  = 0x8u,
+};
+
+void gpio_init(uint gpio);
+void gpio_deinit(uint gpio);
+void gpio_set_function(uint gpio, gpio_function_t fn);
+gpio_function_t gpio_get_function(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+bool gpio_get_dir(uint gpio);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+bool gpio_get_out_level(uint gpio);
+void gpio_set_pulls(uint gpio, bool up, bool down);
+
+// edge events only (level events are not modeled)
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled);
+uint32_t gpio_get_irq_event_mask(uint gpio);
+void gpio_acknowledge_irq(uint gpio, uint32_t event_mask);
+void gpio_add_raw_irq_handler_masked(uint32_t gpio_mask, irq_handler_t handler);
+void gpio_remove_raw_irq_handler_masked(uint32_t gpio_mask, irq_handler_t handler);
+
+static inline void gpio_pull_up(uint gpio)
+{
+    gpio_set_pulls(gpio, true, false);
+}
+
+static inline void gpio_pull_down(uint gpio)
+{
+    gpio_set_pulls(gpio, false, true);
+}
+
+static inline void gpio_disable_pulls(uint gpio)
+{
+    gpio_set_pulls(gpio, false, false);
+}
@@ -0,0 +1,34 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico.h"
+
+// I2C is modeled as blocking writes without bus timing, the registers are only for the code accessing them
+typedef struct {
+    volatile uint32_t enable;
+    volatile uint32_t tar;
+    volatile uint32_t data_cmd;
+    volatile uint32_t status;
+    volatile uint32_t raw_intr_stat;
+    volatile uint32_t clr_tx_abrt;
+} i2c_hw_t;
+
+typedef struct i2c_inst i2c_inst_t;
+
+extern i2c_inst_t* const i2c0;
+extern i2c_inst_t* const i2c1;
+
+#define I2C_IC_STATUS_TFE_BITS            0x00000004u
+#define I2C_IC_STATUS_MST_ACTIVITY_BITS   0x00000020u
+#define I2C_IC_DATA_CMD_STOP_BITS         0x00000200u
+#define I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS 0x00000040u
+
+uint i2c_init(i2c_inst_t* i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t* i2c, uint8_t addr, const uint8_t* src, size_t len, bool nostop);
+i2c_hw_t* i2c_get_hw(i2c_inst_t* i2c);
+uint i2c_get_dreq(i2c_inst_t* i2c, bool is_tx);
@@ -0,0 +1,64 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico.h"
+#include "hardware/irq.h"
+
+// PIO blocks are not emulated instruction by instruction,
+//  instead the state machine runs a behavioral model of the program bound by its program_init function
+
+#define NUM_PIOS 2
+#define NUM_PIO_STATE_MACHINES 4
+#define PIO_INSTRUCTION_COUNT 32
+
+typedef struct {
+    volatile uint32_t irq;  // IRQ flags raised by state machines
+} pio_hw_t;
+
+typedef pio_hw_t* PIO;
+
+typedef struct pio_program {
+    const uint16_t* instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+
+typedef struct {
+    uint32_t clkdiv;
+} pio_sm_config;
+
+enum pio_interrupt_source {
+    pis_interrupt0 = 8,
+    pis_interrupt1,
+    pis_interrupt2,
+    pis_interrupt3
+};
+
+PIO pio_get_instance(uint instance);
+#define pio0 pio_get_instance(0)
+#define pio1 pio_get_instance(1)
+
+uint pio_get_index(PIO pio);
+uint pio_get_irq_num(PIO pio, uint irqn);
+bool pio_can_add_program(PIO pio, const pio_program_t* program);
+uint pio_add_program(PIO pio, const pio_program_t* program);
+void pio_remove_program(PIO pio, const pio_program_t* program, uint loaded_offset);
+int  pio_claim_unused_sm(PIO pio, bool required);
+void pio_sm_claim(PIO pio, uint sm);
+void pio_sm_unclaim(PIO pio, uint sm);
+bool pio_sm_is_claimed(PIO pio, uint sm);
+void pio_set_irqn_source_enabled(PIO pio, uint irq_index, enum pio_interrupt_source source, bool enabled);
+void pio_interrupt_clear(PIO pio, uint pio_interrupt_num);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void pio_sm_clear_fifos(PIO pio, uint sm);
+uint pio_sm_get_rx_fifo_level(PIO pio, uint sm);
+uint pio_sm_get_tx_fifo_level(PIO pio, uint sm);
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm);
+uint32_t pio_sm_get(PIO pio, uint sm);
+uint32_t pio_sm_get_blocking(PIO pio, uint sm);
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
@@ -0,0 +1,48 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico.h"
+
+#define NUM_PWM_SLICES 8
+
+// the output is modeled by its duty (see pico_host::gpio_get_duty()), not by the waveform
+typedef struct {
+    uint32_t csr;
+    uint32_t div;
+    uint32_t top;
+} pwm_config;
+
+static inline uint pwm_gpio_to_slice_num(uint gpio)
+{
+    return (gpio >> 1u) & 7u;
+}
+
+static inline uint pwm_gpio_to_channel(uint gpio)
+{
+    return gpio & 1u;
+}
+
+static inline pwm_config pwm_get_default_config()
+{
+    return {0, 1u << 4u, 0xffff};
+}
+
+static inline void pwm_config_set_clkdiv(pwm_config* c, float div)
+{
+    c->div = (uint32_t) (div * (1u << 4u));
+}
+
+static inline void pwm_config_set_wrap(pwm_config* c, uint16_t wrap)
+{
+    c->top = wrap;
+}
+
+void pwm_init(uint slice_num, pwm_config* c, bool start);
+void pwm_set_clkdiv(uint slice_num, float divider);
+void pwm_set_enabled(uint slice_num, bool enabled);
+void pwm_set_gpio_level(uint gpio, uint16_t level);
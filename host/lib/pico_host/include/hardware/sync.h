@@ -0,0 +1,35 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico.h"
+
+// pico_host world runs in a single thread, therefore only compiler barriers are needed
+static inline void __mem_fence_acquire()
+{
+    __asm__ volatile ("" ::: "memory");
+}
+
+static inline void __mem_fence_release()
+{
+    __asm__ volatile ("" ::: "memory");
+}
+
+static inline void __dmb()
+{
+    __asm__ volatile ("" ::: "memory");
+}
+
+// SEV/WFE: event flag of the world (set by __sev(), queue notification and IRQ delivery)
+//   waiting for the event with timeout is given by best_effort_wfe_or_timeout()
+void __sev();
+void __wfe();
+static inline void __wfi() {}
+
+// IRQ delivery is deferred while disabled (nestable)
+uint32_t save_and_disable_interrupts();
+void restore_interrupts(uint32_t status);
@@ -0,0 +1,39 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico.h"
+
+// UART TX is modeled by the FIFO of 32 bytes drained at the baud rate (10 bits per byte) in virtual time,
+//   the blocking functions advance virtual time until the FIFO has room as core0 waits on device
+//   RX has no data, the registers are only for the code accessing them
+typedef struct {
+    volatile uint32_t dr;
+} uart_hw_t;
+
+typedef struct uart_inst uart_inst_t;
+
+extern uart_inst_t* const uart0;
+extern uart_inst_t* const uart1;
+
+#ifndef uart_default
+#define uart_default uart0
+#endif
+
+#define UART_FIFO_DEPTH 32
+
+uint uart_init(uart_inst_t* uart, uint baudrate);
+uint uart_set_baudrate(uart_inst_t* uart, uint baudrate);
+bool uart_is_writable(uart_inst_t* uart);
+bool uart_is_readable(uart_inst_t* uart);
+void uart_putc_raw(uart_inst_t* uart, char c);
+void uart_write_blocking(uart_inst_t* uart, const uint8_t* src, size_t len);
+void uart_puts(uart_inst_t* uart, const char* s);
+char uart_getc(uart_inst_t* uart);
+void uart_tx_wait_blocking(uart_inst_t* uart);
+uart_hw_t* uart_get_hw(uart_inst_t* uart);
+uint uart_get_dreq(uart_inst_t* uart, bool is_tx);
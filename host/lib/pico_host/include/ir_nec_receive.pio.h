@@ -0,0 +1,28 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+// Host substitute of the header generated from ir_nec_receive.pio
+//   program_init binds the behavioral model of ir_nec_receive to the state machine
+
+#pragma once
+
+#include "hardware/pio.h"
+#include "pico_host.h"
+
+// instruction words are not interpreted, only the length matters for instruction memory allocation
+static const uint16_t ir_nec_receive_program_instructions[14] = {};
+
+static const pio_program_t ir_nec_receive_program = {
+    ir_nec_receive_program_instructions,
+    14,
+    -1
+};
+
+static inline void ir_nec_receive_program_init(PIO pio, uint sm, uint offset, uint pin)
+{
+    (void) offset;
+    pico_host::pio_bind_ir_nec(pio, sm, pin);
+}
@@ -0,0 +1,28 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+// Host substitute of the header generated from ir_rc5_receive.pio
+//   program_init binds the behavioral model of ir_rc5_receive to the state machine
+
+#pragma once
+
+#include "hardware/pio.h"
+#include "pico_host.h"
+
+// instruction words are not interpreted, only the length matters for instruction memory allocation
+static const uint16_t ir_rc5_receive_program_instructions[16] = {};
+
+static const pio_program_t ir_rc5_receive_program = {
+    ir_rc5_receive_program_instructions,
+    16,
+    -1
+};
+
+static inline void ir_rc5_receive_program_init(PIO pio, uint sm, uint offset, uint pin)
+{
+    (void) offset;
+    pico_host::pio_bind_ir_rc5(pio, sm, pin);
+}
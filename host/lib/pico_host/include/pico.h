@@ -0,0 +1,47 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+// Host (Linux) substitute of pico-sdk for simulation
+//   only the subset used by this repository is provided
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <sys/types.h>
+
+typedef unsigned int uint;
+
+#define __isr
+#define __time_critical_func(func_name) func_name
+#define __not_in_flash_func(func_name) func_name
+#define __no_inline_not_in_flash_func(func_name) func_name
+#define __force_inline inline
+
+#define PICO_ON_DEVICE 0
+#define PICO_HOST_SIM 1
+
+#define NUM_BANK0_GPIOS 30
+#define NUM_CORES 2
+
+enum pico_error_codes {
+    PICO_OK = 0,
+    PICO_ERROR_NONE = 0,
+    PICO_ERROR_TIMEOUT = -1,
+    PICO_ERROR_GENERIC = -2,
+    PICO_ERROR_NO_DATA = -3
+};
+
+[[noreturn]] void panic(const char* fmt, ...);
+
+static inline uint get_core_num()
+{
+    return 0;
+}
+
+static inline void tight_loop_contents()
+{
+}
@@ -0,0 +1,12 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+#include "hardware/timer.h"
@@ -0,0 +1,36 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico.h"
+#include "hardware/sync.h"
+
+typedef struct {
+    uint32_t save;
+    bool     initialized;
+} critical_section_t;
+
+static inline void critical_section_init(critical_section_t* crit_sec)
+{
+    crit_sec->save = 0;
+    crit_sec->initialized = true;
+}
+
+static inline void critical_section_enter_blocking(critical_section_t* crit_sec)
+{
+    crit_sec->save = save_and_disable_interrupts();
+}
+
+static inline void critical_section_exit(critical_section_t* crit_sec)
+{
+    restore_interrupts(crit_sec->save);
+}
+
+static inline void critical_section_deinit(critical_section_t* crit_sec)
+{
+    crit_sec->initialized = false;
+}
@@ -0,0 +1,70 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico.h"
+
+// virtual time of pico_host world (microseconds since boot)
+typedef uint64_t absolute_time_t;
+
+static constexpr absolute_time_t at_the_end_of_time = UINT64_MAX;
+
+absolute_time_t get_absolute_time();
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t)
+{
+    return (uint32_t) (t / 1000);
+}
+
+static inline uint64_t to_us_since_boot(absolute_time_t t)
+{
+    return t;
+}
+
+static inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us)
+{
+    return t + us;
+}
+
+static inline absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms)
+{
+    return t + (uint64_t) ms * 1000;
+}
+
+static inline absolute_time_t make_timeout_time_us(uint64_t us)
+{
+    return delayed_by_us(get_absolute_time(), us);
+}
+
+static inline absolute_time_t make_timeout_time_ms(uint32_t ms)
+{
+    return delayed_by_ms(get_absolute_time(), ms);
+}
+
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to)
+{
+    return (int64_t) (to - from);
+}
+
+static inline absolute_time_t absolute_time_min(absolute_time_t a, absolute_time_t b)
+{
+    return (a < b) ? a : b;
+}
+
+static inline bool time_reached(absolute_time_t t)
+{
+    return get_absolute_time() >= t;
+}
+
+// wait for event advances virtual time until the timeout or the event (SEV, queue notification or IRQ)
+//   return true if the timeout is reached
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp);
+
+// sleep advances virtual time (events and IRQ handlers are processed meanwhile)
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void sleep_until(absolute_time_t t);
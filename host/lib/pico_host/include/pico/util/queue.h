@@ -0,0 +1,31 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico.h"
+
+typedef struct {
+    uint8_t* data;
+    uint     element_size;
+    uint     element_count;
+    uint     wptr;
+    uint     rptr;
+    uint     level;
+} queue_t;
+
+void queue_init(queue_t* q, uint element_size, uint element_count);
+void queue_free(queue_t* q);
+uint queue_get_level(queue_t* q);
+bool queue_is_empty(queue_t* q);
+bool queue_is_full(queue_t* q);
+bool queue_try_add(queue_t* q, const void* data);
+bool queue_try_remove(queue_t* q, void* data);
+bool queue_try_peek(queue_t* q, void* data);
+// blocking functions panic instead of blocking since nothing else could fill the queue in the single thread
+void queue_add_blocking(queue_t* q, const void* data);
+void queue_remove_blocking(queue_t* q, void* data);
+void queue_peek_blocking(queue_t* q, void* data);
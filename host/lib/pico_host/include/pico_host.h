@@ -0,0 +1,187 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include "pico.h"
+#include "hardware/i2c.h"
+#include "hardware/pio.h"
+#include "hardware/uart.h"
+
+// pico_host world
+//   Virtual time: time advances only by sleep or advance functions, not by the wall clock.
+//                 Events of devices are processed in time order during the advance,
+//                 and IRQ handlers raised by them are invoked immediately (as on core0).
+//   Threading:    single thread. The program calls process_loop() of core1 side by itself between advances.
+
+namespace pico_host {
+
+/**
+ * device driven by virtual time (mechanism models, PIO state machine models)
+ */
+class device {
+    public:
+    static constexpr uint64_t NO_EVENT = UINT64_MAX;
+    virtual ~device() {}
+    /**
+     * get time of the next event
+     *
+     * @return absolute time in microseconds (NO_EVENT if nothing scheduled)
+     */
+    virtual uint64_t next_event_us() const = 0;
+    /**
+     * process the event due
+     *
+     * @param[in] now_us current virtual time in microseconds
+     */
+    virtual void on_event(uint64_t now_us) = 0;
+};
+
+typedef std::function<void(uint pin, bool level)> gpio_listener_t;
+typedef std::function<void(const uint8_t* src, size_t len)> i2c_target_t;
+
+/**
+ * reset the world (time, GPIO, PIO, IRQ, devices)
+ */
+void reset();
+
+/**
+ * get current virtual time
+ *
+ * @return microseconds since boot
+ */
+uint64_t now_us();
+
+/**
+ * advance virtual time
+ *
+ * @param[in] time_us absolute time to advance to (no effect if past)
+ */
+void advance_to_us(uint64_t time_us);
+
+/**
+ * advance virtual time by duration
+ *
+ * @param[in] us duration in microseconds
+ */
+void advance_us(uint64_t us);
+
+/**
+ * get time of the earliest event among devices
+ *
+ * @return absolute time in microseconds (device::NO_EVENT if nothing scheduled)
+ */
+uint64_t next_event_us();
+
+/**
+ * get number of events processed since reset
+ */
+uint64_t get_num_events();
+
+void add_device(device* dev);
+void remove_device(device* dev);
+
+/**
+ * drive GPIO input level from outside of the program (as external circuit)
+ */
+void gpio_drive(uint pin, bool level);
+
+/**
+ * release GPIO input drive (level is given by pulls)
+ */
+void gpio_release(uint pin);
+
+/**
+ * get duty of GPIO output (PWM level / (wrap + 1) for PWM function, 0 or 1 for others)
+ */
+float gpio_get_duty(uint pin);
+
+/**
+ * get time of the last duty change of GPIO output
+ */
+uint64_t gpio_get_duty_change_us(uint pin);
+
+/**
+ * listen GPIO level change (input: external drive, output: program output)
+ *
+ * @return listener id to remove
+ */
+uint gpio_add_listener(uint pin, const gpio_listener_t& listener);
+
+/**
+ * remove GPIO listener
+ */
+void gpio_remove_listener(uint pin, uint id);
+
+/**
+ * attach I2C target device model
+ *   the bytes of each write transaction to the address are given to the target,
+ *   writes to the address without target fail as NACK
+ *
+ * @param[in] i2c I2C instance
+ * @param[in] addr 7-bit address
+ * @param[in] target device model (nullptr to detach)
+ */
+void i2c_set_target(i2c_inst_t* i2c, uint8_t addr, const i2c_target_t& target);
+
+/**
+ * erase the whole flash array (as a new chip)
+ *   flash contents are kept across reset() as nonvolatile memory
+ */
+void flash_erase_all();
+
+/**
+ * cut the power of flash after the bytes to be erased or programmed from now
+ *   the operation in progress is left partially done and the following ones are ignored,
+ *   as power loss during flash write (cleared by flash_restore_power())
+ *
+ * @param[in] bytes bytes to be erased or programmed before power loss
+ */
+void flash_cut_power_after(uint64_t bytes);
+
+/**
+ * restore the power of flash cut by flash_cut_power_after()
+ *
+ * @return true if the power has been lost
+ */
+bool flash_restore_power();
+
+/**
+ * get erase count of the sector
+ *
+ * @param[in] flash_offs offset in flash of the sector
+ */
+uint32_t flash_get_erase_count(uint32_t flash_offs);
+
+/**
+ * take the bytes written to UART TX since the last call
+ *   the bytes are taken at the write, regardless of the time shifted out
+ */
+std::string uart_take_tx(uart_inst_t* uart);
+
+/**
+ * bind behavioral model of crp42602y_measure_pulse program to the state machine
+ *   called from crp42602y_measure_pulse_program_init() of host
+ */
+void pio_bind_measure_pulse(PIO pio, uint sm, uint pin);
+
+/**
+ * bind behavioral model of ir_nec_receive / ir_rc5_receive program to the state machine
+ *   called from ir_nec_receive_program_init() / ir_rc5_receive_program_init() of host
+ */
+void pio_bind_ir_nec(PIO pio, uint sm, uint pin);
+void pio_bind_ir_rc5(PIO pio, uint sm, uint pin);
+
+/**
+ * push a value to RX FIFO as if the state machine pushed it
+ *   substitute of 'pull', 'mov isr, osr' and 'push' executed by pio_sm_exec() on device (for benchmarks)
+ */
+void pio_push_rx_fifo(PIO pio, uint sm, uint32_t value);
+
+}
@@ -0,0 +1,580 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "pico_host.h"
+#include "pico/stdlib.h"
+#include "pico/util/queue.h"
+#include "hardware/clocks.h"
+#include "hardware/irq.h"
+#include "hardware/pwm.h"
+#include "hardware/sync.h"
+
+// -------------------------------------------------------------------------------
+// world
+
+namespace {
+
+typedef struct _gpio_state_t {
+    bool out_dir;
+    bool out_level;
+    bool driven;
+    bool drive_level;
+    bool pull_up;
+    bool pull_down;
+    bool level;  // effective level
+    uint func;   // GPIO_FUNC_SIO or GPIO_FUNC_PWM
+    uint32_t pwm_level;
+    float duty;  // ratio of high level of output
+    uint64_t duty_change_us;
+    uint32_t irq_enabled;  // GPIO_IRQ_EDGE_FALL / GPIO_IRQ_EDGE_RISE
+    uint32_t irq_events;   // latched edge events
+    std::vector<std::pair<uint, pico_host::gpio_listener_t>> listeners;
+    uint next_listener_id;
+} gpio_state_t;
+
+typedef struct _pwm_slice_t {
+    uint32_t wrap;
+    bool enabled;
+} pwm_slice_t;
+
+typedef struct _irq_state_t {
+    bool enabled;
+    bool pending;
+    std::vector<irq_handler_t> handlers;
+} irq_state_t;
+
+uint64_t _now_us = 0;
+uint64_t _num_events = 0;
+std::vector<pico_host::device*> _devices;
+gpio_state_t _gpio[NUM_BANK0_GPIOS];
+pwm_slice_t _pwm[NUM_PWM_SLICES];
+irq_state_t _irq[NUM_IRQS];
+bool _irq_disabled = false;
+bool _in_irq = false;
+bool _event_flag = false;  // event register of SEV/WFE
+
+float _pwm_duty(uint pin)
+{
+    const gpio_state_t& g = _gpio[pin];
+    const pwm_slice_t& slice = _pwm[pwm_gpio_to_slice_num(pin)];
+    if (!slice.enabled) return 0.0f;
+    uint32_t top = slice.wrap + 1;
+    return (float) ((g.pwm_level < top) ? g.pwm_level : top) / top;
+}
+
+void _gpio_update(uint pin)
+{
+    gpio_state_t& g = _gpio[pin];
+    bool level;
+    float duty = 0.0f;
+    if (g.func == GPIO_FUNC_PWM) {
+        // PWM output is seen as high while the duty is not 0
+        duty = _pwm_duty(pin);
+        level = duty > 0.0f;
+    } else if (g.out_dir) {
+        level = g.out_level;
+        duty = level ? 1.0f : 0.0f;
+    } else if (g.driven) {
+        level = g.drive_level;
+    } else {
+        level = g.pull_up;  // pull-down or floating reads 0
+    }
+    if (duty != g.duty) {
+        g.duty = duty;
+        g.duty_change_us = _now_us;
+    }
+    if (level != g.level) {
+        g.level = level;
+        uint32_t event = level ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+        if (g.irq_enabled & event) {
+            g.irq_events |= event;
+            irq_set_pending(IO_IRQ_BANK0);
+        }
+        // copy since listeners could add another listener
+        auto listeners = g.listeners;
+        for (auto& listener : listeners) {
+            listener.second(pin, level);
+        }
+    }
+}
+
+void _deliver_irqs()
+{
+    if (_irq_disabled || _in_irq) return;
+    bool delivered;
+    do {
+        delivered = false;
+        for (uint num = 0; num < NUM_IRQS; num++) {
+            irq_state_t& irq = _irq[num];
+            if (!irq.pending || !irq.enabled) continue;
+            irq.pending = false;
+            _in_irq = true;
+            _event_flag = true;  // exception entry wakes WFE
+            std::vector<irq_handler_t> handlers = irq.handlers;
+            for (auto handler : handlers) {
+                handler();
+            }
+            _in_irq = false;
+            delivered = true;
+        }
+    } while (delivered && !_irq_disabled);
+}
+
+}
+
+namespace pico_host {
+
+void pio_reset();  // pico_host_pio.cpp
+void uart_reset();  // pico_host_uart.cpp
+
+void reset()
+{
+    _now_us = 0;
+    _num_events = 0;
+    _devices.clear();
+    for (uint pin = 0; pin < NUM_BANK0_GPIOS; pin++) {
+        _gpio[pin] = gpio_state_t{};
+        _gpio[pin].pull_down = true;  // reset default of RP2040
+        _gpio[pin].func = GPIO_FUNC_NULL;
+    }
+    for (uint slice = 0; slice < NUM_PWM_SLICES; slice++) {
+        _pwm[slice] = pwm_slice_t{0xffff, false};
+    }
+    for (uint num = 0; num < NUM_IRQS; num++) {
+        _irq[num] = irq_state_t{};
+    }
+    _irq_disabled = false;
+    _in_irq = false;
+    _event_flag = false;
+    pio_reset();
+    uart_reset();
+}
+
+uint64_t now_us()
+{
+    return _now_us;
+}
+
+uint64_t next_event_us()
+{
+    uint64_t next = device::NO_EVENT;
+    for (auto dev : _devices) {
+        uint64_t t = dev->next_event_us();
+        if (t < next) next = t;
+    }
+    return next;
+}
+
+void advance_to_us(uint64_t time_us)
+{
+    while (true) {
+        device* next_dev = nullptr;
+        uint64_t next = device::NO_EVENT;
+        for (auto dev : _devices) {
+            uint64_t t = dev->next_event_us();
+            if (t < next) {
+                next = t;
+                next_dev = dev;
+            }
+        }
+        if (next_dev == nullptr || next > time_us) break;
+        if (next > _now_us) _now_us = next;
+        next_dev->on_event(_now_us);
+        _num_events++;
+    }
+    if (time_us > _now_us) _now_us = time_us;
+}
+
+void advance_us(uint64_t us)
+{
+    advance_to_us(_now_us + us);
+}
+
+uint64_t get_num_events()
+{
+    return _num_events;
+}
+
+void add_device(device* dev)
+{
+    _devices.push_back(dev);
+}
+
+void remove_device(device* dev)
+{
+    for (auto it = _devices.begin(); it != _devices.end(); ++it) {
+        if (*it == dev) {
+            _devices.erase(it);
+            return;
+        }
+    }
+}
+
+void gpio_drive(uint pin, bool level)
+{
+    _gpio[pin].driven = true;
+    _gpio[pin].drive_level = level;
+    _gpio_update(pin);
+}
+
+void gpio_release(uint pin)
+{
+    _gpio[pin].driven = false;
+    _gpio_update(pin);
+}
+
+float gpio_get_duty(uint pin)
+{
+    return _gpio[pin].duty;
+}
+
+uint64_t gpio_get_duty_change_us(uint pin)
+{
+    return _gpio[pin].duty_change_us;
+}
+
+uint gpio_add_listener(uint pin, const gpio_listener_t& listener)
+{
+    uint id = _gpio[pin].next_listener_id++;
+    _gpio[pin].listeners.push_back({id, listener});
+    return id;
+}
+
+void gpio_remove_listener(uint pin, uint id)
+{
+    auto& listeners = _gpio[pin].listeners;
+    for (auto it = listeners.begin(); it != listeners.end(); ++it) {
+        if (it->first == id) {
+            listeners.erase(it);
+            return;
+        }
+    }
+}
+
+}
+
+// -------------------------------------------------------------------------------
+// pico-sdk substitute
+
+void panic(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "*** PANIC ***\n");
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    abort();
+}
+
+absolute_time_t get_absolute_time()
+{
+    return _now_us;
+}
+
+void sleep_us(uint64_t us)
+{
+    pico_host::advance_us(us);
+}
+
+void sleep_ms(uint32_t ms)
+{
+    pico_host::advance_us((uint64_t) ms * 1000);
+}
+
+void sleep_until(absolute_time_t t)
+{
+    pico_host::advance_to_us(t);
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp)
+{
+    // proceed event by event so that the wait ends at the time of the event which wakes up the core
+    while (!_event_flag) {
+        uint64_t next = pico_host::next_event_us();
+        if (next > timeout_timestamp) {
+            pico_host::advance_to_us(timeout_timestamp);
+            break;
+        }
+        pico_host::advance_to_us(next);
+    }
+    _event_flag = false;
+    return _now_us >= timeout_timestamp;
+}
+
+void __sev()
+{
+    _event_flag = true;
+}
+
+void __wfe()
+{
+    // no time to wait in the world without timeout, only the event is consumed
+    _event_flag = false;
+}
+
+uint32_t clock_get_hz(clock_handle_t clock)
+{
+    return (clock == clk_sys) ? SYS_CLK_HZ : 0;
+}
+
+uint32_t time_us_32()
+{
+    return (uint32_t) _now_us;
+}
+
+uint64_t time_us_64()
+{
+    return _now_us;
+}
+
+void gpio_init(uint gpio)
+{
+    _gpio[gpio].func = GPIO_FUNC_SIO;
+    _gpio[gpio].out_dir = false;
+    _gpio[gpio].out_level = false;
+    _gpio_update(gpio);
+}
+
+void gpio_deinit(uint gpio)
+{
+    gpio_init(gpio);
+}
+
+void gpio_set_function(uint gpio, gpio_function_t fn)
+{
+    _gpio[gpio].func = fn;
+    _gpio_update(gpio);
+}
+
+gpio_function_t gpio_get_function(uint gpio)
+{
+    return (gpio_function_t) _gpio[gpio].func;
+}
+
+void gpio_set_dir(uint gpio, bool out)
+{
+    _gpio[gpio].out_dir = out;
+    _gpio_update(gpio);
+}
+
+bool gpio_get_dir(uint gpio)
+{
+    return _gpio[gpio].out_dir;
+}
+
+void gpio_put(uint gpio, bool value)
+{
+    _gpio[gpio].out_level = value;
+    _gpio_update(gpio);
+}
+
+bool gpio_get(uint gpio)
+{
+    return _gpio[gpio].level;
+}
+
+bool gpio_get_out_level(uint gpio)
+{
+    return _gpio[gpio].out_level;
+}
+
+void gpio_set_pulls(uint gpio, bool up, bool down)
+{
+    _gpio[gpio].pull_up = up;
+    _gpio[gpio].pull_down = down;
+    _gpio_update(gpio);
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t event_mask, bool enabled)
+{
+    event_mask &= GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE;
+    gpio_acknowledge_irq(gpio, event_mask);
+    if (enabled) {
+        _gpio[gpio].irq_enabled |= event_mask;
+    } else {
+        _gpio[gpio].irq_enabled &= ~event_mask;
+    }
+}
+
+uint32_t gpio_get_irq_event_mask(uint gpio)
+{
+    return _gpio[gpio].irq_events & _gpio[gpio].irq_enabled;
+}
+
+void gpio_acknowledge_irq(uint gpio, uint32_t event_mask)
+{
+    _gpio[gpio].irq_events &= ~event_mask;
+}
+
+void gpio_add_raw_irq_handler_masked(uint32_t gpio_mask, irq_handler_t handler)
+{
+    (void) gpio_mask;
+    irq_add_shared_handler(IO_IRQ_BANK0, handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+}
+
+void gpio_remove_raw_irq_handler_masked(uint32_t gpio_mask, irq_handler_t handler)
+{
+    (void) gpio_mask;
+    irq_remove_handler(IO_IRQ_BANK0, handler);
+}
+
+void pwm_init(uint slice_num, pwm_config* c, bool start)
+{
+    _pwm[slice_num].wrap = c->top;  // clkdiv is not modeled since the duty is seen by the world
+    pwm_set_enabled(slice_num, start);
+}
+
+void pwm_set_clkdiv(uint slice_num, float divider)
+{
+    (void) slice_num;
+    (void) divider;  // clkdiv is not modeled since the duty is seen by the world
+}
+
+void pwm_set_enabled(uint slice_num, bool enabled)
+{
+    _pwm[slice_num].enabled = enabled;
+    for (uint pin = slice_num * 2; pin < slice_num * 2 + 2 && pin < NUM_BANK0_GPIOS; pin++) {
+        _gpio_update(pin);
+    }
+}
+
+void pwm_set_gpio_level(uint gpio, uint16_t level)
+{
+    _gpio[gpio].pwm_level = level;
+    _gpio_update(gpio);
+}
+
+uint32_t save_and_disable_interrupts()
+{
+    uint32_t status = _irq_disabled ? 1 : 0;
+    _irq_disabled = true;
+    return status;
+}
+
+void restore_interrupts(uint32_t status)
+{
+    _irq_disabled = status != 0;
+    _deliver_irqs();
+}
+
+void irq_set_enabled(uint num, bool enabled)
+{
+    _irq[num].enabled = enabled;
+    _deliver_irqs();
+}
+
+bool irq_is_enabled(uint num)
+{
+    return _irq[num].enabled;
+}
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler)
+{
+    _irq[num].handlers.clear();
+    _irq[num].handlers.push_back(handler);
+}
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority)
+{
+    (void) order_priority;
+    _irq[num].handlers.push_back(handler);
+}
+
+void irq_remove_handler(uint num, irq_handler_t handler)
+{
+    auto& handlers = _irq[num].handlers;
+    for (auto it = handlers.begin(); it != handlers.end(); ++it) {
+        if (*it == handler) {
+            handlers.erase(it);
+            return;
+        }
+    }
+}
+
+void irq_set_pending(uint num)
+{
+    _irq[num].pending = true;
+    _deliver_irqs();
+}
+
+void queue_init(queue_t* q, uint element_size, uint element_count)
+{
+    q->data = (uint8_t*) calloc(element_count, element_size);
+    q->element_size = element_size;
+    q->element_count = element_count;
+    q->wptr = 0;
+    q->rptr = 0;
+    q->level = 0;
+}
+
+void queue_free(queue_t* q)
+{
+    free(q->data);
+    q->data = nullptr;
+}
+
+uint queue_get_level(queue_t* q)
+{
+    return q->level;
+}
+
+bool queue_is_empty(queue_t* q)
+{
+    return q->level == 0;
+}
+
+bool queue_is_full(queue_t* q)
+{
+    return q->level == q->element_count;
+}
+
+bool queue_try_add(queue_t* q, const void* data)
+{
+    if (queue_is_full(q)) return false;
+    memcpy(&q->data[q->wptr * q->element_size], data, q->element_size);
+    q->wptr = (q->wptr + 1) % q->element_count;
+    q->level++;
+    __sev();  // notify as pico-sdk queue
+    return true;
+}
+
+bool queue_try_peek(queue_t* q, void* data)
+{
+    if (queue_is_empty(q)) return false;
+    memcpy(data, &q->data[q->rptr * q->element_size], q->element_size);
+    return true;
+}
+
+bool queue_try_remove(queue_t* q, void* data)
+{
+    if (!queue_try_peek(q, data)) return false;
+    q->rptr = (q->rptr + 1) % q->element_count;
+    q->level--;
+    return true;
+}
+
+void queue_add_blocking(queue_t* q, const void* data)
+{
+    if (!queue_try_add(q, data)) panic("queue_add_blocking: queue is full");
+}
+
+void queue_remove_blocking(queue_t* q, void* data)
+{
+    if (!queue_try_remove(q, data)) panic("queue_remove_blocking: queue is empty");
+}
+
+void queue_peek_blocking(queue_t* q, void* data)
+{
+    if (!queue_try_peek(q, data)) panic("queue_peek_blocking: queue is empty");
+}
+
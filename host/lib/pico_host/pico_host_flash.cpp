@@ -0,0 +1,130 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "pico_host.h"
+#include "hardware/flash.h"
+#include "pico/flash.h"
+
+namespace {
+
+// typical time of the operations (W25Q16JV), advanced in virtual time
+constexpr uint64_t ERASE_SECTOR_US = 45000;
+constexpr uint64_t PROGRAM_PAGE_US = 400;
+constexpr uint64_t NO_POWER_LOSS = UINT64_MAX;
+
+struct flash_host_t {
+    std::vector<uint8_t> array;
+    std::vector<uint32_t> erase_counts;
+    uint64_t budget;  // bytes to be erased or programmed until power loss
+    bool power_lost;
+};
+
+flash_host_t& _flash()
+{
+    static flash_host_t flash = {
+        std::vector<uint8_t>(PICO_FLASH_SIZE_BYTES, 0xff),
+        std::vector<uint32_t>(PICO_FLASH_SIZE_BYTES / FLASH_SECTOR_SIZE, 0),
+        NO_POWER_LOSS,
+        false
+    };
+    return flash;
+}
+
+// consume the budget and get the bytes to be done
+size_t _consume(size_t count)
+{
+    flash_host_t& flash = _flash();
+    if (flash.power_lost) return 0;
+    if (flash.budget == NO_POWER_LOSS) return count;
+    if (flash.budget >= count) {
+        flash.budget -= count;
+        return count;
+    }
+    size_t done = (size_t) flash.budget;
+    flash.budget = 0;
+    flash.power_lost = true;
+    return done;
+}
+
+}
+
+uintptr_t pico_host::flash_xip_base()
+{
+    return reinterpret_cast<uintptr_t>(_flash().array.data());
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+    if (flash_offs % FLASH_SECTOR_SIZE != 0 || count % FLASH_SECTOR_SIZE != 0 || flash_offs + count > PICO_FLASH_SIZE_BYTES) {
+        panic("flash_range_erase: invalid range 0x%x (%u bytes)", flash_offs, (uint) count);
+    }
+    flash_host_t& flash = _flash();
+    for (uint32_t offs = flash_offs; offs < flash_offs + count; offs += FLASH_SECTOR_SIZE) {
+        size_t done = _consume(FLASH_SECTOR_SIZE);
+        if (done == 0) break;
+        std::fill_n(flash.array.begin() + offs, done, 0xff);
+        flash.erase_counts[offs / FLASH_SECTOR_SIZE]++;
+        pico_host::advance_us(ERASE_SECTOR_US);
+    }
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count)
+{
+    if (flash_offs % FLASH_PAGE_SIZE != 0 || count % FLASH_PAGE_SIZE != 0 || flash_offs + count > PICO_FLASH_SIZE_BYTES) {
+        panic("flash_range_program: invalid range 0x%x (%u bytes)", flash_offs, (uint) count);
+    }
+    flash_host_t& flash = _flash();
+    for (size_t i = 0; i < count; i += FLASH_PAGE_SIZE) {
+        size_t done = _consume(FLASH_PAGE_SIZE);
+        if (done == 0) break;
+        // NOR flash: program only clears bits
+        for (size_t j = 0; j < done; j++) {
+            flash.array[flash_offs + i + j] &= data[i + j];
+        }
+        pico_host::advance_us(PROGRAM_PAGE_US);
+    }
+}
+
+int flash_safe_execute(void (*func)(void*), void* param, uint32_t enter_exit_timeout_ms)
+{
+    func(param);
+    return PICO_OK;
+}
+
+bool flash_safe_execute_core_init()
+{
+    return true;
+}
+
+void pico_host::flash_erase_all()
+{
+    flash_host_t& flash = _flash();
+    std::fill(flash.array.begin(), flash.array.end(), 0xff);
+    std::fill(flash.erase_counts.begin(), flash.erase_counts.end(), 0);
+}
+
+void pico_host::flash_cut_power_after(uint64_t bytes)
+{
+    _flash().budget = bytes;
+}
+
+bool pico_host::flash_restore_power()
+{
+    flash_host_t& flash = _flash();
+    bool lost = flash.power_lost;
+    flash.budget = NO_POWER_LOSS;
+    flash.power_lost = false;
+    return lost;
+}
+
+uint32_t pico_host::flash_get_erase_count(uint32_t flash_offs)
+{
+    return _flash().erase_counts[flash_offs / FLASH_SECTOR_SIZE];
+}
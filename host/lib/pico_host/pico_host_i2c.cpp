@@ -0,0 +1,110 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include <map>
+
+#include "pico_host.h"
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/i2c.h"
+
+namespace {
+
+struct i2c_host_t {
+    i2c_hw_t hw;
+    uint baudrate;
+    std::map<uint8_t, pico_host::i2c_target_t> targets;
+};
+
+i2c_host_t _i2c[2] = {
+    {{0, 0, 0, I2C_IC_STATUS_TFE_BITS, 0, 0}, 0, {}},
+    {{0, 0, 0, I2C_IC_STATUS_TFE_BITS, 0, 0}, 0, {}}
+};
+
+i2c_host_t* _get(i2c_inst_t* i2c)
+{
+    return reinterpret_cast<i2c_host_t*>(i2c);
+}
+
+}
+
+i2c_inst_t* const i2c0 = reinterpret_cast<i2c_inst_t*>(&_i2c[0]);
+i2c_inst_t* const i2c1 = reinterpret_cast<i2c_inst_t*>(&_i2c[1]);
+
+uint i2c_init(i2c_inst_t* i2c, uint baudrate)
+{
+    _get(i2c)->baudrate = baudrate;
+    return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t* i2c, uint8_t addr, const uint8_t* src, size_t len, bool nostop)
+{
+    auto it = _get(i2c)->targets.find(addr);
+    if (it == _get(i2c)->targets.end()) return PICO_ERROR_GENERIC;  // NACK of the address
+    it->second(src, len);
+    return (int) len;
+}
+
+i2c_hw_t* i2c_get_hw(i2c_inst_t* i2c)
+{
+    return &_get(i2c)->hw;
+}
+
+void pico_host::i2c_set_target(i2c_inst_t* i2c, uint8_t addr, const i2c_target_t& target)
+{
+    if (target) {
+        _get(i2c)->targets[addr] = target;
+    } else {
+        _get(i2c)->targets.erase(addr);
+    }
+}
+
+uint i2c_get_dreq(i2c_inst_t* i2c, bool is_tx)
+{
+    return (i2c == i2c0) ? (is_tx ? 32 : 33) : (is_tx ? 34 : 35);
+}
+
+int dma_claim_unused_channel(bool required)
+{
+    if (required) panic("dma_claim_unused_channel: DMA is not modeled");
+    return -1;
+}
+
+void dma_channel_unclaim(uint channel)
+{
+    panic("dma_channel_unclaim: DMA is not modeled");
+}
+
+bool dma_channel_is_busy(uint channel)
+{
+    return false;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel)
+{
+    panic("dma_channel_get_default_config: DMA is not modeled");
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config* c, enum dma_channel_transfer_size size)
+{
+}
+
+void channel_config_set_read_increment(dma_channel_config* c, bool incr)
+{
+}
+
+void channel_config_set_write_increment(dma_channel_config* c, bool incr)
+{
+}
+
+void channel_config_set_dreq(dma_channel_config* c, uint dreq)
+{
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config* config, volatile void* write_addr, const volatile void* read_addr, uint transfer_count, bool trigger)
+{
+    panic("dma_channel_configure: DMA is not modeled");
+}
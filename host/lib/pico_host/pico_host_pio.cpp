@@ -0,0 +1,622 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include <deque>
+
+#include "pico_host.h"
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/irq.h"
+
+// Behavioral models of the PIO programs bound to the state machines by their program_init functions
+
+namespace {
+
+// common part of the state machine models (FIFOs and the input pin)
+class sm_model : public pico_host::device {
+    public:
+    static constexpr uint FIFO_DEPTH = 4;
+    PIO pio = nullptr;
+    uint sm = 0;
+    uint pin = 0;
+    bool bound = false;
+    bool enabled = false;
+    uint32_t listen_mask = 0;  // pins whose listener is registered
+    uint fifo_depth = FIFO_DEPTH;
+    std::deque<uint32_t> tx_fifo;
+    std::deque<uint32_t> rx_fifo;
+
+    virtual void on_pin(bool level) = 0;
+    virtual void on_irq_clear() {}
+    virtual void on_tx() {}
+    virtual void on_enabled() {}
+
+    protected:
+    void _push(uint32_t value)
+    {
+        // 'push noblock' and autopush drop the value when RX FIFO is full
+        if (rx_fifo.size() < fifo_depth) {
+            rx_fifo.push_back(value);
+        }
+    }
+};
+
+// Behavioral model of crp42602y_measure_pulse.pio (1 cycle = 1 us with clkdiv 125)
+//   The timing of each instruction is reproduced so that the counts and the latencies are the same as the actual program:
+//     count loop takes 4 cycles per count and x counts down from 0xffffffff,
+//     the pin is sampled by 'jmp pin' at the top of each loop,
+//     timeout is detected when x reaches y at 'jmp x!=y' in the loop.
+class measure_pulse_sm : public sm_model {
+    public:
+    typedef enum _state_t {
+        WAIT_TX = 0,     // stalled at 'out y'
+        TERM1,           // counting 1-term
+        TERM0,           // counting 0-term
+        WAIT_IRQ_CLEAR   // stalled at 'irq wait 0 rel'
+    } state_t;
+
+    state_t state = WAIT_TX;
+    uint64_t ready_us = 0;        // earliest time to proceed from WAIT_TX
+    uint64_t count_start_us = 0;  // time of 1st 'jmp pin' in the count loop
+    uint32_t y = 0;
+
+    uint64_t next_event_us() const override
+    {
+        if (!bound || !enabled || (state != TERM1 && state != TERM0)) return NO_EVENT;
+        uint32_t timeout_count = (uint32_t) -(int32_t) y;
+        if (timeout_count == 0) return NO_EVENT;
+        // 'in null' and 'irq wait' follow 'jmp x!=y' which detects x == y after (timeout_count - 1) counts
+        return count_start_us + (uint64_t) (timeout_count - 1) * 4 + 4;
+    }
+
+    void on_event(uint64_t now_us) override
+    {
+        // timeout
+        _push(0);
+        state = WAIT_IRQ_CLEAR;
+        _raise_irq();
+    }
+
+    void on_pin(bool level) override
+    {
+        if (!bound || !enabled) return;
+        uint64_t now = pico_host::now_us();
+        if (state == TERM1 && !level) {
+            uint64_t detect_us = _detect_time(now);
+            _push(_count_value(detect_us));
+            // 'jmp term1_end', 'in x', 'mov x' (4 cycles from 1->0 edge)
+            count_start_us = detect_us + 3;
+            state = TERM0;
+        } else if (state == TERM0 && level) {
+            uint64_t detect_us = _detect_time(now);
+            _push(_count_value(detect_us));
+            // 'in x', 'irq 0 rel', then 'out y' and 'mov x' (5 cycles from 0->1 edge)
+            ready_us = detect_us + 3;
+            state = WAIT_TX;
+            _raise_irq();
+            _try_start();
+        }
+    }
+
+    void on_irq_clear() override
+    {
+        if (state == WAIT_IRQ_CLEAR) {
+            ready_us = pico_host::now_us() + 1;
+            state = WAIT_TX;
+            _try_start();
+        }
+    }
+
+    void on_tx() override
+    {
+        _try_start();
+    }
+
+    void on_enabled() override
+    {
+        _try_start();
+    }
+
+    private:
+    uint64_t _detect_time(uint64_t edge_us) const
+    {
+        // the pin is sampled every 4 cycles from count_start_us
+        if (edge_us <= count_start_us) return count_start_us;
+        return count_start_us + (edge_us - count_start_us + 3) / 4 * 4;
+    }
+
+    uint32_t _count_value(uint64_t detect_us) const
+    {
+        return (uint32_t) -1 - (uint32_t) ((detect_us - count_start_us) / 4);
+    }
+
+    void _raise_irq();
+
+    void _try_start()
+    {
+        if (state != WAIT_TX || tx_fifo.empty() || !enabled) return;
+        y = tx_fifo.front();
+        tx_fifo.pop_front();
+        uint64_t now = pico_host::now_us();
+        // 'out y' and 'mov x'
+        count_start_us = ((now > ready_us) ? now : ready_us) + 1;
+        state = TERM1;
+        if (!gpio_get(pin)) {
+            // 1-term ends at the first sample
+            _push((uint32_t) -1);
+            count_start_us += 3;
+            state = TERM0;
+        }
+    }
+};
+
+// Behavioral model of ir_nec_receive.pio (1 cycle = 56.25 us)
+//   the pin is sampled at the same cycles from the edges as the actual program:
+//     the end of burst is polled at 1, 3, ... 61 cycles after its start (longer burst is the leader, the others are ignored),
+//     the space after the leader is sampled 46 cycles after its start (frame or repeat code),
+//     each of 32 bits of the frame is sampled 16 cycles after the end of its burst
+class ir_nec_sm : public sm_model {
+    public:
+    static constexpr uint64_t CYCLE_NS = 56250;
+    static constexpr uint NUM_BITS = 32;
+    typedef enum _state_t {
+        WAIT_BURST = 0,   // stalled at 'wait 0 pin 0' out of frame
+        BURST,            // in burst_loop
+        WAIT_LEADER_END,  // stalled at 'wait 1 pin 0' after the leader
+        CHECK_SPACE,      // delay to 'jmp pin frame'
+        WAIT_BIT_BURST,   // stalled at 'wait 0 pin 0' in bit_loop
+        WAIT_BIT_END,     // stalled at 'wait 1 pin 0' in bit_loop
+        SAMPLE            // delay to 'in pins, 1'
+    } state_t;
+
+    state_t state = WAIT_BURST;
+    uint64_t event_us = 0;
+    uint32_t isr = 0;
+    uint isr_count = 0;
+
+    uint64_t next_event_us() const override
+    {
+        if (!bound || !enabled || (state != BURST && state != CHECK_SPACE && state != SAMPLE)) return NO_EVENT;
+        return event_us;
+    }
+
+    void on_event(uint64_t now_us) override
+    {
+        if (state == BURST) {
+            state = WAIT_LEADER_END;
+            if (gpio_get(pin)) on_pin(true);
+        } else if (state == CHECK_SPACE) {
+            // 'mov isr, null' was done before
+            isr = 0;
+            isr_count = 0;
+            if (gpio_get(pin)) {
+                _wait_bit_burst();
+            } else {
+                // repeat code
+                _push(0);
+                restart();
+            }
+        } else if (state == SAMPLE) {
+            // 'in pins, 1' with shift right and autopush 32
+            isr = (isr >> 1) | ((uint32_t) gpio_get(pin) << 31);
+            if (++isr_count == NUM_BITS) {
+                _push(isr);
+                isr = 0;
+                isr_count = 0;
+                restart();
+            } else {
+                _wait_bit_burst();
+            }
+        }
+    }
+
+    void on_pin(bool level) override
+    {
+        if (!bound || !enabled) return;
+        uint64_t now_ns = pico_host::now_us() * 1000;
+        if (state == WAIT_BURST && !level) {
+            _after(now_ns, 62, BURST);
+        } else if (state == BURST && level) {
+            // short burst out of frame
+            state = WAIT_BURST;
+        } else if (state == WAIT_LEADER_END && level) {
+            _after(now_ns, 46, CHECK_SPACE);
+        } else if (state == WAIT_BIT_BURST && !level) {
+            state = WAIT_BIT_END;
+        } else if (state == WAIT_BIT_END && level) {
+            _after(now_ns, 16, SAMPLE);
+        }
+    }
+
+    void restart()
+    {
+        state = WAIT_BURST;
+        if (!gpio_get(pin)) on_pin(false);
+    }
+
+    private:
+    void _wait_bit_burst()
+    {
+        state = WAIT_BIT_BURST;
+        if (!gpio_get(pin)) on_pin(false);
+    }
+
+    void _after(uint64_t base_ns, uint64_t cycles, state_t next)
+    {
+        event_us = (base_ns + cycles * CYCLE_NS + 999) / 1000;
+        state = next;
+    }
+};
+
+// Behavioral model of ir_rc5_receive.pio (1 cycle = 111.1 us)
+//   the pin is sampled at the same cycles from the edges as the actual program:
+//     the frame starts at the falling edge after the idle of 64 cycles (measured from the rising edge or the abort),
+//     each bit is sampled 11 cycles after the edge at the middle of the previous bit (12 cycles after the falling edge),
+//     the edge at its own middle is polled at 2, 4, ... 12 cycles after the sample, otherwise the frame is aborted
+class ir_rc5_sm : public sm_model {
+    public:
+    static constexpr uint64_t CYCLE_NS = 111111;
+    static constexpr uint NUM_BITS = 13;
+    static constexpr uint NUM_POLLS = 6;
+    static constexpr uint64_t IDLE_CYCLES = 64;
+    typedef enum _state_t {
+        WAIT_HIGH = 0,  // idle_loop restarted by low level
+        IDLE,           // in idle_loop
+        WAIT_START,     // stalled at 'wait 0 pin 0' for the middle of the 1st start bit
+        SAMPLE,         // delay to 'in pins, 1'
+        POLL_MIDDLE     // polling the edge at the middle of the bit
+    } state_t;
+
+    state_t state = WAIT_HIGH;
+    uint64_t event_us = 0;
+    uint64_t sample_ns = 0;  // time of the last sample
+    uint32_t isr = 0;
+    uint isr_count = 0;
+    uint poll = 0;
+    bool bit = false;
+
+    uint64_t next_event_us() const override
+    {
+        if (!bound || !enabled || (state != IDLE && state != SAMPLE && state != POLL_MIDDLE)) return NO_EVENT;
+        return event_us;
+    }
+
+    void on_event(uint64_t now_us) override
+    {
+        if (state == IDLE) {
+            state = WAIT_START;
+            if (!gpio_get(pin)) on_pin(false);
+        } else if (state == SAMPLE) {
+            // 'in pins, 1' with shift left and autopush 13
+            bit = gpio_get(pin);
+            isr = (isr << 1) | bit;
+            if (++isr_count == NUM_BITS) {
+                _push(isr);
+                isr = 0;
+                isr_count = 0;
+            }
+            sample_ns = now_us * 1000;
+            poll = 0;
+            _schedule_poll();
+        } else if (state == POLL_MIDDLE) {
+            if (gpio_get(pin) != bit) {
+                // 'jmp next_bit' takes 1 more cycle for the falling edge
+                _after(_poll_ns(), bit ? 12 : 11, SAMPLE);
+            } else if (++poll < NUM_POLLS) {
+                _schedule_poll();
+            } else {
+                restart();
+            }
+        }
+    }
+
+    void on_pin(bool level) override
+    {
+        if (!bound || !enabled) return;
+        uint64_t now_ns = pico_host::now_us() * 1000;
+        if (state == WAIT_HIGH && level) {
+            _after(now_ns, IDLE_CYCLES, IDLE);
+        } else if (state == IDLE && !level) {
+            state = WAIT_HIGH;
+        } else if (state == WAIT_START && !level) {
+            _after(now_ns, 11, SAMPLE);
+        }
+        // the edge at the middle is taken by the poll
+    }
+
+    void restart()
+    {
+        // 'mov isr, null' at start
+        isr = 0;
+        isr_count = 0;
+        state = WAIT_HIGH;
+        if (gpio_get(pin)) on_pin(true);
+    }
+
+    private:
+    uint64_t _poll_ns() const
+    {
+        // 'jmp pin' at 2, 4, ... 12 cycles after the sample
+        return sample_ns + (2 + 2 * poll) * CYCLE_NS;
+    }
+
+    void _schedule_poll()
+    {
+        event_us = (_poll_ns() + 999) / 1000;
+        state = POLL_MIDDLE;
+    }
+
+    void _after(uint64_t base_ns, uint64_t cycles, state_t next)
+    {
+        event_us = (base_ns + cycles * CYCLE_NS + 999) / 1000;
+        state = next;
+    }
+};
+
+typedef struct _pio_block_t {
+    pio_hw_t hw;
+    uint32_t used_instruction_mask;
+    uint32_t claimed_sm_mask;
+    uint32_t inte[2];  // enabled flags for PIOx_IRQ_0 and PIOx_IRQ_1
+    measure_pulse_sm measure_pulse[NUM_PIO_STATE_MACHINES];
+    ir_nec_sm ir_nec[NUM_PIO_STATE_MACHINES];
+    ir_rc5_sm ir_rc5[NUM_PIO_STATE_MACHINES];
+    sm_model* sms[NUM_PIO_STATE_MACHINES];  // model bound to the state machine
+    uint32_t registered[NUM_PIO_STATE_MACHINES];  // models added as device (bit 0: measure_pulse, 1: ir_nec, 2: ir_rc5)
+} pio_block_t;
+
+pio_block_t _pio[NUM_PIOS];
+
+void measure_pulse_sm::_raise_irq()
+{
+    uint index = pio_get_index(pio);
+    // 'irq 0 rel' raises the flag of the state machine number
+    pio->irq |= 1UL << sm;
+    for (uint irqn = 0; irqn < 2; irqn++) {
+        if (_pio[index].inte[irqn] & (1UL << sm)) {
+            irq_set_pending(pio_get_irq_num(pio, irqn));
+        }
+    }
+}
+
+sm_model& _get_sm(PIO pio, uint sm)
+{
+    return *_pio[pio_get_index(pio)].sms[sm];
+}
+
+// bind the model to the state machine instead of the model bound before
+void _bind(sm_model& model, uint kind, PIO pio, uint sm, uint pin)
+{
+    pio_block_t& block = _pio[pio_get_index(pio)];
+    block.sms[sm]->bound = false;
+    block.sms[sm] = &model;
+    if (!(block.registered[sm] & (1UL << kind))) {
+        pico_host::add_device(&model);
+        block.registered[sm] |= 1UL << kind;
+    }
+    if (!(model.listen_mask & (1UL << pin))) {
+        pico_host::gpio_add_listener(pin, [&model, pin](uint gpio, bool level) {
+            if (model.pin == pin) model.on_pin(level);
+        });
+        model.listen_mask |= 1UL << pin;
+    }
+    model.pio = pio;
+    model.sm = sm;
+    model.pin = pin;
+    model.bound = true;
+    model.enabled = true;
+    model.tx_fifo.clear();
+    model.rx_fifo.clear();
+}
+
+}
+
+namespace pico_host {
+
+void pio_reset()
+{
+    for (uint i = 0; i < NUM_PIOS; i++) {
+        _pio[i].hw.irq = 0;
+        _pio[i].used_instruction_mask = 0;
+        _pio[i].claimed_sm_mask = 0;
+        _pio[i].inte[0] = 0;
+        _pio[i].inte[1] = 0;
+        for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+            _pio[i].measure_pulse[sm] = measure_pulse_sm();
+            _pio[i].ir_nec[sm] = ir_nec_sm();
+            _pio[i].ir_rc5[sm] = ir_rc5_sm();
+            _pio[i].sms[sm] = &_pio[i].measure_pulse[sm];
+            _pio[i].registered[sm] = 0;
+        }
+    }
+}
+
+void pio_bind_measure_pulse(PIO pio, uint sm, uint pin)
+{
+    measure_pulse_sm& model = _pio[pio_get_index(pio)].measure_pulse[sm];
+    _bind(model, 0, pio, sm, pin);
+    model.state = measure_pulse_sm::WAIT_TX;
+    model.ready_us = now_us();
+}
+
+void pio_bind_ir_nec(PIO pio, uint sm, uint pin)
+{
+    ir_nec_sm& model = _pio[pio_get_index(pio)].ir_nec[sm];
+    _bind(model, 1, pio, sm, pin);
+    model.fifo_depth = sm_model::FIFO_DEPTH * 2;  // joined RX FIFO
+    model.isr = 0;
+    model.isr_count = 0;
+    model.restart();
+}
+
+void pio_bind_ir_rc5(PIO pio, uint sm, uint pin)
+{
+    ir_rc5_sm& model = _pio[pio_get_index(pio)].ir_rc5[sm];
+    _bind(model, 2, pio, sm, pin);
+    model.fifo_depth = sm_model::FIFO_DEPTH * 2;  // joined RX FIFO
+    model.restart();
+}
+
+void pio_push_rx_fifo(PIO pio, uint sm, uint32_t value)
+{
+    // 'push block' stalls when RX FIFO is full, here the value is dropped instead
+    sm_model& model = _get_sm(pio, sm);
+    if (model.rx_fifo.size() < model.fifo_depth) {
+        model.rx_fifo.push_back(value);
+    }
+}
+
+}
+
+PIO pio_get_instance(uint instance)
+{
+    return &_pio[instance].hw;
+}
+
+uint pio_get_index(PIO pio)
+{
+    for (uint i = 0; i < NUM_PIOS; i++) {
+        if (pio == &_pio[i].hw) return i;
+    }
+    panic("pio_get_index: invalid PIO");
+}
+
+uint pio_get_irq_num(PIO pio, uint irqn)
+{
+    return PIO0_IRQ_0 + pio_get_index(pio) * 2 + irqn;
+}
+
+static int _find_program_offset(PIO pio, const pio_program_t* program)
+{
+    uint32_t used = _pio[pio_get_index(pio)].used_instruction_mask;
+    uint32_t mask = (program->length >= 32) ? 0xffffffffUL : ((1UL << program->length) - 1);
+    // allocate from the top as pico-sdk does
+    for (int offset = PIO_INSTRUCTION_COUNT - program->length; offset >= 0; offset--) {
+        if ((used & (mask << offset)) == 0) return offset;
+    }
+    return -1;
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t* program)
+{
+    return _find_program_offset(pio, program) >= 0;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t* program)
+{
+    int offset = _find_program_offset(pio, program);
+    if (offset < 0) panic("No program space");
+    uint32_t mask = (program->length >= 32) ? 0xffffffffUL : ((1UL << program->length) - 1);
+    _pio[pio_get_index(pio)].used_instruction_mask |= mask << offset;
+    return (uint) offset;
+}
+
+void pio_remove_program(PIO pio, const pio_program_t* program, uint loaded_offset)
+{
+    uint32_t mask = (program->length >= 32) ? 0xffffffffUL : ((1UL << program->length) - 1);
+    _pio[pio_get_index(pio)].used_instruction_mask &= ~(mask << loaded_offset);
+}
+
+int pio_claim_unused_sm(PIO pio, bool required)
+{
+    pio_block_t& block = _pio[pio_get_index(pio)];
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+        if (!(block.claimed_sm_mask & (1UL << sm))) {
+            block.claimed_sm_mask |= 1UL << sm;
+            return (int) sm;
+        }
+    }
+    if (required) panic("No PIO state machines are available");
+    return -1;
+}
+
+void pio_sm_claim(PIO pio, uint sm)
+{
+    _pio[pio_get_index(pio)].claimed_sm_mask |= 1UL << sm;
+}
+
+void pio_sm_unclaim(PIO pio, uint sm)
+{
+    _pio[pio_get_index(pio)].claimed_sm_mask &= ~(1UL << sm);
+}
+
+bool pio_sm_is_claimed(PIO pio, uint sm)
+{
+    return (_pio[pio_get_index(pio)].claimed_sm_mask & (1UL << sm)) != 0;
+}
+
+void pio_set_irqn_source_enabled(PIO pio, uint irq_index, enum pio_interrupt_source source, bool enabled)
+{
+    uint flag = (uint) source - (uint) pis_interrupt0;
+    if (enabled) {
+        _pio[pio_get_index(pio)].inte[irq_index] |= 1UL << flag;
+    } else {
+        _pio[pio_get_index(pio)].inte[irq_index] &= ~(1UL << flag);
+    }
+}
+
+void pio_interrupt_clear(PIO pio, uint pio_interrupt_num)
+{
+    pio->irq &= ~(1UL << pio_interrupt_num);
+    if (pio_interrupt_num < NUM_PIO_STATE_MACHINES) {
+        _get_sm(pio, pio_interrupt_num).on_irq_clear();
+    }
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled)
+{
+    sm_model& model = _get_sm(pio, sm);
+    model.enabled = enabled;
+    if (enabled) model.on_enabled();
+}
+
+void pio_sm_clear_fifos(PIO pio, uint sm)
+{
+    sm_model& model = _get_sm(pio, sm);
+    model.tx_fifo.clear();
+    model.rx_fifo.clear();
+}
+
+uint pio_sm_get_rx_fifo_level(PIO pio, uint sm)
+{
+    return (uint) _get_sm(pio, sm).rx_fifo.size();
+}
+
+uint pio_sm_get_tx_fifo_level(PIO pio, uint sm)
+{
+    return (uint) _get_sm(pio, sm).tx_fifo.size();
+}
+
+uint32_t pio_sm_get_blocking(PIO pio, uint sm)
+{
+    sm_model& model = _get_sm(pio, sm);
+    if (model.rx_fifo.empty()) panic("pio_sm_get_blocking: RX FIFO is empty");
+    uint32_t value = model.rx_fifo.front();
+    model.rx_fifo.pop_front();
+    return value;
+}
+
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data)
+{
+    sm_model& model = _get_sm(pio, sm);
+    if (model.tx_fifo.size() >= model.fifo_depth) panic("pio_sm_put_blocking: TX FIFO is full");
+    model.tx_fifo.push_back(data);
+    model.on_tx();
+}
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm)
+{
+    return _get_sm(pio, sm).rx_fifo.empty();
+}
+
+uint32_t pio_sm_get(PIO pio, uint sm)
+{
+    sm_model& model = _get_sm(pio, sm);
+    if (model.rx_fifo.empty()) return 0;  // undefined on device
+    uint32_t value = model.rx_fifo.front();
+    model.rx_fifo.pop_front();
+    return value;
+}
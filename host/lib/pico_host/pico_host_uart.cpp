@@ -0,0 +1,137 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include <deque>
+
+#include "pico_host.h"
+#include "pico/stdlib.h"
+#include "hardware/uart.h"
+
+namespace {
+
+constexpr uint DEFAULT_BAUDRATE = 115200;
+constexpr uint BITS_PER_BYTE = 10;  // start, 8 data and stop bits
+
+struct uart_host_t {
+    uart_hw_t hw;
+    uint baudrate;
+    std::deque<uint64_t> done_us;  // time when each byte in TX FIFO is shifted out
+    std::string tx;
+};
+
+uart_host_t _uart[2] = {
+    {{0}, DEFAULT_BAUDRATE, {}, {}},
+    {{0}, DEFAULT_BAUDRATE, {}, {}}
+};
+
+uart_host_t* _get(uart_inst_t* uart)
+{
+    return reinterpret_cast<uart_host_t*>(uart);
+}
+
+uint _level(uart_host_t* u)
+{
+    uint64_t now = pico_host::now_us();
+    while (!u->done_us.empty() && u->done_us.front() <= now) {
+        u->done_us.pop_front();
+    }
+    return (uint) u->done_us.size();
+}
+
+}
+
+uart_inst_t* const uart0 = reinterpret_cast<uart_inst_t*>(&_uart[0]);
+uart_inst_t* const uart1 = reinterpret_cast<uart_inst_t*>(&_uart[1]);
+
+uint uart_init(uart_inst_t* uart, uint baudrate)
+{
+    return uart_set_baudrate(uart, baudrate);
+}
+
+uint uart_set_baudrate(uart_inst_t* uart, uint baudrate)
+{
+    _get(uart)->baudrate = baudrate;
+    return baudrate;
+}
+
+bool uart_is_writable(uart_inst_t* uart)
+{
+    return _level(_get(uart)) < UART_FIFO_DEPTH;
+}
+
+bool uart_is_readable(uart_inst_t* uart)
+{
+    return false;
+}
+
+void uart_putc_raw(uart_inst_t* uart, char c)
+{
+    uart_host_t* u = _get(uart);
+    while (_level(u) >= UART_FIFO_DEPTH) {
+        pico_host::advance_to_us(u->done_us.front());
+    }
+    uint64_t byte_us = (BITS_PER_BYTE * 1000000ULL + u->baudrate - 1) / u->baudrate;
+    uint64_t start_us = u->done_us.empty() ? pico_host::now_us() : u->done_us.back();
+    u->done_us.push_back(start_us + byte_us);
+    u->tx.push_back(c);
+}
+
+void uart_write_blocking(uart_inst_t* uart, const uint8_t* src, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        uart_putc_raw(uart, (char) src[i]);
+    }
+}
+
+void uart_puts(uart_inst_t* uart, const char* s)
+{
+    while (*s) {
+        uart_putc_raw(uart, *s++);
+    }
+}
+
+char uart_getc(uart_inst_t* uart)
+{
+    panic("uart_getc: UART RX is not modeled");
+}
+
+void uart_tx_wait_blocking(uart_inst_t* uart)
+{
+    uart_host_t* u = _get(uart);
+    if (!u->done_us.empty()) pico_host::advance_to_us(u->done_us.back());
+    _level(u);
+}
+
+uart_hw_t* uart_get_hw(uart_inst_t* uart)
+{
+    return &_get(uart)->hw;
+}
+
+uint uart_get_dreq(uart_inst_t* uart, bool is_tx)
+{
+    return (uart == uart0) ? (is_tx ? 20 : 21) : (is_tx ? 22 : 23);
+}
+
+namespace pico_host {
+
+void uart_reset()
+{
+    for (auto& u : _uart) {
+        u.hw.dr = 0;
+        u.baudrate = DEFAULT_BAUDRATE;
+        u.done_us.clear();
+        u.tx.clear();
+    }
+}
+
+std::string uart_take_tx(uart_inst_t* uart)
+{
+    std::string tx;
+    tx.swap(_get(uart)->tx);
+    return tx;
+}
+
+}
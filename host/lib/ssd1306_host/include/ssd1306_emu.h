@@ -0,0 +1,113 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico.h"
+#include "hardware/i2c.h"
+
+// SSD1306 controller model as I2C target of pico_host
+//   the commands and the data written by I2C are interpreted as the controller does
+//   (addressing modes, column and page windows), thus GDDRAM holds what the panel shows
+//   regardless of how the program transmits the framebuffer
+class ssd1306_emu {
+    public:
+    /**
+     * Definitions
+     */
+    typedef struct _stats_t {
+        uint32_t transactions;
+        uint64_t bytes;       // bytes on I2C bus including address bytes
+        uint64_t data_bytes;  // bytes written to GDDRAM
+    } stats_t;
+
+    // Constants
+    static constexpr uint32_t WIDTH = 128;
+    static constexpr uint32_t MAX_PAGES = 8;
+
+    /**
+     * ssd1306_emu class constructor
+     *   attached to the address as I2C target
+     *
+     * @param[in] i2c I2C instance
+     * @param[in] addr 7-bit address
+     * @param[in] height panel height (32 or 64)
+     */
+    ssd1306_emu(i2c_inst_t* i2c, const uint8_t addr = 0x3c, const uint32_t height = 64);
+
+    /**
+     * ssd1306_emu class destructor
+     *   detached from I2C
+     */
+    virtual ~ssd1306_emu();
+
+    uint32_t get_width() const;
+    uint32_t get_height() const;
+
+    /**
+     * get GDDRAM
+     *
+     * @return GDDRAM of the same layout as the framebuffer of ssd1306 library ([page * WIDTH + x], LSB is the top row)
+     */
+    const uint8_t* get_gddram() const;
+
+    /**
+     * get pixel as the panel shows (display off and inverse are applied)
+     *
+     * @return true if the pixel is lit
+     */
+    bool get_pixel(const uint32_t x, const uint32_t y) const;
+
+    bool is_display_on() const;
+
+    /**
+     * get statistics of I2C transactions
+     *
+     * @param[out] stats statistics
+     */
+    void get_stats(stats_t& stats) const;
+    void reset_stats();
+
+    /**
+     * write the panel image as PBM (P4, lit pixel is black)
+     *
+     * @param[in] filename file name
+     * @return true if success
+     */
+    bool write_pbm(const char* filename) const;
+
+    /**
+     * compare the panel image with PBM (P4) file
+     *
+     * @param[in] filename file name
+     * @return number of different pixels (-1 if the file is not readable or the size differs)
+     */
+    int compare_pbm(const char* filename) const;
+
+    protected:
+    i2c_inst_t* _i2c;
+    uint8_t _addr;
+    uint32_t _height;
+    uint8_t _gddram[MAX_PAGES * WIDTH];
+    bool _display_on;
+    bool _inverse;
+    uint8_t _mem_mode;   // 0: horizontal, 1: vertical, 2: page
+    uint8_t _col_start;
+    uint8_t _col_end;
+    uint8_t _page_start;
+    uint8_t _page_end;
+    uint8_t _col;
+    uint8_t _page;
+    uint8_t _cmd[8];     // command in progress with its arguments
+    uint32_t _cmd_len;
+    stats_t _stats;
+
+    void _on_write(const uint8_t* src, const size_t len);
+    void _on_command_byte(const uint8_t byte);
+    void _exec_command();
+    void _on_data_byte(const uint8_t byte);
+    void _get_image(uint8_t* bits) const;
+};
@@ -0,0 +1,246 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include "ssd1306_emu.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "pico_host.h"
+
+// control byte
+static constexpr uint8_t CTRL_CO = 0x80;  // continuation: a control byte follows the next byte
+static constexpr uint8_t CTRL_DC = 0x40;  // data (GDDRAM) instead of command
+
+static uint32_t _num_args(const uint8_t cmd)
+{
+    switch (cmd) {
+    case 0x20:  // memory addressing mode
+    case 0x81:  // contrast
+    case 0x8D:  // charge pump
+    case 0xA8:  // multiplex ratio
+    case 0xD3:  // display offset
+    case 0xD5:  // display clock divide
+    case 0xD9:  // pre-charge period
+    case 0xDA:  // COM pins
+    case 0xDB:  // VCOMH deselect level
+        return 1;
+    case 0x21:  // column address
+    case 0x22:  // page address
+    case 0xA3:  // vertical scroll area
+        return 2;
+    case 0x29:  // vertical and horizontal scroll
+    case 0x2A:
+        return 5;
+    case 0x26:  // horizontal scroll
+    case 0x27:
+        return 6;
+    default:
+        return 0;
+    }
+}
+
+ssd1306_emu::ssd1306_emu(i2c_inst_t* i2c, const uint8_t addr, const uint32_t height) :
+    _i2c(i2c),
+    _addr(addr),
+    _height((height <= MAX_PAGES * 8) ? height : MAX_PAGES * 8),
+    _gddram{},
+    _display_on(false),
+    _inverse(false),
+    _mem_mode(2),  // reset value
+    _col_start(0),
+    _col_end(WIDTH - 1),
+    _page_start(0),
+    _page_end(MAX_PAGES - 1),
+    _col(0),
+    _page(0),
+    _cmd{},
+    _cmd_len(0),
+    _stats{}
+{
+    pico_host::i2c_set_target(_i2c, _addr, [this](const uint8_t* src, size_t len) { _on_write(src, len); });
+}
+
+ssd1306_emu::~ssd1306_emu()
+{
+    pico_host::i2c_set_target(_i2c, _addr, nullptr);
+}
+
+uint32_t ssd1306_emu::get_width() const
+{
+    return WIDTH;
+}
+
+uint32_t ssd1306_emu::get_height() const
+{
+    return _height;
+}
+
+const uint8_t* ssd1306_emu::get_gddram() const
+{
+    return _gddram;
+}
+
+bool ssd1306_emu::get_pixel(const uint32_t x, const uint32_t y) const
+{
+    if (x >= WIDTH || y >= _height || !_display_on) return false;
+    bool lit = (_gddram[(y / 8) * WIDTH + x] >> (y % 8)) & 1;
+    return lit != _inverse;
+}
+
+bool ssd1306_emu::is_display_on() const
+{
+    return _display_on;
+}
+
+void ssd1306_emu::get_stats(stats_t& stats) const
+{
+    stats = _stats;
+}
+
+void ssd1306_emu::reset_stats()
+{
+    _stats = {};
+}
+
+bool ssd1306_emu::write_pbm(const char* filename) const
+{
+    FILE* fp = fopen(filename, "wb");
+    if (fp == nullptr) return false;
+    std::vector<uint8_t> bits(WIDTH / 8 * _height);
+    _get_image(bits.data());
+    fprintf(fp, "P4\n%u %u\n", WIDTH, _height);
+    bool ok = fwrite(bits.data(), 1, bits.size(), fp) == bits.size();
+    fclose(fp);
+    return ok;
+}
+
+int ssd1306_emu::compare_pbm(const char* filename) const
+{
+    FILE* fp = fopen(filename, "rb");
+    if (fp == nullptr) return -1;
+    unsigned int width = 0;
+    unsigned int height = 0;
+    std::vector<uint8_t> bits(WIDTH / 8 * _height);
+    // single whitespace follows the height
+    bool ok = fscanf(fp, "P4 %u %u", &width, &height) == 2 && fgetc(fp) != EOF &&
+        width == WIDTH && height == _height && fread(bits.data(), 1, bits.size(), fp) == bits.size();
+    fclose(fp);
+    if (!ok) return -1;
+    std::vector<uint8_t> image(bits.size());
+    _get_image(image.data());
+    int num_diffs = 0;
+    for (size_t i = 0; i < bits.size(); i++) {
+        num_diffs += __builtin_popcount(bits[i] ^ image[i]);
+    }
+    return num_diffs;
+}
+
+void ssd1306_emu::_on_write(const uint8_t* src, const size_t len)
+{
+    _stats.transactions++;
+    _stats.bytes += len + 1;  // address byte
+    size_t i = 0;
+    while (i < len) {
+        uint8_t control = src[i++];
+        if (control & CTRL_CO) {
+            // a byte then the next control byte
+            if (i >= len) break;
+            if (control & CTRL_DC) {
+                _on_data_byte(src[i++]);
+            } else {
+                _on_command_byte(src[i++]);
+            }
+        } else {
+            // the rest of the transaction
+            for (; i < len; i++) {
+                if (control & CTRL_DC) {
+                    _on_data_byte(src[i]);
+                } else {
+                    _on_command_byte(src[i]);
+                }
+            }
+        }
+    }
+}
+
+void ssd1306_emu::_on_command_byte(const uint8_t byte)
+{
+    // the arguments can come in the following transactions (e.g. a command byte per transaction)
+    _cmd[_cmd_len++] = byte;
+    if (_cmd_len > _num_args(_cmd[0])) {
+        _exec_command();
+        _cmd_len = 0;
+    }
+}
+
+void ssd1306_emu::_exec_command()
+{
+    const uint8_t cmd = _cmd[0];
+    if (cmd == 0x20) {
+        _mem_mode = _cmd[1] & 0x3;
+    } else if (cmd == 0x21) {
+        _col_start = _cmd[1] & 0x7f;
+        _col_end = _cmd[2] & 0x7f;
+        _col = _col_start;
+    } else if (cmd == 0x22) {
+        _page_start = _cmd[1] & 0x7;
+        _page_end = _cmd[2] & 0x7;
+        _page = _page_start;
+    } else if (cmd <= 0x0f) {
+        // lower column start address for page addressing mode
+        _col = (_col & 0xf0) | cmd;
+    } else if (cmd >= 0x10 && cmd <= 0x1f) {
+        // higher column start address for page addressing mode
+        _col = (_col & 0x0f) | ((cmd & 0x7) << 4);
+    } else if (cmd >= 0xb0 && cmd <= 0xb7) {
+        // page start address for page addressing mode
+        _page = cmd & 0x7;
+    } else if (cmd == 0xa6 || cmd == 0xa7) {
+        _inverse = cmd & 1;
+    } else if (cmd == 0xae || cmd == 0xaf) {
+        _display_on = cmd & 1;
+    }
+    // the other commands don't change the image (the orientation is as initialized by ssd1306 library)
+}
+
+void ssd1306_emu::_on_data_byte(const uint8_t byte)
+{
+    _gddram[_page * WIDTH + _col] = byte;
+    _stats.data_bytes++;
+    if (_mem_mode == 0) {
+        // horizontal: column first in the window, then page
+        if (_col >= _col_end) {
+            _col = _col_start;
+            _page = (_page >= _page_end) ? _page_start : _page + 1;
+        } else {
+            _col++;
+        }
+    } else if (_mem_mode == 1) {
+        // vertical: page first in the window, then column
+        if (_page >= _page_end) {
+            _page = _page_start;
+            _col = (_col >= _col_end) ? _col_start : _col + 1;
+        } else {
+            _page++;
+        }
+    } else {
+        // page: column wraps in the page
+        _col = (_col + 1) % WIDTH;
+    }
+}
+
+void ssd1306_emu::_get_image(uint8_t* bits) const
+{
+    // PBM rows are MSB first and 1 is black, thus a lit pixel is 1
+    memset(bits, 0, WIDTH / 8 * _height);
+    for (uint32_t y = 0; y < _height; y++) {
+        for (uint32_t x = 0; x < WIDTH; x++) {
+            if (get_pixel(x, y)) bits[y * (WIDTH / 8) + x / 8] |= 0x80 >> (x % 8);
+        }
+    }
+}
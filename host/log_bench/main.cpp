@@ -0,0 +1,278 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+// Run dma_log against the UART model of pico_host
+//   cost: host time per log() call (producer) and per record formatted by process() (consumer) compared with snprintf
+//   blocking: virtual time the UI loop is blocked by a burst of event lines, printf style (uart_puts) vs dma_log
+//   order, drop and format: output of mixed log(), vlog() and write() compared with the expected text
+//   buffer bound: a drop reported at the last line of the TX buffer is not written past the buffer
+//   (DMA is not modeled, thus dma_log transmits by the CPU path only as much as the FIFO has room)
+//   exit code is non-zero if any check fails
+//   usage: log_bench [-n num_records]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+#include "pico_host.h"
+#include "dma_log.h"
+
+static constexpr uint BAUDRATE = 115200;
+static constexpr uint LOOP_INTERVAL_US = 1000;  // UI loop of the samples
+
+static int _failures = 0;
+
+static void _check(const bool ok, const char* name)
+{
+    printf("  %-40s %s\n", name, ok ? "PASS" : "FAIL");
+    if (!ok) _failures++;
+}
+
+static uint64_t _now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static std::string _sprintf(const char* fmt, ...)
+{
+    char buf[dma_log::MAX_LINE];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+    return std::string(buf);
+}
+
+static dma_log* _vlog_target = nullptr;
+
+static void _vlog(const char* fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    _vlog_target->vlog(fmt, args);
+    va_end(args);
+}
+
+static void _bench_cost(const uint32_t num_records)
+{
+    printf("cost (host time, %u records of 3 arguments)\n", num_records);
+    pico_host::reset();
+    uart_init(uart0, BAUDRATE);
+    dma_log log(uart0);
+    const uint batch = dma_log::DEFAULT_NUM_RECORDS;
+    uint64_t log_ns = 0;
+    uint64_t drain_ns = 0;
+    for (uint32_t i = 0; i < num_records; i += batch) {
+        uint64_t start_ns = _now_ns();
+        for (uint j = 0; j < batch; j++) {
+            log.log("Play A %lu ms %d %.1f\r\n", i + j, (int) j - 100, (float) j * 0.5f);
+        }
+        uint64_t mid_ns = _now_ns();
+        log.flush();
+        drain_ns += _now_ns() - mid_ns;
+        log_ns += mid_ns - start_ns;
+    }
+    pico_host::uart_take_tx(uart0);
+    char buf[dma_log::MAX_LINE];
+    volatile size_t total = 0;
+    uint64_t start_ns = _now_ns();
+    for (uint32_t i = 0; i < num_records; i++) {
+        total += snprintf(buf, sizeof(buf), "Play A %lu ms %d %.1f\r\n", (unsigned long) i, (int) (i % batch) - 100, (double) (i % batch) * 0.5);
+    }
+    uint64_t snprintf_ns = _now_ns() - start_ns;
+    const dma_log::log_stats_t& stats = log.get_stats();
+    printf("  log() per call:          %7.1f ns\n", (double) log_ns / num_records);
+    printf("  process() per record:    %7.1f ns (format and UART model)\n", (double) drain_ns / num_records);
+    printf("  snprintf() per call:     %7.1f ns\n", (double) snprintf_ns / num_records);
+    printf("  records %u, dropped %u, max level %u, bytes %llu\n", stats.records, stats.dropped, stats.max_level, (unsigned long long) stats.bytes);
+    _check(stats.records == (num_records + batch - 1) / batch * batch && stats.dropped == 0, "all records transmitted");
+}
+
+static void _bench_blocking()
+{
+    printf("blocking (virtual time at %u baud, burst of 8 event lines)\n", BAUDRATE);
+    static const char* const EVENTS[] = {"Cassette set", "Play A", "Reversed", "Play B", "FF", "Stop", "REW", "Power off"};
+    const uint num_events = sizeof(EVENTS) / sizeof(EVENTS[0]);
+
+    // printf style: the UI loop waits for the FIFO
+    pico_host::reset();
+    uart_init(uart0, BAUDRATE);
+    uint64_t start_us = pico_host::now_us();
+    std::string expected;
+    for (uint i = 0; i < num_events; i++) {
+        std::string line = _sprintf("%s (%u)\r\n", EVENTS[i], i);
+        uart_puts(uart0, line.c_str());
+        expected += line;
+    }
+    uint64_t blocking_us = pico_host::now_us() - start_us;
+    uart_tx_wait_blocking(uart0);
+    pico_host::uart_take_tx(uart0);
+
+    // dma_log: the UI loop only stores the records and transmits as much as the FIFO has room in every loop
+    pico_host::reset();
+    uart_init(uart0, BAUDRATE);
+    dma_log log(uart0);
+    uint64_t max_blocked_us = 0;
+    start_us = pico_host::now_us();
+    for (uint i = 0; i < num_events; i++) {
+        switch (i) {  // the format strings are static
+        case 0: log.log("Cassette set (%u)\r\n", i); break;
+        case 1: log.log("Play A (%u)\r\n", i); break;
+        case 2: log.log("Reversed (%u)\r\n", i); break;
+        case 3: log.log("Play B (%u)\r\n", i); break;
+        case 4: log.log("FF (%u)\r\n", i); break;
+        case 5: log.log("Stop (%u)\r\n", i); break;
+        case 6: log.log("REW (%u)\r\n", i); break;
+        default: log.log("Power off (%u)\r\n", i); break;
+        }
+    }
+    max_blocked_us = pico_host::now_us() - start_us;
+    uint loops = 0;
+    while (true) {
+        uint64_t loop_us = pico_host::now_us();
+        bool remains = log.process();
+        max_blocked_us = std::max(max_blocked_us, pico_host::now_us() - loop_us);
+        if (!remains) break;
+        pico_host::advance_us(LOOP_INTERVAL_US);
+        loops++;
+    }
+    uart_tx_wait_blocking(uart0);
+    std::string output = pico_host::uart_take_tx(uart0);
+    printf("  printf style blocked:    %7llu us\n", (unsigned long long) blocking_us);
+    printf("  dma_log max blocked:     %7llu us (transmitted in %u loops of %u us)\n", (unsigned long long) max_blocked_us, loops, LOOP_INTERVAL_US);
+    _check(output == expected, "same output as printf style");
+    _check(max_blocked_us == 0, "UI loop never blocked");
+}
+
+// exposes the TX buffers to check the bounds of _fill_buffer()
+class dma_log_probe : public dma_log {
+    public:
+    dma_log_probe(uart_inst_t* uart, const uint num_records) : dma_log(uart, num_records) {}
+    size_t fill_from(const size_t len)
+    {
+        _tx_len[_fill] = len;
+        _tx_pos = 0;
+        _fill_buffer();
+        return _tx_len[_fill];
+    }
+    void reset_buffer()
+    {
+        _tx_len[_fill] = 0;
+        _tx_pos = 0;
+    }
+    uint8_t* guard() { return _tx[_fill ^ 1]; }  // placed just after the buffer being filled (unused by CPU path)
+};
+
+static void _check_buffer_bound()
+{
+    printf("buffer bound\n");
+    pico_host::reset();
+    uart_init(uart0, BAUDRATE);
+    dma_log_probe log(uart0, 16);
+
+    // a record with a drop pending at the last line of the buffer
+    for (uint i = 0; i < 17; i++) {
+        log.log("line %u\r\n", i);
+    }
+    log.flush();
+    pico_host::uart_take_tx(uart0);
+    const char* const long_line = "%u: the line of this record is long enough to overflow the buffer if written after the drop line.....\r\n";
+    log.log(long_line, 1u);
+    memset(log.guard(), 0xcc, dma_log::TX_BUF_SIZE);
+    size_t len = log.fill_from(dma_log::TX_BUF_SIZE - dma_log::MAX_LINE);
+    bool untouched = std::all_of(log.guard(), log.guard() + dma_log::TX_BUF_SIZE, [](const uint8_t b) { return b == 0xcc; });
+    _check(len <= dma_log::TX_BUF_SIZE && untouched, "no write past the buffer by drop line");
+
+    // the record is kept for the next buffer
+    log.reset_buffer();
+    log.flush();
+    std::string output = pico_host::uart_take_tx(uart0);
+    _check(output == "[dma_log] 1 records dropped\r\n" + _sprintf(long_line, 1u), "drop line and record in next buffer");
+}
+
+static void _check_order_drop_format()
+{
+    printf("order, drop and format\n");
+    pico_host::reset();
+    uart_init(uart0, BAUDRATE);
+    dma_log log(uart0, 16);
+    _vlog_target = &log;
+
+    // text records and bytes of write() are kept in order
+    std::string expected;
+    const uint8_t frame[] = {0xa5, 0x01, 0x00, 0x00, 0x0d, 0x0a, 0xff, 0x00, 0x55, 0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70, 0x80, 0x90, 0xa0};
+    log.log("head dir %c\r\n", 'A');
+    expected += "head dir A\r\n";
+    log.write(frame, sizeof(frame));
+    expected += std::string((const char*) frame, sizeof(frame));
+    log.log("%5.2f %d %u %x %%\r\n", 3.14159, -42, 42u, 0xbeef);
+    expected += _sprintf("%5.2f %d %u %x %%\r\n", 3.14159, -42, 42u, 0xbeef);
+    _vlog("vlog %ld %lu %-4x| %.1f\r\n", -7L, 7UL, 0xa, 2.5);
+    expected += _sprintf("vlog %ld %lu %-4x| %.1f\r\n", -7L, 7UL, 0xa, 2.5);
+    log.log("int as float %.1f, float as int %d\r\n", 3, 2.9f);
+    expected += "int as float 3.0, float as int 2\r\n";
+    log.flush();
+    std::string output = pico_host::uart_take_tx(uart0);
+    _check(output == expected, "order and format of log, vlog and write");
+    if (output != expected) {
+        size_t pos = std::mismatch(output.begin(), output.end(), expected.begin(), expected.end()).first - output.begin();
+        printf("    differs at %zu:\n    output:   %s\n    expected: %s\n", pos, output.substr(pos).c_str(), expected.substr(pos).c_str());
+    }
+
+    // records are dropped without blocking when the ring is full, then the drop is reported
+    expected.clear();
+    for (uint i = 0; i < 40; i++) {
+        bool logged = log.log("line %u\r\n", i);
+        if (logged) expected += _sprintf("line %u\r\n", i);
+    }
+    bool frame_logged = log.write(frame, sizeof(frame));
+    log.flush();
+    expected += "[dma_log] 26 records dropped\r\n";
+    log.log("after drop\r\n");
+    log.flush();
+    expected += "after drop\r\n";
+    output = pico_host::uart_take_tx(uart0);
+    const dma_log::log_stats_t& stats = log.get_stats();
+    _check(!frame_logged && stats.dropped == 26, "records dropped when full");
+    _check(output == expected, "drop reported in order");
+
+    // timestamp
+    pico_host::advance_us(1234567);
+    log.set_timestamp(true);
+    uint32_t time_ms = (uint32_t) pico_host::now_us() / 1000;
+    log.log("stamped\r\n");
+    log.flush();
+    output = pico_host::uart_take_tx(uart0);
+    _check(output == _sprintf("[%4u.%03u] stamped\r\n", time_ms / 1000, time_ms % 1000), "timestamp prepended");
+    _vlog_target = nullptr;
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t num_records = 1000000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+        case 'n':
+            num_records = strtoul(optarg, nullptr, 0);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n num_records]\n", argv[0]);
+            return 1;
+        }
+    }
+    _bench_cost(std::max(num_records, 1u));
+    _bench_blocking();
+    _check_order_drop_format();
+    _check_buffer_bound();
+    printf("%s\n", (_failures == 0) ? "ALL PASS" : "FAILED");
+    return (_failures == 0) ? 0 : 1;
+}
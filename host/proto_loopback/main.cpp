@@ -0,0 +1,339 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+// Loopback of deck_proto over a pseudo-terminal
+//   the device thread runs crp42602y_ctrl_with_counter against crp42602y_sim with deck_proto_server
+//   on the master side of the pty (virtual time is paced to the wall clock), and prints the callbacks
+//   as text like the samples. deck_proto_client opens the slave side as a serial port.
+//   reports round-trip time of ping, throughput of pipelined requests, latency of a command batch
+//   and the telemetry rate, then checks the recovery from garbage and corrupt frames
+//   exit code is non-zero if any check fails
+//   usage: proto_loopback [-n num_pings] [-t telemetry_interval_ms]
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "pico_host.h"
+#include "crp42602y_ctrl.h"
+#include "crp42602y_sim.h"
+#include "deck_proto_client.h"
+#include "deck_proto_server.h"
+
+// CRP42602Y control pins (the same as samples)
+static constexpr uint PIN_SOLENOID_CTRL   = 2;
+static constexpr uint PIN_CASSETTE_DETECT = 3;
+static constexpr uint PIN_GEAR_STATUS_SW  = 4;
+static constexpr uint PIN_ROTATION_SENS   = 5;
+static constexpr uint PIN_POWER_CTRL      = 6;
+
+static constexpr uint32_t PIPELINE_DEPTH = 32;
+static constexpr int PLAY_TIMEOUT_MS = 5000;
+
+static int _master_fd = -1;
+static std::atomic<bool> _quit(false);
+static std::vector<crp42602y_ctrl::callback_type_t> _callbacks;  // device thread only
+static uint32_t _text_bytes = 0;  // bytes handled as single character commands (device thread only)
+static int _num_failures = 0;
+
+typedef std::chrono::steady_clock clock_type;
+
+static double _elapsed_us(const clock_type::time_point& start)
+{
+    return std::chrono::duration<double, std::micro>(clock_type::now() - start).count();
+}
+
+static void _check(const char* name, const bool pass)
+{
+    printf("  %s: %s\n", name, pass ? "PASS" : "FAIL");
+    if (!pass) _num_failures++;
+}
+
+static void _device_write(const uint8_t* data, size_t len)
+{
+    size_t pos = 0;
+    while (pos < len) {
+        ssize_t n = write(_master_fd, &data[pos], len - pos);
+        if (n > 0) {
+            pos += n;
+        } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            return;
+        }
+    }
+}
+
+static void _device_print(const char* text)
+{
+    _device_write(reinterpret_cast<const uint8_t*>(text), strlen(text));
+}
+
+static void _device_callback(const crp42602y_ctrl::callback_type_t callback_type)
+{
+    _callbacks.push_back(callback_type);
+}
+
+// the UI loop of the samples with process_loop() of core1 in a thread
+static void _device_thread(crp42602y_ctrl* ctrl, deck_proto_server* server)
+{
+    static const char* names[] = {
+        "Gear error", "Command FIFO overflow", "Cassette set", "Cassette eject", "Stop", "Play",
+        "Cue", "FF/REW", "Reversed", "Power off", "Power recover", "End of tape"
+    };
+    uint64_t base_us = pico_host::now_us();
+    auto start = clock_type::now();
+    while (!_quit) {
+        pico_host::advance_to_us(base_us + (uint64_t) _elapsed_us(start));
+        ctrl->process_loop();
+
+        struct pollfd pfd = {_master_fd, POLLIN, 0};
+        poll(&pfd, 1, 1);
+        uint8_t buf[256];
+        ssize_t n = read(_master_fd, buf, sizeof(buf));
+        for (ssize_t i = 0; i < n; i++) {
+            if (!server->feed(buf[i])) _text_bytes++;
+        }
+        server->process();
+
+        for (auto callback_type : _callbacks) {
+            if (callback_type < sizeof(names) / sizeof(names[0])) {
+                _device_print(names[callback_type]);
+                _device_print("\r\n");
+            }
+            server->notify_event(callback_type);
+        }
+        _callbacks.clear();
+    }
+}
+
+static bool _open_pty(char* slave_path, size_t size)
+{
+    _master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (_master_fd < 0 || grantpt(_master_fd) != 0 || unlockpt(_master_fd) != 0) return false;
+    const char* name = ptsname(_master_fd);
+    if (name == nullptr) return false;
+    snprintf(slave_path, size, "%s", name);
+    fcntl(_master_fd, F_SETFL, fcntl(_master_fd, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+static void _test_ping(deck_proto_client& client, const uint32_t num_pings)
+{
+    printf("[ping] %u sequential pings of 8 bytes\n", num_pings);
+    std::vector<double> rtts;
+    uint8_t data[8];
+    uint32_t lost = 0;
+    for (uint32_t i = 0; i < num_pings; i++) {
+        for (uint j = 0; j < sizeof(data); j++) data[j] = (uint8_t) (i + j);
+        auto start = clock_type::now();
+        if (client.ping(data, sizeof(data))) {
+            rtts.push_back(_elapsed_us(start));
+        } else {
+            lost++;
+        }
+    }
+    std::sort(rtts.begin(), rtts.end());
+    double total = 0.0;
+    for (double rtt : rtts) total += rtt;
+    if (!rtts.empty()) {
+        printf("  round trip: min %.1f us, avg %.1f us, p99 %.1f us, max %.1f us\n",
+            rtts.front(), total / rtts.size(), rtts[rtts.size() * 99 / 100], rtts.back());
+    }
+    _check("all pings echoed", lost == 0);
+}
+
+static void _test_pipeline(deck_proto_client& client, const uint32_t num_requests)
+{
+    printf("[pipeline] %u pings of 32 bytes with %u requests in flight\n", num_requests, PIPELINE_DEPTH);
+    uint8_t data[32] = {};
+    std::vector<int> tickets;
+    uint32_t sent = 0;
+    uint32_t received = 0;
+    auto start = clock_type::now();
+    while (received < num_requests) {
+        while (sent < num_requests && tickets.size() < PIPELINE_DEPTH) {
+            tickets.push_back(client.request(deck_proto::MSG_PING, data, sizeof(data)));
+            sent++;
+        }
+        deck_proto::frame_t frame;
+        if (!client.wait_response((uint16_t) tickets.front(), frame)) break;
+        tickets.erase(tickets.begin());
+        received++;
+    }
+    double sec = _elapsed_us(start) / 1e6;
+    size_t frame_bytes = deck_proto::OVERHEAD + deck_proto::TICKET_SIZE + sizeof(data);
+    printf("  %.0f requests/sec, %.1f KB/sec each way\n", received / sec, received * frame_bytes / sec / 1e3);
+    _check("all responses in order of tickets", received == num_requests);
+}
+
+static void _test_commands(deck_proto_client& client, const uint16_t interval_ms)
+{
+    printf("[commands] batch of reverse mode and PLAY A, then telemetry at %u ms\n", interval_ms);
+    bool played = false;
+    double play_event_us = 0.0;
+    std::vector<deck_proto::telemetry_t> telemetry;
+    auto start = clock_type::now();
+    client.set_event_callback([&](const uint8_t callback_type, const uint32_t time_ms) {
+        if (callback_type == crp42602y_ctrl::ON_PLAY && !played) {
+            played = true;
+            play_event_us = _elapsed_us(start);
+        }
+    });
+    client.set_telemetry_callback([&](const deck_proto::telemetry_t& t) { telemetry.push_back(t); });
+    _check("subscribe", client.subscribe(interval_ms, true));
+
+    const uint8_t codes[] = {deck_proto::CODE_RVS_ONE_WAY, deck_proto::CODE_PLAY_A};
+    deck_proto::status_t status;
+    uint8_t accepted = 0;
+    start = clock_type::now();
+    bool acked = client.send_commands(codes, sizeof(codes), status, accepted);
+    double ack_us = _elapsed_us(start);
+    while (!played && _elapsed_us(start) < PLAY_TIMEOUT_MS * 1e3) {
+        client.poll(10);
+    }
+    printf("  command to ACK: %.1f us, command to ON_PLAY event: %.1f ms (gear sequence of the mechanism)\n", ack_us, play_event_us / 1e3);
+    _check("batch accepted", acked && status == deck_proto::STATUS_OK && accepted == sizeof(codes));
+    _check("ON_PLAY event", played);
+
+    deck_proto::state_t state;
+    bool got_state = client.get_state(state);
+    _check("state playing A", got_state && (state.transport_state & crp42602y_ctrl::TS_PLAYING_BIT) &&
+        (state.transport_state & crp42602y_ctrl::TS_HEAD_DIR_A_BIT) && state.reverse_mode == crp42602y_ctrl::RVS_ONE_WAY &&
+        (state.flags & deck_proto::FLAG_HAS_CASSETTE));
+
+    const uint8_t repeated[] = {deck_proto::CODE_PLAY_A, deck_proto::CODE_STOP};
+    acked = client.send_commands(repeated, sizeof(repeated), status, accepted);
+    _check("repeated command rejected", acked && status == deck_proto::STATUS_REJECTED && accepted == 0);
+
+    telemetry.clear();
+    client.poll(1000);
+    uint32_t gaps = 0;
+    for (size_t i = 1; i < telemetry.size(); i++) {
+        if ((uint16_t) (telemetry[i].seq - telemetry[i - 1].seq) != 1) gaps++;
+    }
+    uint32_t expected = 1000 / interval_ms;
+    printf("  telemetry: %zu frames in 1 sec (expected %u), %u gaps of seq\n", telemetry.size(), expected, gaps);
+    if (!telemetry.empty()) {
+        printf("  last telemetry: time %u ms, transport state 0x%08x, flags 0x%02x, counter A %.1f sec\n",
+            telemetry.back().time_ms, telemetry.back().transport_state, telemetry.back().flags, telemetry.back().playing_sec[0]);
+    }
+    _check("telemetry rate", telemetry.size() + 2 >= expected && telemetry.size() <= expected + 2 && gaps == 0);
+
+    deck_proto::counter_t counter;
+    bool got_counter = client.get_counter(counter);
+    printf("  counter: state %u, A %.1f sec, B %.1f sec\n", counter.state, counter.playing_sec[0], counter.playing_sec[1]);
+    _check("counter snapshot", got_counter);
+
+    const uint8_t stop[] = {deck_proto::CODE_STOP};
+    acked = client.send_commands(stop, sizeof(stop), status, accepted);
+    _check("stop accepted", acked && status == deck_proto::STATUS_OK);
+    _check("unsubscribe", client.subscribe(0, false));
+    client.set_event_callback(nullptr);
+    client.set_telemetry_callback(nullptr);
+}
+
+static void _test_recovery(deck_proto_client& client)
+{
+    printf("[recovery] garbage, truncated and corrupt frames followed by a request\n");
+    deck_proto::frame_t frame;
+    int ticket = client.request(0x7f, nullptr, 0);
+    _check("unknown type", ticket >= 0 && client.wait_response(ticket, frame) &&
+        frame.type == deck_proto::MSG_ACK && frame.payload[2] == deck_proto::STATUS_UNKNOWN_TYPE);
+
+    // random bytes including SYNC, the frame in reception is discarded by inter-byte timeout
+    std::vector<uint8_t> garbage(256);
+    srand(1);
+    for (auto& byte : garbage) byte = (uint8_t) rand();
+    garbage.back() = deck_proto::SYNC;
+    client.write_raw(garbage.data(), garbage.size());
+    client.poll(deck_proto_server::INTER_BYTE_TIMEOUT_MS * 2);
+    _check("ping after garbage", client.ping(nullptr, 0));
+
+    // corrupt CRC
+    uint8_t payload[deck_proto::TICKET_SIZE] = {0, 0};
+    uint8_t corrupt[deck_proto::MAX_FRAME];
+    size_t len = deck_proto::encode(corrupt, deck_proto::MSG_PING, payload, sizeof(payload));
+    corrupt[len - 1] ^= 0x5a;
+    client.write_raw(corrupt, len);
+    _check("ping after corrupt frame", client.ping(nullptr, 0));
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t num_pings = 1000;
+    uint16_t interval_ms = 20;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:t:")) != -1) {
+        switch (opt) {
+        case 'n':
+            num_pings = strtoul(optarg, nullptr, 0);
+            break;
+        case 't':
+            interval_ms = (uint16_t) std::max(strtoul(optarg, nullptr, 0), (unsigned long) deck_proto_server::MIN_TELEMETRY_INTERVAL_MS);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-n num_pings] [-t telemetry_interval_ms]\n", argv[0]);
+            return 1;
+        }
+    }
+    char slave_path[64];
+    if (!_open_pty(slave_path, sizeof(slave_path))) {
+        fprintf(stderr, "ERROR: cannot open pseudo-terminal\n");
+        return 2;
+    }
+
+    // device
+    pico_host::reset();
+    crp42602y_sim::pins_t pins = {PIN_CASSETTE_DETECT, PIN_GEAR_STATUS_SW, PIN_ROTATION_SENS, PIN_SOLENOID_CTRL, PIN_POWER_CTRL, 0, 0};
+    crp42602y_ctrl* ctrl = new crp42602y_ctrl_with_counter(PIN_CASSETTE_DETECT, PIN_GEAR_STATUS_SW, PIN_ROTATION_SENS, PIN_SOLENOID_CTRL, PIN_POWER_CTRL);
+    crp42602y_sim* sim = new crp42602y_sim(pins);
+    deck_proto_server* server = new deck_proto_server(ctrl, _device_write);
+    ctrl->register_callback_all(_device_callback);
+    ctrl->recover_power_from_timeout();
+    sim->insert_cassette(crp42602y_sim::make_tape(30.0, 18.0));
+
+    deck_proto_client client;
+    if (!client.open(slave_path)) {
+        fprintf(stderr, "ERROR: cannot open %s\n", slave_path);
+        return 2;
+    }
+    std::thread device(_device_thread, ctrl, server);
+    client.poll(1000);  // cassette detection
+
+    _test_ping(client, num_pings);
+    _test_pipeline(client, num_pings * 4);
+    _test_commands(client, interval_ms);
+    _test_recovery(client);
+
+    _quit = true;
+    device.join();
+    client.close();
+    close(_master_fd);
+
+    const deck_proto::parser_stats_t& device_parser = server->get_parser_stats();
+    const deck_proto_server::server_stats_t& stats = server->get_stats();
+    const deck_proto::parser_stats_t& client_parser = client.get_parser_stats();
+    printf("device: %u frames, %u errors, %u timeouts, %u text bytes, %u requests, %u commands, %u rejected, %u telemetry, %u events\n",
+        device_parser.frames, device_parser.errors, stats.timeouts, _text_bytes, stats.requests, stats.commands, stats.rejected, stats.telemetry, stats.events);
+    printf("client: %u frames, %u errors, %u text bytes skipped\n", client_parser.frames, client_parser.errors, client_parser.others);
+    _check("corrupt frame detected", device_parser.errors + stats.timeouts > 0);
+    _check("text skipped by client", client_parser.others > 0 && client_parser.errors == 0);
+
+    delete server;
+    delete sim;
+    delete ctrl;
+    printf("%s\n", (_num_failures == 0) ? "ALL PASS" : "FAIL");
+    return (_num_failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,584 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+// Run the scenarios of crp42602y_ctrl against crp42602y_sim in virtual time
+//   exit code is non-zero if any scenario exceeds its threshold
+//   usage: sim_run [scenario] [-t trace.bin]  (-t records the counter trace of deck 0 with the ground truth)
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "pico_host.h"
+#include "crp42602y_ctrl.h"
+#include "crp42602y_multi_deck.h"
+#include "crp42602y_sim.h"
+
+// CRP42602Y control pins (the same as samples for deck 0)
+static constexpr uint NUM_PINS_PER_DECK = 5;
+static constexpr uint PIN_SOLENOID_CTRL   = 2;
+static constexpr uint PIN_CASSETTE_DETECT = 3;
+static constexpr uint PIN_GEAR_STATUS_SW  = 4;
+static constexpr uint PIN_ROTATION_SENS   = 5;
+static constexpr uint PIN_POWER_CTRL      = 6;
+
+// Thresholds
+static constexpr float    PLAY_COUNTER_ERROR_SEC = 2.0;
+static constexpr float    FF_REW_COUNTER_ERROR_SEC = 5.0;
+static constexpr int64_t  SYNC_SKEW_US = 2000;
+static constexpr uint64_t RELAY_GAP_US = 1500000;
+static constexpr uint64_t CASSETTE_DETECT_LATENCY_US = 50000;
+
+typedef decltype(crp42602y_ctrl::STOP_COMMAND) command_t;  // command_t itself is not public
+
+typedef struct _deck_t {
+    crp42602y_ctrl_with_counter* ctrl;
+    crp42602y_sim* sim;
+} deck_t;
+
+static std::vector<deck_t> _decks;
+static crp42602y_multi_deck* _multi_deck = nullptr;
+static uint64_t _num_loops = 0;
+static bool _end_of_tape[crp42602y_multi_deck::MAX_NUM_DECKS];
+static uint64_t _cassette_set_us[crp42602y_multi_deck::MAX_NUM_DECKS];
+static uint64_t _cassette_eject_us[crp42602y_multi_deck::MAX_NUM_DECKS];
+static uint32_t _num_gear_errors[crp42602y_multi_deck::MAX_NUM_DECKS];
+static int _num_failures = 0;
+static FILE* _trace_fp = nullptr;  // counter trace of deck 0
+static uint64_t _next_truth_us = 0;
+static constexpr uint64_t TRUTH_INTERVAL_US = 1000000;
+
+static crp42602y_sim::pins_t _deck_pins(const uint deck)
+{
+    uint base = deck * NUM_PINS_PER_DECK;
+    return {base + PIN_CASSETTE_DETECT, base + PIN_GEAR_STATUS_SW, base + PIN_ROTATION_SENS, base + PIN_SOLENOID_CTRL, base + PIN_POWER_CTRL, 0, 0};
+}
+
+static void _on_deck_callback(const uint deck, const crp42602y_ctrl::callback_type_t callback_type)
+{
+    if (callback_type == crp42602y_ctrl::ON_END_OF_TAPE) {
+        _end_of_tape[deck] = true;
+    } else if (callback_type == crp42602y_ctrl::ON_CASSETTE_SET) {
+        _cassette_set_us[deck] = pico_host::now_us();
+    } else if (callback_type == crp42602y_ctrl::ON_CASSETTE_EJECT) {
+        _cassette_eject_us[deck] = pico_host::now_us();
+    } else if (callback_type == crp42602y_ctrl::ON_GEAR_ERROR) {
+        _num_gear_errors[deck]++;
+    }
+}
+
+static void _write_trace(const crp42602y_counter::trace_record_t& record)
+{
+    fwrite(&record, sizeof(record), 1, _trace_fp);
+}
+
+static void _setup(const uint num_decks, const crp42602y_sim::config_t& config = crp42602y_sim::DEFAULT_CONFIG)
+{
+    pico_host::reset();
+    crp42602y_ctrl* ctrls[crp42602y_multi_deck::MAX_NUM_DECKS];
+    for (uint i = 0; i < num_decks; i++) {
+        crp42602y_sim::pins_t pins = _deck_pins(i);
+        deck_t deck;
+        deck.ctrl = new crp42602y_ctrl_with_counter(pins.cassette_detect, pins.gear_status_sw, pins.rotation_sens, pins.solenoid_ctrl, pins.power_ctrl);
+        deck.sim = new crp42602y_sim(pins, config);
+        deck.ctrl->set_reverse_mode(crp42602y_ctrl::RVS_ONE_WAY);
+        _decks.push_back(deck);
+        ctrls[i] = deck.ctrl;
+        _end_of_tape[i] = false;
+        _cassette_set_us[i] = 0;
+        _cassette_eject_us[i] = 0;
+        _num_gear_errors[i] = 0;
+    }
+    _multi_deck = new crp42602y_multi_deck(ctrls, num_decks);
+    _multi_deck->register_callback_all(_on_deck_callback);
+    if (_trace_fp != nullptr) {
+        // each scenario starts with a new counter
+        _write_trace({crp42602y_counter::TRACE_RESTART, 0, 0, 0});
+        _decks[0].ctrl->get_counter_inst()->set_trace_callback(_write_trace);
+        _next_truth_us = 0;
+    }
+    // power on the mechanisms as the application does before the first command
+    for (auto& deck : _decks) {
+        deck.ctrl->recover_power_from_timeout();
+    }
+    _num_loops = 0;
+}
+
+static void _teardown()
+{
+    delete _multi_deck;
+    _multi_deck = nullptr;
+    for (auto& deck : _decks) {
+        delete deck.sim;
+        delete deck.ctrl;
+    }
+    _decks.clear();
+}
+
+static void _send(const uint deck, const command_t& command)
+{
+    _multi_deck->send_command(deck, command);
+}
+
+static void _send_sync(const command_t& command)
+{
+    _multi_deck->send_command_sync(command);
+}
+
+/**
+ * run process_loop as core1 until the condition or the duration
+ *   core1 sleeps by wait_for_event() between the loops as on device
+ *
+ * @return true if the condition is met
+ */
+static bool _run(const float max_sec, const std::function<bool()>& done = nullptr)
+{
+    uint64_t end_us = pico_host::now_us() + (uint64_t) (max_sec * 1e6);
+    while (pico_host::now_us() < end_us) {
+        _multi_deck->process_loop();
+        _num_loops++;
+        if (_trace_fp != nullptr && pico_host::now_us() >= _next_truth_us) {
+            uint32_t position_ms = (uint32_t) (_decks[0].sim->get_position_sec() * 1000.0f);
+            _write_trace({crp42602y_counter::TRACE_TRUTH, 0, 0, position_ms});
+            _next_truth_us += TRUTH_INTERVAL_US;
+        }
+        if (done && done()) return true;
+        uint64_t limit_us = (_trace_fp != nullptr && _next_truth_us < end_us) ? _next_truth_us : end_us;
+        _multi_deck->wait_for_event(limit_us);
+    }
+    return false;
+}
+
+/**
+ * get counter error of side A
+ *
+ * @param[in] deck deck number
+ * @param[in] origin_sec tape position where the counter started from zero
+ */
+static float _counter_error(const uint deck, const float origin_sec = 0.0)
+{
+    crp42602y_counter::counter_snapshot_t snapshot;
+    _decks[deck].ctrl->get_counter_inst()->get_snapshot(snapshot);
+    return std::fabs(snapshot.playing_sec[0] - (_decks[deck].sim->get_position_sec() - origin_sec));
+}
+
+static void _check(const char* name, const bool pass)
+{
+    printf("  %s: %s\n", name, pass ? "PASS" : "FAIL");
+    if (!pass) _num_failures++;
+}
+
+// Play a whole side of C-90 and compare the counter with the actual position
+static void _scenario_play_side()
+{
+    printf("[play_side] C-90 side A from the beginning\n");
+    _setup(1);
+    crp42602y_sim* sim = _decks[0].sim;
+    sim->insert_cassette(crp42602y_sim::make_tape(45.0, 12.0));
+    _run(1.0);
+    _send(0, crp42602y_ctrl::PLAY_A_COMMAND);
+    float max_error = 0.0;
+    uint64_t next_check_us = pico_host::now_us() + 60 * 1000000ULL;  // after the counter is determined
+    bool end = _run(sim->get_tape_length_sec() + 60.0, [&]() {
+        if (pico_host::now_us() >= next_check_us) {
+            float error = _counter_error(0);
+            if (std::isnan(error) || error > max_error) max_error = error;
+            next_check_us += 1000000;
+        }
+        return _end_of_tape[0];
+    });
+    printf("  end of tape: %s at %7.1f sec (tape %7.1f sec)\n", end ? "detected" : "not detected",
+        (float) sim->get_tape_end_us() / 1e6, sim->get_tape_length_sec());
+    printf("  counter max error: %5.2f sec, sensor pulses: %u, reel mismatch: %u\n",
+        max_error, sim->get_num_sensor_pulses(), sim->get_num_reel_mismatch());
+    _check("end of tape", end);
+    _check("counter error", max_error < PLAY_COUNTER_ERROR_SEC);
+    _check("no reel mismatch", sim->get_num_reel_mismatch() == 0);
+    _teardown();
+}
+
+// FF and REW after the counter has learned the tape
+static void _scenario_ff_rew()
+{
+    printf("[ff_rew] C-60 play 60 sec, FF 40 sec, REW 20 sec\n");
+    _setup(1);
+    crp42602y_sim* sim = _decks[0].sim;
+    constexpr float origin_sec = 300.0;
+    sim->insert_cassette(crp42602y_sim::make_tape(30.0, 18.0), origin_sec);
+    _run(1.0);
+    _send(0, crp42602y_ctrl::PLAY_A_COMMAND);
+    _run(60.0);
+    _send(0, crp42602y_ctrl::FF_COMMAND);
+    _run(40.0);
+    _send(0, crp42602y_ctrl::STOP_COMMAND);
+    _run(2.0);
+    float ff_error = _counter_error(0, origin_sec);
+    printf("  after FF:  position %7.1f sec, counter error %5.2f sec\n", sim->get_position_sec(), ff_error);
+    _send(0, crp42602y_ctrl::REW_COMMAND);
+    _run(20.0);
+    _send(0, crp42602y_ctrl::STOP_COMMAND);
+    _run(2.0);
+    float rew_error = _counter_error(0, origin_sec);
+    printf("  after REW: position %7.1f sec, counter error %5.2f sec\n", sim->get_position_sec(), rew_error);
+    _check("FF counter error", ff_error < FF_REW_COUNTER_ERROR_SEC);
+    _check("REW counter error", rew_error < FF_REW_COUNTER_ERROR_SEC);
+    _teardown();
+}
+
+// Synchronized start of two decks
+static void _scenario_sync_start()
+{
+    printf("[sync_start] two decks start play synchronously\n");
+    _setup(2);
+    for (auto& deck : _decks) {
+        deck.sim->insert_cassette(crp42602y_sim::make_tape(45.0, 12.0));
+    }
+    _run(1.0);
+    _send_sync(crp42602y_ctrl::PLAY_A_COMMAND);
+    _run(5.0);
+    int64_t mech_skew = (int64_t) _decks[0].sim->get_func_arrival_us() - (int64_t) _decks[1].sim->get_func_arrival_us();
+    int32_t ctrl_skew = _multi_deck->get_sync_skew_us();
+    printf("  mechanical skew: %lld us, measured skew: %d us\n", (long long) mech_skew, ctrl_skew);
+    _check("both playing", _decks[0].ctrl->is_playing() && _decks[1].ctrl->is_playing());
+    _check("mechanical skew", std::llabs(mech_skew) < SYNC_SKEW_US);
+    _teardown();
+}
+
+// Relay play from deck 0 to deck 1 at the end of tape
+static void _scenario_relay()
+{
+    printf("[relay] deck 0 relays to deck 1 at the end of tape\n");
+    _setup(2);
+    crp42602y_sim::tape_t tape = crp42602y_sim::make_tape(45.0, 12.0);
+    _decks[0].sim->insert_cassette(tape, tape.length_cm / crp42602y_sim::DEFAULT_CONFIG.tape_speed_cm_per_sec - 30.0);
+    _decks[1].sim->insert_cassette(tape);
+    _run(1.0);
+    _multi_deck->set_relay(0, 1);
+    _send(0, crp42602y_ctrl::PLAY_A_COMMAND);
+    bool relayed = _run(60.0, []() { return _decks[1].ctrl->is_playing(); });
+    _run(1.0);
+    uint64_t end_us = _decks[0].sim->get_tape_end_us();
+    uint64_t start_us = _decks[1].sim->get_func_arrival_us();
+    uint64_t gap_us = (relayed && start_us > end_us) ? start_us - end_us : UINT64_MAX;
+    printf("  deck 0 tape end: %7.3f sec, deck 1 play start: %7.3f sec, gap %7.3f sec\n",
+        (float) end_us / 1e6, (float) start_us / 1e6, relayed ? (float) gap_us / 1e6 : NAN);
+    _check("relayed", relayed);
+    _check("relay gap", gap_us < RELAY_GAP_US);
+    _teardown();
+}
+
+// Cassette insertion and eject while playing are recognized right after the switch settles
+static void _scenario_eject()
+{
+    printf("[eject] insert cassette, play 5 sec, then eject while playing\n");
+    _setup(1);
+    crp42602y_sim* sim = _decks[0].sim;
+    _run(1.0);
+    uint64_t insert_us = pico_host::now_us();
+    sim->insert_cassette(crp42602y_sim::make_tape(30.0, 18.0));
+    _run(1.0, []() { return _cassette_set_us[0] != 0; });
+    uint64_t set_latency_us = (_cassette_set_us[0] != 0) ? _cassette_set_us[0] - insert_us : 0;
+    _send(0, crp42602y_ctrl::PLAY_A_COMMAND);
+    _run(5.0);
+    bool playing = _decks[0].ctrl->is_playing();
+    uint64_t eject_us = pico_host::now_us();
+    sim->eject_cassette();
+    bool stopped = _run(2.0, []() { return _cassette_eject_us[0] != 0 && !_decks[0].ctrl->is_operating(); });
+    uint64_t eject_latency_us = (_cassette_eject_us[0] != 0) ? _cassette_eject_us[0] - eject_us : 0;
+    uint64_t stop_latency_us = pico_host::now_us() - eject_us;
+    printf("  cassette set: %6.1f ms, cassette eject: %6.1f ms, stop: %6.1f ms after the switch\n",
+        set_latency_us / 1e3, eject_latency_us / 1e3, stop_latency_us / 1e3);
+    _check("cassette set", _cassette_set_us[0] != 0 && set_latency_us < CASSETTE_DETECT_LATENCY_US);
+    _check("playing before eject", playing);
+    _check("cassette eject", _cassette_eject_us[0] != 0 && eject_latency_us < CASSETTE_DETECT_LATENCY_US);
+    _check("stopped by eject", stopped);
+    _teardown();
+}
+
+// Wait for motor stable given by the measured spin-up time is kept, and a too short wait is raised by the arrival time of the function gear
+static void _scenario_spin_up()
+{
+    constexpr int NUM_CYCLES = 5;
+    constexpr uint32_t MARGIN_MS = 50;
+    constexpr uint32_t SHORT_MS = 100;
+    const uint32_t spinup_ms = crp42602y_sim::DEFAULT_CONFIG.motor_spinup_ms;
+    printf("[spin_up] play after power off timeout with default wait, wait %u ms and %u ms (motor spin-up %u ms)\n",
+        spinup_ms + MARGIN_MS, spinup_ms - SHORT_MS, spinup_ms);
+    _setup(1);
+    crp42602y_sim* sim = _decks[0].sim;
+    crp42602y_ctrl* ctrl = _decks[0].ctrl;
+    ctrl->set_power_off_timeout_sec(1);
+    sim->insert_cassette(crp42602y_sim::make_tape(30.0, 18.0));
+    _run(1.0);
+    const uint32_t default_wait_ms = ctrl->get_motor_stable_ms();
+    int num_played = 0;
+    bool never_shortened = true;
+    // returns the first command latency
+    auto cycle = [&](int index) {
+        // cycle 0 plays with the motor already stable to take the reference
+        if (index > 0) ctrl->recover_power_from_timeout();
+        uint32_t wait_ms = ctrl->get_motor_stable_ms();
+        _send(0, crp42602y_ctrl::PLAY_A_COMMAND);
+        bool played = _run(2.0, [&]() { return ctrl->is_playing(); }) && sim->get_mode() == crp42602y_sim::MODE_PLAY;
+        uint32_t latency_ms = ctrl->get_first_command_latency_ms();
+        if (index > 0) {
+            if (played) num_played++;
+            if (ctrl->get_motor_stable_ms() < wait_ms) never_shortened = false;
+            printf("  cycle %2d: wait %3u ms -> %3u ms, first command latency %4u ms, %s\n", index, wait_ms, ctrl->get_motor_stable_ms(), latency_ms, played ? "play" : "not play");
+        }
+        _send(0, crp42602y_ctrl::STOP_COMMAND);
+        _run(3.0);  // until power off
+        return latency_ms;
+    };
+    int index = 0;
+    cycle(index++);
+    uint32_t default_latency_ms = cycle(index++);
+
+    // wait by the measured spin-up time with margin
+    ctrl->set_motor_stable_ms(spinup_ms + MARGIN_MS);
+    bool kept = true;
+    uint32_t max_latency_ms = 0;
+    for (int i = 0; i < NUM_CYCLES; i++) {
+        max_latency_ms = std::max(max_latency_ms, cycle(index++));
+        if (ctrl->get_motor_stable_ms() != spinup_ms + MARGIN_MS) kept = false;
+    }
+    _check("played every cycle", num_played == index - 1);
+    _check("no gear error", _num_gear_errors[0] == 0);
+    _check("measured wait kept", kept);
+    _check("latency shortened", max_latency_ms < default_latency_ms);
+
+    // too short wait is raised by the delayed arrival of the function gear
+    ctrl->set_motor_stable_ms(spinup_ms - SHORT_MS);
+    for (int i = 0; i < NUM_CYCLES; i++) {
+        cycle(index++);
+    }
+    _check("too short wait raised", ctrl->get_motor_stable_ms() == default_wait_ms);
+    _check("wait never shortened", never_shortened);
+    _teardown();
+}
+
+// Wait for motor stable is not shortened by the first commands sent long after power on (the wait is not tested by them)
+static void _scenario_late_first()
+{
+    constexpr int NUM_CYCLES = 10;
+    constexpr float LATE_SEC = 1.0;
+    printf("[late_first] play %.1f sec after power on %d times\n", LATE_SEC, NUM_CYCLES);
+    _setup(1);
+    crp42602y_sim* sim = _decks[0].sim;
+    crp42602y_ctrl* ctrl = _decks[0].ctrl;
+    ctrl->set_power_off_timeout_sec(2);
+    sim->insert_cassette(crp42602y_sim::make_tape(30.0, 18.0));
+    _run(1.0);
+    const uint32_t initial_wait_ms = ctrl->get_motor_stable_ms();
+    int num_played = 0;
+    int num_late = 0;
+    for (int cycle = 0; cycle <= NUM_CYCLES; cycle++) {
+        // cycle 0 plays with the motor already stable to take the reference
+        if (cycle > 0) {
+            ctrl->recover_power_from_timeout();
+            _run(LATE_SEC);
+        }
+        _send(0, crp42602y_ctrl::PLAY_A_COMMAND);
+        bool played = _run(2.0, [&]() { return ctrl->is_playing(); }) && sim->get_mode() == crp42602y_sim::MODE_PLAY;
+        if (cycle > 0) {
+            uint32_t latency_ms = ctrl->get_first_command_latency_ms();
+            if (played) num_played++;
+            if (latency_ms >= LATE_SEC * 1000) num_late++;
+            printf("  cycle %2d: wait %3u ms, first command latency %4u ms, %s\n", cycle, ctrl->get_motor_stable_ms(), latency_ms, played ? "play" : "not play");
+        }
+        _send(0, crp42602y_ctrl::STOP_COMMAND);
+        _run(4.0);  // until power off
+    }
+    _check("played every cycle", num_played == NUM_CYCLES);
+    _check("first commands were late", num_late == NUM_CYCLES);
+    _check("no gear error", _num_gear_errors[0] == 0);
+    _check("wait not shortened", ctrl->get_motor_stable_ms() == initial_wait_ms);
+    _teardown();
+}
+
+// Warm standby powers on at cassette set or warm_up() and drops back to off within the idle budget
+static void _scenario_warm_standby()
+{
+    constexpr uint32_t WARM_STANDBY_MS = 1000;
+    constexpr float INTENT_AHEAD_SEC = 0.4;  // warm_up() ahead of the command (e.g. button press before the click is decided)
+    printf("[warm_standby] idle budget %u ms, warm up %.0f ms ahead of the command\n", WARM_STANDBY_MS, INTENT_AHEAD_SEC * 1e3);
+    _setup(1);
+    crp42602y_sim* sim = _decks[0].sim;
+    crp42602y_ctrl* ctrl = _decks[0].ctrl;
+    const uint pin_power = _deck_pins(0).power_ctrl;
+    ctrl->set_power_off_timeout_sec(5);
+    ctrl->set_warm_standby_ms(WARM_STANDBY_MS);
+    sim->insert_cassette(crp42602y_sim::make_tape(30.0, 18.0));
+    _run(6.0, [&]() { return !gpio_get_out_level(pin_power); });
+
+    // cold start: power on by the command itself
+    ctrl->recover_power_from_timeout();
+    _send(0, crp42602y_ctrl::PLAY_A_COMMAND);
+    uint64_t start_us = pico_host::now_us();
+    bool cold_played = _run(2.0, [&]() { return ctrl->is_playing(); });
+    uint64_t cold_us = pico_host::now_us() - start_us;
+    _send(0, crp42602y_ctrl::STOP_COMMAND);
+    _run(7.0, [&]() { return !gpio_get_out_level(pin_power); });
+
+    // cassette set powers on in advance and drops back to off without command
+    sim->eject_cassette();
+    _run(0.5);
+    sim->insert_cassette(crp42602y_sim::make_tape(30.0, 18.0));
+    _run(0.1, [&]() { return ctrl->is_warm_standby(); });
+    bool warm_by_cassette = ctrl->is_warm_standby() && gpio_get_out_level(pin_power);
+    start_us = pico_host::now_us();
+    bool idle_off = _run(3.0, [&]() { return !gpio_get_out_level(pin_power); });
+    uint64_t idle_us = pico_host::now_us() - start_us;
+
+    // warm start: power on by warm_up() ahead of the command
+    ctrl->warm_up();
+    _run(INTENT_AHEAD_SEC);
+    _send(0, crp42602y_ctrl::PLAY_A_COMMAND);
+    start_us = pico_host::now_us();
+    bool warm_played = _run(2.0, [&]() { return ctrl->is_playing(); });
+    uint64_t warm_us = pico_host::now_us() - start_us;
+    printf("  play latency: cold %6.1f ms, warm %6.1f ms, power off %6.1f ms after warm up by cassette set\n",
+        cold_us / 1e3, warm_us / 1e3, idle_us / 1e3);
+    _check("played", cold_played && warm_played);
+    _check("warm up by cassette set", warm_by_cassette);
+    _check("power off within idle budget", idle_off && idle_us < (WARM_STANDBY_MS + 500) * 1000ULL);
+    _check("warm standby ends by command", !ctrl->is_warm_standby());
+    _check("latency hidden", warm_us < cold_us);
+    _teardown();
+}
+
+// Solenoid drive profile reduces the energy per gear transition with the same function
+static void _scenario_solenoid()
+{
+    const struct {
+        const char* name;
+        crp42602y_ctrl::solenoid_profile_t profile;
+    } cases[] = {
+        {"full drive", crp42602y_ctrl::FULL_DRIVE_PROFILE},
+        {"hold 40%",   {20, 40}},
+        {"hold 10%",   {20, 10}},  // below the hold duty of the model
+    };
+    constexpr int NUM_CASES = sizeof(cases) / sizeof(cases[0]);
+    printf("[solenoid] play A with drive profiles (model: pull-in %u ms, hold duty %.0f%%)\n",
+        crp42602y_sim::DEFAULT_CONFIG.solenoid_pull_in_ms, crp42602y_sim::DEFAULT_CONFIG.solenoid_hold_duty * 100);
+    _setup(1);
+    crp42602y_sim* sim = _decks[0].sim;
+    crp42602y_ctrl* ctrl = _decks[0].ctrl;
+    sim->insert_cassette(crp42602y_sim::make_tape(30.0, 18.0));
+    _run(1.0);
+    const uint pin_solenoid = _deck_pins(0).solenoid_ctrl;
+    bool played[NUM_CASES];
+    uint32_t drive_us[NUM_CASES];
+    gpio_function_t func[NUM_CASES];
+    for (int i = 0; i < NUM_CASES; i++) {
+        for (int phase = 0; phase < crp42602y_ctrl::__NUM_SOLENOID_PHASES__; phase++) {
+            ctrl->set_solenoid_profile((crp42602y_ctrl::solenoid_phase_t) phase, cases[i].profile);
+        }
+        func[i] = gpio_get_function(pin_solenoid);
+        _send(0, crp42602y_ctrl::PLAY_A_COMMAND);
+        _run(2.0, [&]() { return ctrl->is_playing(); });
+        played[i] = sim->get_mode() == crp42602y_sim::MODE_PLAY;
+        drive_us[i] = ctrl->get_solenoid_drive_us();
+        printf("  %-10s: solenoid drive %6.1f ms (full drive equivalent), %s\n", cases[i].name, drive_us[i] / 1e3, played[i] ? "play" : "not play");
+        _send(0, crp42602y_ctrl::STOP_COMMAND);
+        _run(2.0);
+    }
+    _check("play by full drive", played[0]);
+    _check("GPIO by full drive", func[0] == GPIO_FUNC_SIO);
+    _check("PWM by hold profile", func[1] == GPIO_FUNC_PWM);
+    _check("play by hold profile", played[1]);
+    _check("energy reduced", drive_us[1] < drive_us[0] * 7 / 10);
+    _check("weak hold not engaged (model)", !played[2]);
+    _teardown();
+}
+
+// Idle window to pause process_loop() (e.g. flash programming) excludes pending commands, gear sequences and operations
+static void _scenario_idle_window()
+{
+    constexpr uint64_t BLACKOUT_US = 50000;  // sector erase and program of flash
+    printf("[idle_window] pause process_loop() %.0f ms at the idle window after stop\n", BLACKOUT_US / 1e3);
+    _setup(1);
+    crp42602y_sim* sim = _decks[0].sim;
+    crp42602y_ctrl* ctrl = _decks[0].ctrl;
+    sim->insert_cassette(crp42602y_sim::make_tape(30.0, 18.0));
+    _run(1.0);
+    bool idle_at_stop = ctrl->is_idle();
+    _send(0, crp42602y_ctrl::PLAY_A_COMMAND);
+    bool idle_at_send = ctrl->is_idle();
+    bool idle_in_transition = false;
+    bool played = _run(2.0, [&]() {
+        if (!ctrl->is_playing() && ctrl->is_idle()) idle_in_transition = true;
+        return ctrl->is_playing();
+    });
+    _run(1.0);
+    bool idle_in_play = ctrl->is_idle();
+    _send(0, crp42602y_ctrl::STOP_COMMAND);
+    uint64_t start_us = pico_host::now_us();
+    bool idle_after_stop = _run(2.0, [&]() { return ctrl->is_idle(); });
+    uint64_t window_us = pico_host::now_us() - start_us;
+
+    // core1 is paused by the lockout, IRQs keep running
+    pico_host::advance_us(BLACKOUT_US);
+    _send(0, crp42602y_ctrl::PLAY_A_COMMAND);
+    bool played_after = _run(2.0, [&]() { return ctrl->is_playing(); }) && sim->get_mode() == crp42602y_sim::MODE_PLAY;
+    printf("  idle window %.1f ms after STOP command\n", window_us / 1e3);
+    _check("idle at stop", idle_at_stop);
+    _check("not idle with command pending", !idle_at_send);
+    _check("not idle until played", played && !idle_in_transition);
+    _check("not idle in play", !idle_in_play);
+    _check("idle after stop", idle_after_stop);
+    _check("play after blackout", played_after);
+    _check("no gear error", _num_gear_errors[0] == 0);
+    _teardown();
+}
+
+int main(int argc, char* argv[])
+{
+    const struct {
+        const char* name;
+        void (*func)();
+    } scenarios[] = {
+        {"play_side",  _scenario_play_side},
+        {"ff_rew",     _scenario_ff_rew},
+        {"sync_start", _scenario_sync_start},
+        {"relay",      _scenario_relay},
+        {"eject",      _scenario_eject},
+        {"spin_up",    _scenario_spin_up},
+        {"late_first", _scenario_late_first},
+        {"warm_standby", _scenario_warm_standby},
+        {"solenoid",   _scenario_solenoid},
+        {"idle_window", _scenario_idle_window},
+    };
+    const char* name = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            _trace_fp = fopen(argv[++i], "wb");
+            if (_trace_fp == nullptr) {
+                fprintf(stderr, "ERROR: cannot open %s\n", argv[i]);
+                return 2;
+            }
+            _write_trace({crp42602y_counter::TRACE_HEADER, 0, crp42602y_counter::TRACE_VERSION, crp42602y_counter::TRACE_MAGIC});
+        } else {
+            name = argv[i];
+        }
+    }
+    for (const auto& scenario : scenarios) {
+        if (name != nullptr && strcmp(name, scenario.name) != 0) continue;
+        auto start = std::chrono::steady_clock::now();
+        scenario.func();
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        double virtual_sec = (double) pico_host::now_us() / 1e6;
+        printf("  wall time: %.3f sec, events: %llu, virtual time: %.1f sec, loops: %llu (%.1f per sec)\n",
+            elapsed, (unsigned long long) pico_host::get_num_events(), virtual_sec, (unsigned long long) _num_loops, _num_loops / virtual_sec);
+    }
+    if (_trace_fp != nullptr) fclose(_trace_fp);
+    printf("%s\n", (_num_failures == 0) ? "ALL PASS" : "FAILED");
+    return (_num_failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,170 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+// Render cost of the transport animation of single_pb_deck by lines (as before) and by pre-rendered sprites
+//   the pixels of both are compared for every frame, exit code is non-zero if any frame differs
+//   usage: sprite_bench [num_loops]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "hardware/i2c.h"
+#include "ssd1306_canvas.h"
+#include "deck_sprites.h"
+
+typedef enum _anim_t {
+    ANIM_STOP = 0,
+    ANIM_PLAY,
+    ANIM_CUE,
+    __NUM_ANIMS__
+} anim_t;
+
+static const char* const ANIM_NAMES[__NUM_ANIMS__] = {"stop", "play", "cue"};
+
+// the animation band cleared at each frame
+static constexpr uint32_t BAND_X = 0;
+static constexpr uint32_t BAND_Y = 16;
+static constexpr uint32_t BAND_W = 128 - 16;
+static constexpr uint32_t BAND_H = 8 * 4;
+
+// drawing by lines and by pixels as single_pb_deck did before sprites
+static void _legacy_draw_arrow(ssd1306_canvas* p, uint32_t x, uint32_t y, bool right_dir)
+{
+    for (int i = 0; i < 6; i++) {
+        uint32_t sx = x + i*1;
+        uint32_t sy = y;
+        if (right_dir) {
+            p->draw_line(sx, sy, sx+8, sy+8);
+            p->draw_line(sx, sy+16, sx+8, sy+8);
+        } else {
+            p->draw_line(sx, sy+8, sx+8, sy);
+            p->draw_line(sx, sy+8, sx+8, sy+16);
+        }
+    }
+}
+
+static void _legacy_render(ssd1306_t* disp, ssd1306_canvas* p, const anim_t anim, const bool right_dir, const uint32_t pos)
+{
+    for (uint32_t iy = BAND_Y; iy < BAND_Y + BAND_H; iy++) {
+        for (uint32_t ix = BAND_X; ix < BAND_X + BAND_W; ix++) {
+            ssd1306_clear_pixel(disp, ix, iy);
+        }
+    }
+    uint32_t ofs = right_dir ? (pos + 8) % 16 : (24 - pos) % 16;
+    if (anim == ANIM_STOP) {
+        _legacy_draw_arrow(p, 64-14/2, 32-8, right_dir);
+    } else if (anim == ANIM_PLAY) {
+        _legacy_draw_arrow(p, 64-14/2 + ofs - 8, 32-8, right_dir);
+    } else {
+        for (int i = 0; i < 2; i++) {
+            _legacy_draw_arrow(p, 64-22/2 + i*8 + ofs - 8, 32-8, right_dir);
+        }
+    }
+}
+
+static void _sprite_render(ssd1306_canvas* p, const anim_t anim, const bool right_dir, const uint32_t pos)
+{
+    p->clear_square(BAND_X, BAND_Y, BAND_W, BAND_H);
+    if (anim == ANIM_STOP) {
+        p->draw_sprite(ARROW_X, ARROW_Y, sprite_arrow[right_dir]);
+    } else if (anim == ANIM_PLAY) {
+        p->draw_sprite(ARROW_X + arrow_frame_offset(right_dir, pos), ARROW_Y, sprite_arrow[right_dir]);
+    } else {
+        p->draw_sprite(CUE_X + arrow_frame_offset(right_dir, pos), ARROW_Y, sprite_cue[right_dir]);
+    }
+}
+
+static void _fill(ssd1306_t* disp, const uint8_t value)
+{
+    memset(disp->buffer, value, disp->bufsize);
+}
+
+static int _check_frames(ssd1306_t* disp_a, ssd1306_canvas* canvas_a, ssd1306_t* disp_b, ssd1306_canvas* canvas_b)
+{
+    int num_errors = 0;
+    for (int anim = 0; anim < __NUM_ANIMS__; anim++) {
+        for (int dir = 0; dir < 2; dir++) {
+            for (uint32_t pos = 0; pos < NUM_ARROW_POSITIONS; pos++) {
+                // the background outside of the band is kept by both
+                _fill(disp_a, 0x5a);
+                _fill(disp_b, 0x5a);
+                _legacy_render(disp_a, canvas_a, (anim_t) anim, dir, pos);
+                _sprite_render(canvas_b, (anim_t) anim, dir, pos);
+                if (memcmp(disp_a->buffer, disp_b->buffer, disp_a->bufsize) != 0) {
+                    printf("ERROR: %s arrow (%s, pos %u) differs\n", ANIM_NAMES[anim], dir ? "right" : "left", pos);
+                    num_errors++;
+                }
+            }
+        }
+    }
+    // icons by font and by sprite
+    for (int i = 0; i < 4; i++) {
+        const uint8_t* font = (i < 3) ? font_reverse_mode : font_bluetooth;
+        const icon_sprite_t& sprite = (i < 3) ? sprite_reverse_mode[i] : sprite_bluetooth;
+        char c = (i < 3) ? (char) i : 0;
+        for (uint32_t y = 20; y < 28; y++) {
+            _fill(disp_a, 0x00);
+            _fill(disp_b, 0x00);
+            canvas_a->draw_char_with_font(112, y, 1, font, c);
+            canvas_b->draw_sprite(112, y, sprite);
+            if (memcmp(disp_a->buffer, disp_b->buffer, disp_a->bufsize) != 0) {
+                printf("ERROR: icon %d at y = %u differs\n", i, y);
+                num_errors++;
+            }
+        }
+    }
+    return num_errors;
+}
+
+template <typename F>
+static double _measure_ns_per_frame(const uint32_t num_loops, F render)
+{
+    uint32_t num_frames = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t loop = 0; loop < num_loops; loop++) {
+        for (int anim = 0; anim < __NUM_ANIMS__; anim++) {
+            for (int dir = 0; dir < 2; dir++) {
+                for (uint32_t pos = 0; pos < NUM_ARROW_POSITIONS; pos++) {
+                    render((anim_t) anim, dir, pos);
+                    num_frames++;
+                }
+            }
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / num_frames;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t num_loops = (argc > 1) ? strtoul(argv[1], nullptr, 0) : 2000;
+
+    ssd1306_t disp_a = {};
+    ssd1306_t disp_b = {};
+    ssd1306_init(&disp_a, 128, 64, 0x3c, i2c0);
+    ssd1306_init(&disp_b, 128, 64, 0x3c, i2c0);
+    ssd1306_canvas canvas_a(&disp_a, false);
+    ssd1306_canvas canvas_b(&disp_b, false);
+
+    int num_errors = _check_frames(&disp_a, &canvas_a, &disp_b, &canvas_b);
+    printf("Pixel check: %d frames differ\n", num_errors);
+
+    double legacy_ns = _measure_ns_per_frame(num_loops, [&](anim_t anim, bool right_dir, uint32_t pos) {
+        _legacy_render(&disp_a, &canvas_a, anim, right_dir, pos);
+    });
+    double sprite_ns = _measure_ns_per_frame(num_loops, [&](anim_t anim, bool right_dir, uint32_t pos) {
+        _sprite_render(&canvas_b, anim, right_dir, pos);
+    });
+    printf("Render cost per frame (clear %ux%u band and draw arrow)\n", BAND_W, BAND_H);
+    printf("  lines and pixels: %8.1f ns\n", legacy_ns);
+    printf("  sprites:          %8.1f ns (x%.1f)\n", sprite_ns, legacy_ns / sprite_ns);
+
+    ssd1306_deinit(&disp_a);
+    ssd1306_deinit(&disp_b);
+    return (num_errors > 0) ? 1 : 0;
+}
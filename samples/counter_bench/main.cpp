@@ -0,0 +1,384 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+// Micro benchmark of the counter hot paths
+//   on device: cycles measured by SysTick (processor clock), interrupts are disabled during each measurement
+//   on host:   nanoseconds measured by steady_clock (built by host/CMakeLists.txt with pico_host)
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/sync.h"
+
+#include "crp42602y_ctrl.h"
+
+#if PICO_ON_DEVICE
+#include "hardware/structs/systick.h"
+#else
+#include <chrono>
+#include "pico_host.h"
+#include "crp42602y_replay.h"
+#endif
+
+// CRP42602Y control pins
+static constexpr uint PIN_SOLENOID_CTRL   = 2;
+static constexpr uint PIN_CASSETTE_DETECT = 3;
+static constexpr uint PIN_GEAR_STATUS_SW  = 4;
+static constexpr uint PIN_ROTATION_SENS   = 5;
+static constexpr uint PIN_POWER_CTRL      = 6;  // Optional: 0 if not use
+
+static constexpr int NUM_LOOP_ITERATIONS = 10000;
+static constexpr int NUM_IRQ_ITERATIONS = 2000;
+
+typedef crp42602y_counter::trace_record_t trace_record_t;
+
+#if PICO_ON_DEVICE
+static constexpr const char* UNIT = "cycles";
+
+static inline void _timer_init()
+{
+    systick_hw->csr = 0;
+    systick_hw->rvr = 0x00ffffff;
+    systick_hw->cvr = 0;
+    systick_hw->csr = 0x5;  // enable with processor clock, no interrupt
+}
+
+static inline uint32_t _timer_now()
+{
+    return systick_hw->cvr;
+}
+
+static inline uint32_t _timer_elapsed(const uint32_t start, const uint32_t end)
+{
+    return (start - end) & 0x00ffffff;  // 24-bit down counter
+}
+#else
+static constexpr const char* UNIT = "ns";
+
+static inline void _timer_init()
+{
+}
+
+static inline uint32_t _timer_now()
+{
+    return (uint32_t) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static inline uint32_t _timer_elapsed(const uint32_t start, const uint32_t end)
+{
+    return end - start;
+}
+#endif
+
+/**
+ * min/mean/max of the measurements
+ */
+class bench_stat {
+    public:
+    bench_stat(const char* name) : _name(name), _num(0), _min(UINT32_MAX), _max(0), _total(0) {}
+
+    void add(const uint32_t value)
+    {
+        if (value < _min) _min = value;
+        if (value > _max) _max = value;
+        _total += value;
+        _num++;
+    }
+
+    void print() const
+    {
+        if (_num == 0) {
+            printf("%-28s %8u %10s %10s %10s\n", _name, _num, "-", "-", "-");
+        } else {
+            printf("%-28s %8u %10u %10.1f %10u\n", _name, _num, _min, (double) _total / _num, _max);
+        }
+    }
+
+    protected:
+    const char* _name;
+    uint32_t _num;
+    uint32_t _min;
+    uint32_t _max;
+    uint64_t _total;
+};
+
+/**
+ * exposes the transport state to the benchmark
+ */
+class crp42602y_ctrl_bench : public crp42602y_ctrl_with_counter {
+    public:
+    using crp42602y_ctrl_with_counter::crp42602y_ctrl_with_counter;
+
+    void set_transport_state(const uint32_t transport_state)
+    {
+        _transport_state = transport_state;
+    }
+};
+
+/**
+ * drives the internal functions of crp42602y_counter on the current core
+ *   the benchmark owns a state machine detached from the rotation sensor so that RX FIFO is fed only by the benchmark
+ *   process_loop() of ctrl must not run on the other core
+ */
+class crp42602y_counter_bench : public crp42602y_counter {
+    public:
+    crp42602y_counter_bench(crp42602y_ctrl_bench& ctrl, const uint pin_rotation_sens) :
+        crp42602y_counter(pin_rotation_sens, &ctrl), _bench_ctrl(ctrl), _overhead(0)
+    {
+        pio_sm_set_enabled(_pio, _sm, false);
+        pio_sm_clear_fifos(_pio, _sm);
+        pio_interrupt_clear(_pio, _sm);
+        _enable = true;
+
+        _timer_init();
+        // overhead of the measurement itself
+        uint32_t overhead = UINT32_MAX;
+        for (int i = 0; i < 100; i++) {
+            uint32_t save = save_and_disable_interrupts();
+            uint32_t start = _timer_now();
+            uint32_t end = _timer_now();
+            restore_interrupts(save);
+            uint32_t elapsed = _timer_elapsed(start, end);
+            if (elapsed < overhead) overhead = elapsed;
+        }
+        _overhead = overhead;
+    }
+
+    void bench_process_loop_idle(bench_stat& stat)
+    {
+        for (int i = 0; i < NUM_LOOP_ITERATIONS; i++) {
+            uint32_t save = save_and_disable_interrupts();
+            uint32_t start = _timer_now();
+            _bench_ctrl.process_loop();
+            uint32_t end = _timer_now();
+            restore_interrupts(save);
+            stat.add(_elapsed(start, end));
+        }
+    }
+
+    void bench_irq_callback(bench_stat& stat, const uint32_t transport_state, const uint32_t interval_us)
+    {
+        _bench_ctrl.set_transport_state(transport_state);
+        _rot_count = 0;
+        uint32_t term_count = interval_us / crp42602y_counter::PIO_COUNT_DIV / 2;
+        for (int i = 0; i < NUM_IRQ_ITERATIONS; i++) {
+            pio_sm_clear_fifos(_pio, _sm);
+            _push_rx_fifo((uint32_t) -(int32_t) term_count);  // 1-term
+            _push_rx_fifo((uint32_t) -(int32_t) term_count);  // 0-term
+            uint32_t save = save_and_disable_interrupts();
+            uint32_t start = _timer_now();
+            _irq_callback();
+            uint32_t end = _timer_now();
+            restore_interrupts(save);
+            stat.add(_elapsed(start, end));
+            _drain_rotation_events();
+        }
+        pio_sm_clear_fifos(_pio, _sm);
+        _bench_ctrl.set_transport_state(0);
+    }
+
+    // feed rotation records in the same way as _process() and measure _process_play() and _process_cue()
+    void bench_stream(bench_stat& stat_play, bench_stat& stat_cue, const std::vector<trace_record_t>& records)
+    {
+        _restart();
+        for (const auto& record : records) {
+            if (record.type == crp42602y_counter::TRACE_RESTART) {
+                _restart();
+                continue;
+            }
+            if (record.type != crp42602y_counter::TRACE_ROTATION) continue;
+            bool is_cue = record.flags & crp42602y_counter::TRACE_FLAG_CUE;
+            crp42602y_counter::rotation_event_t event = {
+                record.value + _config.additional_us,
+                is_cue ? crp42602y_counter::CUE : crp42602y_counter::PLAY,
+                (record.flags & crp42602y_counter::TRACE_FLAG_DIR_A) != 0,
+                (int) record.arg
+            };
+            if (event.num_to_average > (int) _config.num_to_average) event.num_to_average = (int) _config.num_to_average;
+            if (event.num_to_average == 0) _count = 0;
+            uint32_t save = save_and_disable_interrupts();
+            uint32_t start = _timer_now();
+            if (is_cue) {
+                _process_cue(event);
+            } else {
+                _process_play(event);
+            }
+            uint32_t end = _timer_now();
+            restore_interrupts(save);
+            (is_cue ? stat_cue : stat_play).add(_elapsed(start, end));
+        }
+    }
+
+    // synthetic rotation stream of C-90 side A: play, FF, play, REW
+    //   covers the thickness measurement during play and at the transition from cue to play
+    static std::vector<trace_record_t> synthetic_stream()
+    {
+        constexpr float CORE_RADIUS_CM = 1.1;
+        constexpr float THICKNESS_CM = 12.0e-4;
+        constexpr float LENGTH_CM = 45.0 * 60 * crp42602y_counter::TAPE_SPEED_CM_PER_SEC;
+        constexpr float WIND_RPS = 6.0;
+        constexpr float HUB_ROTATIONS_PER_EVENT = 1.0 / crp42602y_counter::NUM_ROTATION_WINGS / crp42602y_counter::ROTATION_GEAR_RATIO;
+        const float full_radius_cm = sqrtf(CORE_RADIUS_CM * CORE_RADIUS_CM + LENGTH_CM * THICKNESS_CM / (float) M_PI);
+        std::vector<trace_record_t> records;
+        float radius_a = CORE_RADIUS_CM;  // hub of side A rolling up during play
+        float radius_b = full_radius_cm;
+
+        auto wind = [&](float& up, float& down) {
+            float length = 2.0f * (float) M_PI * up * HUB_ROTATIONS_PER_EVENT;
+            up += THICKNESS_CM * HUB_ROTATIONS_PER_EVENT;
+            down = sqrtf(fmaxf(down * down - length * THICKNESS_CM / (float) M_PI, CORE_RADIUS_CM * CORE_RADIUS_CM));
+        };
+        auto play = [&](int num) {
+            for (int i = 0; i < num; i++) {
+                float interval_us = 2.0f * (float) M_PI * radius_a / crp42602y_counter::TAPE_SPEED_CM_PER_SEC * HUB_ROTATIONS_PER_EVENT * 1e6f;
+                _append_rotation(records, false, true, i, interval_us);
+                wind(radius_a, radius_b);
+            }
+        };
+        auto cue = [&](int num, bool is_dir_a) {
+            for (int i = 0; i < num; i++) {
+                _append_rotation(records, true, is_dir_a, i, HUB_ROTATIONS_PER_EVENT / WIND_RPS * 1e6f);
+                if (is_dir_a) {
+                    wind(radius_a, radius_b);
+                } else {
+                    wind(radius_b, radius_a);
+                }
+            }
+        };
+        play(1000);
+        cue(2000, true);
+        play(1000);
+        cue(3000, false);
+        return records;
+    }
+
+    protected:
+    crp42602y_ctrl_bench& _bench_ctrl;
+    uint32_t _overhead;
+
+    static void _append_rotation(std::vector<trace_record_t>& records, const bool is_cue, const bool is_dir_a, const int index, const float interval_us)
+    {
+        int num_to_average = (index < (int) crp42602y_counter::MAX_NUM_TO_AVERAGE) ? index : (int) crp42602y_counter::MAX_NUM_TO_AVERAGE;
+        trace_record_t record = {
+            crp42602y_counter::TRACE_ROTATION,
+            (uint8_t) ((is_cue ? crp42602y_counter::TRACE_FLAG_CUE : 0) | (is_dir_a ? crp42602y_counter::TRACE_FLAG_DIR_A : 0)),
+            (uint16_t) num_to_average,
+            (uint32_t) interval_us - crp42602y_counter::ADDITIONAL_US
+        };
+        records.push_back(record);
+    }
+
+    uint32_t _elapsed(const uint32_t start, const uint32_t end) const
+    {
+        uint32_t elapsed = _timer_elapsed(start, end);
+        return (elapsed > _overhead) ? elapsed - _overhead : 0;
+    }
+
+    void _push_rx_fifo(const uint32_t value)
+    {
+#if PICO_ON_DEVICE
+        pio_sm_put(_pio, _sm, value);
+        pio_sm_exec(_pio, _sm, pio_encode_pull(false, true));
+        pio_sm_exec(_pio, _sm, pio_encode_mov(pio_isr, pio_osr));
+        pio_sm_exec(_pio, _sm, pio_encode_push(false, true));
+#else
+        pico_host::pio_push_rx_fifo(_pio, _sm, value);
+#endif
+    }
+
+    void _drain_rotation_events()
+    {
+        crp42602y_counter::rotation_event_t event;
+        while (queue_try_remove(&_rotation_event_queue, &event)) {}
+    }
+};
+
+static void _run(crp42602y_ctrl_bench& ctrl, const std::vector<std::pair<std::string, std::vector<trace_record_t>>>& streams)
+{
+    crp42602y_counter_bench bench(ctrl, PIN_ROTATION_SENS);
+
+    printf("%-28s %8s %10s %10s %10s (%s)\n", "benchmark", "num", "min", "mean", "max", UNIT);
+    bench_stat stat_loop("process_loop (idle)");
+    bench.bench_process_loop_idle(stat_loop);
+    stat_loop.print();
+
+    bench_stat stat_irq_play("_irq_callback (play)");
+    bench.bench_irq_callback(stat_irq_play, crp42602y_ctrl::TS_PLAYING_BIT | crp42602y_ctrl::TS_HEAD_DIR_A_BIT, 400000);
+    stat_irq_play.print();
+    bench_stat stat_irq_cue("_irq_callback (cue)");
+    bench.bench_irq_callback(stat_irq_cue, crp42602y_ctrl::TS_FF_REW_BIT | crp42602y_ctrl::TS_CUE_DIR_A_BIT, 40000);
+    stat_irq_cue.print();
+    bench_stat stat_irq_stop("_irq_callback (stop)");
+    bench.bench_irq_callback(stat_irq_stop, 0, 400000);
+    stat_irq_stop.print();
+
+    for (const auto& stream : streams) {
+        std::string name_play = "_process_play (" + stream.first + ")";
+        std::string name_cue = "_process_cue (" + stream.first + ")";
+        bench_stat stat_play(name_play.c_str());
+        bench_stat stat_cue(name_cue.c_str());
+        bench.bench_stream(stat_play, stat_cue, stream.second);
+        stat_play.print();
+        stat_cue.print();
+    }
+}
+
+#if PICO_ON_DEVICE
+int main()
+{
+    stdio_init_all();
+
+    // CRP42602Y pins pull-up (GPIO mode is cared in the library)
+    gpio_pull_up(PIN_CASSETTE_DETECT);
+    gpio_pull_up(PIN_GEAR_STATUS_SW);
+    gpio_pull_up(PIN_ROTATION_SENS);
+
+    std::vector<std::pair<std::string, std::vector<trace_record_t>>> streams;
+    streams.emplace_back("synthetic", crp42602y_counter_bench::synthetic_stream());
+
+    // the benchmark runs on core0 only (process_loop() is called by the benchmark)
+    while (true) {
+        printf("press 'b' to run counter benchmark\n");
+        int c;
+        while ((c = getchar_timeout_us(1000 * 1000)) != 'b') {}
+        crp42602y_ctrl_bench* ctrl = new crp42602y_ctrl_bench(PIN_CASSETTE_DETECT, PIN_GEAR_STATUS_SW, PIN_ROTATION_SENS, PIN_SOLENOID_CTRL, PIN_POWER_CTRL);
+        _run(*ctrl, streams);
+        delete ctrl;
+    }
+
+    return 0;
+}
+#else
+int main(int argc, char* argv[])
+{
+    std::vector<std::pair<std::string, std::vector<trace_record_t>>> streams;
+    streams.emplace_back("synthetic", crp42602y_counter_bench::synthetic_stream());
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] == '-') {
+            fprintf(stderr, "usage: %s [trace.bin...]\n", argv[0]);
+            return 2;
+        }
+        std::vector<trace_record_t> records;
+        std::string error;
+        if (!load_trace(argv[i], records, error)) {
+            fprintf(stderr, "ERROR: %s\n", error.c_str());
+            return 2;
+        }
+        const char* name = strrchr(argv[i], '/');
+        streams.emplace_back((name != nullptr) ? name + 1 : argv[i], std::move(records));
+    }
+
+    pico_host::reset();
+    crp42602y_ctrl_bench ctrl(PIN_CASSETTE_DETECT, PIN_GEAR_STATUS_SW, PIN_ROTATION_SENS, PIN_SOLENOID_CTRL, PIN_POWER_CTRL);
+    _run(ctrl, streams);
+    return 0;
+}
+#endif
@@ -0,0 +1,139 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include <cstdio>
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/util/queue.h"
+
+#include "crp42602y_ctrl.h"
+
+static constexpr uint PIN_LED = PICO_DEFAULT_LED_PIN;
+
+// CRP42602Y control pins
+static constexpr uint PIN_SOLENOID_CTRL   = 2;
+static constexpr uint PIN_CASSETTE_DETECT = 3;
+static constexpr uint PIN_GEAR_STATUS_SW  = 4;
+static constexpr uint PIN_ROTATION_SENS   = 5;
+static constexpr uint PIN_POWER_CTRL      = 6;  // Optional: 0 if not use
+
+static constexpr int TRACE_QUEUE_LENGTH = 256;
+static constexpr uint32_t LOST_BLINK_MS = 100;
+
+typedef crp42602y_counter::trace_record_t trace_record_t;
+
+static queue_t _trace_queue;
+static volatile bool _trace_lost = false;
+static bool _tracing = false;
+
+// Instances
+crp42602y_ctrl_with_counter *crp42602y_ctrl0 = nullptr;
+
+static inline uint32_t _millis()
+{
+    return to_ms_since_boot(get_absolute_time());
+}
+
+static void crp42602y_process()
+{
+    crp42602y_ctrl0->send_command(crp42602y_ctrl::STOP_COMMAND);
+    while (true) {
+        crp42602y_ctrl0->process_loop();
+        crp42602y_ctrl0->wait_for_event();
+    }
+}
+
+// invoked on core1, pass the record to core0
+static void trace_callback(const trace_record_t& record)
+{
+    if (!queue_try_add(&_trace_queue, &record)) {
+        _trace_lost = true;
+    }
+}
+
+static void write_record(const trace_record_t& record)
+{
+    // raw output to avoid CR/LF translation
+    const uint8_t* bytes = (const uint8_t*) &record;
+    for (size_t i = 0; i < sizeof(record); i++) {
+        putchar_raw(bytes[i]);
+    }
+}
+
+static void toggle_trace()
+{
+    crp42602y_counter* counter = crp42602y_ctrl0->get_counter_inst();
+    _tracing = !_tracing;
+    if (_tracing) {
+        trace_record_t header = {crp42602y_counter::TRACE_HEADER, 0, crp42602y_counter::TRACE_VERSION, crp42602y_counter::TRACE_MAGIC};
+        write_record(header);
+        _trace_lost = false;
+        counter->set_trace_callback(trace_callback);
+    } else {
+        counter->set_trace_callback(nullptr);
+    }
+}
+
+int main()
+{
+    stdio_init_all();
+
+    // GPIO settings
+    gpio_init(PIN_LED);
+    gpio_set_dir(PIN_LED, GPIO_OUT);
+    gpio_put(PIN_LED, 0);
+
+    // CRP42602Y pins pull-up (GPIO mode is cared in the library)
+    gpio_pull_up(PIN_CASSETTE_DETECT);
+    gpio_pull_up(PIN_GEAR_STATUS_SW);
+    gpio_pull_up(PIN_ROTATION_SENS);
+
+    // CRP42602Y_CTRL
+    queue_init(&_trace_queue, sizeof(trace_record_t), TRACE_QUEUE_LENGTH);
+    crp42602y_ctrl0 = new crp42602y_ctrl_with_counter(PIN_CASSETTE_DETECT, PIN_GEAR_STATUS_SW, PIN_ROTATION_SENS, PIN_SOLENOID_CTRL, PIN_POWER_CTRL);
+    crp42602y_ctrl0->set_power_off_timeout_sec(60 * 60);
+
+    // Core1 runs CRP62602Y process
+    multicore_reset_core1();
+    multicore_launch_core1(crp42602y_process);
+
+    while (true) {
+        uint32_t now_time = _millis();
+
+        // Serial I/F
+        int c = getchar_timeout_us(0);
+        if (c >= 0) {
+            if (c == 't') toggle_trace();
+            if (c == 's') crp42602y_ctrl0->send_command(crp42602y_ctrl::STOP_COMMAND);
+            if (c == 'p') crp42602y_ctrl0->send_command(crp42602y_ctrl::PLAY_COMMAND);
+            if (c == 'q') crp42602y_ctrl0->send_command(crp42602y_ctrl::PLAY_REVERSE_COMMAND);
+            if (c == 'f') crp42602y_ctrl0->send_command(crp42602y_ctrl::FF_COMMAND);
+            if (c == 'r') crp42602y_ctrl0->send_command(crp42602y_ctrl::REW_COMMAND);
+            if (c == 'c') crp42602y_ctrl0->get_counter_inst()->reset();
+            if (c == 'd') crp42602y_ctrl0->set_head_dir_is_a(!crp42602y_ctrl0->get_head_dir_is_a());
+            if (c == 'v') {
+                int mode = ((int) crp42602y_ctrl0->get_reverse_mode() + 1) % crp42602y_ctrl::__NUM_RVS_MODES__;
+                crp42602y_ctrl0->set_reverse_mode((crp42602y_ctrl::reverse_mode_t) mode);
+            }
+        }
+
+        // Stream trace records (records queued after stopping the trace are also sent)
+        trace_record_t record;
+        while (queue_try_remove(&_trace_queue, &record)) {
+            write_record(record);
+        }
+
+        // LED: on while tracing, blink if records have been lost
+        if (_tracing && _trace_lost) {
+            gpio_put(PIN_LED, (now_time / LOST_BLINK_MS) % 2);
+        } else {
+            gpio_put(PIN_LED, _tracing);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,181 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include "deck_proto.h"
+
+deck_proto::deck_proto() :
+    _state(PARSE_SYNC),
+    _frame{},
+    _pos(0),
+    _crc(0),
+    _stats{}
+{
+}
+
+deck_proto::~deck_proto()
+{
+}
+
+deck_proto::feed_result_t deck_proto::feed(const uint8_t byte)
+{
+    switch (_state) {
+    case PARSE_SYNC:
+        if (byte != SYNC) {
+            _stats.others++;
+            return FEED_NONE;
+        }
+        _state = PARSE_LEN;
+        break;
+    case PARSE_LEN:
+        if (byte > MAX_PAYLOAD) {
+            _stats.errors++;
+            reset();
+            return FEED_ERROR;
+        }
+        _frame.len = byte;
+        _crc = crc16(&byte, 1);
+        _state = PARSE_TYPE;
+        break;
+    case PARSE_TYPE:
+        _frame.type = byte;
+        _crc = crc16(&byte, 1, _crc);
+        _pos = 0;
+        _state = (_frame.len > 0) ? PARSE_PAYLOAD : PARSE_CRC_L;
+        break;
+    case PARSE_PAYLOAD:
+        _frame.payload[_pos++] = byte;
+        if (_pos == _frame.len) {
+            _crc = crc16(_frame.payload, _frame.len, _crc);
+            _state = PARSE_CRC_L;
+        }
+        break;
+    case PARSE_CRC_L:
+        if (byte != (uint8_t) _crc) {
+            _stats.errors++;
+            reset();
+            return FEED_ERROR;
+        }
+        _state = PARSE_CRC_H;
+        break;
+    case PARSE_CRC_H:
+        _state = PARSE_SYNC;
+        if (byte != (uint8_t) (_crc >> 8)) {
+            _stats.errors++;
+            return FEED_ERROR;
+        }
+        _stats.frames++;
+        return FEED_FRAME;
+    default:
+        reset();
+        break;
+    }
+    return FEED_PARTIAL;
+}
+
+const deck_proto::frame_t& deck_proto::get_frame() const
+{
+    return _frame;
+}
+
+bool deck_proto::is_busy() const
+{
+    return _state != PARSE_SYNC;
+}
+
+void deck_proto::reset()
+{
+    _state = PARSE_SYNC;
+    _pos = 0;
+}
+
+const deck_proto::parser_stats_t& deck_proto::get_stats() const
+{
+    return _stats;
+}
+
+size_t deck_proto::encode(uint8_t* frame, const uint8_t type, const uint8_t* payload, const size_t len)
+{
+    if (len > MAX_PAYLOAD) return 0;
+    frame[0] = SYNC;
+    frame[1] = (uint8_t) len;
+    frame[2] = type;
+    if (len > 0) memcpy(&frame[3], payload, len);
+    put_u16(&frame[3 + len], crc16(&frame[1], 2 + len));
+    return OVERHEAD + len;
+}
+
+uint16_t deck_proto::crc16(const uint8_t* data, const size_t len, uint16_t crc)
+{
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t) data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+size_t deck_proto::put_state(uint8_t* buf, const state_t& state)
+{
+    put_u32(&buf[0], state.time_ms);
+    put_u32(&buf[4], state.transport_state);
+    buf[8] = state.flags;
+    buf[9] = state.reverse_mode;
+    return STATE_SIZE;
+}
+
+size_t deck_proto::get_state(const uint8_t* buf, state_t& state)
+{
+    state.time_ms = get_u32(&buf[0]);
+    state.transport_state = get_u32(&buf[4]);
+    state.flags = buf[8];
+    state.reverse_mode = buf[9];
+    return STATE_SIZE;
+}
+
+size_t deck_proto::put_counter(uint8_t* buf, const counter_t& counter)
+{
+    put_u32(&buf[0], counter.state);
+    put_f32(&buf[4], counter.playing_sec[0]);
+    put_f32(&buf[8], counter.playing_sec[1]);
+    put_f32(&buf[12], counter.remaining_sec[0]);
+    put_f32(&buf[16], counter.remaining_sec[1]);
+    put_f32(&buf[20], counter.tape_thickness_um);
+    return COUNTER_SIZE;
+}
+
+size_t deck_proto::get_counter(const uint8_t* buf, counter_t& counter)
+{
+    counter.state = get_u32(&buf[0]);
+    counter.playing_sec[0] = get_f32(&buf[4]);
+    counter.playing_sec[1] = get_f32(&buf[8]);
+    counter.remaining_sec[0] = get_f32(&buf[12]);
+    counter.remaining_sec[1] = get_f32(&buf[16]);
+    counter.tape_thickness_um = get_f32(&buf[20]);
+    return COUNTER_SIZE;
+}
+
+size_t deck_proto::put_telemetry(uint8_t* buf, const telemetry_t& telemetry)
+{
+    put_u16(&buf[0], telemetry.seq);
+    put_u32(&buf[2], telemetry.time_ms);
+    put_u32(&buf[6], telemetry.transport_state);
+    buf[10] = telemetry.flags;
+    put_f32(&buf[11], telemetry.playing_sec[0]);
+    put_f32(&buf[15], telemetry.playing_sec[1]);
+    return TELEMETRY_SIZE;
+}
+
+size_t deck_proto::get_telemetry(const uint8_t* buf, telemetry_t& telemetry)
+{
+    telemetry.seq = get_u16(&buf[0]);
+    telemetry.time_ms = get_u32(&buf[2]);
+    telemetry.transport_state = get_u32(&buf[6]);
+    telemetry.flags = buf[10];
+    telemetry.playing_sec[0] = get_f32(&buf[11]);
+    telemetry.playing_sec[1] = get_f32(&buf[15]);
+    return TELEMETRY_SIZE;
+}
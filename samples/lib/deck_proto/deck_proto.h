@@ -0,0 +1,232 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Binary framed protocol to control a deck and read its state over serial
+//   frame: SYNC | LEN | TYPE | PAYLOAD (LEN bytes) | CRC (2 bytes)
+//     CRC is CRC-16/CCITT-FALSE of LEN, TYPE and PAYLOAD, multi-byte fields are little endian
+//     SYNC is out of ASCII, thus the frames can share the serial with the text output and the single character commands
+//   requests (host to device) start with 2 bytes of ticket, which is returned in the response
+//   this file has no dependency on pico-sdk to be shared with the host client
+class deck_proto {
+    public:
+    // Constants
+    static constexpr uint8_t SYNC = 0xa5;
+    static constexpr size_t MAX_PAYLOAD = 64;
+    static constexpr size_t OVERHEAD = 5;  // SYNC, LEN, TYPE and CRC
+    static constexpr size_t MAX_FRAME = MAX_PAYLOAD + OVERHEAD;
+    static constexpr size_t TICKET_SIZE = 2;
+    static constexpr size_t MAX_BATCH = 16;
+    static constexpr size_t STATE_SIZE = 4 + 4 + 1 + 1;
+    static constexpr size_t COUNTER_SIZE = 4 + 4 * 5;
+    static constexpr size_t TELEMETRY_SIZE = 2 + 4 + 4 + 1 + 4 * 2;
+    static constexpr size_t EVENT_SIZE = 1 + 4;
+
+    /**
+     * Definitions
+     */
+    typedef enum _msg_type_t {
+        // requests (payload starts with ticket)
+        MSG_COMMANDS    = 0x01,  // command codes (1 ~ MAX_BATCH) executed in order -> MSG_ACK
+        MSG_GET_STATE   = 0x02,  // -> MSG_STATE
+        MSG_GET_COUNTER = 0x03,  // -> MSG_COUNTER (MSG_ACK with STATUS_NOT_SUPPORTED without counter)
+        MSG_SUBSCRIBE   = 0x04,  // interval_ms (u16, 0: stop telemetry), events (u8, 1: notify callbacks) -> MSG_ACK
+        MSG_PING        = 0x05,  // any data -> MSG_PONG with the same data
+        // responses (payload starts with ticket of the request)
+        MSG_ACK         = 0x81,  // status (u8), accepted (u8)
+        MSG_STATE       = 0x82,  // state_t
+        MSG_COUNTER     = 0x83,  // counter_t
+        MSG_PONG        = 0x85,  // data of MSG_PING
+        // notifications
+        MSG_TELEMETRY   = 0x90,  // telemetry_t at the interval of MSG_SUBSCRIBE
+        MSG_EVENT       = 0x91,  // callback type (u8), time_ms (u32)
+    } msg_type_t;
+    typedef enum _status_t {
+        STATUS_OK = 0,
+        STATUS_REJECTED,       // some of the commands are not accepted
+        STATUS_BAD_REQUEST,    // invalid length or parameter
+        STATUS_UNKNOWN_TYPE,
+        STATUS_NOT_SUPPORTED
+    } status_t;
+    typedef enum _command_code_t {
+        CODE_STOP = 0,
+        CODE_PLAY,
+        CODE_PLAY_REVERSE,
+        CODE_PLAY_A,
+        CODE_PLAY_B,
+        CODE_FF,
+        CODE_REW,
+        CODE_CUE_FF,
+        CODE_CUE_REW,
+        CODE_RECOVER_POWER,
+        CODE_WARM_UP,
+        CODE_RVS_ONE_WAY,
+        CODE_RVS_ONE_ROUND,
+        CODE_RVS_INFINITE_ROUND,
+        __NUM_COMMAND_CODES__
+    } command_code_t;
+    typedef enum _state_flag_t {
+        FLAG_HAS_CASSETTE = (1 << 0),
+        FLAG_POWER        = (1 << 1),
+        FLAG_IDLE         = (1 << 2),
+        FLAG_WARM_STANDBY = (1 << 3)
+    } state_flag_t;
+    typedef enum _feed_result_t {
+        FEED_NONE = 0,  // the byte is not of a frame
+        FEED_PARTIAL,   // the byte is taken into the frame
+        FEED_FRAME,     // the frame is completed (get_frame())
+        FEED_ERROR      // the frame is discarded by CRC error or invalid length
+    } feed_result_t;
+    typedef struct _frame_t {
+        uint8_t type;
+        uint8_t len;
+        uint8_t payload[MAX_PAYLOAD];
+    } frame_t;
+    typedef struct _state_t {
+        uint32_t time_ms;
+        uint32_t transport_state;  // crp42602y_ctrl::get_transport_state()
+        uint8_t flags;             // FLAG_xxx
+        uint8_t reverse_mode;      // crp42602y_ctrl::reverse_mode_t
+    } state_t;
+    typedef struct _counter_t {
+        uint32_t state;            // crp42602y_counter::counter_state_t
+        float playing_sec[2];
+        float remaining_sec[2];
+        float tape_thickness_um;
+    } counter_t;
+    typedef struct _telemetry_t {
+        uint16_t seq;
+        uint32_t time_ms;
+        uint32_t transport_state;
+        uint8_t flags;
+        float playing_sec[2];      // NAN without counter
+    } telemetry_t;
+    typedef struct _parser_stats_t {
+        uint32_t frames;
+        uint32_t errors;           // frames discarded by CRC error or invalid length
+        uint32_t others;           // bytes out of frames
+    } parser_stats_t;
+
+    /**
+     * deck_proto class constructor (parser)
+     */
+    deck_proto();
+
+    /**
+     * deck_proto class destructor
+     */
+    virtual ~deck_proto();
+
+    /**
+     * feed a received byte to the parser
+     *
+     * @param[in] byte received byte
+     * @return result (the frame is available by get_frame() for FEED_FRAME)
+     */
+    feed_result_t feed(const uint8_t byte);
+
+    /**
+     * get the frame completed by feed()
+     */
+    const frame_t& get_frame() const;
+
+    /**
+     * check if a frame is being received
+     */
+    bool is_busy() const;
+
+    /**
+     * discard the frame being received
+     */
+    void reset();
+
+    /**
+     * get statistics of the parser
+     */
+    const parser_stats_t& get_stats() const;
+
+    /**
+     * encode a frame
+     *
+     * @param[out] frame buffer of OVERHEAD + len bytes
+     * @param[in] type message type
+     * @param[in] payload payload
+     * @param[in] len length of payload (~ MAX_PAYLOAD)
+     * @return length of the frame (0 if too long)
+     */
+    static size_t encode(uint8_t* frame, const uint8_t type, const uint8_t* payload, const size_t len);
+
+    /**
+     * CRC-16/CCITT-FALSE
+     */
+    static uint16_t crc16(const uint8_t* data, const size_t len, uint16_t crc = 0xffff);
+
+    /**
+     * serialize and deserialize payloads (return the bytes)
+     */
+    static size_t put_state(uint8_t* buf, const state_t& state);
+    static size_t get_state(const uint8_t* buf, state_t& state);
+    static size_t put_counter(uint8_t* buf, const counter_t& counter);
+    static size_t get_counter(const uint8_t* buf, counter_t& counter);
+    static size_t put_telemetry(uint8_t* buf, const telemetry_t& telemetry);
+    static size_t get_telemetry(const uint8_t* buf, telemetry_t& telemetry);
+
+    /**
+     * little endian fields
+     */
+    static inline void put_u16(uint8_t* buf, const uint16_t value)
+    {
+        buf[0] = (uint8_t) value;
+        buf[1] = (uint8_t) (value >> 8);
+    }
+    static inline void put_u32(uint8_t* buf, const uint32_t value)
+    {
+        put_u16(&buf[0], (uint16_t) value);
+        put_u16(&buf[2], (uint16_t) (value >> 16));
+    }
+    static inline void put_f32(uint8_t* buf, const float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        put_u32(buf, bits);
+    }
+    static inline uint16_t get_u16(const uint8_t* buf)
+    {
+        return (uint16_t) (buf[0] | (buf[1] << 8));
+    }
+    static inline uint32_t get_u32(const uint8_t* buf)
+    {
+        return get_u16(&buf[0]) | ((uint32_t) get_u16(&buf[2]) << 16);
+    }
+    static inline float get_f32(const uint8_t* buf)
+    {
+        uint32_t bits = get_u32(buf);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    protected:
+    typedef enum _parse_state_t {
+        PARSE_SYNC = 0,
+        PARSE_LEN,
+        PARSE_TYPE,
+        PARSE_PAYLOAD,
+        PARSE_CRC_L,
+        PARSE_CRC_H
+    } parse_state_t;
+
+    parse_state_t _state;
+    frame_t _frame;
+    size_t _pos;
+    uint16_t _crc;
+    parser_stats_t _stats;
+};
@@ -0,0 +1,285 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include "deck_proto_server.h"
+
+#include <cmath>
+
+#include "hardware/sync.h"
+
+deck_proto_server::deck_proto_server(crp42602y_ctrl* ctrl, void (*write)(const uint8_t* data, size_t len)) :
+    _ctrl(ctrl),
+    _write(write),
+    _parser(),
+    _has_cassette(false),
+    _power(true),
+    _telemetry_interval_ms(0),
+    _next_telemetry_ms(0),
+    _events(false),
+    _telemetry_seq(0),
+    _last_byte_ms(0),
+    _stats{}
+{
+}
+
+deck_proto_server::~deck_proto_server()
+{
+}
+
+bool deck_proto_server::feed(const uint8_t byte)
+{
+    deck_proto::feed_result_t result = _parser.feed(byte);
+    if (result == deck_proto::FEED_NONE) return false;
+    _last_byte_ms = _millis();
+    if (result == deck_proto::FEED_FRAME) {
+        _execute(_parser.get_frame());
+    }
+    return true;
+}
+
+void deck_proto_server::process()
+{
+    uint32_t now = _millis();
+    if (_parser.is_busy() && now - _last_byte_ms >= INTER_BYTE_TIMEOUT_MS) {
+        _parser.reset();
+        _stats.timeouts++;
+    }
+    if (_telemetry_interval_ms > 0 && (int32_t) (now - _next_telemetry_ms) >= 0) {
+        deck_proto::telemetry_t telemetry;
+        telemetry.seq = _telemetry_seq++;
+        telemetry.time_ms = now;
+        telemetry.transport_state = _ctrl->get_transport_state();
+        telemetry.flags = _get_flags();
+        crp42602y_counter* counter = _ctrl->get_counter_inst();
+        if (counter != nullptr) {
+            crp42602y_counter::counter_snapshot_t snapshot;
+            counter->get_snapshot(snapshot);
+            telemetry.playing_sec[0] = snapshot.playing_sec[0];
+            telemetry.playing_sec[1] = snapshot.playing_sec[1];
+        } else {
+            telemetry.playing_sec[0] = NAN;
+            telemetry.playing_sec[1] = NAN;
+        }
+        uint8_t payload[deck_proto::TELEMETRY_SIZE];
+        _send(deck_proto::MSG_TELEMETRY, payload, deck_proto::put_telemetry(payload, telemetry));
+        _stats.telemetry++;
+        // keep the phase unless the loop has been late by more than an interval
+        _next_telemetry_ms += _telemetry_interval_ms;
+        if ((int32_t) (now - _next_telemetry_ms) >= 0) {
+            _next_telemetry_ms = now + _telemetry_interval_ms;
+        }
+    }
+}
+
+void deck_proto_server::notify_event(const crp42602y_ctrl::callback_type_t callback_type)
+{
+    switch (callback_type) {
+    case crp42602y_ctrl::ON_CASSETTE_SET:
+        _has_cassette = true;
+        break;
+    case crp42602y_ctrl::ON_CASSETTE_EJECT:
+        _has_cassette = false;
+        break;
+    case crp42602y_ctrl::ON_TIMEOUT_POWER_OFF:
+        _power = false;
+        break;
+    case crp42602y_ctrl::ON_RECOVER_POWER_FROM_TIMEOUT:
+        _power = true;
+        break;
+    default:
+        break;
+    }
+    if (!_events) return;
+    uint8_t payload[deck_proto::EVENT_SIZE];
+    payload[0] = (uint8_t) callback_type;
+    deck_proto::put_u32(&payload[1], _millis());
+    _send(deck_proto::MSG_EVENT, payload, sizeof(payload));
+    _stats.events++;
+}
+
+bool deck_proto_server::is_subscribed() const
+{
+    return _telemetry_interval_ms > 0 || _events;
+}
+
+const deck_proto::parser_stats_t& deck_proto_server::get_parser_stats() const
+{
+    return _parser.get_stats();
+}
+
+const deck_proto_server::server_stats_t& deck_proto_server::get_stats() const
+{
+    return _stats;
+}
+
+uint32_t deck_proto_server::_millis()
+{
+    return to_ms_since_boot(get_absolute_time());
+}
+
+void deck_proto_server::_send(const uint8_t type, const uint8_t* payload, const size_t len)
+{
+    uint8_t frame[deck_proto::MAX_FRAME];
+    size_t frame_len = deck_proto::encode(frame, type, payload, len);
+    if (frame_len > 0) _write(frame, frame_len);
+}
+
+void deck_proto_server::_send_ack(const uint16_t ticket, const deck_proto::status_t status, const uint8_t accepted)
+{
+    uint8_t payload[deck_proto::TICKET_SIZE + 2];
+    deck_proto::put_u16(&payload[0], ticket);
+    payload[2] = (uint8_t) status;
+    payload[3] = accepted;
+    _send(deck_proto::MSG_ACK, payload, sizeof(payload));
+}
+
+uint8_t deck_proto_server::_get_flags()
+{
+    uint8_t flags = 0;
+    if (_has_cassette) flags |= deck_proto::FLAG_HAS_CASSETTE;
+    if (_power) flags |= deck_proto::FLAG_POWER;
+    if (_ctrl->is_idle()) flags |= deck_proto::FLAG_IDLE;
+    if (_ctrl->is_warm_standby()) flags |= deck_proto::FLAG_WARM_STANDBY;
+    return flags;
+}
+
+void deck_proto_server::_execute(const deck_proto::frame_t& frame)
+{
+    if (frame.len < deck_proto::TICKET_SIZE) {
+        _send_ack(0, deck_proto::STATUS_BAD_REQUEST, 0);
+        return;
+    }
+    _stats.requests++;
+    uint16_t ticket = deck_proto::get_u16(&frame.payload[0]);
+    const uint8_t* params = &frame.payload[deck_proto::TICKET_SIZE];
+    size_t params_len = frame.len - deck_proto::TICKET_SIZE;
+    uint8_t payload[deck_proto::MAX_PAYLOAD];
+    deck_proto::put_u16(&payload[0], ticket);
+
+    switch (frame.type) {
+    case deck_proto::MSG_COMMANDS:
+        if (params_len == 0 || params_len > deck_proto::MAX_BATCH) {
+            _send_ack(ticket, deck_proto::STATUS_BAD_REQUEST, 0);
+        } else {
+            _execute_commands(ticket, params, params_len);
+        }
+        break;
+    case deck_proto::MSG_GET_STATE:
+    {
+        deck_proto::state_t state;
+        state.time_ms = _millis();
+        state.transport_state = _ctrl->get_transport_state();
+        state.flags = _get_flags();
+        state.reverse_mode = (uint8_t) _ctrl->get_reverse_mode();
+        size_t len = deck_proto::put_state(&payload[deck_proto::TICKET_SIZE], state);
+        _send(deck_proto::MSG_STATE, payload, deck_proto::TICKET_SIZE + len);
+        break;
+    }
+    case deck_proto::MSG_GET_COUNTER:
+    {
+        crp42602y_counter* counter = _ctrl->get_counter_inst();
+        if (counter == nullptr) {
+            _send_ack(ticket, deck_proto::STATUS_NOT_SUPPORTED, 0);
+            break;
+        }
+        crp42602y_counter::counter_snapshot_t snapshot;
+        counter->get_snapshot(snapshot);
+        deck_proto::counter_t values;
+        values.state = (uint32_t) snapshot.state;
+        values.playing_sec[0] = snapshot.playing_sec[0];
+        values.playing_sec[1] = snapshot.playing_sec[1];
+        values.remaining_sec[0] = snapshot.remaining_sec[0];
+        values.remaining_sec[1] = snapshot.remaining_sec[1];
+        values.tape_thickness_um = snapshot.tape_thickness_um;
+        size_t len = deck_proto::put_counter(&payload[deck_proto::TICKET_SIZE], values);
+        _send(deck_proto::MSG_COUNTER, payload, deck_proto::TICKET_SIZE + len);
+        break;
+    }
+    case deck_proto::MSG_SUBSCRIBE:
+    {
+        if (params_len != 3) {
+            _send_ack(ticket, deck_proto::STATUS_BAD_REQUEST, 0);
+            break;
+        }
+        uint32_t interval_ms = deck_proto::get_u16(&params[0]);
+        if (interval_ms > 0 && interval_ms < MIN_TELEMETRY_INTERVAL_MS) interval_ms = MIN_TELEMETRY_INTERVAL_MS;
+        _telemetry_interval_ms = interval_ms;
+        _next_telemetry_ms = _millis();
+        _events = params[2] != 0;
+        _send_ack(ticket, deck_proto::STATUS_OK, 0);
+        break;
+    }
+    case deck_proto::MSG_PING:
+        _send(deck_proto::MSG_PONG, frame.payload, frame.len);
+        break;
+    default:
+        _send_ack(ticket, deck_proto::STATUS_UNKNOWN_TYPE, 0);
+        break;
+    }
+}
+
+void deck_proto_server::_execute_commands(const uint16_t ticket, const uint8_t* codes, const size_t num_codes)
+{
+    // the codes are executed in order until the first one not accepted
+    size_t accepted;
+    for (accepted = 0; accepted < num_codes; accepted++) {
+        if (!_execute_command(codes[accepted])) break;
+    }
+    _stats.commands += accepted;
+    _stats.rejected += num_codes - accepted;
+    if (accepted > 0) _ctrl->extend_timeout_power_off();
+    _send_ack(ticket, (accepted == num_codes) ? deck_proto::STATUS_OK : deck_proto::STATUS_REJECTED, (uint8_t) accepted);
+}
+
+bool deck_proto_server::_execute_command(const uint8_t code)
+{
+    typedef decltype(crp42602y_ctrl::STOP_COMMAND) command_t;  // command_t itself is not public
+    static constexpr command_t transport_commands[] = {
+        crp42602y_ctrl::STOP_COMMAND,
+        crp42602y_ctrl::PLAY_COMMAND,
+        crp42602y_ctrl::PLAY_REVERSE_COMMAND,
+        crp42602y_ctrl::PLAY_A_COMMAND,
+        crp42602y_ctrl::PLAY_B_COMMAND,
+        crp42602y_ctrl::FF_COMMAND,
+        crp42602y_ctrl::REW_COMMAND,
+        crp42602y_ctrl::CUE_FF_COMMAND,
+        crp42602y_ctrl::CUE_REW_COMMAND
+    };
+    static constexpr uint NUM_TRANSPORT_COMMANDS = sizeof(transport_commands) / sizeof(command_t);
+
+    if (code < NUM_TRANSPORT_COMMANDS) {
+        // the command is accepted also at the recovery from power off
+        if (!_power) {
+            _ctrl->recover_power_from_timeout();
+            _power = true;
+        }
+        // the command can be sent also from IRQ by the application (e.g. button edge), thus interrupts are disabled
+        uint32_t status = save_and_disable_interrupts();
+        bool flag = _ctrl->send_command(transport_commands[code]);
+        restore_interrupts(status);
+        return flag;
+    }
+    switch (code) {
+    case deck_proto::CODE_RECOVER_POWER:
+        _ctrl->recover_power_from_timeout();
+        _power = true;
+        return true;
+    case deck_proto::CODE_WARM_UP:
+        _ctrl->warm_up();
+        return true;
+    case deck_proto::CODE_RVS_ONE_WAY:
+        _ctrl->set_reverse_mode(crp42602y_ctrl::RVS_ONE_WAY);
+        return true;
+    case deck_proto::CODE_RVS_ONE_ROUND:
+        _ctrl->set_reverse_mode(crp42602y_ctrl::RVS_ONE_ROUND);
+        return true;
+    case deck_proto::CODE_RVS_INFINITE_ROUND:
+        _ctrl->set_reverse_mode(crp42602y_ctrl::RVS_INFINITE_ROUND);
+        return true;
+    default:
+        return false;
+    }
+}
@@ -0,0 +1,109 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico/stdlib.h"
+
+#include "crp42602y_ctrl.h"
+#include "deck_proto.h"
+
+// Device side of deck_proto
+//   feed() parses the received bytes without blocking in the UI loop and executes the requests at once,
+//   the responses and notifications are written by the write function given (e.g. by putchar_raw())
+//   the instance is to be used from the core of the UI loop (not the core running process_loop())
+class deck_proto_server {
+    public:
+    /**
+     * Definitions
+     */
+    typedef struct _server_stats_t {
+        uint32_t requests;    // requests executed
+        uint32_t commands;    // command codes accepted
+        uint32_t rejected;    // command codes not accepted
+        uint32_t telemetry;   // telemetry frames sent
+        uint32_t events;      // event frames sent
+        uint32_t timeouts;    // frames discarded by inter-byte timeout
+    } server_stats_t;
+
+    // Constants
+    static constexpr uint32_t MIN_TELEMETRY_INTERVAL_MS = 10;
+    static constexpr uint32_t INTER_BYTE_TIMEOUT_MS = 100;
+
+    /**
+     * deck_proto_server class constructor
+     *
+     * @param[in] ctrl crp42602y_ctrl instance to control
+     * @param[in] write function to write the bytes of a frame to the serial
+     */
+    deck_proto_server(crp42602y_ctrl* ctrl, void (*write)(const uint8_t* data, size_t len));
+
+    /**
+     * deck_proto_server class destructor
+     */
+    virtual ~deck_proto_server();
+
+    /**
+     * feed a received byte
+     *   the request is executed when the frame is completed
+     *
+     * @param[in] byte received byte
+     * @return false if the byte is not of a frame (to be handled as single character command)
+     */
+    bool feed(const uint8_t byte);
+
+    /**
+     * send telemetry at the interval subscribed and discard the frame stalled in reception
+     *   to be called in every UI loop
+     */
+    void process();
+
+    /**
+     * notify the callback of crp42602y_ctrl to the subscriber
+     *   to be called for each callback taken out in the UI loop (also tracks cassette and power status)
+     *
+     * @param[in] callback_type callback type
+     */
+    void notify_event(const crp42602y_ctrl::callback_type_t callback_type);
+
+    /**
+     * get is subscribed
+     *
+     * @return true if telemetry or events are subscribed
+     */
+    bool is_subscribed() const;
+
+    /**
+     * get statistics of the parser
+     */
+    const deck_proto::parser_stats_t& get_parser_stats() const;
+
+    /**
+     * get statistics of the server
+     */
+    const server_stats_t& get_stats() const;
+
+    protected:
+    crp42602y_ctrl* _ctrl;
+    void (*_write)(const uint8_t* data, size_t len);
+    deck_proto _parser;
+    bool _has_cassette;
+    bool _power;
+    uint32_t _telemetry_interval_ms;  // 0: not subscribed
+    uint32_t _next_telemetry_ms;
+    bool _events;
+    uint16_t _telemetry_seq;
+    uint32_t _last_byte_ms;
+    server_stats_t _stats;
+
+    static uint32_t _millis();
+    void _send(const uint8_t type, const uint8_t* payload, const size_t len);
+    void _send_ack(const uint16_t ticket, const deck_proto::status_t status, const uint8_t accepted);
+    uint8_t _get_flags();
+    void _execute(const deck_proto::frame_t& frame);
+    void _execute_commands(const uint16_t ticket, const uint8_t* codes, const size_t num_codes);
+    bool _execute_command(const uint8_t code);
+};
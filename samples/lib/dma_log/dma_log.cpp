@@ -0,0 +1,405 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include "dma_log.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "hardware/dma.h"
+#include "hardware/sync.h"
+#if LIB_PICO_STDIO
+#include "pico/stdio/driver.h"
+#endif
+#if LIB_PICO_STDIO_UART
+#include "pico/stdio_uart.h"
+#endif
+
+namespace {
+
+// conversion specification of printf format
+typedef struct _spec_t {
+    char text[16];   // without the length modifiers and '*'
+    char conv;       // 0 at the end of the format
+    uint8_t longs;   // number of 'l'
+    bool size;       // 'z', 'j' or 't'
+    uint8_t stars;   // width or precision taken by argument
+} spec_t;
+
+const char* _parse_spec(const char* p, spec_t& spec)
+{
+    // p points the character next to '%'
+    uint len = 0;
+    spec.text[len++] = '%';
+    spec.longs = 0;
+    spec.size = false;
+    spec.stars = 0;
+    while (*p != '\0' && strchr("-+ #0123456789.*hlLzjt", *p) != nullptr) {
+        if (*p == '*') {
+            spec.stars++;
+        } else if (*p == 'l') {
+            spec.longs++;
+        } else if (*p == 'z' || *p == 'j' || *p == 't') {
+            spec.size = true;
+        } else if (*p != 'h' && *p != 'L' && len < sizeof(spec.text) - 2) {
+            spec.text[len++] = *p;
+        }
+        p++;
+    }
+    spec.conv = *p;
+    if (*p != '\0') p++;
+    spec.text[len++] = spec.conv;
+    spec.text[len] = '\0';
+    return p;
+}
+
+bool _is_float_conv(const char conv)
+{
+    return conv != '\0' && strchr("fFeEgGaA", conv) != nullptr;
+}
+
+uint _round_up_pow2(const uint value)
+{
+    uint pow2 = 1;
+    while (pow2 < value) pow2 <<= 1;
+    return pow2;
+}
+
+dma_log* _stdio_log = nullptr;
+uint _stdio_core = 0;
+#if LIB_PICO_STDIO
+stdio_driver_t _stdio_driver = {};
+#endif
+
+}
+
+dma_log::dma_log(uart_inst_t* uart, const uint num_records, const bool use_dma) :
+    _uart(uart),
+    _num_records(_round_up_pow2(num_records)),
+    _mask(_num_records - 1),
+    _records(new record_t[_num_records]()),
+    _lock(),
+    _head(0),
+    _tail(0),
+    _use_dma(use_dma),
+    _dma_chan(-1),
+    _timestamp(false),
+    _drops(0),
+    _tx{},
+    _tx_len{},
+    _fill(0),
+    _tx_pos(0),
+    _stats{}
+{
+    critical_section_init(&_lock);
+}
+
+dma_log::~dma_log()
+{
+    if (_stdio_log == this) {
+#if LIB_PICO_STDIO
+        stdio_set_driver_enabled(&_stdio_driver, false);
+#endif
+        _stdio_log = nullptr;
+    }
+    if (_dma_chan >= 0) {
+        while (dma_channel_is_busy(_dma_chan)) {
+            tight_loop_contents();
+        }
+        dma_channel_unclaim(_dma_chan);
+    }
+    critical_section_deinit(&_lock);
+    delete[] _records;
+}
+
+bool dma_log::vlog(const char* fmt, va_list args)
+{
+    // take the arguments by the conversions before the reservation
+    uint32_t values[MAX_ARGS];
+    uint8_t num_args = 0;
+    uint8_t float_mask = 0;
+    const char* p = fmt;
+    while (*p != '\0' && num_args < MAX_ARGS) {
+        if (*p++ != '%') continue;
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+        spec_t spec;
+        p = _parse_spec(p, spec);
+        for (uint i = 0; i < spec.stars; i++) {
+            (void) va_arg(args, int);
+        }
+        if (_is_float_conv(spec.conv)) {
+            float value = (float) va_arg(args, double);
+            float_mask |= 1 << num_args;
+            memcpy(&values[num_args++], &value, sizeof(float));
+        } else if (spec.conv == 's' || spec.conv == 'p' || spec.conv == 'n') {
+            values[num_args++] = (uint32_t) (uintptr_t) va_arg(args, void*);
+        } else if (spec.conv != '\0' && strchr("diuoxXc", spec.conv) != nullptr) {
+            if (spec.longs >= 2) {
+                values[num_args++] = (uint32_t) va_arg(args, long long);
+            } else if (spec.longs == 1) {
+                values[num_args++] = (uint32_t) va_arg(args, long);
+            } else if (spec.size) {
+                values[num_args++] = (uint32_t) va_arg(args, size_t);
+            } else {
+                values[num_args++] = (uint32_t) va_arg(args, int);
+            }
+        } else {
+            break;  // the type of the rest is unknown
+        }
+    }
+
+    uint32_t index;
+    if (!_reserve(1, index)) return false;
+    record_t& record = _records[index & _mask];
+    record.time_us = time_us_32();
+    record.fmt = fmt;
+    memcpy(record.args, values, num_args * sizeof(uint32_t));
+    record.num_args = num_args;
+    record.float_mask = float_mask;
+    _commit(index, 1);
+    return true;
+}
+
+bool dma_log::write(const uint8_t* data, const size_t len)
+{
+    if (len == 0) return true;
+    uint num = (uint) ((len + RAW_BYTES - 1) / RAW_BYTES);
+    uint32_t index;
+    if (!_reserve(num, index)) return false;
+    for (uint i = 0; i < num; i++) {
+        record_t& record = _records[(index + i) & _mask];
+        size_t bytes = std::min((size_t) RAW_BYTES, len - i * RAW_BYTES);
+        record.fmt = nullptr;
+        memcpy(record.args, &data[i * RAW_BYTES], bytes);
+        record.num_args = (uint8_t) bytes;
+        record.float_mask = 0;
+        if (i > 0) record.dropped = 0;  // the drop is taken by the first record
+    }
+    _commit(index, num);
+    return true;
+}
+
+bool dma_log::process()
+{
+    if (_use_dma && _dma_chan < 0) {
+        // claimed here since the constructor could run before the DMA channels are available (static instance)
+        _dma_chan = dma_claim_unused_channel(false);
+        _use_dma = _dma_chan >= 0;
+    }
+    return (_dma_chan >= 0) ? _transmit_by_dma() : _transmit_by_cpu(false);
+}
+
+void dma_log::flush()
+{
+    while (process()) {
+        if (_dma_chan < 0) _transmit_by_cpu(true);
+    }
+    uart_tx_wait_blocking(_uart);
+}
+
+void dma_log::enable_stdio()
+{
+#if LIB_PICO_STDIO
+    _stdio_log = this;
+    _stdio_core = get_core_num();
+    _stdio_driver.out_chars = _stdio_out_chars;
+    _stdio_driver.out_flush = _stdio_out_flush;
+    _stdio_driver.in_chars = _stdio_in_chars;
+#if PICO_STDIO_ENABLE_CRLF_SUPPORT
+    _stdio_driver.crlf_enabled = PICO_STDIO_DEFAULT_CRLF;
+#endif
+#if LIB_PICO_STDIO_UART
+    stdio_set_driver_enabled(&stdio_uart, false);
+#endif
+    stdio_set_driver_enabled(&_stdio_driver, true);
+#endif
+}
+
+void dma_log::set_timestamp(const bool flag)
+{
+    _timestamp = flag;
+}
+
+const dma_log::log_stats_t& dma_log::get_stats() const
+{
+    return _stats;
+}
+
+bool dma_log::_reserve(const uint num, uint32_t& index)
+{
+    // only the index is taken in the critical section, the record is filled outside
+    critical_section_enter_blocking(&_lock);
+    uint32_t level = _head - _tail + num;
+    bool reserved = level <= _num_records;
+    if (reserved) {
+        index = _head;
+        _head = index + num;
+        _records[index & _mask].dropped = (uint16_t) std::min(_drops, (uint32_t) UINT16_MAX);
+        _drops = 0;
+        _stats.records += num;
+        if (level > _stats.max_level) _stats.max_level = level;
+    } else {
+        _stats.dropped += num;
+        _drops += num;
+    }
+    critical_section_exit(&_lock);
+    return reserved;
+}
+
+void dma_log::_commit(const uint32_t index, const uint num)
+{
+    __dmb();  // the record is visible before the sequence
+    for (uint i = 0; i < num; i++) {
+        _records[(index + i) & _mask].seq = index + i + 1;
+    }
+}
+
+size_t dma_log::_format(const record_t& record, char* buf, const size_t size) const
+{
+    size_t n = 0;
+    if (_timestamp) {
+        uint32_t time_ms = record.time_us / 1000;
+        n = std::min((size_t) snprintf(buf, size, "[%4lu.%03lu] ", (unsigned long) (time_ms / 1000), (unsigned long) (time_ms % 1000)), size - 1);
+    }
+    uint arg = 0;
+    const char* p = record.fmt;
+    while (*p != '\0' && n < size - 1) {
+        if (*p != '%') {
+            buf[n++] = *p++;
+            continue;
+        }
+        p++;
+        if (*p == '%') {
+            buf[n++] = *p++;
+            continue;
+        }
+        spec_t spec;
+        p = _parse_spec(p, spec);
+        if (spec.conv == '\0') break;
+        if (arg >= record.num_args) continue;  // missing argument is omitted
+        uint32_t value = record.args[arg];
+        bool is_float = (record.float_mask >> arg) & 1;
+        arg++;
+        float value_f;
+        memcpy(&value_f, &value, sizeof(float));
+        int len;
+        if (_is_float_conv(spec.conv)) {
+            len = snprintf(&buf[n], size - n, spec.text, is_float ? (double) value_f : (double) (int32_t) value);
+        } else if (spec.conv == 'd' || spec.conv == 'i' || spec.conv == 'c') {
+            len = snprintf(&buf[n], size - n, spec.text, is_float ? (int) value_f : (int) value);
+        } else if (spec.conv == 'u' || spec.conv == 'o' || spec.conv == 'x' || spec.conv == 'X') {
+            len = snprintf(&buf[n], size - n, spec.text, is_float ? (unsigned int) value_f : (unsigned int) value);
+        } else {
+            len = snprintf(&buf[n], size - n, "?");  // string and pointer are not kept by the record
+        }
+        if (len > 0) n += std::min((size_t) len, size - 1 - n);
+    }
+    return n;
+}
+
+void dma_log::_fill_buffer()
+{
+    uint8_t* buf = _tx[_fill];
+    size_t& len = _tx_len[_fill];
+    while (len + MAX_LINE <= TX_BUF_SIZE) {
+        uint32_t tail = _tail;
+        const record_t& record = _records[tail & _mask];
+        if (record.seq != tail + 1) break;
+        __dmb();  // the record is read after the sequence
+        if (record.dropped > 0) {
+            if (len + 2 * MAX_LINE > TX_BUF_SIZE) break;  // the drop line and the record are kept together
+            // reported at the position of the drop
+            len += std::min((size_t) snprintf((char*) &buf[len], MAX_LINE, "[dma_log] %u records dropped\r\n", (uint) record.dropped), MAX_LINE - 1);
+        }
+        if (record.fmt == nullptr) {
+            memcpy(&buf[len], record.args, record.num_args);
+            len += record.num_args;
+        } else {
+            len += _format(record, (char*) &buf[len], MAX_LINE);
+        }
+        __dmb();  // the record is read before the slot is released
+        _tail = tail + 1;
+    }
+}
+
+bool dma_log::_transmit_by_dma()
+{
+    if (dma_channel_is_busy(_dma_chan)) {
+        // format the next records while transmitting
+        _fill_buffer();
+        return true;
+    }
+    _fill_buffer();
+    size_t len = _tx_len[_fill];
+    if (len == 0) return _tail != _head;
+    dma_channel_config config = dma_channel_get_default_config(_dma_chan);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, uart_get_dreq(_uart, true));
+    dma_channel_configure(_dma_chan, &config, &uart_get_hw(_uart)->dr, _tx[_fill], len, true);
+    _stats.bytes += len;
+    _stats.transfers++;
+    _fill ^= 1;
+    _tx_len[_fill] = 0;
+    return true;
+}
+
+bool dma_log::_transmit_by_cpu(const bool blocking)
+{
+    // single buffer refilled when transmitted
+    if (_tx_pos >= _tx_len[0]) {
+        _tx_len[0] = 0;
+        _tx_pos = 0;
+        _fill_buffer();
+    }
+    while (_tx_pos < _tx_len[0] && (blocking || uart_is_writable(_uart))) {
+        uart_putc_raw(_uart, (char) _tx[0][_tx_pos++]);
+        _stats.bytes++;
+    }
+    return _tx_pos < _tx_len[0] || _tail != _head;
+}
+
+void dma_log::_wait_room(const uint num)
+{
+    while (_head - _tail + num > _num_records) {
+        if (!process()) break;
+        if (_dma_chan < 0) _transmit_by_cpu(true);
+    }
+}
+
+void dma_log::_stdio_out_chars(const char* buf, int length)
+{
+    dma_log* log = _stdio_log;
+    if (log == nullptr) return;
+    // long text is split not to occupy the ring at once
+    while (length > 0) {
+        int len = std::min(length, (int) MAX_LINE);
+        if (get_core_num() == _stdio_core) log->_wait_room((uint) ((len + RAW_BYTES - 1) / RAW_BYTES));
+        log->write((const uint8_t*) buf, (size_t) len);
+        buf += len;
+        length -= len;
+    }
+}
+
+void dma_log::_stdio_out_flush()
+{
+    dma_log* log = _stdio_log;
+    if (log != nullptr && get_core_num() == _stdio_core) log->flush();
+}
+
+int dma_log::_stdio_in_chars(char* buf, int length)
+{
+    dma_log* log = _stdio_log;
+    int n = 0;
+    while (log != nullptr && n < length && uart_is_readable(log->_uart)) {
+        buf[n++] = uart_getc(log->_uart);
+    }
+    return (n > 0) ? n : PICO_ERROR_NO_DATA;
+}
@@ -0,0 +1,181 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include <cstdarg>
+#include <cstring>
+#include <type_traits>
+
+#include "pico/stdlib.h"
+#include "pico/sync.h"
+#include "hardware/uart.h"
+
+// Non-blocking logging console on UART
+//   log() stores a compact binary record (format string pointer, timestamp and up to MAX_ARGS 32-bit arguments)
+//   to the ring without formatting, process() formats the records on the UI core and transmits them by DMA to UART
+//   the producers are any of both cores and IRQ handlers: a slot is reserved by a short critical section
+//   (RP2040 has no atomic read-modify-write) and committed by its sequence number, thus the consumer never locks
+//   the record is dropped (and counted) when the ring is full, thus the producer never waits for UART
+//   format strings must be static (the pointer is kept), %s is not supported (arguments are integers or floats)
+class dma_log {
+    public:
+    /**
+     * Definitions
+     */
+    typedef struct _log_stats_t {
+        uint32_t records;    // records committed
+        uint32_t dropped;    // records dropped by full ring
+        uint32_t max_level;  // max number of records in the ring
+        uint64_t bytes;      // bytes transmitted to UART
+        uint32_t transfers;  // DMA transfers (0 for CPU path)
+    } log_stats_t;
+
+    // Constants
+    static constexpr uint MAX_ARGS = 4;
+    static constexpr uint RAW_BYTES = MAX_ARGS * sizeof(uint32_t);  // bytes of write() per record
+    static constexpr uint DEFAULT_NUM_RECORDS = 256;
+    static constexpr size_t TX_BUF_SIZE = 512;
+    static constexpr size_t MAX_LINE = 128;  // longer line is truncated
+
+    /**
+     * dma_log class constructor
+     *   a DMA channel is claimed at the first process() (CPU path by FIFO room if no channel is available)
+     *
+     * @param[in] uart UART instance initialized
+     * @param[in] num_records number of records of the ring (power of 2)
+     * @param[in] use_dma true to transmit by DMA
+     */
+    dma_log(uart_inst_t* uart, const uint num_records = DEFAULT_NUM_RECORDS, const bool use_dma = true);
+
+    /**
+     * dma_log class destructor
+     */
+    virtual ~dma_log();
+
+    /**
+     * log a record (formatted later by process())
+     *   callable from any core and IRQ
+     *
+     * @param[in] fmt static format string of printf
+     * @param[in] args integers or floats (~ MAX_ARGS)
+     * @return false if dropped by full ring
+     */
+    template <typename... Args>
+    bool log(const char* fmt, const Args... args)
+    {
+        static_assert(sizeof...(Args) <= MAX_ARGS, "too many arguments for dma_log");
+        uint32_t index;
+        if (!_reserve(1, index)) return false;
+        record_t& record = _records[index & _mask];
+        record.time_us = time_us_32();
+        record.fmt = fmt;
+        record.num_args = 0;
+        record.float_mask = 0;
+        (_put_arg(record, args), ...);
+        _commit(index, 1);
+        return true;
+    }
+
+    /**
+     * log a record by va_list (for the callbacks of printf style)
+     *   the arguments are taken by the conversions of the format
+     */
+    bool vlog(const char* fmt, va_list args);
+
+    /**
+     * write bytes as they are (e.g. binary frames)
+     *   the records of the bytes are reserved at once, thus the bytes are not split by the records of the others
+     *
+     * @return false if dropped by full ring
+     */
+    bool write(const uint8_t* data, const size_t len);
+
+    /**
+     * format the records and transmit them
+     *   to be called in every UI loop, never waits for UART
+     *
+     * @return true if something remains to transmit
+     */
+    bool process();
+
+    /**
+     * transmit all the records (blocking)
+     */
+    void flush();
+
+    /**
+     * route the output of stdio (printf, putchar) to write() and read the input of stdio from UART directly
+     *   instead of stdio_uart, thus the text output is kept in order with the records
+     *   the output waits for the room of the ring on the core calling this, dropped when full on the other core
+     *   (no effect without pico_stdio)
+     */
+    void enable_stdio();
+
+    /**
+     * prepend the time of record to each line of log() as [seconds.milliseconds] (wraps at 4294 seconds)
+     */
+    void set_timestamp(const bool flag);
+
+    /**
+     * get statistics
+     */
+    const log_stats_t& get_stats() const;
+
+    protected:
+    typedef struct _record_t {
+        volatile uint32_t seq;    // index + 1 when committed
+        uint32_t time_us;
+        const char* fmt;          // nullptr for bytes of write()
+        uint32_t args[MAX_ARGS];  // or bytes of write()
+        uint8_t num_args;         // or number of bytes of write()
+        uint8_t float_mask;       // bit of float argument
+        uint16_t dropped;         // records dropped just before this
+    } record_t;
+
+    uart_inst_t* _uart;
+    const uint _num_records;
+    const uint32_t _mask;
+    record_t* _records;
+    critical_section_t _lock;
+    volatile uint32_t _head;  // next index to reserve (under _lock)
+    volatile uint32_t _tail;  // next index to consume (by process())
+    bool _use_dma;
+    int _dma_chan;
+    bool _timestamp;
+    uint32_t _drops;          // records dropped since the last reservation (under _lock)
+    uint8_t _tx[2][TX_BUF_SIZE];
+    size_t _tx_len[2];
+    uint _fill;               // buffer being filled (the other one is being transmitted)
+    size_t _tx_pos;           // position transmitted of CPU path
+    log_stats_t _stats;
+
+    static void _put_arg(record_t& record, const float value)
+    {
+        record.float_mask |= 1 << record.num_args;
+        memcpy(&record.args[record.num_args++], &value, sizeof(float));
+    }
+    static void _put_arg(record_t& record, const double value)
+    {
+        _put_arg(record, (float) value);
+    }
+    template <typename T>
+    static void _put_arg(record_t& record, const T value)
+    {
+        static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "dma_log takes integers or floats");
+        record.args[record.num_args++] = (uint32_t) value;
+    }
+    bool _reserve(const uint num, uint32_t& index);
+    void _commit(const uint32_t index, const uint num);
+    size_t _format(const record_t& record, char* buf, const size_t size) const;
+    void _fill_buffer();
+    bool _transmit_by_dma();
+    bool _transmit_by_cpu(const bool blocking);
+    void _wait_room(const uint num);
+    static void _stdio_out_chars(const char* buf, int length);
+    static void _stdio_out_flush();
+    static int _stdio_in_chars(char* buf, int length);
+};
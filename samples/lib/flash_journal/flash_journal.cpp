@@ -0,0 +1,292 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include "flash_journal.h"
+
+#include <cstring>
+
+#include "pico/flash.h"
+
+flash_journal::flash_journal(const uint32_t flash_offs, const uint num_sectors) :
+    _flash_offs(flash_offs),
+    _num_sectors((num_sectors < 2) ? 2 : (num_sectors > MAX_SECTORS) ? MAX_SECTORS : num_sectors),
+    _values{},
+    _valid_keys(0),
+    _pending{},
+    _num_pending(0),
+    _head_sector(NO_SECTOR),
+    _head_slot(0),
+    _seq(0),
+    _erased(0),
+    _write_buf{},
+    _page_buf{},
+    _stats{}
+{
+}
+
+flash_journal::~flash_journal()
+{
+}
+
+bool flash_journal::open()
+{
+    uint32_t start_us = time_us_32();
+    _valid_keys = 0;
+    _num_pending = 0;
+    _head_sector = NO_SECTOR;
+    _head_slot = 0;
+    _erased = 0;
+    _stats.scanned = 0;
+    _stats.torn = 0;
+
+    // headers of the sectors
+    uint32_t header_seqs[MAX_SECTORS];
+    uint32_t candidates = 0;  // bit mask of sectors with header
+    uint32_t max_seq = 0;
+    for (uint sector = 0; sector < _num_sectors; sector++) {
+        const record_t* header = _get_record(sector, 0);
+        _stats.scanned++;
+        if (_is_valid(*header) && header->key == KEY_HEADER && header->value[0] == MAGIC) {
+            header_seqs[sector] = header->seq;
+            candidates |= 1UL << sector;
+            if (header->seq >= max_seq) max_seq = header->seq;
+        }
+    }
+    bool found = candidates != 0;
+    // the newest sector with complete checkpoint is the head
+    while (candidates != 0) {
+        uint newest = NO_SECTOR;
+        for (uint sector = 0; sector < _num_sectors; sector++) {
+            if ((candidates & (1UL << sector)) && (newest == NO_SECTOR || header_seqs[sector] > header_seqs[newest])) {
+                newest = sector;
+            }
+        }
+        candidates &= ~(1UL << newest);
+        uint next_slot;
+        uint32_t last_seq;
+        if (_restore_sector(newest, next_slot, last_seq)) {
+            _head_sector = newest;
+            _head_slot = next_slot;
+            if (last_seq > max_seq) max_seq = last_seq;
+            break;
+        }
+    }
+    _seq = found ? max_seq + 1 : 0;
+    _stats.restore_us = time_us_32() - start_us;
+    return _head_sector != NO_SECTOR;
+}
+
+bool flash_journal::get(const uint key, uint64_t& value) const
+{
+    if (key >= MAX_KEYS || (_valid_keys & (1UL << key)) == 0) return false;
+    value = _values[key];
+    return true;
+}
+
+bool flash_journal::put(const uint key, const uint64_t value)
+{
+    if (key >= MAX_KEYS) return false;
+    if ((_valid_keys & (1UL << key)) && _values[key] == value) return true;
+    uint index;
+    for (index = 0; index < _num_pending; index++) {
+        if (_pending[index].key == key) break;
+    }
+    if (index == MAX_PENDING) return false;
+    if (index == _num_pending) {
+        _pending[index].key = key;
+        _num_pending++;
+    }
+    _pending[index].value[0] = (uint32_t) value;
+    _pending[index].value[1] = (uint32_t) (value >> 32);
+    _values[key] = value;
+    _valid_keys |= 1UL << key;
+    _stats.put_bytes += RECORD_SIZE;
+    return true;
+}
+
+uint flash_journal::get_num_pending() const
+{
+    return _num_pending;
+}
+
+bool flash_journal::flush()
+{
+    if (_num_pending == 0) return true;
+    bool flag;
+    if (_head_sector != NO_SECTOR && _head_slot + _num_pending <= RECORDS_PER_SECTOR) {
+        for (uint i = 0; i < _num_pending; i++) {
+            uint64_t value = ((uint64_t) _pending[i].value[1] << 32) | _pending[i].value[0];
+            _make_record(_write_buf[i], _pending[i].key, value);
+        }
+        flag = _write(_head_sector, _head_slot, _num_pending, false);
+        if (flag) _head_slot += _num_pending;
+    } else {
+        // next sector starts with the checkpoint of all the live values, which includes the pending ones
+        uint sector = (_head_sector == NO_SECTOR) ? 0 : (_head_sector + 1) % _num_sectors;
+        uint num_records = 0;
+        uint num_keys = 0;
+        _make_record(_write_buf[num_records++], KEY_HEADER, MAGIC);
+        for (uint key = 0; key < MAX_KEYS; key++) {
+            if ((_valid_keys & (1UL << key)) == 0) continue;
+            _make_record(_write_buf[num_records++], key, _values[key]);
+            num_keys++;
+        }
+        _make_record(_write_buf[num_records++], KEY_CHECKPOINT, num_keys);
+        bool erase = (_erased & (1UL << sector)) == 0 && !_is_blank(sector);
+        flag = _write(sector, 0, num_records, erase);
+        if (flag) {
+            _head_sector = sector;
+            _head_slot = num_records;
+            _erased &= ~(1UL << sector);
+            _stats.switches++;
+        }
+    }
+    if (flag) {
+        _num_pending = 0;
+        _stats.flushes++;
+    }
+    return flag;
+}
+
+bool flash_journal::compact()
+{
+    // from the oldest sector (next to the head in the ring)
+    uint base = (_head_sector == NO_SECTOR) ? 0 : _head_sector + 1;
+    for (uint i = 0; i < _num_sectors; i++) {
+        uint sector = (base + i) % _num_sectors;
+        if (sector == _head_sector || (_erased & (1UL << sector))) continue;
+        if (!_is_blank(sector)) {
+            if (!_write(sector, 0, 0, true)) return false;
+            _erased |= 1UL << sector;
+            return true;
+        }
+        _erased |= 1UL << sector;
+    }
+    return false;
+}
+
+float flash_journal::get_write_amplification() const
+{
+    if (_stats.put_bytes == 0) return 0.0f;
+    return (float) _stats.programmed_bytes / _stats.put_bytes;
+}
+
+const flash_journal::journal_stats_t& flash_journal::get_stats() const
+{
+    return _stats;
+}
+
+uint16_t flash_journal::_crc16(const record_t& record)
+{
+    // CRC-16/CCITT-FALSE of seq, key and value
+    uint8_t bytes[4 + 2 + 8];
+    memcpy(&bytes[0], &record.seq, 4);
+    memcpy(&bytes[4], &record.key, 2);
+    memcpy(&bytes[6], &record.value[0], 8);
+    uint16_t crc = 0xffff;
+    for (uint i = 0; i < sizeof(bytes); i++) {
+        crc ^= (uint16_t) bytes[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+void flash_journal::_flash_write(void* param)
+{
+    const write_param_t* p = static_cast<const write_param_t*>(param);
+    flash_journal* inst = p->inst;
+    uint32_t sector_offs = inst->_flash_offs + p->sector * FLASH_SECTOR_SIZE;
+    if (p->erase) {
+        flash_range_erase(sector_offs, FLASH_SECTOR_SIZE);
+    }
+    uint slot = p->slot;
+    uint index = 0;
+    while (index < p->num_records) {
+        // 0xff leaves the bits already programmed as they are
+        uint page = slot / RECORDS_PER_PAGE;
+        memset(inst->_page_buf, 0xff, FLASH_PAGE_SIZE);
+        while (index < p->num_records && slot / RECORDS_PER_PAGE == page) {
+            memcpy(&inst->_page_buf[(slot % RECORDS_PER_PAGE) * RECORD_SIZE], &inst->_write_buf[index++], RECORD_SIZE);
+            slot++;
+        }
+        flash_range_program(sector_offs + page * FLASH_PAGE_SIZE, inst->_page_buf, FLASH_PAGE_SIZE);
+        inst->_stats.programmed_bytes += FLASH_PAGE_SIZE;
+    }
+}
+
+const flash_journal::record_t* flash_journal::_get_record(const uint sector, const uint slot) const
+{
+    return reinterpret_cast<const record_t*>(XIP_BASE + _flash_offs + sector * FLASH_SECTOR_SIZE + slot * RECORD_SIZE);
+}
+
+bool flash_journal::_is_valid(const record_t& record) const
+{
+    return record.seq != EMPTY_SEQ && record.crc == _crc16(record);
+}
+
+bool flash_journal::_is_blank(const uint sector) const
+{
+    const uint32_t* words = reinterpret_cast<const uint32_t*>(_get_record(sector, 0));
+    for (uint i = 0; i < FLASH_SECTOR_SIZE / sizeof(uint32_t); i++) {
+        if (words[i] != 0xffffffff) return false;
+    }
+    return true;
+}
+
+bool flash_journal::_restore_sector(const uint sector, uint& next_slot, uint32_t& last_seq)
+{
+    uint64_t values[MAX_KEYS];
+    uint32_t valid_keys = 0;
+    bool checkpoint = false;
+    last_seq = _get_record(sector, 0)->seq;
+    uint slot;
+    for (slot = 1; slot < RECORDS_PER_SECTOR; slot++) {
+        const record_t* record = _get_record(sector, slot);
+        const uint32_t* words = reinterpret_cast<const uint32_t*>(record);
+        if ((words[0] & words[1] & words[2] & words[3]) == 0xffffffff) break;  // the end of records
+        _stats.scanned++;
+        if (!_is_valid(*record)) {
+            _stats.torn++;
+            continue;
+        }
+        last_seq = record->seq;
+        if (record->key == KEY_CHECKPOINT) {
+            checkpoint = true;
+        } else if (record->key < MAX_KEYS) {
+            values[record->key] = ((uint64_t) record->value[1] << 32) | record->value[0];
+            valid_keys |= 1UL << record->key;
+        }
+    }
+    next_slot = slot;
+    if (!checkpoint) return false;
+    for (uint key = 0; key < MAX_KEYS; key++) {
+        if (valid_keys & (1UL << key)) _values[key] = values[key];
+    }
+    _valid_keys = valid_keys;
+    return true;
+}
+
+void flash_journal::_make_record(record_t& record, const uint16_t key, const uint64_t value)
+{
+    record.seq = _seq++;
+    record.key = key;
+    record.value[0] = (uint32_t) value;
+    record.value[1] = (uint32_t) (value >> 32);
+    record.crc = _crc16(record);
+}
+
+bool flash_journal::_write(const uint sector, const uint slot, const uint num_records, const bool erase)
+{
+    write_param_t param = {this, sector, slot, num_records, erase};
+    if (flash_safe_execute(_flash_write, &param, SAFE_EXECUTE_TIMEOUT_MS) != PICO_OK) return false;
+    if (erase) _stats.erases++;
+    _stats.record_bytes += num_records * RECORD_SIZE;
+    // verify (power loss or failure of program)
+    if (erase && num_records == 0) return _is_blank(sector);
+    return memcmp(_get_record(sector, slot), _write_buf, num_records * RECORD_SIZE) == 0;
+}
@@ -0,0 +1,166 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+
+// Append-only journal of key-value records in a reserved flash region
+//   put() buffers fixed-size records in RAM, flush() programs them in a batch at safe points (by flash_safe_execute())
+//   the sectors of the region are used as a ring (wear leveling), each sector starts with the header
+//   and the checkpoint of all the live values, followed by the appended records
+//   open() restores the values by the headers of the sectors and the records of the newest sector only (the tail of the ring)
+//   the sectors behind the newest one are stale, compact() erases one of them at a time in background
+//   a record torn by power loss is discarded by CRC, a sector with torn checkpoint is skipped and the previous one is used
+//   the instance is to be used from one core, the other core needs flash_safe_execute_core_init() if running
+class flash_journal {
+    public:
+    /**
+     * Definitions
+     */
+    typedef struct _journal_stats_t {
+        uint32_t restore_us;        // time of open()
+        uint32_t scanned;           // records read by open()
+        uint32_t torn;              // records discarded by CRC error at open()
+        uint32_t flushes;           // number of flush() which programmed records
+        uint32_t switches;          // number of sector switches (checkpoints)
+        uint32_t erases;            // number of sectors erased
+        uint64_t put_bytes;         // bytes of the records of changed values by put()
+        uint64_t record_bytes;      // bytes of the records programmed including headers and checkpoints
+        uint64_t programmed_bytes;  // bytes of the pages programmed
+    } journal_stats_t;
+
+    // Constants
+    static constexpr uint MAX_KEYS = 32;
+    static constexpr uint MAX_PENDING = 16;
+    static constexpr uint MAX_SECTORS = 32;
+    static constexpr uint RECORD_SIZE = 16;
+    static constexpr uint RECORDS_PER_SECTOR = FLASH_SECTOR_SIZE / RECORD_SIZE;
+    static constexpr uint RECORDS_PER_PAGE = FLASH_PAGE_SIZE / RECORD_SIZE;
+
+    /**
+     * flash_journal class constructor
+     *
+     * @param[in] flash_offs offset in flash of the region (aligned to FLASH_SECTOR_SIZE)
+     * @param[in] num_sectors number of sectors of the region (2 ~ MAX_SECTORS)
+     */
+    flash_journal(const uint32_t flash_offs, const uint num_sectors);
+
+    /**
+     * flash_journal class destructor
+     */
+    virtual ~flash_journal();
+
+    /**
+     * restore the values from flash
+     *   the pending records are discarded
+     *
+     * @return true if restored, false if no valid sector (empty journal)
+     */
+    bool open();
+
+    /**
+     * get value
+     *
+     * @param[in] key key (0 ~ MAX_KEYS - 1)
+     * @param[out] value value
+     * @return true if the key has value
+     */
+    bool get(const uint key, uint64_t& value) const;
+
+    /**
+     * put value
+     *   the value is applied at once and buffered to flush(), unchanged value is ignored
+     *   and the pending record of the same key is overwritten
+     *
+     * @param[in] key key (0 ~ MAX_KEYS - 1)
+     * @param[in] value value
+     * @return false if invalid key or no room of pending records (flush() is needed)
+     */
+    bool put(const uint key, const uint64_t value);
+
+    /**
+     * get number of the records waiting for flush()
+     */
+    uint get_num_pending() const;
+
+    /**
+     * program the pending records to flash
+     *   switches to the next sector with checkpoint if the records don't fit in the current one
+     *   (erases it first if compact() has not)
+     *
+     * @return true if succeeded or nothing to do
+     */
+    bool flush();
+
+    /**
+     * erase a stale sector in background
+     *   one sector per call, the sectors already erased are only checked
+     *
+     * @return true if a sector is erased
+     */
+    bool compact();
+
+    /**
+     * get write amplification
+     *
+     * @return bytes of the pages programmed per byte of the records of changed values (0.0 if nothing put)
+     */
+    float get_write_amplification() const;
+
+    /**
+     * get statistics
+     */
+    const journal_stats_t& get_stats() const;
+
+    protected:
+    typedef struct _record_t {
+        uint32_t seq;       // sequence number (EMPTY_SEQ if not programmed)
+        uint16_t key;
+        uint16_t crc;       // CRC-16 of seq, key and value
+        uint32_t value[2];  // low word first
+    } record_t;
+    static_assert(sizeof(record_t) == RECORD_SIZE);
+
+    typedef struct _write_param_t {
+        flash_journal* inst;
+        uint sector;
+        uint slot;
+        uint num_records;
+        bool erase;
+    } write_param_t;
+
+    static constexpr uint32_t EMPTY_SEQ = 0xffffffff;
+    static constexpr uint16_t KEY_HEADER = 0xfff0;      // the first record of sector (value[0]: MAGIC)
+    static constexpr uint16_t KEY_CHECKPOINT = 0xfff1;  // the end of checkpoint (value[0]: number of keys)
+    static constexpr uint32_t MAGIC = 0x4c4e524a;       // "JRNL"
+    static constexpr uint NO_SECTOR = MAX_SECTORS;
+    static constexpr uint32_t SAFE_EXECUTE_TIMEOUT_MS = 100;
+
+    const uint32_t _flash_offs;
+    const uint _num_sectors;
+    uint64_t _values[MAX_KEYS];
+    uint32_t _valid_keys;    // bit mask of keys having value
+    record_t _pending[MAX_PENDING];
+    uint _num_pending;
+    uint _head_sector;       // sector appending records (NO_SECTOR if none)
+    uint _head_slot;         // next slot to append in the head sector
+    uint32_t _seq;           // sequence number of the next record
+    uint32_t _erased;        // bit mask of sectors known to be erased
+    record_t _write_buf[2 + MAX_KEYS];  // header, checkpoint or appended records to program
+    uint8_t _page_buf[FLASH_PAGE_SIZE];
+    journal_stats_t _stats;
+
+    static uint16_t _crc16(const record_t& record);
+    static void _flash_write(void* param);
+    const record_t* _get_record(const uint sector, const uint slot) const;
+    bool _is_valid(const record_t& record) const;
+    bool _is_blank(const uint sector) const;
+    bool _restore_sector(const uint sector, uint& next_slot, uint32_t& last_seq);
+    void _make_record(record_t& record, const uint16_t key, const uint64_t value);
+    bool _write(const uint sector, const uint slot, const uint num_records, const bool erase);
+};
@@ -0,0 +1,133 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include "ir_decoder.h"
+
+ir_decoder::ir_decoder() :
+    _holding(false), _held{}, _rc5_toggle(0), _press_ms(0), _last_ms(0),
+    _events{}, _event_head(0), _event_count(0), _stats{}
+{
+}
+
+bool ir_decoder::feed(const protocol_t protocol, const uint32_t word, const uint32_t now_ms)
+{
+    poll(now_ms);
+    bool held = _holding && _held.protocol == protocol;
+    if (protocol == PROTOCOL_NEC) {
+        if (word == NEC_REPEAT_CODE) {
+            if (!held) {
+                _stats.errors++;
+                return false;
+            }
+            _repeat(now_ms);
+            return true;
+        }
+        uint8_t command = (uint8_t) (word >> 16);
+        if ((command ^ (uint8_t) (word >> 24)) != 0xff) {
+            _stats.errors++;
+            return false;
+        }
+        // standard NEC has ~address in the 2nd byte, extended NEC has 16-bit address instead
+        uint8_t address_low = (uint8_t) word;
+        uint16_t address = ((address_low ^ (uint8_t) (word >> 8)) == 0xff) ? address_low : (uint16_t) word;
+        _stats.frames++;
+        // some remotes send the frame again instead of the repeat code
+        if (held && _held.address == address && _held.command == command) {
+            _repeat(now_ms);
+        } else {
+            _press(protocol, address, command, now_ms);
+        }
+        return true;
+    } else if (protocol == PROTOCOL_RC5) {
+        if (word >> RC5_NUM_BITS) {
+            _stats.errors++;
+            return false;
+        }
+        uint8_t toggle = (word >> 11) & 0x1;
+        uint16_t address = (word >> 6) & 0x1f;
+        uint8_t command = (word & 0x3f) | ((word & (1UL << 12)) ? 0x00 : 0x40);  // 2nd start bit is inverted command bit 6 (RC-5X)
+        _stats.frames++;
+        // the toggle bit flips at each press, thus the frames with the same toggle bit are of the key held
+        if (held && _held.address == address && _held.command == command && _rc5_toggle == toggle) {
+            _repeat(now_ms);
+        } else {
+            _press(protocol, address, command, now_ms);
+            _rc5_toggle = toggle;
+        }
+        return true;
+    }
+    _stats.errors++;
+    return false;
+}
+
+void ir_decoder::poll(const uint32_t now_ms)
+{
+    if (_holding && now_ms - _last_ms > RELEASE_TIMEOUT_MS) {
+        _release(now_ms);
+    }
+}
+
+bool ir_decoder::get_event(key_event_t& event)
+{
+    if (_event_count == 0) return false;
+    event = _events[_event_head];
+    _event_head = (_event_head + 1) % EVENT_QUEUE_LENGTH;
+    _event_count--;
+    return true;
+}
+
+void ir_decoder::reset()
+{
+    _holding = false;
+    _event_head = 0;
+    _event_count = 0;
+}
+
+bool ir_decoder::is_holding() const
+{
+    return _holding;
+}
+
+const ir_decoder::decoder_stats_t& ir_decoder::get_stats() const
+{
+    return _stats;
+}
+
+void ir_decoder::_press(const protocol_t protocol, const uint16_t address, const uint8_t command, const uint32_t now_ms)
+{
+    // a new key ends the key held
+    if (_holding) _release(now_ms);
+    _held.protocol = protocol;
+    _held.address = address;
+    _held.command = command;
+    _press_ms = now_ms;
+    _last_ms = now_ms;
+    _holding = true;
+    _put_event(EVT_PRESS, 0);
+}
+
+void ir_decoder::_repeat(const uint32_t now_ms)
+{
+    _last_ms = now_ms;
+    _stats.repeats++;
+    _put_event(EVT_REPEAT, now_ms - _press_ms);
+}
+
+void ir_decoder::_release(const uint32_t now_ms)
+{
+    _holding = false;
+    _put_event(EVT_RELEASE, now_ms - _press_ms);
+}
+
+void ir_decoder::_put_event(const event_type_t type, const uint32_t hold_ms)
+{
+    if (_event_count >= EVENT_QUEUE_LENGTH) return;  // the events are taken in every loop
+    key_event_t& event = _events[(_event_head + _event_count) % EVENT_QUEUE_LENGTH];
+    event = _held;
+    event.type = type;
+    event.hold_ms = hold_ms;
+    _event_count++;
+}
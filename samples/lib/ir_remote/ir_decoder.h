@@ -0,0 +1,112 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Key events from the frames of IR remote control received by the PIO programs (ir_nec_receive, ir_rc5_receive)
+//   NEC:  32-bit word of the frame (address, ~address, command, ~command), 0 for the repeat code
+//   RC-5: 13-bit word of the frame (2nd start bit, toggle, address, command)
+//   a key is held while its frames or repeat codes come within RELEASE_TIMEOUT_MS, thus PRESS, REPEAT... and RELEASE
+//   this file has no dependency on pico-sdk to be tested on host with the recorded pulse timings
+class ir_decoder {
+    public:
+    /**
+     * Definitions
+     */
+    typedef enum _protocol_t {
+        PROTOCOL_NEC = 0,
+        PROTOCOL_RC5,
+        __NUM_PROTOCOLS__
+    } protocol_t;
+    typedef enum _event_type_t {
+        EVT_PRESS = 0,
+        EVT_REPEAT,
+        EVT_RELEASE
+    } event_type_t;
+    typedef struct _key_event_t {
+        event_type_t type;
+        protocol_t protocol;
+        uint16_t address;  // NEC: 8 bits (16 bits for extended NEC), RC-5: 5 bits
+        uint8_t command;   // NEC: 8 bits, RC-5: 6 bits (7 bits for RC-5X)
+        uint32_t hold_ms;  // from the press (0 for EVT_PRESS)
+    } key_event_t;
+    typedef struct _decoder_stats_t {
+        uint32_t frames;   // valid frames
+        uint32_t repeats;  // repeat codes and frames of the key held
+        uint32_t errors;   // invalid frames and repeat codes without key held
+    } decoder_stats_t;
+
+    // Constants
+    static constexpr uint32_t RELEASE_TIMEOUT_MS = 160;  // repeat interval is 108 ms (NEC), 114 ms (RC-5)
+    static constexpr uint32_t NEC_REPEAT_CODE = 0;
+    static constexpr uint32_t RC5_NUM_BITS = 13;
+    static constexpr size_t EVENT_QUEUE_LENGTH = 8;
+
+    /**
+     * ir_decoder class constructor
+     */
+    ir_decoder();
+
+    /**
+     * feed a word received from the state machine
+     *
+     * @param[in] protocol protocol of the state machine
+     * @param[in] word word pushed by the state machine
+     * @param[in] now_ms time of the reception in milliseconds
+     * @return false if the word is invalid
+     */
+    bool feed(const protocol_t protocol, const uint32_t word, const uint32_t now_ms);
+
+    /**
+     * release the key held when its frames stop
+     *   to be called in every loop
+     *
+     * @param[in] now_ms current time in milliseconds
+     */
+    void poll(const uint32_t now_ms);
+
+    /**
+     * get the key event in order
+     *
+     * @param[out] event key event
+     * @return true if an event is taken
+     */
+    bool get_event(key_event_t& event);
+
+    /**
+     * release the key held immediately and discard the events not taken
+     */
+    void reset();
+
+    /**
+     * get is a key held
+     */
+    bool is_holding() const;
+
+    /**
+     * get statistics
+     */
+    const decoder_stats_t& get_stats() const;
+
+    protected:
+    bool _holding;
+    key_event_t _held;      // key held (type is not used)
+    uint8_t _rc5_toggle;    // toggle bit of the key held (RC-5)
+    uint32_t _press_ms;
+    uint32_t _last_ms;      // last frame or repeat code of the key held
+    key_event_t _events[EVENT_QUEUE_LENGTH];
+    size_t _event_head;
+    size_t _event_count;
+    decoder_stats_t _stats;
+
+    void _press(const protocol_t protocol, const uint16_t address, const uint8_t command, const uint32_t now_ms);
+    void _repeat(const uint32_t now_ms);
+    void _release(const uint32_t now_ms);
+    void _put_event(const event_type_t type, const uint32_t hold_ms);
+};
@@ -0,0 +1,224 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include "ir_remote.h"
+
+#include "hardware/sync.h"
+
+#include "ir_nec_receive.pio.h"
+#include "ir_rc5_receive.pio.h"
+
+static const pio_program_t* const _programs[ir_decoder::__NUM_PROTOCOLS__] = {
+    &ir_nec_receive_program,
+    &ir_rc5_receive_program
+};
+
+uint32_t ir_remote::_sm_mask[ir_decoder::__NUM_PROTOCOLS__][NUM_PIOS] = {};
+uint ir_remote::_program_offset[ir_decoder::__NUM_PROTOCOLS__][NUM_PIOS] = {};
+
+ir_remote::ir_remote(crp42602y_ctrl* ctrl, const uint pin, const uint32_t protocol_mask) :
+    _ctrl(ctrl), _pin(pin), _pio{}, _sm{}, _decoder(), _keymap(nullptr), _num_entries(0),
+    _callback(nullptr), _held_action(ACT_NONE), _cue_held(false)
+{
+    gpio_init(_pin);
+    gpio_set_dir(_pin, GPIO_IN);
+    gpio_pull_up(_pin);
+
+    for (int i = 0; i < ir_decoder::__NUM_PROTOCOLS__; i++) {
+        if (!(protocol_mask & (1UL << i))) continue;
+        _alloc_pio_sm((ir_decoder::protocol_t) i);
+        _init_sm((ir_decoder::protocol_t) i);
+    }
+}
+
+ir_remote::~ir_remote()
+{
+    for (int i = 0; i < ir_decoder::__NUM_PROTOCOLS__; i++) {
+        if (_pio[i] == nullptr) continue;
+        pio_sm_set_enabled(_pio[i], _sm[i], false);
+        _free_pio_sm((ir_decoder::protocol_t) i);
+    }
+}
+
+void ir_remote::set_keymap(const keymap_entry_t* keymap, const size_t num_entries)
+{
+    _keymap = keymap;
+    _num_entries = num_entries;
+}
+
+void ir_remote::register_callback(const event_callback_t func)
+{
+    _callback = func;
+}
+
+void ir_remote::process()
+{
+    _take_frames();
+    _decoder.poll(to_ms_since_boot(get_absolute_time()));
+    ir_decoder::key_event_t event;
+    while (_decoder.get_event(event)) {
+        action_t action = (event.type == ir_decoder::EVT_PRESS) ? _find_action(event) : _held_action;
+        _execute(event, action);
+        if (_callback != nullptr) {
+            (*_callback)(event, action);
+        }
+    }
+}
+
+bool ir_remote::has_frame() const
+{
+    for (int i = 0; i < ir_decoder::__NUM_PROTOCOLS__; i++) {
+        if (_pio[i] != nullptr && !pio_sm_is_rx_fifo_empty(_pio[i], _sm[i])) return true;
+    }
+    return false;
+}
+
+void ir_remote::restart()
+{
+    // the frames already received are kept in the decoder
+    _take_frames();
+    for (int i = 0; i < ir_decoder::__NUM_PROTOCOLS__; i++) {
+        if (_pio[i] == nullptr) continue;
+        pio_sm_set_enabled(_pio[i], _sm[i], false);
+        _init_sm((ir_decoder::protocol_t) i);
+    }
+}
+
+const ir_decoder::decoder_stats_t& ir_remote::get_stats() const
+{
+    return _decoder.get_stats();
+}
+
+void ir_remote::_take_frames()
+{
+    uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+    // one word per frame, the bits are taken by the state machines
+    for (int i = 0; i < ir_decoder::__NUM_PROTOCOLS__; i++) {
+        if (_pio[i] == nullptr) continue;
+        while (!pio_sm_is_rx_fifo_empty(_pio[i], _sm[i])) {
+            _decoder.feed((ir_decoder::protocol_t) i, pio_sm_get(_pio[i], _sm[i]), now_ms);
+        }
+    }
+}
+
+ir_remote::action_t ir_remote::_find_action(const ir_decoder::key_event_t& event) const
+{
+    for (size_t i = 0; i < _num_entries; i++) {
+        const keymap_entry_t& entry = _keymap[i];
+        if (entry.protocol == event.protocol && entry.address == event.address && entry.command == event.command) {
+            return entry.action;
+        }
+    }
+    return ACT_NONE;
+}
+
+void ir_remote::_execute(const ir_decoder::key_event_t& event, const action_t action)
+{
+    if (event.type == ir_decoder::EVT_PRESS) _held_action = action;
+    if (action == ACT_NONE || action == ACT_USER) return;
+    if (event.type == ir_decoder::EVT_REPEAT) {
+        // keep the mechanism powered while the key is held
+        _ctrl->extend_timeout_power_off();
+        return;
+    } else if (event.type == ir_decoder::EVT_RELEASE) {
+        if (_cue_held) {
+            _send_command(crp42602y_ctrl::PLAY_COMMAND);
+            _cue_held = false;
+        }
+        _held_action = ACT_NONE;
+        return;
+    }
+    // the command is accepted also at the recovery from power off
+    _ctrl->recover_power_from_timeout();
+    bool in_play = _ctrl->is_playing() || _ctrl->is_cueing();
+    switch (action) {
+    case ACT_STOP:
+        _send_command(crp42602y_ctrl::STOP_COMMAND);
+        break;
+    case ACT_PLAY:
+        _send_command(crp42602y_ctrl::PLAY_COMMAND);
+        break;
+    case ACT_PLAY_REVERSE:
+        _send_command(crp42602y_ctrl::PLAY_REVERSE_COMMAND);
+        break;
+    case ACT_PLAY_A:
+        _send_command(crp42602y_ctrl::PLAY_A_COMMAND);
+        break;
+    case ACT_PLAY_B:
+        _send_command(crp42602y_ctrl::PLAY_B_COMMAND);
+        break;
+    case ACT_FF:
+        _send_command(in_play ? crp42602y_ctrl::CUE_FF_COMMAND : crp42602y_ctrl::FF_COMMAND);
+        _cue_held = in_play;
+        break;
+    case ACT_REW:
+        _send_command(in_play ? crp42602y_ctrl::CUE_REW_COMMAND : crp42602y_ctrl::REW_COMMAND);
+        _cue_held = in_play;
+        break;
+    case ACT_STOP_PLAY:
+        if (_ctrl->is_playing() || _ctrl->is_ff_rew_ing()) {
+            _send_command(crp42602y_ctrl::STOP_COMMAND);
+        } else {
+            _send_command(crp42602y_ctrl::PLAY_COMMAND);
+        }
+        break;
+    default:
+        break;
+    }
+    _ctrl->extend_timeout_power_off();
+}
+
+void ir_remote::_send_command(const command_t& command)
+{
+    // the command can be sent also from IRQ by the application (e.g. button edge), thus interrupts are disabled
+    uint32_t status = save_and_disable_interrupts();
+    _ctrl->send_command(command);
+    restore_interrupts(status);
+}
+
+void ir_remote::_alloc_pio_sm(const ir_decoder::protocol_t protocol)
+{
+    // search from PICO_IR_REMOTE_PIO, then the other PIO blocks
+    for (uint i = 0; i < NUM_PIOS; i++) {
+        uint pio_index = (PICO_IR_REMOTE_PIO + i) % NUM_PIOS;
+        PIO pio = pio_get_instance(pio_index);
+        bool loaded = _sm_mask[protocol][pio_index] != 0;
+        if (!loaded && !pio_can_add_program(pio, _programs[protocol])) continue;
+        int sm = pio_claim_unused_sm(pio, false);
+        if (sm < 0) continue;
+        if (!loaded) {
+            _program_offset[protocol][pio_index] = pio_add_program(pio, _programs[protocol]);
+        }
+        _sm_mask[protocol][pio_index] |= 1UL << sm;
+        _pio[protocol] = pio;
+        _sm[protocol] = (uint) sm;
+        return;
+    }
+    panic("All PIO state machines are reserved");
+}
+
+void ir_remote::_free_pio_sm(const ir_decoder::protocol_t protocol)
+{
+    uint pio_index = pio_get_index(_pio[protocol]);
+    _sm_mask[protocol][pio_index] &= ~(1UL << _sm[protocol]);
+    pio_sm_unclaim(_pio[protocol], _sm[protocol]);
+
+    // Remove program if there are no instances left on this PIO
+    if (_sm_mask[protocol][pio_index] == 0) {
+        pio_remove_program(_pio[protocol], _programs[protocol], _program_offset[protocol][pio_index]);
+    }
+    _pio[protocol] = nullptr;
+}
+
+void ir_remote::_init_sm(const ir_decoder::protocol_t protocol)
+{
+    uint offset = _program_offset[protocol][pio_get_index(_pio[protocol])];
+    if (protocol == ir_decoder::PROTOCOL_NEC) {
+        ir_nec_receive_program_init(_pio[protocol], _sm[protocol], offset, _pin);
+    } else {
+        ir_rc5_receive_program_init(_pio[protocol], _sm[protocol], offset, _pin);
+    }
+}
@@ -0,0 +1,134 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#if !defined(PICO_IR_REMOTE_PIO)
+#define PICO_IR_REMOTE_PIO 1  // the other PIO than PICO_CRP42602Y_CTRL_PIO by default
+#endif
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+
+#include "crp42602y_ctrl.h"
+#include "ir_decoder.h"
+
+// IR remote control of crp42602y_ctrl
+//   a PIO state machine per protocol decodes the frames from the IR receiver module on the pin (no CPU per bit),
+//   process() takes one word per frame from RX FIFO in the UI loop and maps the key to the action by the keymap
+//   the programs are loaded to PICO_IR_REMOTE_PIO, or the other PIO if it has no room (e.g. PICO_CRP42602Y_CTRL_PIO set to the same PIO),
+//   the programs are shared by the instances (e.g. two receivers) on the same PIO
+//   FF/REW key held in play or cue cues while held and returns to play at the release (FF/REW from stop keeps winding)
+//   the instance is to be used from the core of the UI loop (not the core running process_loop())
+class ir_remote {
+    public:
+    /**
+     * Definitions
+     */
+    typedef enum _action_t {
+        ACT_NONE = 0,
+        ACT_STOP,
+        ACT_PLAY,
+        ACT_PLAY_REVERSE,
+        ACT_PLAY_A,
+        ACT_PLAY_B,
+        ACT_FF,            // CUE_FF while held in play or cue, FF otherwise
+        ACT_REW,           // CUE_REW while held in play or cue, REW otherwise
+        ACT_STOP_PLAY,     // STOP in play or FF/REW, PLAY otherwise
+        ACT_USER,          // only notified to the callback
+        __NUM_ACTIONS__
+    } action_t;
+    typedef struct _keymap_entry_t {
+        ir_decoder::protocol_t protocol;
+        uint16_t address;
+        uint8_t command;
+        action_t action;
+    } keymap_entry_t;
+    typedef void (*event_callback_t)(const ir_decoder::key_event_t& event, const action_t action);
+
+    // Constants
+    static constexpr uint32_t ALL_PROTOCOLS = (1UL << ir_decoder::__NUM_PROTOCOLS__) - 1;
+
+    /**
+     * ir_remote class constructor
+     *   the pin is pulled up for the open collector output of IR receiver module
+     *
+     * @param[in] ctrl crp42602y_ctrl instance to control
+     * @param[in] pin GPIO Input: IR receiver module output (active low)
+     * @param[in] protocol_mask protocols to receive (1 << ir_decoder::protocol_t), a state machine for each
+     */
+    ir_remote(crp42602y_ctrl* ctrl, const uint pin, const uint32_t protocol_mask = ALL_PROTOCOLS);
+
+    /**
+     * ir_remote class destructor
+     */
+    virtual ~ir_remote();
+
+    /**
+     * set keymap
+     *   the entries are referred, not copied (static table)
+     *
+     * @param[in] keymap array of keymap entries
+     * @param[in] num_entries number of entries
+     */
+    void set_keymap(const keymap_entry_t* keymap, const size_t num_entries);
+
+    /**
+     * register callback of all key events (with the action mapped, ACT_NONE for the key not in the keymap)
+     *   called from process(), e.g. to find the address and the command of a key to add to the keymap
+     *
+     * @param[in] func callback function (nullptr to unregister)
+     */
+    void register_callback(const event_callback_t func);
+
+    /**
+     * take the frames received and execute the actions of the keys
+     *   to be called in every UI loop
+     */
+    void process();
+
+    /**
+     * check if any frame is received and not taken by process() yet
+     *   e.g. to wake up from the sleep waiting for a key
+     *
+     * @return true if received
+     */
+    bool has_frame() const;
+
+    /**
+     * restart the state machines with the clock divider for the current system clock
+     *   to be called after the change of the system clock (the frames already received are kept)
+     */
+    void restart();
+
+    /**
+     * get the statistics of the decoder
+     */
+    const ir_decoder::decoder_stats_t& get_stats() const;
+
+    protected:
+    typedef decltype(crp42602y_ctrl::STOP_COMMAND) command_t;  // command_t itself is not public
+    static uint32_t _sm_mask[ir_decoder::__NUM_PROTOCOLS__][NUM_PIOS];  // state machines used by the instances
+    static uint _program_offset[ir_decoder::__NUM_PROTOCOLS__][NUM_PIOS];
+    crp42602y_ctrl* _ctrl;
+    const uint _pin;
+    PIO _pio[ir_decoder::__NUM_PROTOCOLS__];  // nullptr for the protocol not received
+    uint _sm[ir_decoder::__NUM_PROTOCOLS__];
+    ir_decoder _decoder;
+    const keymap_entry_t* _keymap;
+    size_t _num_entries;
+    event_callback_t _callback;
+    action_t _held_action;  // action of the key held
+    bool _cue_held;         // cue by the key held, to return to play at the release
+
+    action_t _find_action(const ir_decoder::key_event_t& event) const;
+    void _execute(const ir_decoder::key_event_t& event, const action_t action);
+    void _take_frames();
+    void _send_command(const command_t& command);
+    void _alloc_pio_sm(const ir_decoder::protocol_t protocol);
+    void _free_pio_sm(const ir_decoder::protocol_t protocol);
+    void _init_sm(const ir_decoder::protocol_t protocol);
+};
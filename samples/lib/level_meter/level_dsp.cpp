@@ -0,0 +1,207 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include "level_dsp.h"
+
+static constexpr int32_t LOG2_FRAC_BITS = 12;
+static constexpr int32_t LOG2_FULL_SCALE = 15;  // log2(FULL_SCALE)
+static_assert(level_dsp::FULL_SCALE == (1UL << LOG2_FULL_SCALE), "LOG2_FULL_SCALE");
+
+level_dsp::level_dsp(const uint32_t window) :
+    _window(1), _hold_windows(0), _decay_db10(-DB10_MIN), _acc{}, _dc(-1), _level{},
+    _rms_db10(DB10_MIN), _peak_db10(DB10_MIN), _peak_hold_db10(DB10_MIN), _hold_count(0), _num_windows(0)
+{
+    set_window(window);
+}
+
+void level_dsp::set_window(const uint32_t window)
+{
+    _window = (window < 1) ? 1 : (window > MAX_WINDOW) ? MAX_WINDOW : window;
+    _clear_acc();
+}
+
+uint32_t level_dsp::get_window() const
+{
+    return _window;
+}
+
+void level_dsp::set_peak_hold(const uint32_t hold_windows, const int32_t decay_db10)
+{
+    _hold_windows = hold_windows;
+    _decay_db10 = decay_db10;
+}
+
+void level_dsp::reset()
+{
+    _clear_acc();
+    _dc = -1;
+    _level = {};
+    _rms_db10 = DB10_MIN;
+    _peak_db10 = DB10_MIN;
+    _peak_hold_db10 = DB10_MIN;
+    _hold_count = 0;
+    _num_windows = 0;
+}
+
+uint32_t level_dsp::process(const uint16_t* samples, const uint32_t count, const uint32_t stride)
+{
+    uint32_t windows = 0;
+    uint32_t remaining = count;
+    while (remaining > 0) {
+        uint32_t n = _window - _acc.count;
+        if (n > remaining) n = remaining;
+        accumulate(_acc, samples, n, stride);
+        samples += n * stride;
+        remaining -= n;
+        if (_acc.count == _window) {
+            _finish_window();
+            windows++;
+        }
+    }
+    return windows;
+}
+
+const level_dsp::level_t& level_dsp::get_level() const
+{
+    return _level;
+}
+
+int32_t level_dsp::get_rms_db10() const
+{
+    return _rms_db10;
+}
+
+int32_t level_dsp::get_peak_db10() const
+{
+    return _peak_db10;
+}
+
+int32_t level_dsp::get_peak_hold_db10() const
+{
+    return _peak_hold_db10;
+}
+
+uint32_t level_dsp::get_dc() const
+{
+    return (_dc < 0) ? 0 : (uint32_t) _dc;
+}
+
+uint32_t level_dsp::get_num_windows() const
+{
+    return _num_windows;
+}
+
+void level_dsp::accumulate(accum_t& acc, const uint16_t* samples, const uint32_t count, const uint32_t stride)
+{
+    uint32_t sum = acc.sum;
+    uint64_t sum_sq = acc.sum_sq;
+    uint32_t min = acc.min;
+    uint32_t max = acc.max;
+    uint32_t remaining = count;
+    while (remaining > 0) {
+        uint32_t n = (remaining < SQ_CHUNK) ? remaining : SQ_CHUNK;
+        remaining -= n;
+        // the squares are summed in 32 bits within a chunk, then carried to 64 bits
+        uint32_t chunk_sq = 0;
+        for (; n > 0; n--) {
+            uint32_t x = *samples;
+            samples += stride;
+            sum += x;
+            chunk_sq += x * x;
+            if (x < min) min = x;
+            if (x > max) max = x;
+        }
+        sum_sq += chunk_sq;
+    }
+    acc.count += count;
+    acc.sum = sum;
+    acc.sum_sq = sum_sq;
+    acc.min = (uint16_t) min;
+    acc.max = (uint16_t) max;
+}
+
+int32_t level_dsp::to_db10(const uint32_t amplitude)
+{
+    if (amplitude == 0) return DB10_MIN;
+    // log2 in Q12: the integer part by the leading bit, the fraction by repeated squaring of the mantissa in Q30
+    int32_t n = 31 - __builtin_clz(amplitude);
+    uint64_t m = (n <= 30) ? ((uint64_t) amplitude << (30 - n)) : ((uint64_t) amplitude >> (n - 30));
+    int32_t log2 = n << LOG2_FRAC_BITS;
+    for (int32_t bit = LOG2_FRAC_BITS - 1; bit >= 0; bit--) {
+        m = (m * m) >> 30;
+        if (m >= (2ULL << 30)) {
+            m >>= 1;
+            log2 |= 1 << bit;
+        }
+    }
+    // 200 * log10(2) = 60.206 (0.1 dB per bit), rounded to nearest
+    int64_t num = (int64_t) (log2 - (LOG2_FULL_SCALE << LOG2_FRAC_BITS)) * 60206;
+    constexpr int64_t den = (1LL << LOG2_FRAC_BITS) * 1000;
+    int32_t db10 = (int32_t) ((num >= 0) ? (num + den / 2) / den : (num - den / 2) / den);
+    return (db10 < DB10_MIN) ? DB10_MIN : db10;
+}
+
+uint32_t level_dsp::isqrt(uint64_t value)
+{
+    uint64_t result = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > value) bit >>= 2;
+    while (bit != 0) {
+        if (value >= result + bit) {
+            value -= result + bit;
+            result = (result >> 1) + bit;
+        } else {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t) result;
+}
+
+void level_dsp::_clear_acc()
+{
+    _acc.count = 0;
+    _acc.sum = 0;
+    _acc.sum_sq = 0;
+    _acc.min = 0xffff;
+    _acc.max = 0;
+}
+
+void level_dsp::_finish_window()
+{
+    const int64_t n = _acc.count;
+    // mean of the window (Q4), the DC level starts from the mean of the first window
+    int32_t mean = (int32_t) ((((int64_t) _acc.sum << FRAC_BITS) + n / 2) / n);
+    if (_dc < 0) _dc = mean;
+    const int64_t dc = _dc;
+
+    // sum of (16x - dc)^2 = 256 * sum(x^2) - 32 * dc * sum(x) + n * dc^2 (exact in 64 bits up to MAX_WINDOW)
+    int64_t sq = ((int64_t) _acc.sum_sq << (2 * FRAC_BITS)) - ((dc * _acc.sum) << (FRAC_BITS + 1)) + n * dc * dc;
+    uint32_t rms = isqrt((sq > 0) ? (uint64_t) sq / (uint64_t) n : 0);
+    int32_t high = ((int32_t) _acc.max << FRAC_BITS) - _dc;
+    int32_t low = _dc - ((int32_t) _acc.min << FRAC_BITS);
+    int32_t peak = (high > low) ? high : low;
+    if (peak < 0) peak = 0;
+    _level.rms = (uint16_t) ((rms > 0xffff) ? 0xffff : rms);
+    _level.peak = (uint16_t) ((peak > 0xffff) ? 0xffff : peak);
+
+    // the DC level follows the mean of the windows (low cut below 1 Hz for windows of tens of ms)
+    _dc += (mean - _dc) / (1 << DC_SHIFT);
+
+    _rms_db10 = to_db10(_level.rms);
+    _peak_db10 = to_db10(_level.peak);
+    if (_peak_db10 >= _peak_hold_db10) {
+        _peak_hold_db10 = _peak_db10;
+        _hold_count = _hold_windows;
+    } else if (_hold_count > 0) {
+        _hold_count--;
+    } else {
+        _peak_hold_db10 -= _decay_db10;
+        if (_peak_hold_db10 < _peak_db10) _peak_hold_db10 = _peak_db10;
+    }
+    _num_windows++;
+    _clear_acc();
+}
@@ -0,0 +1,160 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Peak and RMS of a channel of 12-bit ADC samples in fixed point over windows
+//   the per-sample kernel only accumulates the sum, the sum of squares, min and max (no multiplication by 64 bits),
+//   the DC level (bias of the input) is removed per window from the sums by the level tracked over the windows,
+//   thus the signal lower than the window (e.g. 20 Hz in 50 ms) is measured as well
+//   levels are in 1/16 of ADC count (Q4) from the DC level, and in 0.1 dB (0 dB at the amplitude of full scale)
+//   this file has no dependency on pico-sdk to be tested on host with synthetic signals
+class level_dsp {
+    public:
+    /**
+     * Definitions
+     */
+    typedef struct _level_t {
+        uint16_t peak;  // max of |x - DC| (Q4)
+        uint16_t rms;   // sqrt of mean of (x - DC)^2 (Q4)
+    } level_t;
+    typedef struct _accum_t {
+        uint32_t count;
+        uint32_t sum;
+        uint64_t sum_sq;
+        uint16_t min;
+        uint16_t max;
+    } accum_t;
+
+    // Constants
+    static constexpr uint32_t ADC_BITS = 12;
+    static constexpr uint32_t FRAC_BITS = 4;
+    static constexpr uint32_t FULL_SCALE = (1UL << (ADC_BITS - 1)) << FRAC_BITS;  // amplitude of 0 dB (Q4)
+    static constexpr int32_t DB10_MIN = -900;     // floor of the levels in 0.1 dB (also for 0)
+    static constexpr uint32_t MAX_WINDOW = 65535;  // samples (the sums fit in 32 bits)
+    static constexpr uint32_t DC_SHIFT = 3;        // DC level follows the mean of windows by 1/8 per window
+    static constexpr uint32_t SQ_CHUNK = 256;      // samples per 32-bit sum of squares (256 * 4095^2 < 2^32)
+
+    /**
+     * level_dsp class constructor
+     *
+     * @param[in] window samples per window (1 ~ MAX_WINDOW)
+     */
+    level_dsp(const uint32_t window = 1024);
+
+    /**
+     * level_dsp class destructor
+     */
+    virtual ~level_dsp() {}
+
+    /**
+     * set samples per window (the window in progress is restarted)
+     *
+     * @param[in] window samples per window (1 ~ MAX_WINDOW)
+     */
+    void set_window(const uint32_t window);
+
+    /**
+     * get samples per window
+     */
+    uint32_t get_window() const;
+
+    /**
+     * set peak hold
+     *   the peak is held for hold_windows, then falls by decay_db10 per window
+     *
+     * @param[in] hold_windows windows to hold the peak
+     * @param[in] decay_db10 fall per window after the hold (0.1 dB)
+     */
+    void set_peak_hold(const uint32_t hold_windows, const int32_t decay_db10);
+
+    /**
+     * reset the levels, the DC level and the window in progress
+     */
+    void reset();
+
+    /**
+     * process samples of the channel
+     *
+     * @param[in] samples first sample of the channel (12 bits)
+     * @param[in] count number of samples of the channel
+     * @param[in] stride distance between the samples (number of interleaved channels)
+     * @return number of windows completed
+     */
+    uint32_t process(const uint16_t* samples, const uint32_t count, const uint32_t stride = 1);
+
+    /**
+     * get the levels of the last window completed
+     */
+    const level_t& get_level() const;
+
+    /**
+     * get the levels of the last window completed in 0.1 dB (DB10_MIN or more, 0 dB at full scale)
+     */
+    int32_t get_rms_db10() const;
+    int32_t get_peak_db10() const;
+
+    /**
+     * get the peak held in 0.1 dB (DB10_MIN or more)
+     */
+    int32_t get_peak_hold_db10() const;
+
+    /**
+     * get the DC level tracked (Q4)
+     */
+    uint32_t get_dc() const;
+
+    /**
+     * get number of windows completed since reset()
+     */
+    uint32_t get_num_windows() const;
+
+    /**
+     * accumulate samples (kernel of process())
+     *   acc.count + count must be MAX_WINDOW or less
+     *
+     * @param[in,out] acc accumulation of the window
+     * @param[in] samples first sample
+     * @param[in] count number of samples
+     * @param[in] stride distance between the samples
+     */
+    static void accumulate(accum_t& acc, const uint16_t* samples, const uint32_t count, const uint32_t stride);
+
+    /**
+     * convert amplitude to 0.1 dB
+     *
+     * @param[in] amplitude amplitude (Q4)
+     * @return 200 * log10(amplitude / FULL_SCALE) (DB10_MIN for 0 or smaller)
+     */
+    static int32_t to_db10(const uint32_t amplitude);
+
+    /**
+     * integer square root
+     *
+     * @param[in] value value
+     * @return floor(sqrt(value))
+     */
+    static uint32_t isqrt(uint64_t value);
+
+    protected:
+    uint32_t _window;
+    uint32_t _hold_windows;
+    int32_t _decay_db10;
+    accum_t _acc;
+    int32_t _dc;       // Q4, -1 until the first window
+    level_t _level;
+    int32_t _rms_db10;
+    int32_t _peak_db10;
+    int32_t _peak_hold_db10;
+    uint32_t _hold_count;
+    uint32_t _num_windows;
+
+    void _clear_acc();
+    void _finish_window();
+};
@@ -0,0 +1,166 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include "level_meter.h"
+
+#include "hardware/adc.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/sync.h"
+
+static constexpr uint32_t TRANSFER_COUNT = 0xffffffff;  // 24 hours at 2 x 24 kHz, then restarted by process()
+static constexpr uint32_t RING_MARGIN = level_meter::RING_SIZE / 8;  // the samples being overwritten while taken
+
+// the DMA wraps the write address at the size of the ring buffer, thus it must be aligned by the size
+uint16_t level_meter::_ring[RING_SIZE] __attribute__((aligned(level_meter::RING_SIZE * sizeof(uint16_t))));
+
+level_meter::level_meter(const uint32_t input_mask, const uint32_t sample_rate, const uint32_t window_ms) :
+    _input_mask(0), _num_channels(0), _sample_rate(sample_rate), _dsp{}, _dma_chan(-1), _running(false),
+    _read_count(0), _last_us(0), _stats{}
+{
+    adc_init();
+    for (uint i = 0; i < NUM_ADC_INPUTS && _num_channels < MAX_CHANNELS; i++) {
+        if (!(input_mask & (1UL << i))) continue;
+        adc_gpio_init(ADC_BASE_PIN + i);
+        _input_mask |= 1UL << i;
+        _num_channels++;
+    }
+    if (_num_channels == 0) {
+        panic("No ADC input for level_meter");
+    }
+    if (_sample_rate * _num_channels > MAX_SAMPLE_RATE) {
+        _sample_rate = MAX_SAMPLE_RATE / _num_channels;
+    }
+    set_window_ms(window_ms);
+    _dma_chan = dma_claim_unused_channel(true);
+    start();
+}
+
+level_meter::~level_meter()
+{
+    stop();
+    dma_channel_unclaim(_dma_chan);
+}
+
+void level_meter::start()
+{
+    if (_running) return;
+    adc_run(false);
+    adc_fifo_drain();
+    // the conversions start from the lowest input, thus the channels are interleaved in order from the head of the ring buffer
+    adc_select_input(__builtin_ctz(_input_mask));
+    adc_set_round_robin((_num_channels > 1) ? _input_mask : 0);
+    adc_fifo_setup(true, true, 1, false, false);  // FIFO with DREQ, 12 bits without error flag
+    adc_set_clkdiv((float) clock_get_hz(clk_adc) / (float) (_sample_rate * _num_channels) - 1.0f);  // (1 + div) cycles per sample
+
+    dma_channel_config config = dma_channel_get_default_config(_dma_chan);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, false);
+    channel_config_set_write_increment(&config, true);
+    channel_config_set_ring(&config, true, PICO_LEVEL_METER_RING_BITS);
+    channel_config_set_dreq(&config, DREQ_ADC);
+    dma_channel_configure(_dma_chan, &config, _ring, &adc_hw->fifo, TRANSFER_COUNT, true);
+
+    for (uint ch = 0; ch < _num_channels; ch++) {
+        _dsp[ch].reset();
+    }
+    _read_count = 0;
+    _last_us = time_us_64();
+    _running = true;
+    adc_run(true);
+}
+
+void level_meter::stop()
+{
+    if (!_running) return;
+    adc_run(false);
+    dma_channel_abort(_dma_chan);
+    adc_fifo_drain();
+    adc_set_round_robin(0);
+    _running = false;
+}
+
+bool level_meter::is_running() const
+{
+    return _running;
+}
+
+void level_meter::set_window_ms(const uint32_t window_ms)
+{
+    const uint32_t ms = (window_ms < 1) ? 1 : window_ms;
+    const uint32_t window = (uint32_t) ((uint64_t) _sample_rate * ms / 1000);
+    const int32_t decay_db10 = PEAK_DECAY_DB10_PER_SEC * (int32_t) ms / 1000;
+    for (uint ch = 0; ch < MAX_CHANNELS; ch++) {
+        _dsp[ch].set_window(window);
+        _dsp[ch].set_peak_hold(PEAK_HOLD_MS / ms, (decay_db10 < 1) ? 1 : decay_db10);
+    }
+}
+
+uint32_t level_meter::process()
+{
+    if (!_running) return 0;
+    const uint32_t start_us = time_us_32();
+    const uint32_t written = _written_count();
+    __mem_fence_acquire();  // the samples up to written are in the ring buffer
+    uint32_t available = written - _read_count;
+    if (available > RING_SIZE - RING_MARGIN) {
+        // overwritten before taken: skip to the half of the ring buffer behind the DMA
+        uint32_t skip = available - RING_SIZE / 2;
+        skip += (_num_channels - skip % _num_channels) % _num_channels;
+        _read_count += skip;
+        available -= skip;
+        _stats.overruns++;
+    }
+    available -= available % _num_channels;
+
+    uint32_t windows = 0;
+    while (available > 0) {
+        // RING_SIZE is a multiple of the channels, thus the head of each part is always of channel 0
+        const uint32_t index = _read_count % RING_SIZE;
+        const uint32_t n = (available < RING_SIZE - index) ? available : RING_SIZE - index;
+        for (uint ch = 0; ch < _num_channels; ch++) {
+            windows += _dsp[ch].process(&_ring[index + ch], n / _num_channels, _num_channels);
+        }
+        _read_count += n;
+        available -= n;
+        _stats.samples += n;
+    }
+    _stats.windows += windows;
+
+    if (!dma_channel_is_busy(_dma_chan)) {
+        // the end of the transfer count
+        stop();
+        start();
+        _stats.restarts++;
+    }
+    const uint32_t busy_us = time_us_32() - start_us;
+    _stats.busy_us += busy_us;
+    if (busy_us > _stats.max_busy_us) _stats.max_busy_us = busy_us;
+    const uint64_t now_us = time_us_64();
+    _stats.elapsed_us += now_us - _last_us;
+    _last_us = now_us;
+    return windows;
+}
+
+uint level_meter::get_num_channels() const
+{
+    return _num_channels;
+}
+
+const level_dsp& level_meter::get_dsp(const uint ch) const
+{
+    return _dsp[(ch < _num_channels) ? ch : 0];
+}
+
+const level_meter::meter_stats_t& level_meter::get_stats() const
+{
+    return _stats;
+}
+
+uint32_t level_meter::_written_count() const
+{
+    return TRANSFER_COUNT - dma_channel_hw_addr(_dma_chan)->transfer_count;
+}
@@ -0,0 +1,125 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#if !defined(PICO_LEVEL_METER_RING_BITS)
+#define PICO_LEVEL_METER_RING_BITS 13  // ring buffer of 8 KB (4096 samples, 85 ms at 2 x 24 kHz)
+#endif
+
+#include "pico/stdlib.h"
+
+#include "level_dsp.h"
+
+// Audio level meter of the line output on the ADC inputs
+//   the ADC runs free in round robin of the inputs, a DMA channel writes the samples into the ring buffer
+//   without end (no CPU per sample), process() takes the samples written since the last call in the UI loop
+//   and level_dsp measures the peak and RMS of each channel in fixed point over the windows
+//   the ring buffer covers the UI loops of tens of ms, the samples overwritten before taken are skipped (overrun)
+//   only one instance (the ADC and the ring buffer are shared), to be used from the core of the UI loop
+class level_meter {
+    public:
+    /**
+     * Definitions
+     */
+    typedef struct _meter_stats_t {
+        uint64_t samples;     // samples taken (all channels)
+        uint32_t windows;     // windows completed (all channels)
+        uint32_t overruns;    // the samples skipped since the ring buffer was overwritten
+        uint32_t restarts;    // DMA restarted at the end of the transfer count
+        uint64_t busy_us;     // time in process()
+        uint32_t max_busy_us; // longest process()
+        uint64_t elapsed_us;  // time sampling until the last process()
+    } meter_stats_t;
+
+    // Constants
+    static constexpr uint MAX_CHANNELS = 2;
+    static constexpr uint NUM_ADC_INPUTS = 4;  // ADC0 ~ ADC3 (GP26 ~ GP29)
+    static constexpr uint ADC_BASE_PIN = 26;
+    static constexpr uint32_t MAX_SAMPLE_RATE = 500000;  // all channels
+    static constexpr uint32_t RING_SIZE = (1UL << PICO_LEVEL_METER_RING_BITS) / sizeof(uint16_t);  // samples
+    static constexpr uint32_t PEAK_HOLD_MS = 1000;
+    static constexpr int32_t PEAK_DECAY_DB10_PER_SEC = 200;
+
+    /**
+     * level_meter class constructor
+     *   the ADC and the DMA start sampling
+     *
+     * @param[in] input_mask ADC inputs (1 << input), MAX_CHANNELS of the lowest inputs are used (channel 0, 1 in order)
+     * @param[in] sample_rate samples per second per channel
+     * @param[in] window_ms window of the levels in ms
+     */
+    level_meter(const uint32_t input_mask, const uint32_t sample_rate = 24000, const uint32_t window_ms = 50);
+
+    /**
+     * level_meter class destructor
+     */
+    virtual ~level_meter();
+
+    /**
+     * start sampling (the levels and the DC levels are reset)
+     *   e.g. after clk_adc is restarted
+     */
+    void start();
+
+    /**
+     * stop sampling
+     *   to be called before clk_adc is stopped
+     */
+    void stop();
+
+    /**
+     * check if sampling
+     */
+    bool is_running() const;
+
+    /**
+     * set window of the levels (the peak hold and the decay are set for the window)
+     *
+     * @param[in] window_ms window in ms
+     */
+    void set_window_ms(const uint32_t window_ms);
+
+    /**
+     * take the samples written since the last call and measure the levels
+     *   to be called in every UI loop (within the time of the ring buffer)
+     *
+     * @return number of windows completed (all channels)
+     */
+    uint32_t process();
+
+    /**
+     * get number of channels
+     */
+    uint get_num_channels() const;
+
+    /**
+     * get the levels of the channel
+     *
+     * @param[in] ch channel
+     * @return level_dsp of the channel (channel 0 for out of range)
+     */
+    const level_dsp& get_dsp(const uint ch) const;
+
+    /**
+     * get the statistics
+     */
+    const meter_stats_t& get_stats() const;
+
+    protected:
+    static uint16_t _ring[RING_SIZE];
+    uint32_t _input_mask;  // inputs used
+    uint _num_channels;
+    uint32_t _sample_rate;
+    level_dsp _dsp[MAX_CHANNELS];
+    int _dma_chan;
+    bool _running;
+    uint32_t _read_count;  // samples taken since start()
+    uint64_t _last_us;     // time of start() or the last process()
+    meter_stats_t _stats;
+
+    uint32_t _written_count() const;
+};
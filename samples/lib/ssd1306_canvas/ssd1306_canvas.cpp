@@ -0,0 +1,309 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include "ssd1306_canvas.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "hardware/dma.h"
+#include "hardware/i2c.h"
+
+// SSD1306 control bytes (the commands are ssd1306_command_t of ssd1306 library)
+static constexpr uint8_t CTRL_COMMANDS = 0x00;
+static constexpr uint8_t CTRL_DATA     = 0x40;
+static constexpr uint32_t NUM_SHOW_COMMANDS = 6;  // ssd1306_show() sends each command in a transaction of 2 bytes
+
+ssd1306_canvas::ssd1306_canvas(ssd1306_t* disp, const bool use_dma) :
+    _disp(disp),
+    _sent{},
+    _invalid(true),
+    _full_refresh(false),
+    _use_dma(use_dma),
+    _dma_chan(-1),
+    _pending(false),
+    _tx{},
+    _tx_len(0),
+    _stats{}
+{
+    _clear_marks();
+}
+
+ssd1306_canvas::~ssd1306_canvas()
+{
+    if (_dma_chan >= 0) {
+        wait_idle();
+        dma_channel_unclaim(_dma_chan);
+    }
+}
+
+void ssd1306_canvas::clear()
+{
+    ssd1306_clear(_disp);
+    _mark(0, 0, _disp->width, _disp->height);
+}
+
+void ssd1306_canvas::clear_square(const uint32_t x, const uint32_t y, const uint32_t width, const uint32_t height)
+{
+    uint32_t x1 = std::min(x + width, (uint32_t) _disp->width);
+    uint32_t y1 = std::min(y + height, (uint32_t) _disp->height);
+    if (x >= x1 || y >= y1) return;
+    // clear by bytes of the pages with the mask of the rows
+    for (uint32_t page = y / 8; page <= (y1 - 1) / 8; page++) {
+        uint32_t top = std::max(y, page * 8) - page * 8;
+        uint32_t bottom = std::min(y1, page * 8 + 8) - page * 8;
+        uint8_t mask = (uint8_t) (((1U << bottom) - 1) & ~((1U << top) - 1));
+        uint8_t* buf = &_disp->buffer[page * _disp->width];
+        for (uint32_t ix = x; ix < x1; ix++) {
+            buf[ix] &= ~mask;
+        }
+    }
+    _mark(x, y, width, height);
+}
+
+void ssd1306_canvas::draw_line(const int32_t x1, const int32_t y1, const int32_t x2, const int32_t y2)
+{
+    ssd1306_draw_line(_disp, x1, y1, x2, y2);
+    _mark(std::min(x1, x2), std::min(y1, y2), std::abs(x2 - x1) + 1, std::abs(y2 - y1) + 1);
+}
+
+void ssd1306_canvas::draw_string(const uint32_t x, const uint32_t y, const uint32_t scale, const char* s)
+{
+    ssd1306_draw_string(_disp, x, y, scale, s);
+    _mark(x, y, strlen(s) * CHAR_WIDTH * scale, CHAR_HEIGHT * scale);
+}
+
+void ssd1306_canvas::draw_char_with_font(const uint32_t x, const uint32_t y, const uint32_t scale, const uint8_t* font, const char c)
+{
+    // font format: <height>, <width>, <additional spacing per char>, <first ascii char>, <last ascii char>, <data>
+    ssd1306_draw_char_with_font(_disp, x, y, scale, font, c);
+    _mark(x, y, font[1] * scale, font[0] * scale);
+}
+
+void ssd1306_canvas::invalidate()
+{
+    _invalid = true;
+}
+
+void ssd1306_canvas::set_full_refresh(const bool flag)
+{
+    _full_refresh = flag;
+}
+
+bool ssd1306_canvas::get_full_refresh() const
+{
+    return _full_refresh;
+}
+
+uint32_t ssd1306_canvas::show()
+{
+    uint64_t start_us = time_us_64();
+    if (is_busy()) {
+        // the changes are kept by the marks and the back buffer
+        _pending = true;
+        _stats.busy++;
+        return 0;
+    }
+    _pending = false;
+    if (_use_dma && _dma_chan < 0) {
+        // claimed here since the constructor could run before the DMA channels are available (static instance)
+        _dma_chan = dma_claim_unused_channel(false);
+        _use_dma = _dma_chan >= 0;
+    }
+    uint32_t num_pages = std::min((uint32_t) _disp->pages, MAX_PAGES);
+    uint32_t width = std::min((uint32_t) _disp->width, MAX_WIDTH);
+    uint32_t bytes = 0;
+    if (_full_refresh) {
+        ssd1306_show(_disp);  // blocking write as the reference
+        bytes = NUM_SHOW_COMMANDS * 3 + 2 + _disp->bufsize;
+        for (uint32_t page = 0; page < num_pages; page++) {
+            memcpy(&_sent[page * MAX_WIDTH], &_disp->buffer[page * _disp->width], width);
+        }
+    } else {
+        _tx_len = 0;
+        for (uint32_t page = 0; page < num_pages; page++) {
+            uint32_t x0 = _invalid ? 0 : _dirty_x0[page];
+            uint32_t x1 = _invalid ? width - 1 : _dirty_x1[page];
+            if (x0 > x1) continue;
+            if (!_invalid) {
+                // narrow the marked columns to the changed ones
+                const uint8_t* buf = &_disp->buffer[page * _disp->width];
+                const uint8_t* sent = &_sent[page * MAX_WIDTH];
+                while (x0 <= x1 && buf[x0] == sent[x0]) x0++;
+                while (x1 > x0 && buf[x1] == sent[x1]) x1--;
+                if (x0 > x1) continue;
+            }
+            bytes += _use_dma ? _queue_window(page, x0, x1) : _send_window(page, x0, x1);
+        }
+        if (_tx_len > 0) _start_transfer();
+    }
+    _invalid = false;
+    _clear_marks();
+    uint32_t time_us = (uint32_t) (time_us_64() - start_us);
+    _stats.shows++;
+    if (bytes > 0) _stats.frames++;
+    _stats.bytes += bytes;
+    _stats.time_us += time_us;
+    if (time_us > _stats.max_time_us) _stats.max_time_us = time_us;
+    return bytes;
+}
+
+bool ssd1306_canvas::is_busy()
+{
+    if (_dma_chan < 0) return false;
+    if (dma_channel_is_busy(_dma_chan)) return true;
+    // the tail of the transfer is still in TX FIFO of I2C after DMA completes
+    const i2c_hw_t* hw = i2c_get_hw(_disp->i2c_i);
+    if (!(hw->status & I2C_IC_STATUS_TFE_BITS) || (hw->status & I2C_IC_STATUS_MST_ACTIVITY_BITS)) return true;
+    _check_abort();
+    return false;
+}
+
+bool ssd1306_canvas::is_pending() const
+{
+    return _pending;
+}
+
+void ssd1306_canvas::wait_idle()
+{
+    while (is_busy()) {
+        tight_loop_contents();
+    }
+}
+
+void ssd1306_canvas::get_stats(stats_t& stats) const
+{
+    stats = _stats;
+}
+
+void ssd1306_canvas::reset_stats()
+{
+    _stats = {};
+}
+
+void ssd1306_canvas::_mark(const int32_t x, const int32_t y, const int32_t width, const int32_t height)
+{
+    int32_t x0 = std::max(x, (int32_t) 0);
+    int32_t y0 = std::max(y, (int32_t) 0);
+    int32_t x1 = std::min(x + width - 1, (int32_t) std::min((uint32_t) _disp->width, MAX_WIDTH) - 1);
+    int32_t y1 = std::min(y + height - 1, (int32_t) std::min((uint32_t) _disp->pages, MAX_PAGES) * 8 - 1);
+    if (x0 > x1 || y0 > y1) return;
+    for (int32_t page = y0 / 8; page <= y1 / 8; page++) {
+        if (x0 < _dirty_x0[page]) _dirty_x0[page] = x0;
+        if (x1 > _dirty_x1[page]) _dirty_x1[page] = x1;
+    }
+}
+
+void ssd1306_canvas::_clear_marks()
+{
+    for (uint32_t page = 0; page < MAX_PAGES; page++) {
+        _dirty_x0[page] = MAX_WIDTH - 1;
+        _dirty_x1[page] = 0;
+    }
+}
+
+void ssd1306_canvas::_blit(const int32_t x, const int32_t y, const uint8_t* data, const uint32_t width, const uint32_t height)
+{
+    // rows of the sprite are shifted by (y & 7) across two pages of the framebuffer
+    int32_t shift = y & 7;
+    int32_t top_page = (y - shift) / 8;
+    int32_t disp_pages = _disp->height / 8;
+    int32_t ix0 = std::max(x, (int32_t) 0);
+    int32_t ix1 = std::min(x + (int32_t) width, (int32_t) _disp->width);
+    for (int32_t sp = 0; sp < (int32_t) (height + 7) / 8; sp++) {
+        int32_t page = top_page + sp;
+        const uint8_t* src = &data[sp * width];
+        uint8_t* buf0 = (page >= 0 && page < disp_pages) ? &_disp->buffer[page * _disp->width] : nullptr;
+        uint8_t* buf1 = (page + 1 >= 0 && page + 1 < disp_pages && shift > 0) ? &_disp->buffer[(page + 1) * _disp->width] : nullptr;
+        for (int32_t ix = ix0; ix < ix1; ix++) {
+            uint32_t bits = (uint32_t) src[ix - x] << shift;
+            if (buf0 != nullptr) buf0[ix] |= (uint8_t) bits;
+            if (buf1 != nullptr) buf1[ix] |= (uint8_t) (bits >> 8);
+        }
+    }
+    _mark(x, y, width, height);
+}
+
+uint32_t ssd1306_canvas::_send_commands(const uint8_t* commands, const size_t len)
+{
+    uint8_t buf[1 + NUM_WINDOW_COMMANDS];
+    buf[0] = CTRL_COMMANDS;  // commands follow in the same transaction
+    memcpy(&buf[1], commands, len);
+    i2c_write_blocking(_disp->i2c_i, _disp->address, buf, len + 1, false);
+    return 1 + len + 1;  // address, control and commands
+}
+
+uint32_t ssd1306_canvas::_send_window(const uint32_t page, const uint32_t x0, const uint32_t x1)
+{
+    uint8_t col_ofs = (_disp->width == 64) ? 32 : 0;  // the same as ssd1306_show()
+    const uint8_t commands[NUM_WINDOW_COMMANDS] = {
+        SET_COL_ADDR, (uint8_t) (x0 + col_ofs), (uint8_t) (x1 + col_ofs),
+        SET_PAGE_ADDR, (uint8_t) page, (uint8_t) page
+    };
+    uint32_t bytes = _send_commands(commands, sizeof(commands));
+
+    // the byte before the data is borrowed for the control byte as ssd1306_show() does (buffer[-1] is reserved by ssd1306 library)
+    uint8_t* data = &_disp->buffer[page * _disp->width + x0];
+    uint32_t len = x1 - x0 + 1;
+    uint8_t saved = *(data - 1);
+    *(data - 1) = CTRL_DATA;
+    i2c_write_blocking(_disp->i2c_i, _disp->address, data - 1, len + 1, false);
+    *(data - 1) = saved;
+    memcpy(&_sent[page * MAX_WIDTH + x0], data, len);
+    return bytes + 1 + 1 + len;  // address, control and data
+}
+
+uint32_t ssd1306_canvas::_queue_transaction(const uint8_t control, const uint8_t* bytes, const uint32_t len)
+{
+    // each word is written to IC_DATA_CMD, STOP at the last byte ends the transaction (the next byte starts a new one)
+    _tx[_tx_len++] = control;
+    for (uint32_t i = 0; i < len; i++) {
+        _tx[_tx_len++] = bytes[i];
+    }
+    _tx[_tx_len - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+    return 1 + 1 + len;  // address, control and bytes
+}
+
+uint32_t ssd1306_canvas::_queue_window(const uint32_t page, const uint32_t x0, const uint32_t x1)
+{
+    uint8_t col_ofs = (_disp->width == 64) ? 32 : 0;  // the same as ssd1306_show()
+    const uint8_t commands[NUM_WINDOW_COMMANDS] = {
+        SET_COL_ADDR, (uint8_t) (x0 + col_ofs), (uint8_t) (x1 + col_ofs),
+        SET_PAGE_ADDR, (uint8_t) page, (uint8_t) page
+    };
+    uint32_t bytes = _queue_transaction(CTRL_COMMANDS, commands, sizeof(commands));
+    const uint8_t* data = &_disp->buffer[page * _disp->width + x0];
+    uint32_t len = x1 - x0 + 1;
+    bytes += _queue_transaction(CTRL_DATA, data, len);
+    memcpy(&_sent[page * MAX_WIDTH + x0], data, len);
+    return bytes;
+}
+
+void ssd1306_canvas::_start_transfer()
+{
+    // the target address can be changed only while I2C is disabled (the bus is idle here)
+    i2c_hw_t* hw = i2c_get_hw(_disp->i2c_i);
+    hw->enable = 0;
+    hw->tar = _disp->address;
+    hw->enable = 1;
+
+    dma_channel_config config = dma_channel_get_default_config(_dma_chan);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, i2c_get_dreq(_disp->i2c_i, true));
+    dma_channel_configure(_dma_chan, &config, &hw->data_cmd, _tx, _tx_len, true);
+}
+
+void ssd1306_canvas::_check_abort()
+{
+    i2c_hw_t* hw = i2c_get_hw(_disp->i2c_i);
+    if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+        (void) hw->clr_tx_abrt;
+        _stats.aborts++;
+        invalidate();  // the contents of the display are unknown
+    }
+}
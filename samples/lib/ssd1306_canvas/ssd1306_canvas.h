@@ -0,0 +1,152 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico/stdlib.h"
+extern "C" {
+#include "ssd1306.h"
+}
+#include "ssd1306_sprite.h"
+
+// Drawing layer of ssd1306 with dirty tracking
+//   each draw call marks the columns of the pages it touches,
+//   show() compares the marked columns with the contents sent last time and transmits only the changed column range of each page
+//   the framebuffer of ssd1306 is the back buffer to draw, the changes are copied to the transmit buffer
+//   and transmitted by DMA to I2C, thus show() doesn't wait for the bus
+class ssd1306_canvas {
+    public:
+    /**
+     * Definitions
+     */
+    typedef struct _stats_t {
+        uint32_t shows;        // number of show()
+        uint32_t frames;       // number of show() which transmitted something
+        uint64_t bytes;        // bytes on I2C bus including address bytes
+        uint64_t time_us;      // time spent in show()
+        uint32_t max_time_us;
+        uint32_t busy;         // number of show() deferred by the transfer in progress
+        uint32_t aborts;       // number of transfers aborted (e.g. NACK)
+    } stats_t;
+
+    // Constants
+    static constexpr uint32_t MAX_WIDTH = 128;
+    static constexpr uint32_t MAX_PAGES = 8;
+    static constexpr uint32_t CHAR_WIDTH = 6;   // width of default font including spacing
+    static constexpr uint32_t CHAR_HEIGHT = 8;
+    static constexpr uint32_t NUM_WINDOW_COMMANDS = 6;  // column and page address
+    static constexpr uint32_t MAX_TX_WORDS = MAX_PAGES * (1 + NUM_WINDOW_COMMANDS + 1 + MAX_WIDTH);
+
+    /**
+     * ssd1306_canvas class constructor
+     *   a DMA channel is claimed at the first show() (blocking I2C write if no channel is available)
+     *
+     * @param[in] disp ssd1306 instance (the contents of the display are sent entirely at the first show())
+     * @param[in] use_dma true to transmit by DMA
+     */
+    ssd1306_canvas(ssd1306_t* disp, const bool use_dma = true);
+
+    /**
+     * ssd1306_canvas class destructor
+     */
+    virtual ~ssd1306_canvas();
+
+    /**
+     * drawing functions (the same arguments as ssd1306 library except for the instance)
+     */
+    void clear();
+    void clear_square(const uint32_t x, const uint32_t y, const uint32_t width, const uint32_t height);
+    void draw_line(const int32_t x1, const int32_t y1, const int32_t x2, const int32_t y2);
+    void draw_string(const uint32_t x, const uint32_t y, const uint32_t scale, const char* s);
+    void draw_char_with_font(const uint32_t x, const uint32_t y, const uint32_t scale, const uint8_t* font, const char c);
+
+    /**
+     * draw pre-rendered sprite (OR by bytes of the pages)
+     *
+     * @param[in] x left position
+     * @param[in] y top position
+     * @param[in] sprite sprite in page format
+     */
+    template <uint32_t W, uint32_t H>
+    void draw_sprite(const int32_t x, const int32_t y, const ssd1306_sprite<W, H>& sprite)
+    {
+        _blit(x, y, &sprite.data[0][0], W, H);
+    }
+
+    /**
+     * invalidate the display contents (send entirely at the next show())
+     */
+    void invalidate();
+
+    /**
+     * set full refresh
+     *   send the whole framebuffer at each show() as ssd1306_show() (to compare the cost)
+     *
+     * @param[in] flag true to send the whole framebuffer
+     */
+    void set_full_refresh(const bool flag);
+    bool get_full_refresh() const;
+
+    /**
+     * transmit the changes to the display
+     *   if the previous transfer is in progress, the changes are kept to be transmitted at the next show()
+     *
+     * @return bytes on I2C bus including address bytes (0 if no change or deferred)
+     */
+    uint32_t show();
+
+    /**
+     * check if the transfer is in progress
+     *
+     * @return true if DMA or I2C is still transmitting
+     */
+    bool is_busy();
+
+    /**
+     * check if show() has been deferred by the transfer in progress
+     *
+     * @return true if show() is to be called again
+     */
+    bool is_pending() const;
+
+    /**
+     * wait for the end of the transfer
+     *   call this before other functions of ssd1306 library accessing I2C (e.g. ssd1306_poweroff())
+     */
+    void wait_idle();
+
+    /**
+     * get statistics of show()
+     *
+     * @param[out] stats statistics
+     */
+    void get_stats(stats_t& stats) const;
+    void reset_stats();
+
+    protected:
+    ssd1306_t* _disp;
+    uint8_t _dirty_x0[MAX_PAGES];  // no dirty column if _dirty_x0 > _dirty_x1
+    uint8_t _dirty_x1[MAX_PAGES];
+    uint8_t _sent[MAX_PAGES * MAX_WIDTH];  // contents sent to the display
+    bool _invalid;
+    bool _full_refresh;
+    bool _use_dma;
+    int _dma_chan;    // -1 if not claimed
+    bool _pending;
+    uint16_t _tx[MAX_TX_WORDS];  // data and commands of I2C for DMA (front buffer)
+    uint32_t _tx_len;
+    stats_t _stats;
+
+    void _mark(const int32_t x, const int32_t y, const int32_t width, const int32_t height);
+    void _clear_marks();
+    void _blit(const int32_t x, const int32_t y, const uint8_t* data, const uint32_t width, const uint32_t height);
+    uint32_t _send_commands(const uint8_t* commands, const size_t len);
+    uint32_t _send_window(const uint32_t page, const uint32_t x0, const uint32_t x1);
+    uint32_t _queue_transaction(const uint8_t control, const uint8_t* bytes, const uint32_t len);
+    uint32_t _queue_window(const uint32_t page, const uint32_t x0, const uint32_t x1);
+    void _start_transfer();
+    void _check_abort();
+};
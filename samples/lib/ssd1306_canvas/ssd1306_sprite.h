@@ -0,0 +1,60 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include <cstdint>
+
+// Sprite in SSD1306 page format (data[page][x], LSB is the top row of the page)
+//   drawing functions are constexpr to render sprites at compile time,
+//   ssd1306_canvas::draw_sprite() blits them by bytes
+template <uint32_t WIDTH, uint32_t HEIGHT>
+struct ssd1306_sprite {
+    static constexpr uint32_t width = WIDTH;
+    static constexpr uint32_t height = HEIGHT;
+    static constexpr uint32_t pages = (HEIGHT + 7) / 8;
+
+    uint8_t data[pages][WIDTH];
+
+    constexpr void draw_pixel(const int32_t x, const int32_t y)
+    {
+        if (x < 0 || x >= (int32_t) WIDTH || y < 0 || y >= (int32_t) HEIGHT) return;
+        data[y / 8][x] |= 1 << (y % 8);
+    }
+
+    // the same pixels as ssd1306_draw_line() (y is truncated on the line from the left end)
+    constexpr void draw_line(int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+    {
+        if (x1 > x2) {
+            int32_t t = x1; x1 = x2; x2 = t;
+            t = y1; y1 = y2; y2 = t;
+        }
+        if (x1 == x2) {
+            for (int32_t y = (y1 < y2) ? y1 : y2; y <= ((y1 < y2) ? y2 : y1); y++) {
+                draw_pixel(x1, y);
+            }
+            return;
+        }
+        for (int32_t x = x1; x <= x2; x++) {
+            draw_pixel(x, (y1 * (x2 - x1) + (y2 - y1) * (x - x1)) / (x2 - x1));
+        }
+    }
+
+    // font format: <height>, <width>, <additional spacing per char>, <first ascii char>, <last ascii char>, <data>
+    constexpr void draw_char_with_font(const int32_t x, const int32_t y, const uint8_t* font, const char c)
+    {
+        if (c < font[3] || c > font[4]) return;
+        uint32_t parts_per_line = (font[0] + 7) / 8;
+        for (uint32_t w = 0; w < font[1]; w++) {
+            const uint8_t* parts = &font[5 + ((c - font[3]) * font[1] + w) * parts_per_line];
+            for (uint32_t part = 0; part < parts_per_line; part++) {
+                for (uint32_t j = 0; j < 8; j++) {
+                    if (parts[part] & (1 << j)) draw_pixel(x + w, y + part * 8 + j);
+                }
+            }
+        }
+    }
+};
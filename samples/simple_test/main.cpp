@@ -4,6 +4,7 @@
 / refer to https://opensource.org/licenses/BSD-2-Clause
 /------------------------------------------------------*/
 
+#include <cstdarg>
 #include <cstdio>
 #include <cstring>
 
@@ -12,6 +13,8 @@
 #include "pico/util/queue.h"
 
 #include "crp42602y_ctrl.h"
+#include "deck_proto_server.h"
+#include "dma_log.h"
 
 static constexpr uint PIN_LED = PICO_DEFAULT_LED_PIN;
 
@@ -30,8 +33,18 @@ static bool _crp42602y_power = true;
 static queue_t _callback_queue;
 static constexpr int CALLBACK_QUEUE_LENGTH = 16;
 
+// core1 sleep statistics (written by core1, read by core0)
+static volatile uint64_t _sleep_us = 0;
+static volatile uint64_t _process_start_us = 0;
+static volatile uint64_t _command_sent_us = 0;  // set by core0 before send_command, cleared by core1
+static volatile uint32_t _latency_count = 0;
+static volatile uint32_t _latency_max_us = 0;
+static volatile uint64_t _latency_total_us = 0;
+
 // Instances
 crp42602y_ctrl *crp42602y_ctrl0 = nullptr;
+deck_proto_server *deck_proto_server0 = nullptr;
+dma_log *dma_log0 = nullptr;
 
 static inline uint64_t _micros()
 {
@@ -43,42 +56,99 @@ static inline uint32_t _millis()
     return to_ms_since_boot(get_absolute_time());
 }
 
+static void mark_command_sent()
+{
+    _command_sent_us = _micros();
+}
+
 static void stop()
 {
+    mark_command_sent();
     crp42602y_ctrl0->send_command(crp42602y_ctrl::STOP_COMMAND);
 }
 
 static void play(bool nonReverse)
 {
     if (nonReverse) {
+        mark_command_sent();
         crp42602y_ctrl0->send_command(crp42602y_ctrl::PLAY_COMMAND);
     } else {
+        mark_command_sent();
         crp42602y_ctrl0->send_command(crp42602y_ctrl::PLAY_REVERSE_COMMAND);
     }
 }
 
 static void fast_forward()
 {
+    mark_command_sent();
     crp42602y_ctrl0->send_command(crp42602y_ctrl::FF_COMMAND);
 }
 
 static void rewind()
 {
+    mark_command_sent();
     crp42602y_ctrl0->send_command(crp42602y_ctrl::REW_COMMAND);
 }
 
 static void crp42602y_process()
 {
     stop();
+    _process_start_us = _micros();
     while (true) {
         crp42602y_ctrl0->process_loop();
+        // sleep until the next deadline or an event from core0 / IRQ
+        uint64_t sleep_start_us = _micros();
+        bool woken = crp42602y_ctrl0->wait_for_event();
+        uint64_t wake_us = _micros();
+        _sleep_us += wake_us - sleep_start_us;
+        uint64_t sent_us = _command_sent_us;
+        if (woken && sent_us != 0) {
+            uint32_t latency_us = (uint32_t) (wake_us - sent_us);
+            _latency_total_us += latency_us;
+            if (latency_us > _latency_max_us) _latency_max_us = latency_us;
+            _latency_count++;
+            _command_sent_us = 0;
+        }
+    }
+}
+
+static void print_idle_stat()
+{
+    uint64_t elapsed_us = _micros() - _process_start_us;
+    uint32_t count = _latency_count;
+    printf("core1 idle: %.1f%%\r\n", (elapsed_us > 0) ? (float) _sleep_us * 100.0f / elapsed_us : 0.0f);
+    if (count > 0) {
+        printf("command wake-up latency: mean %u us, max %u us (%u commands)\r\n", (uint32_t) (_latency_total_us / count), _latency_max_us, count);
     }
+    const dma_log::log_stats_t& log_stats = dma_log0->get_stats();
+    printf("log: %u records, %u dropped, max level %u, %llu bytes\r\n", log_stats.records, log_stats.dropped, log_stats.max_level, (unsigned long long) log_stats.bytes);
+}
+
+// debug log of the counter algorithm on core1 (stored to the ring, formatted on core0)
+static void counter_log(const char* fmt, va_list args)
+{
+    dma_log0->vlog(fmt, args);
+}
+
+static void toggle_counter_log()
+{
+    static bool enabled = false;
+    enabled = !enabled;
+    crp42602y_ctrl0->get_counter_inst()->set_log_callback(enabled ? counter_log : nullptr);
+    printf("counter log %s\r\n", enabled ? "on" : "off");
+}
+
+// frames of deck_proto share the serial with the text output in the ring of dma_log (not translated to CRLF)
+//   a frame dropped by full ring is recovered by the retry of the client
+static void serial_write(const uint8_t* data, size_t len)
+{
+    dma_log0->write(data, len);
 }
 
 void crp42602y_callback(const crp42602y_ctrl::callback_type_t callback_type)
 {
     if (!queue_try_add(&_callback_queue, &callback_type)) {
-        printf("ERROR: _callback_queue is full\r\n");
+        dma_log0->log("ERROR: _callback_queue is full\r\n");
     }
 }
 
@@ -133,6 +203,10 @@ int main()
 {
     stdio_init_all();
 
+    // logging console: printf and the records go through the ring drained by DMA to UART
+    dma_log0 = new dma_log(uart_default);
+    dma_log0->enable_stdio();
+
     // GPIO settings
     gpio_init(PIN_LED);
     gpio_set_dir(PIN_LED, GPIO_OUT);
@@ -148,6 +222,9 @@ int main()
     crp42602y_ctrl0 = new crp42602y_ctrl(PIN_CASSETTE_DETECT, PIN_GEAR_STATUS_SW, PIN_ROTATION_SENS, PIN_SOLENOID_CTRL, PIN_POWER_CTRL);
     crp42602y_ctrl0->register_callback_all(crp42602y_callback);
 
+    // binary framed protocol on the serial with the single character commands
+    deck_proto_server0 = new deck_proto_server(crp42602y_ctrl0, serial_write);
+
     printf("CRP42602Y control started\r\n");
 
     // Core1 runs CRP62602Y process
@@ -157,8 +234,12 @@ int main()
     while (true) {
         uint32_t now_time = _millis();
 
-        // Serial I/F
+        // Serial I/F (the frames of deck_proto are taken first, other bytes are single character commands)
         int c = getchar_timeout_us(0);
+        while (c >= 0 && deck_proto_server0->feed((uint8_t) c)) {
+            c = getchar_timeout_us(0);
+        }
+        deck_proto_server0->process();
         if (c >= 0) {
             if (c == 's') stop();
             if (c == 'p') play(true);
@@ -167,62 +248,70 @@ int main()
             if (c == 'r') rewind();
             if (c == 'd') inc_head_dir();
             if (c == 'v') inc_reverse_mode();
+            if (c == 'i') print_idle_stat();
+            if (c == 'l') toggle_counter_log();
         }
 
         // Process callback
         crp42602y_ctrl::callback_type_t callback_type;
         while (crp42602y_get_callback(&callback_type)) {
+            deck_proto_server0->notify_event(callback_type);
             switch (callback_type) {
             case crp42602y_ctrl::ON_GEAR_ERROR:
-                printf("Gear error\r\n");
+                dma_log0->log("Gear error\r\n");
                 break;
             case crp42602y_ctrl::ON_COMMAND_FIFO_OVERFLOW:
-                printf("Command FIFO overflow\r\n");
+                dma_log0->log("Command FIFO overflow\r\n");
                 break;
             case crp42602y_ctrl::ON_CASSETTE_SET:
-                printf("Cassette set\r\n");
+                dma_log0->log("Cassette set\r\n");
                 _has_cassette = true;
                 crp42602y_ctrl0->recover_power_from_timeout();
                 break;
             case crp42602y_ctrl::ON_CASSETTE_EJECT:
-                printf("Cassette eject\r\n");
+                dma_log0->log("Cassette eject\r\n");
                 _has_cassette = false;
                 break;
             case crp42602y_ctrl::ON_STOP:
-                printf("Stop\r\n");
+                dma_log0->log("Stop\r\n");
                 break;
             case crp42602y_ctrl::ON_PLAY:
                 if (crp42602y_ctrl0->get_head_dir_is_a()) {
-                    printf("Play A\r\n");
+                    dma_log0->log("Play A\r\n");
                 } else {
-                    printf("Play B\r\n");
+                    dma_log0->log("Play B\r\n");
                 }
                 break;
             case crp42602y_ctrl::ON_CUE:
                 if (crp42602y_ctrl0->get_cue_dir_is_a()) {
-                    printf("FF\r\n");
+                    dma_log0->log("FF\r\n");
                 } else {
-                    printf("REW\r\n");
+                    dma_log0->log("REW\r\n");
                 }
                 break;
             case crp42602y_ctrl::ON_REVERSE:
-                printf("Reversed\r\n");
+                dma_log0->log("Reversed\r\n");
                 if (crp42602y_ctrl0->get_head_dir_is_a()) {
-                    printf("Play A\r\n");
+                    dma_log0->log("Play A\r\n");
                 } else {
-                    printf("Play B\r\n");
+                    dma_log0->log("Play B\r\n");
                 }
                 break;
             case crp42602y_ctrl::ON_TIMEOUT_POWER_OFF:
-                printf("Power off\r\n");
+                dma_log0->log("Power off\r\n");
                 _crp42602y_power = false;
                 break;
             case crp42602y_ctrl::ON_RECOVER_POWER_FROM_TIMEOUT:
-                printf("Power recover\r\n");
+                dma_log0->log("Power recover\r\n");
                 _crp42602y_power = true;
                 break;
+            case crp42602y_ctrl::ON_END_OF_TAPE:
+                dma_log0->log("End of tape\r\n");
+                break;
             }
         }
+
+        dma_log0->process();
     }
 
     return 0;
@@ -0,0 +1,120 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include "button_edge.h"
+
+#include "hardware/irq.h"
+
+button_edge* button_edge::_inst = nullptr;
+
+button_edge::button_edge(const uint pins[], const uint num_buttons, void (*callback)(const uint index, const event_t event, const uint64_t edge_us), const uint32_t debounce_us) :
+    _pins{},
+    _num_buttons((num_buttons <= MAX_NUM_BUTTONS) ? num_buttons : MAX_NUM_BUTTONS),
+    _pin_mask(0),
+    _callback(callback),
+    _debounce_us(debounce_us),
+    _states{},
+    _edge_time_us{}
+{
+    _inst = this;
+    for (uint i = 0; i < _num_buttons; i++) {
+        _pins[i] = pins[i];
+        _pin_mask |= 1UL << pins[i];
+        _states[i] = gpio_get(pins[i]) ? RELEASED : PRESSED;
+    }
+    // the raw handler shares IO_IRQ_BANK0 with the other GPIO users
+    gpio_add_raw_irq_handler_masked(_pin_mask, _gpio_irq_handler);
+    for (uint i = 0; i < _num_buttons; i++) {
+        gpio_set_irq_enabled(_pins[i], GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true);
+    }
+    irq_set_enabled(IO_IRQ_BANK0, true);
+}
+
+button_edge::~button_edge()
+{
+    for (uint i = 0; i < _num_buttons; i++) {
+        gpio_set_irq_enabled(_pins[i], GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, false);
+    }
+    gpio_remove_raw_irq_handler_masked(_pin_mask, _gpio_irq_handler);
+    _inst = nullptr;
+}
+
+uint32_t button_edge::get_pin_mask() const
+{
+    return _pin_mask;
+}
+
+uint64_t button_edge::get_edge_time_us(const uint index) const
+{
+    return (index < _num_buttons) ? _edge_time_us[index] : 0;
+}
+
+bool button_edge::is_pressed(const uint index) const
+{
+    if (index >= _num_buttons) return false;
+    state_t state = _states[index];
+    return state == PRESSED || state == RELEASE_DEBOUNCE;
+}
+
+void button_edge::_gpio_irq_handler()
+{
+    if (_inst == nullptr) return;
+    for (uint i = 0; i < _inst->_num_buttons; i++) {
+        uint32_t events = gpio_get_irq_event_mask(_inst->_pins[i]) & (GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE);
+        if (events) {
+            gpio_acknowledge_irq(_inst->_pins[i], events);
+            _inst->_on_edge(i);
+        }
+    }
+}
+
+int64_t button_edge::_debounce_alarm(alarm_id_t id, void* user_data)
+{
+    if (_inst != nullptr) {
+        _inst->_on_debounce((uint) (uintptr_t) user_data);
+    }
+    return 0;  // no repeat
+}
+
+void button_edge::_on_edge(const uint index)
+{
+    // the edges during debounce are bounces, the level is decided at the end of debounce
+    switch (_states[index]) {
+    case RELEASED:
+        _edge_time_us[index] = time_us_64();
+        _states[index] = PRESS_DEBOUNCE;
+        if (_callback != nullptr) {
+            _callback(index, EVENT_EDGE, _edge_time_us[index]);
+        }
+        break;
+    case PRESSED:
+        _states[index] = RELEASE_DEBOUNCE;
+        break;
+    default:
+        return;
+    }
+    if (add_alarm_in_us(_debounce_us, _debounce_alarm, (void*) (uintptr_t) index, true) < 0) {
+        // no alarm slot, the level is taken as is
+        _on_debounce(index);
+    }
+}
+
+void button_edge::_on_debounce(const uint index)
+{
+    bool low = !gpio_get(_pins[index]);
+    if (_states[index] == PRESS_DEBOUNCE) {
+        if (low) {
+            _states[index] = PRESSED;
+            if (_callback != nullptr) {
+                _callback(index, EVENT_PRESS, _edge_time_us[index]);
+            }
+        } else {
+            _states[index] = RELEASED;  // glitch
+        }
+    } else if (_states[index] == RELEASE_DEBOUNCE) {
+        _states[index] = low ? PRESSED : RELEASED;
+    }
+}
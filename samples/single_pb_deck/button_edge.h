@@ -0,0 +1,90 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "pico/stdlib.h"
+
+// GPIO edge front end of the buttons (active low)
+//   the first edge of a press is timestamped and starts debounce by an alarm,
+//   the press is confirmed if the pin is still low at the end of debounce (the release is debounced in the same way)
+//   callbacks are called in IRQ context of the core constructing the instance
+//   (the periodic scan of Buttons library is kept for clicks, long press and repeat)
+class button_edge {
+    public:
+    /**
+     * Definitions
+     */
+    typedef enum _event_t {
+        EVENT_EDGE = 0,   // the first edge of a press (not debounced yet)
+        EVENT_PRESS       // the press confirmed by debounce
+    } event_t;
+
+    // Constants
+    static constexpr uint MAX_NUM_BUTTONS = 8;
+    static constexpr uint32_t DEFAULT_DEBOUNCE_US = 5000;
+
+    /**
+     * button_edge class constructor
+     *   only one instance is allowed
+     *
+     * @param[in] pins GPIO pins of the buttons (pulled up)
+     * @param[in] num_buttons number of the buttons (up to MAX_NUM_BUTTONS)
+     * @param[in] callback function called in IRQ context with the index of the button, the event and the time of the first edge
+     * @param[in] debounce_us debounce time
+     */
+    button_edge(const uint pins[], const uint num_buttons, void (*callback)(const uint index, const event_t event, const uint64_t edge_us), const uint32_t debounce_us = DEFAULT_DEBOUNCE_US);
+
+    /**
+     * button_edge class destructor
+     */
+    virtual ~button_edge();
+
+    /**
+     * get GPIO mask of the buttons
+     *
+     * @return mask of the pins
+     */
+    uint32_t get_pin_mask() const;
+
+    /**
+     * get time of the first edge of the last press
+     *
+     * @param[in] index index of the button
+     * @return time in microseconds since boot (0 if never pressed)
+     */
+    uint64_t get_edge_time_us(const uint index) const;
+
+    /**
+     * check if the button is pressed (debounced)
+     *
+     * @param[in] index index of the button
+     * @return true if pressed
+     */
+    bool is_pressed(const uint index) const;
+
+    protected:
+    typedef enum _state_t {
+        RELEASED = 0,
+        PRESS_DEBOUNCE,
+        PRESSED,
+        RELEASE_DEBOUNCE
+    } state_t;
+
+    static button_edge* _inst;
+    uint _pins[MAX_NUM_BUTTONS];
+    uint _num_buttons;
+    uint32_t _pin_mask;
+    void (*_callback)(const uint index, const event_t event, const uint64_t edge_us);
+    uint32_t _debounce_us;
+    volatile state_t _states[MAX_NUM_BUTTONS];
+    volatile uint64_t _edge_time_us[MAX_NUM_BUTTONS];
+
+    static void _gpio_irq_handler();
+    static int64_t _debounce_alarm(alarm_id_t id, void* user_data);
+    void _on_edge(const uint index);
+    void _on_debounce(const uint index);
+};
@@ -0,0 +1,114 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "ssd1306_sprite.h"
+
+/*
+ * Font Format for reverse mode
+ * <height>, <width>, <additional spacing per char>,
+ * <first ascii char>, <last ascii char>,
+ * <data>
+ */
+static constexpr uint8_t font_reverse_mode[] =
+{
+    16, 16, 1, 0, 2,
+    // One Way
+    0x00,0x00,0x10,0x08,0x10,0x1C,0x10,0x3E,0x10,0x7F,0x10,0x08,0x10,0x08,0x10,0x08,
+    0x10,0x08,0x10,0x08,0x10,0x08,0xFE,0x08,0x7C,0x08,0x38,0x08,0x10,0x08,0x00,0x00,
+    // One Round
+    0x00,0x00,0x10,0x08,0x10,0x1C,0x10,0x3E,0x10,0x7F,0x10,0x08,0x10,0x08,0x10,0x08,
+    0x10,0x08,0x10,0x08,0x10,0x08,0x10,0x08,0x10,0x08,0x20,0x04,0xC0,0x03,0x00,0x00,
+    // Infinite Round
+    0x00,0x00,0xC0,0x03,0x20,0x04,0x10,0x08,0x10,0x1C,0x10,0x3E,0x10,0x7F,0x10,0x08,
+    0x10,0x08,0xFE,0x08,0x7C,0x08,0x38,0x08,0x10,0x08,0x20,0x04,0xC0,0x03,0x00,0x00
+};
+
+/*
+ * Font Format for bluetooth
+ * <height>, <width>, <additional spacing per char>,
+ * <first ascii char>, <last ascii char>,
+ * <data>
+ */
+static constexpr uint8_t font_bluetooth[] =
+{
+    16, 16, 1, 0, 0,
+    0x00,0x00,0x00,0x00,0x00,0x00,0xC0,0x07,0xF0,0x1F,0xB8,0x3B,0x7C,0x7D,0x04,0x40,
+    0xEC,0x6E,0x5C,0x75,0xB8,0x3B,0xF0,0x1F,0xC0,0x07,0x00,0x00,0x00,0x00,0x00,0x00
+};
+
+/*
+ * Sprites of the deck UI rendered at compile time
+ *   the animation frames of play/cue arrows differ only in x position,
+ *   which costs nothing to blit in page format, thus a sprite per direction covers all the positions
+ */
+typedef ssd1306_sprite<14, 17> arrow_sprite_t;      // 6 strokes of 9 x 17 chevron
+typedef ssd1306_sprite<14 + 8, 17> cue_sprite_t;    // 2 arrows with 8 pixel pitch
+typedef ssd1306_sprite<16, 16> icon_sprite_t;
+typedef ssd1306_sprite<128, 8> meter_sprite_t;      // level meter of 2 channels composed at run time
+
+static constexpr uint32_t ARROW_X = 64 - arrow_sprite_t::width / 2;
+static constexpr uint32_t CUE_X = 64 - cue_sprite_t::width / 2;
+static constexpr uint32_t ARROW_Y = 32 - 8;
+static constexpr uint32_t NUM_ARROW_POSITIONS = 16;
+static constexpr uint32_t METER_Y = 8;
+static constexpr uint32_t NUM_METER_SEGMENTS = 32;  // 4 pixel pitch (3 lit and 1 gap)
+static constexpr int32_t METER_DB10_PER_SEGMENT = 15;
+static constexpr int32_t METER_DB10_MIN = -(int32_t) NUM_METER_SEGMENTS * METER_DB10_PER_SEGMENT;  // -48 dB
+static constexpr uint8_t METER_ROWS[2] = {0x0e, 0xe0};  // [ch] rows 1 ~ 3 for L, rows 5 ~ 7 for R
+
+template <typename SPRITE>
+static constexpr void draw_arrow_on_sprite(SPRITE& s, const int32_t x, const bool right_dir)
+{
+    for (int32_t i = 0; i < 6; i++) {
+        int32_t sx = x + i;
+        if (right_dir) {
+            s.draw_line(sx, 0, sx + 8, 8);
+            s.draw_line(sx, 16, sx + 8, 8);
+        } else {
+            s.draw_line(sx, 8, sx + 8, 0);
+            s.draw_line(sx, 8, sx + 8, 16);
+        }
+    }
+}
+
+static constexpr arrow_sprite_t make_arrow_sprite(const bool right_dir)
+{
+    arrow_sprite_t s{};
+    draw_arrow_on_sprite(s, 0, right_dir);
+    return s;
+}
+
+static constexpr cue_sprite_t make_cue_sprite(const bool right_dir)
+{
+    cue_sprite_t s{};
+    draw_arrow_on_sprite(s, 0, right_dir);
+    draw_arrow_on_sprite(s, 8, right_dir);
+    return s;
+}
+
+static constexpr icon_sprite_t make_icon_sprite(const uint8_t* font, const char c)
+{
+    icon_sprite_t s{};
+    s.draw_char_with_font(0, 0, font, c);
+    return s;
+}
+
+// [right_dir]
+static constexpr arrow_sprite_t sprite_arrow[2] = {make_arrow_sprite(false), make_arrow_sprite(true)};
+static constexpr cue_sprite_t sprite_cue[2] = {make_cue_sprite(false), make_cue_sprite(true)};
+// [reverse_mode]
+static constexpr icon_sprite_t sprite_reverse_mode[3] = {
+    make_icon_sprite(font_reverse_mode, 0), make_icon_sprite(font_reverse_mode, 1), make_icon_sprite(font_reverse_mode, 2)
+};
+static constexpr icon_sprite_t sprite_bluetooth = make_icon_sprite(font_bluetooth, 0);
+
+// x offset of the animation frame (pos: 0 ~ 15) from the position of stop arrow
+static constexpr int32_t arrow_frame_offset(const bool right_dir, const uint32_t pos)
+{
+    return (int32_t) (right_dir ? (pos + 8) % NUM_ARROW_POSITIONS : (24 - pos) % NUM_ARROW_POSITIONS) - 8;
+}
@@ -0,0 +1,172 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#include "deck_ui.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+// number of meter segments lit up to the level (0 ~ NUM_METER_SEGMENTS)
+static uint32_t _meter_segments(const int32_t db10)
+{
+    if (db10 <= METER_DB10_MIN) return 0;
+    uint32_t n = (uint32_t) ((db10 - METER_DB10_MIN) / METER_DB10_PER_SEGMENT);
+    return (n > NUM_METER_SEGMENTS) ? NUM_METER_SEGMENTS : n;
+}
+
+static const char* const MODE_STRINGS[deck_ui::__NUM_MODES__] = {
+    "STOP", "PLAY A", "PLAY B", "FF", "REW", "FF CUE", "REW CUE"
+};
+
+deck_ui::deck_ui(ssd1306_canvas* canvas) :
+    _canvas(canvas)
+{
+}
+
+ssd1306_canvas* deck_ui::get_canvas() const
+{
+    return _canvas;
+}
+
+void deck_ui::clear()
+{
+    _canvas->clear();
+}
+
+void deck_ui::draw_default(const bool has_cassette, const bool head_dir_is_a)
+{
+    _canvas->clear_square(0, 8, 128-16, 8*5);
+    if (has_cassette) {
+        draw_image(IMAGE_STOP, head_dir_is_a);
+    } else {
+        draw_image(IMAGE_NO_CASSETTE);
+    }
+    draw_mode(MODE_STOP);
+}
+
+void deck_ui::draw_mode(const mode_t mode)
+{
+    _canvas->clear_square(0, 0, 6*7, 8);
+    if (mode < __NUM_MODES__) {
+        _canvas->draw_string(0, 0, 1, MODE_STRINGS[mode]);
+    }
+}
+
+void deck_ui::draw_image(const image_t image, const bool dir_is_a, const uint32_t pos)
+{
+    _canvas->clear_square(0, 16, 128-16, 8*4);
+    switch (image) {
+    case IMAGE_STOP:
+        _canvas->draw_sprite(ARROW_X, ARROW_Y, sprite_arrow[dir_is_a]);
+        break;
+    case IMAGE_PLAY:
+        _canvas->draw_sprite(ARROW_X + arrow_frame_offset(dir_is_a, pos), ARROW_Y, sprite_arrow[dir_is_a]);
+        break;
+    case IMAGE_CUE:
+        _canvas->draw_sprite(CUE_X + arrow_frame_offset(dir_is_a, pos), ARROW_Y, sprite_cue[dir_is_a]);
+        break;
+    case IMAGE_NO_CASSETTE:
+        _canvas->draw_string(32, 32-4, 1, "NO CASSETTE");
+        break;
+    case IMAGE_SETTING_SAVED:
+        _canvas->draw_string(24, 32-4, 1, "SETTING SAVED");
+        break;
+    default:
+        break;
+    }
+}
+
+void deck_ui::draw_counter(const bool determined, const bool visible, const float sec)
+{
+    _canvas->clear_square(6*6, 64-8, 6*7, 8);
+    if (!determined) {
+        _canvas->draw_string(6*6, 64-8, 1, "  --:--");
+    } else if (visible) {
+        int counter_sec = (int) sec;
+        int counter_min = counter_sec / 60;
+        char str[16];
+        if (counter_sec < 0 && counter_min == 0) {
+            sprintf(str, "  -0:%02d", abs(counter_sec) % 60);
+        } else {
+            sprintf(str, "%4d:%02d", counter_min, abs(counter_sec) % 60);
+        }
+        _canvas->draw_string(6*6, 64-8, 1, str);
+    }
+}
+
+void deck_ui::draw_reverse_mode(const crp42602y_ctrl::reverse_mode_t reverse_mode)
+{
+    _canvas->clear_square(0, 64-16, 16, 16);
+    if (reverse_mode < crp42602y_ctrl::__NUM_RVS_MODES__) {
+        _canvas->draw_sprite(0, 64-16, sprite_reverse_mode[reverse_mode]);
+    }
+}
+
+void deck_ui::draw_eq(const eq_nr::eq_type_t eq_type)
+{
+    const int n = 6;
+    const uint32_t sx = 128-6*n;
+    const uint32_t sy = 0;
+    _canvas->clear_square(sx, sy, 6*n, 8);
+    switch (eq_type) {
+    case eq_nr::EQ_120US:
+        _canvas->draw_string(sx, sy, 1, "120 uS");
+        break;
+    case eq_nr::EQ_70US:
+        _canvas->draw_string(sx, sy, 1, " 70 uS");
+        break;
+    default:
+        _canvas->draw_string(sx, sy, 1, "120 uS");
+        break;
+    }
+}
+
+void deck_ui::draw_nr(const eq_nr::nr_type_t nr_type)
+{
+    const int n = 7;
+    const uint32_t sx = 128-6*n;
+    const uint32_t sy = 64-8;
+    _canvas->clear_square(sx, sy, 6*n, 8);
+    switch (nr_type) {
+    case eq_nr::NR_OFF:
+        _canvas->draw_string(sx, sy, 1, " NR OFF");
+        break;
+    case eq_nr::DOLBY_B:
+        _canvas->draw_string(sx, sy, 1, "Dolby B");
+        break;
+    case eq_nr::DOLBY_C:
+        _canvas->draw_string(sx, sy, 1, "Dolby C");
+        break;
+    default:
+        _canvas->draw_string(sx, sy, 1, "NR OFF");
+        break;
+    }
+}
+
+void deck_ui::draw_bluetooth(const bool visible)
+{
+    _canvas->clear_square(128-16, 32-8, 16, 16);
+    if (visible) {
+        _canvas->draw_sprite(128-16, 32-8, sprite_bluetooth);
+    }
+}
+
+void deck_ui::draw_level_meter(const int32_t rms_db10[2], const int32_t peak_db10[2])
+{
+    meter_sprite_t s{};
+    for (int ch = 0; ch < 2; ch++) {
+        const uint32_t bar = _meter_segments(rms_db10[ch]);
+        const uint32_t peak = _meter_segments(peak_db10[ch]);
+        for (uint32_t i = 0; i < NUM_METER_SEGMENTS; i++) {
+            if (i >= bar && i + 1 != peak) continue;
+            for (uint32_t x = 0; x < 3; x++) {
+                s.data[0][i*4 + x] |= METER_ROWS[ch];
+            }
+        }
+    }
+    _canvas->clear_square(0, METER_Y, meter_sprite_t::width, meter_sprite_t::height);
+    _canvas->draw_sprite(0, METER_Y, s);
+}
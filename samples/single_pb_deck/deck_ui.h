@@ -0,0 +1,121 @@
+/*------------------------------------------------------/
+/ Copyright (c) 2025, Elehobica
+/ Released under the BSD-2-Clause
+/ refer to https://opensource.org/licenses/BSD-2-Clause
+/------------------------------------------------------*/
+
+#pragma once
+
+#include "crp42602y_ctrl.h"
+#include "eq_nr.h"
+#include "ssd1306_canvas.h"
+#include "deck_sprites.h"
+
+// Display contents of single_pb_deck on ssd1306_canvas
+//   the contents are given by values instead of the instances of the mechanism,
+//   thus the same drawing runs on the host against a framebuffer emulator
+//   (show() is left to the caller)
+class deck_ui {
+    public:
+    /**
+     * Definitions
+     */
+    typedef enum _mode_t {
+        MODE_STOP = 0,
+        MODE_PLAY_A,
+        MODE_PLAY_B,
+        MODE_FF,
+        MODE_REW,
+        MODE_FF_CUE,
+        MODE_REW_CUE,
+        __NUM_MODES__
+    } mode_t;
+    typedef enum _image_t {
+        IMAGE_STOP = 0,       // stop arrow
+        IMAGE_PLAY,           // play arrow animated by position
+        IMAGE_CUE,            // double arrow animated by position (FF, REW and cue)
+        IMAGE_NO_CASSETTE,
+        IMAGE_SETTING_SAVED,
+        __NUM_IMAGES__
+    } image_t;
+
+    // Constants
+    static constexpr uint32_t NUM_POSITIONS = NUM_ARROW_POSITIONS;  // animation positions of the arrows
+
+    /**
+     * deck_ui class constructor
+     *
+     * @param[in] canvas canvas to draw
+     */
+    deck_ui(ssd1306_canvas* canvas);
+
+    /**
+     * deck_ui class destructor
+     */
+    virtual ~deck_ui() {}
+
+    /**
+     * get canvas
+     *
+     * @return canvas to draw
+     */
+    ssd1306_canvas* get_canvas() const;
+
+    /**
+     * clear all the contents
+     */
+    void clear();
+
+    /**
+     * draw default contents (STOP with stop arrow or NO CASSETTE)
+     *
+     * @param[in] has_cassette true if cassette is set
+     * @param[in] head_dir_is_a head direction
+     */
+    void draw_default(const bool has_cassette, const bool head_dir_is_a);
+
+    /**
+     * draw transport mode string at top left
+     *
+     * @param[in] mode transport mode
+     */
+    void draw_mode(const mode_t mode);
+
+    /**
+     * draw image at center
+     *
+     * @param[in] image image
+     * @param[in] dir_is_a direction of arrow (head direction for IMAGE_STOP and IMAGE_PLAY, cue direction for IMAGE_CUE)
+     * @param[in] pos animation position of arrow (0 ~ NUM_POSITIONS - 1)
+     */
+    void draw_image(const image_t image, const bool dir_is_a = true, const uint32_t pos = 0);
+
+    /**
+     * draw counter at bottom
+     *
+     * @param[in] determined false to show "--:--" (the counter is not available yet)
+     * @param[in] visible false to blank the counter (blink)
+     * @param[in] sec counter value in seconds
+     */
+    void draw_counter(const bool determined, const bool visible, const float sec);
+
+    /**
+     * draw icons and strings of the settings
+     */
+    void draw_reverse_mode(const crp42602y_ctrl::reverse_mode_t reverse_mode);
+    void draw_eq(const eq_nr::eq_type_t eq_type);
+    void draw_nr(const eq_nr::nr_type_t nr_type);
+    void draw_bluetooth(const bool visible);
+
+    /**
+     * draw level meter of 2 channels below the mode string (L upper, R lower)
+     *   RMS as the bar and the peak held as the segment, -48 dB ~ 0 dB in 1.5 dB per segment
+     *
+     * @param[in] rms_db10 RMS of the channels in 0.1 dB (0 dB at full scale)
+     * @param[in] peak_db10 peak held of the channels in 0.1 dB
+     */
+    void draw_level_meter(const int32_t rms_db10[2], const int32_t peak_db10[2]);
+
+    protected:
+    ssd1306_canvas* _canvas;
+};
@@ -4,6 +4,7 @@
 / refer to https://opensource.org/licenses/BSD-2-Clause
 /------------------------------------------------------*/
 
+#include <cstdarg>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -13,14 +14,26 @@
 #include "pico/multicore.h"
 #include "pico/stdlib.h"
 #include "pico/util/queue.h"
+#include "hardware/clocks.h"
+#include "hardware/sync.h"
+#include "hardware/uart.h"
 
 #include "Buttons.h"
+#include "button_edge.h"
 #include "ConfigParam.h"
 #include "crp42602y_ctrl.h"
+#include "deck_proto_server.h"
+#include "deck_ui.h"
+#include "dma_log.h"
 #include "eq_nr.h"
-extern "C" {
-#include "ssd1306.h"
-}
+#include "flash_journal.h"
+#include "ir_remote.h"
+#include "level_meter.h"
+#include "ssd1306_canvas.h"
+
+#if !defined(SINGLE_PB_DECK_LEVEL_METER)
+#define SINGLE_PB_DECK_LEVEL_METER 0  // 1: level meter of the line output on ADC0/ADC1, the SET/RESET buttons move to GP12/GP13
+#endif
 
 static constexpr uint PIN_LED = PICO_DEFAULT_LED_PIN;
 
@@ -43,8 +56,13 @@ static constexpr uint PIN_DOWN_BUTTON   = 19;
 static constexpr uint PIN_LEFT_BUTTON   = 20;
 static constexpr uint PIN_RIGHT_BUTTON  = 21;
 static constexpr uint PIN_CENTER_BUTTON = 22;
+#if SINGLE_PB_DECK_LEVEL_METER
+static constexpr uint PIN_SET_BUTTON    = 12;
+static constexpr uint PIN_RESET_BUTTON  = 13;
+#else
 static constexpr uint PIN_SET_BUTTON    = 26;
 static constexpr uint PIN_RESET_BUTTON  = 27;
+#endif
 
 // Bluetooth Tx Connect pin
 static constexpr uint PIN_BT_TX_POWER   = 16;
@@ -57,18 +75,43 @@ static constexpr uint PIN_REALTIME_COUNTER_SEL  = 28;
 static constexpr uint PIN_SSD1306_SDA = 8;
 static constexpr uint PIN_SSD1306_SCL = 9;
 
+// IR receiver module pin (output of 38 kHz demodulator, active low)
+static constexpr uint PIN_IR_RECEIVER = 17;
+
+#if SINGLE_PB_DECK_LEVEL_METER
+// Level meter inputs: ADC0 (GP26) for L, ADC1 (GP27) for R (line output biased at the half of ADC_VREF)
+static constexpr uint32_t LEVEL_METER_INPUT_MASK = (1UL << 0) | (1UL << 1);
+#endif
+
+// IR remote keymap (the address and the command of other remotes are found in the log of the keys)
+//   NEC: a common 21-key remote (address 0x00), RC-5: VCR commands (address 0x05)
+static const ir_remote::keymap_entry_t ir_keymap[] = {
+    {ir_decoder::PROTOCOL_NEC, 0x00, 0x43, ir_remote::ACT_STOP_PLAY},     // play/pause
+    {ir_decoder::PROTOCOL_NEC, 0x00, 0x44, ir_remote::ACT_REW},           // prev
+    {ir_decoder::PROTOCOL_NEC, 0x00, 0x40, ir_remote::ACT_FF},            // next
+    {ir_decoder::PROTOCOL_NEC, 0x00, 0x45, ir_remote::ACT_STOP},          // CH-
+    {ir_decoder::PROTOCOL_NEC, 0x00, 0x46, ir_remote::ACT_PLAY_REVERSE},  // CH
+    {ir_decoder::PROTOCOL_RC5, 0x05, 0x35, ir_remote::ACT_PLAY},
+    {ir_decoder::PROTOCOL_RC5, 0x05, 0x36, ir_remote::ACT_STOP},
+    {ir_decoder::PROTOCOL_RC5, 0x05, 0x34, ir_remote::ACT_FF},
+    {ir_decoder::PROTOCOL_RC5, 0x05, 0x32, ir_remote::ACT_REW},
+};
+
 // Timer & frequency
 static repeating_timer_t timer;
 static constexpr int INTERVAL_MS_BUTTONS_CHECK = 50;
+static constexpr uint32_t BUTTON_DEBOUNCE_US = 5000;
 
 static uint32_t _count = 0;
 
 static constexpr uint32_t POWER_OFF_TIMEOUT_SEC = 300;
+static constexpr uint32_t WARM_STANDBY_MS = 10000;
 static bool _has_cassette = false;
-static bool _crp42602y_power = true;
+static volatile bool _crp42602y_power = true;  // also read by button edge IRQ
 static bool _flash_stored_display = false;
 static bool _bt_tx_power = false;
 static bool _bt_tx_connect_req = false;
+static uint32_t _max_loop_us = 0;
 
 static constexpr uint32_t DISP_INTERVAL_MS         = 50;  // ms
 static constexpr uint32_t BT_TX_CONNECT_BLINK_TERM = (1200 / DISP_INTERVAL_MS + 7)/8*8 - 1;
@@ -76,8 +119,32 @@ static constexpr uint32_t BT_TX_CONNECT_BLINK_TERM = (1200 / DISP_INTERVAL_MS +
 static constexpr int CALLBACK_QUEUE_LENGTH = 16;
 static queue_t _callback_queue;
 
-static volatile bool _core1_exec = false;
-static volatile bool _core1_is_running = false;
+// Flash store (core1 is paused by the lockout of flash_safe_execute() during erase and program)
+static bool _flash_store_pending = false;  // deferred to the idle window of the mechanism
+static uint32_t _flash_store_count = 0;
+static uint32_t _flash_skip_count = 0;
+static uint32_t _max_flash_blackout_us = 0;
+
+// Flash journal of the tape position and lifetime statistics (below the region of pico_flash_param at the end of flash)
+static constexpr uint JOURNAL_NUM_SECTORS = 8;
+static constexpr uint32_t JOURNAL_FLASH_OFFS = PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE * (JOURNAL_NUM_SECTORS + 4);
+typedef enum _journal_key_t {
+    JOURNAL_POSITION_A = 0,  // counter of side A at stop (bits of float)
+    JOURNAL_POSITION_B,      // counter of side B at stop (bits of float)
+    JOURNAL_TAPE_THICKNESS,  // tape thickness in um at stop (bits of float)
+    JOURNAL_PLAY_MS,         // lifetime play time
+    JOURNAL_GEAR_CYCLES,     // lifetime function changes (stop, play, FF/REW and cue)
+    JOURNAL_GEAR_ERRORS,     // lifetime gear errors
+    JOURNAL_POWER_CYCLES     // lifetime mechanism power on (boot and recovery from power off)
+} journal_key_t;
+static flash_journal journal(JOURNAL_FLASH_OFFS, JOURNAL_NUM_SECTORS);
+static uint32_t _play_start_ms = 0;  // 0: not playing
+
+// Standby (low power idle during power off by timeout)
+static volatile bool _standby = false;
+static uint32_t _standby_wake_mask = 0;  // GPIOs to wake up core0 by falling edge
+static uint32_t _standby_sys_clock_khz = 0;
+static uint64_t _standby_start_us = 0;
 
 typedef enum _button_id_t {
     ID_UP_BUTTON = 0,
@@ -100,45 +167,44 @@ static button_t btns_5way_tactile_plus2[] = {
     {ID_UP_BUTTON,     "up",     PIN_UP_BUTTON,     &Buttons::DEFAULT_BUTTON_SINGLE_REPEAT_CONFIG}
 };
 
+// pins indexed by button_id_t for the edge front end
+static constexpr uint button_pins[] = {
+    PIN_UP_BUTTON, PIN_DOWN_BUTTON, PIN_LEFT_BUTTON, PIN_RIGHT_BUTTON, PIN_CENTER_BUTTON, PIN_SET_BUTTON, PIN_RESET_BUTTON
+};
+static constexpr uint NUM_BUTTONS = sizeof(button_pins) / sizeof(uint);
+
+// Button press to send_command() latency
+typedef struct _latency_stats_t {
+    uint32_t count;
+    uint64_t total_us;
+    uint32_t max_us;
+} latency_stats_t;
+static latency_stats_t _fast_latency = {};    // sent by the edge front end at the press
+static latency_stats_t _polled_latency = {};  // sent at the button event of the periodic scan
+
+// state of the press for the edge front end
+typedef enum _fast_state_t {
+    FAST_IDLE = 0,
+    FAST_PENDING,  // the edge comes, the command is not sent yet
+    FAST_SENT      // the command is sent at the press, the button event of the press is to be skipped
+} fast_state_t;
+static volatile fast_state_t _fast_states[NUM_BUTTONS] = {};
+
+typedef decltype(crp42602y_ctrl::STOP_COMMAND) command_t;  // command_t itself is not public
+
 // Instances
 static Buttons* buttons = nullptr;
+static button_edge* button_edge0 = nullptr;
 static crp42602y_ctrl* crp42602y_ctrl0 = nullptr;
 static crp42602y_counter* crp42602y_counter0 = nullptr;
 static eq_nr* eq_nr0 = nullptr;
+static deck_proto_server* deck_proto_server0 = nullptr;
+static dma_log* dma_log0 = nullptr;
+static ir_remote* ir_remote0 = nullptr;
+static level_meter* level_meter0 = nullptr;
 static ssd1306_t disp;
-
-/*
- * Font Format for reverse mode
- * <height>, <width>, <additional spacing per char>,
- * <first ascii char>, <last ascii char>,
- * <data>
- */
-static const uint8_t font_reverse_mode[] =
-{
-    16, 16, 1, 0, 2,
-    // One Way
-    0x00,0x00,0x10,0x08,0x10,0x1C,0x10,0x3E,0x10,0x7F,0x10,0x08,0x10,0x08,0x10,0x08,
-    0x10,0x08,0x10,0x08,0x10,0x08,0xFE,0x08,0x7C,0x08,0x38,0x08,0x10,0x08,0x00,0x00,
-    // One Round
-    0x00,0x00,0x10,0x08,0x10,0x1C,0x10,0x3E,0x10,0x7F,0x10,0x08,0x10,0x08,0x10,0x08,
-    0x10,0x08,0x10,0x08,0x10,0x08,0x10,0x08,0x10,0x08,0x20,0x04,0xC0,0x03,0x00,0x00,
-    // Infinite Round
-    0x00,0x00,0xC0,0x03,0x20,0x04,0x10,0x08,0x10,0x1C,0x10,0x3E,0x10,0x7F,0x10,0x08,
-    0x10,0x08,0xFE,0x08,0x7C,0x08,0x38,0x08,0x10,0x08,0x20,0x04,0xC0,0x03,0x00,0x00
-};
-
-/*
- * Font Format for bluetooth
- * <height>, <width>, <additional spacing per char>,
- * <first ascii char>, <last ascii char>,
- * <data>
- */
-static const uint8_t font_bluetooth[] =
-{
-    16, 16, 1, 0, 0,
-    0x00,0x00,0x00,0x00,0x00,0x00,0xC0,0x07,0xF0,0x1F,0xB8,0x3B,0x7C,0x7D,0x04,0x40,
-    0xEC,0x6E,0x5C,0x75,0xB8,0x3B,0xF0,0x1F,0xC0,0x07,0x00,0x00,0x00,0x00,0x00,0x00
-};
+static ssd1306_canvas canvas(&disp);
+static deck_ui ui(&canvas);
 
 static inline uint64_t _micros()
 {
@@ -150,70 +216,89 @@ static inline uint32_t _millis()
     return to_ms_since_boot(get_absolute_time());
 }
 
-static void _ssd1306_clear_square(ssd1306_t* p, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+static void _ssd1306_show(ssd1306_canvas* p)
 {
-    for (uint32_t iy = y; iy < y + height; iy++) {
-        for (uint32_t ix = x; ix < x + width; ix++) {
-            ssd1306_clear_pixel(p, ix, iy);
-        }
-    }
+    if (!_crp42602y_power) { return; }
+    p->show();  // only the changed columns of each page are transmitted by DMA without waiting for the bus
 }
 
-static void _ssd1306_draw_arrow(ssd1306_t* p, uint32_t x, uint32_t y, bool right_dir)
+static void print_latency_stats(const char* name, latency_stats_t& stats)
 {
-    for (int i = 0; i < 6; i++) {
-        uint32_t sx = x + i*1;
-        uint32_t sy = y;
-        if (right_dir) {
-            ssd1306_draw_line(p, sx, sy, sx+8, sy+8);
-            ssd1306_draw_line(p, sx, sy+16, sx+8, sy+8);
-        } else {
-            ssd1306_draw_line(p, sx, sy+8, sx+8, sy);
-            ssd1306_draw_line(p, sx, sy+8, sx+8, sy+16);
-        }
+    uint32_t count = (stats.count > 0) ? stats.count : 1;
+    printf("  %s: %lu presses, avg %llu us, max %lu us\r\n", name, stats.count, stats.total_us / count, stats.max_us);
+    stats = {};
+}
+
+static void print_ui_stat()
+{
+    ssd1306_canvas::stats_t stats;
+    canvas.get_stats(stats);
+    uint32_t shows = (stats.shows > 0) ? stats.shows : 1;
+    printf("Display (%s): %lu shows, %lu frames, %lu deferred, %llu bytes/show, %llu us/show (max %lu us)\r\n",
+        canvas.get_full_refresh() ? "full refresh" : "dirty columns", stats.shows, stats.frames, stats.busy,
+        stats.bytes / shows, stats.time_us / shows, stats.max_time_us);
+    // the worst case latency from an input (serial or button event) to its action on core0 is the longest loop
+    printf("Core0 loop: max %lu us\r\n", _max_loop_us);
+    canvas.reset_stats();
+    _max_loop_us = 0;
+    // from the first edge of the button to send_command() including debounce
+    uint32_t status = save_and_disable_interrupts();
+    printf("Button to command\r\n");
+    print_latency_stats("edge", _fast_latency);
+    print_latency_stats("event", _polled_latency);
+    restore_interrupts(status);
+    const flash_journal::journal_stats_t& journal_stats = journal.get_stats();
+    printf("Journal: restore %lu us (%lu records), %lu flushes, %lu sector switches, %lu erases, write amplification %.2f\r\n",
+        journal_stats.restore_us, journal_stats.scanned, journal_stats.flushes, journal_stats.switches, journal_stats.erases, journal.get_write_amplification());
+    printf("Flash store: %lu stored, %lu skipped (unchanged), core1 blackout max %lu us\r\n", _flash_store_count, _flash_skip_count, _max_flash_blackout_us);
+    const deck_proto::parser_stats_t& proto_parser = deck_proto_server0->get_parser_stats();
+    const deck_proto_server::server_stats_t& proto_stats = deck_proto_server0->get_stats();
+    printf("Protocol: %lu frames, %lu errors, %lu timeouts, %lu commands (%lu rejected), %lu telemetry, %lu events\r\n",
+        proto_parser.frames, proto_parser.errors, proto_stats.timeouts, proto_stats.commands, proto_stats.rejected, proto_stats.telemetry, proto_stats.events);
+    const dma_log::log_stats_t& log_stats = dma_log0->get_stats();
+    printf("Log: %lu records, %lu dropped, max level %lu, %llu bytes, %lu DMA transfers\r\n",
+        log_stats.records, log_stats.dropped, log_stats.max_level, log_stats.bytes, log_stats.transfers);
+    const ir_decoder::decoder_stats_t& ir_stats = ir_remote0->get_stats();
+    printf("IR remote: %lu frames, %lu repeats, %lu errors\r\n", ir_stats.frames, ir_stats.repeats, ir_stats.errors);
+    if (level_meter0 != nullptr) {
+        const level_meter::meter_stats_t& meter_stats = level_meter0->get_stats();
+        uint64_t elapsed_us = (meter_stats.elapsed_us > 0) ? meter_stats.elapsed_us : 1;
+        printf("Level meter: %llu samples, %lu windows, %lu overruns, CPU %.2f %% (max %lu us/process), L %.1f dB, R %.1f dB\r\n",
+            meter_stats.samples, meter_stats.windows, meter_stats.overruns, (float) meter_stats.busy_us * 100.0f / elapsed_us, meter_stats.max_busy_us,
+            level_meter0->get_dsp(0).get_rms_db10() / 10.0f, level_meter0->get_dsp(1).get_rms_db10() / 10.0f);
     }
+    _max_flash_blackout_us = 0;
 }
 
-static void _ssd1306_draw_stop_arrow(ssd1306_t* p, bool right_dir)
+// frames of deck_proto share the serial with the text output in the ring of dma_log (not translated to CRLF)
+//   a frame dropped by full ring is recovered by the retry of the client
+static void serial_write(const uint8_t* data, size_t len)
 {
-    uint32_t ox = 64-14/2;
-    uint32_t oy = 32-8;
-    _ssd1306_draw_arrow(p, ox, oy, right_dir);
+    dma_log0->write(data, len);
 }
 
-// pos: 0 ~ 15
-static void _ssd1306_draw_play_arrow(ssd1306_t* p, bool right_dir, uint32_t pos)
+// debug log of the counter algorithm on core1 (stored to the ring, formatted on core0)
+static void counter_log(const char* fmt, va_list args)
 {
-    uint32_t ox = 64-14/2;
-    uint32_t oy = 32-8;
-    uint32_t ofs;
-    if (right_dir) {
-        ofs = (pos + 8) % 16;
-    } else {
-        ofs = (24 - pos) % 16;
-    }
-    _ssd1306_draw_arrow(p, ox + ofs - 8, oy, right_dir);
+    dma_log0->vlog(fmt, args);
 }
 
-static void _ssd1306_draw_cue_arrow(ssd1306_t* p, bool right_dir, uint32_t pos)
+// keys of IR remote (REPEAT is not logged)
+static void ir_remote_callback(const ir_decoder::key_event_t& event, const ir_remote::action_t action)
 {
-    uint32_t ox = 64-22/2;
-    uint32_t oy = 32-8;
-    uint32_t ofs;
-    if (right_dir) {
-        ofs = (pos + 8) % 16;
-    } else {
-        ofs = (24 - pos) % 16;
-    }
-    for (int i = 0; i < 2; i++) {
-        _ssd1306_draw_arrow(p, ox + i*8 + ofs - 8, oy, right_dir);
-    }
+    if (event.type == ir_decoder::EVT_REPEAT) return;
+    dma_log0->log("IR %s: %s address 0x%04x command 0x%02x (action %d)\r\n",
+        (event.protocol == ir_decoder::PROTOCOL_NEC) ? "NEC" : "RC-5", (event.type == ir_decoder::EVT_PRESS) ? "press" : "release",
+        event.address, event.command, (int) action);
 }
 
-static void _ssd1306_show(ssd1306_t* p)
+static void toggle_counter_log()
 {
-    if (!_crp42602y_power) { return; }
-    ssd1306_show(p);
+    static bool enabled = false;
+    if (crp42602y_counter0 == nullptr) return;
+    enabled = !enabled;
+    crp42602y_counter0->set_log_callback(enabled ? counter_log : nullptr);
+    printf("Counter log: %s\r\n", enabled ? "ON" : "OFF");
 }
 
 static bool periodic_func(repeating_timer_t* rt)
@@ -227,70 +312,126 @@ static bool periodic_func(repeating_timer_t* rt)
     return true; // keep repeating
 }
 
-static void stop()
+// the command is sent also from IRQ of the button edge front end, thus interrupts are disabled
+static void send_command(const command_t& command, const uint64_t edge_us = 0, const bool fast = false)
 {
-    crp42602y_ctrl0->send_command(crp42602y_ctrl::STOP_COMMAND);
+    uint32_t status = save_and_disable_interrupts();
+    crp42602y_ctrl0->send_command(command);
+    if (edge_us != 0) {
+        latency_stats_t& stats = fast ? _fast_latency : _polled_latency;
+        uint32_t latency_us = (uint32_t) (_micros() - edge_us);
+        stats.count++;
+        stats.total_us += latency_us;
+        if (latency_us > stats.max_us) stats.max_us = latency_us;
+    }
+    restore_interrupts(status);
 }
 
-static void play(bool nonReverse)
+static void stop(const uint64_t edge_us = 0)
+{
+    send_command(crp42602y_ctrl::STOP_COMMAND, edge_us);
+}
+
+static void play(bool nonReverse, const uint64_t edge_us = 0)
 {
     if (nonReverse) {
-        crp42602y_ctrl0->send_command(crp42602y_ctrl::PLAY_COMMAND);
+        send_command(crp42602y_ctrl::PLAY_COMMAND, edge_us);
     } else {
-        crp42602y_ctrl0->send_command(crp42602y_ctrl::PLAY_REVERSE_COMMAND);
+        send_command(crp42602y_ctrl::PLAY_REVERSE_COMMAND, edge_us);
     }
 }
 
-static void fast_forward()
+static void fast_forward(const uint64_t edge_us = 0, const bool fast = false)
+{
+    send_command(crp42602y_ctrl::FF_COMMAND, edge_us, fast);
+}
+
+static void rewind(const uint64_t edge_us = 0, const bool fast = false)
 {
-    crp42602y_ctrl0->send_command(crp42602y_ctrl::FF_COMMAND);
+    send_command(crp42602y_ctrl::REW_COMMAND, edge_us, fast);
+}
+
+static void cue_fast_forward(const uint64_t edge_us = 0, const bool fast = false)
+{
+    send_command(crp42602y_ctrl::CUE_FF_COMMAND, edge_us, fast);
+}
+
+static void cue_rewind(const uint64_t edge_us = 0, const bool fast = false)
+{
+    send_command(crp42602y_ctrl::CUE_REW_COMMAND, edge_us, fast);
+}
+
+static void down_button(const uint64_t edge_us, const bool fast)
+{
+    if (crp42602y_ctrl0->is_playing() || crp42602y_ctrl0->is_cueing()) {
+        cue_fast_forward(edge_us, fast);
+    } else {
+        fast_forward(edge_us, fast);
+    }
 }
 
-static void rewind()
+static void up_button(const uint64_t edge_us, const bool fast)
 {
-    crp42602y_ctrl0->send_command(crp42602y_ctrl::REW_COMMAND);
+    if (crp42602y_ctrl0->is_playing() || crp42602y_ctrl0->is_cueing()) {
+        cue_rewind(edge_us, fast);
+    } else {
+        rewind(edge_us, fast);
+    }
 }
 
-static void cue_fast_forward()
+// called in GPIO and alarm IRQ on core0
+static void button_edge_callback(const uint index, const button_edge::event_t event, const uint64_t edge_us)
 {
-    crp42602y_ctrl0->send_command(crp42602y_ctrl::CUE_FF_COMMAND);
+    if (event == button_edge::EVENT_EDGE) {
+        _fast_states[index] = FAST_PENDING;
+        // warm up the mechanism during power off (ahead of the button event decided later)
+        if (!_crp42602y_power) {
+            crp42602y_ctrl0->warm_up();
+        }
+        return;
+    }
+    // DOWN and UP are decided by the press itself, the other buttons wait for clicks or long press of the button event
+    if (_fast_states[index] != FAST_PENDING || !_crp42602y_power || _standby) return;
+    if (index == ID_DOWN_BUTTON) {
+        down_button(edge_us, true);
+    } else if (index == ID_UP_BUTTON) {
+        up_button(edge_us, true);
+    } else {
+        return;
+    }
+    _fast_states[index] = FAST_SENT;
+    crp42602y_ctrl0->extend_timeout_power_off();
 }
 
-static void cue_rewind()
+// check if the command of the press has been sent by the edge front end (the pending press is taken over)
+static bool take_fast_sent(const uint index)
 {
-    crp42602y_ctrl0->send_command(crp42602y_ctrl::CUE_REW_COMMAND);
+    uint32_t status = save_and_disable_interrupts();
+    bool sent = _fast_states[index] == FAST_SENT;
+    _fast_states[index] = FAST_IDLE;
+    restore_interrupts(status);
+    return sent;
 }
 
 static void crp42602y_process()
 {
-    flash_safe_execute_core_init();  // no access to flash on core1
-    _core1_is_running = true;
-    while (_core1_exec) {
+    flash_safe_execute_core_init();  // core1 accepts the lockout by flash_safe_execute() from core0
+    while (true) {
         crp42602y_ctrl0->process_loop();
+        crp42602y_ctrl0->wait_for_event();
     }
-    _core1_is_running = false;
 }
 
 static void exec_core1_crp42602y_process()
 {
     multicore_reset_core1();
-    _core1_exec = true;
     multicore_launch_core1(crp42602y_process);
 }
 
-static void terminate_core1_crp42602y_process()
-{
-    _core1_exec = false;
-    // blocks until it ends
-    while (_core1_is_running) {
-        sleep_ms(10);
-    }
-}
-
 static void crp42602y_callback(const crp42602y_ctrl::callback_type_t callback_type)
 {
     if (!queue_try_add(&_callback_queue, &callback_type)) {
-        printf("ERROR: _callback_queue is full\r\n");
+        dma_log0->log("ERROR: _callback_queue is full\r\n");
     }
 }
 
@@ -337,9 +478,8 @@ static void inc_reverse_mode(bool inc = true)
             break;
         }
     }
-    _ssd1306_clear_square(&disp, 0, 64-16, 16, 16);
-    ssd1306_draw_char_with_font(&disp, 0, 64-16, 1, font_reverse_mode, (char) reverse_mode);
-    _ssd1306_show(&disp);
+    ui.draw_reverse_mode(reverse_mode);
+    _ssd1306_show(&canvas);
 }
 
 static void inc_eq(bool inc = true)
@@ -363,22 +503,8 @@ static void inc_eq(bool inc = true)
             break;
         }
     }
-    const int n = 6;
-    const uint32_t sx = 128-6*n;
-    const uint32_t sy = 0;
-    _ssd1306_clear_square(&disp, sx, sy, 6*n, 8);
-    switch (eq_type) {
-    case eq_nr::EQ_120US:
-        ssd1306_draw_string(&disp, sx, sy, 1, "120 uS");
-        break;
-    case eq_nr::EQ_70US:
-        ssd1306_draw_string(&disp, sx, sy, 1, " 70 uS");
-        break;
-    default:
-        ssd1306_draw_string(&disp, sx, sy, 1, "120 uS");
-        break;
-    }
-    _ssd1306_show(&disp);
+    ui.draw_eq(eq_type);
+    _ssd1306_show(&canvas);
 }
 
 static void inc_nr(bool inc = true)
@@ -405,25 +531,8 @@ static void inc_nr(bool inc = true)
             break;
         }
     }
-    const int n = 7;
-    const uint32_t sx = 128-6*n;
-    const uint32_t sy = 64-8;
-    _ssd1306_clear_square(&disp, sx, sy, 6*n, 8);
-    switch (nr_type) {
-    case eq_nr::NR_OFF:
-        ssd1306_draw_string(&disp, sx, sy, 1, " NR OFF");
-        break;
-    case eq_nr::DOLBY_B:
-        ssd1306_draw_string(&disp, sx, sy, 1, "Dolby B");
-        break;
-    case eq_nr::DOLBY_C:
-        ssd1306_draw_string(&disp, sx, sy, 1, "Dolby C");
-        break;
-    default:
-        ssd1306_draw_string(&disp, sx, sy, 1, "NR OFF");
-        break;
-    }
-    _ssd1306_show(&disp);
+    ui.draw_nr(nr_type);
+    _ssd1306_show(&canvas);
 }
 
 static void set_bt_tx_enable(bool flag)
@@ -450,23 +559,18 @@ static void send_bt_tx_connect(bool flag)
 static void reset_counter()
 {
     if (crp42602y_counter0 != nullptr) {
-        printf("Reset counter\r\n");
-        crp42602y_counter0->reset();
+        if (crp42602y_counter0->reset()) {
+            printf("Reset counter\r\n");
+        } else {
+            printf("Reset counter failed (request queue full)\r\n");
+        }
     }
 }
 
 static void disp_default_contents()
 {
-    _ssd1306_clear_square(&disp, 0, 8, 128-16, 8*5);
-    if (_has_cassette) {
-        _ssd1306_draw_stop_arrow(&disp, crp42602y_ctrl0->get_head_dir_is_a());
-    } else {
-        ssd1306_draw_string(&disp, 32, 32-4, 1, "NO CASSETTE");
-    }
-
-    _ssd1306_clear_square(&disp, 0, 0, 6*7, 8);
-    ssd1306_draw_string(&disp, 0, 0, 1, "STOP");
-    _ssd1306_show(&disp);
+    ui.draw_default(_has_cassette, crp42602y_ctrl0->get_head_dir_is_a());
+    _ssd1306_show(&canvas);
 
     inc_head_dir(false);
     inc_reverse_mode(false);
@@ -484,32 +588,221 @@ static void load_from_flash()
     set_bt_tx_enable(cfgParam.P_CFG_BT_TX_ENABLE.get());
 }
 
+/**
+ * store ConfigParam to flash
+ *   core1 keeps running and is paused only during erase and program by the lockout of flash_safe_execute(),
+ *   thus the store is deferred to the idle window of the mechanism (no operation, gear sequence or command)
+ *
+ * @return true if stored or unchanged, false if failed or deferred
+ */
 static bool store_to_flash()
 {
     ConfigParam& cfgParam = ConfigParam::instance();
-    cfgParam.P_CFG_EQ_TYPE.set(static_cast<uint32_t>(eq_nr0->get_eq_type()));
-    cfgParam.P_CFG_NR_TYPE.set(static_cast<uint32_t>(eq_nr0->get_nr_type()));
-    cfgParam.P_CFG_REVERSE_MODE.set(static_cast<uint32_t>(crp42602y_ctrl0->get_reverse_mode()));
-    cfgParam.P_CFG_BT_TX_ENABLE.set(get_bt_tx_enable());
-
-    // running core1 can let flash programming crash
-    terminate_core1_crp42602y_process();
-    bool flag;
-    if (cfgParam.finalize()) {
-        printf("store ConfigParam to flash successfully\r\n");
-        flag = true;
+    const uint32_t eq_type = static_cast<uint32_t>(eq_nr0->get_eq_type());
+    const uint32_t nr_type = static_cast<uint32_t>(eq_nr0->get_nr_type());
+    const uint32_t reverse_mode = static_cast<uint32_t>(crp42602y_ctrl0->get_reverse_mode());
+    const bool bt_tx_enable = get_bt_tx_enable();
+    if (cfgParam.P_CFG_EQ_TYPE.get() == eq_type && cfgParam.P_CFG_NR_TYPE.get() == nr_type &&
+        cfgParam.P_CFG_REVERSE_MODE.get() == reverse_mode && cfgParam.P_CFG_BT_TX_ENABLE.get() == bt_tx_enable) {
+        _flash_store_pending = false;
+        _flash_skip_count++;
+        printf("ConfigParam unchanged, skip to store\r\n");
+        return true;
+    }
+    if (!crp42602y_ctrl0->is_idle()) {
+        _flash_store_pending = true;
+        return false;
+    }
+    _flash_store_pending = false;
+    cfgParam.P_CFG_EQ_TYPE.set(eq_type);
+    cfgParam.P_CFG_NR_TYPE.set(nr_type);
+    cfgParam.P_CFG_REVERSE_MODE.set(reverse_mode);
+    cfgParam.P_CFG_BT_TX_ENABLE.set(bt_tx_enable);
+
+    // the blackout of core1 is within the time of finalize() (lockout, erase and program)
+    uint64_t start_us = _micros();
+    bool flag = cfgParam.finalize();
+    uint32_t blackout_us = static_cast<uint32_t>(_micros() - start_us);
+    if (blackout_us > _max_flash_blackout_us) _max_flash_blackout_us = blackout_us;
+    if (flag) {
+        _flash_store_count++;
+        printf("store ConfigParam to flash successfully (core1 blackout %lu us)\r\n", blackout_us);
     } else {
         printf("ERROR: failed to store ConfigParam to flash\r\n");
-        flag = false;
     }
-    exec_core1_crp42602y_process();
     return flag;
 }
 
+static uint64_t _float_to_bits(const float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static float _bits_to_float(const uint64_t bits)
+{
+    uint32_t word = static_cast<uint32_t>(bits);
+    float value;
+    memcpy(&value, &word, sizeof(value));
+    return value;
+}
+
+static uint64_t journal_get(const journal_key_t key)
+{
+    uint64_t value = 0;
+    journal.get(key, value);
+    return value;
+}
+
+static void journal_add(const journal_key_t key, const uint64_t count)
+{
+    journal.put(key, journal_get(key) + count);
+}
+
+static void journal_restore()
+{
+    bool restored = journal.open();
+    const flash_journal::journal_stats_t& stats = journal.get_stats();
+    printf("Journal %s in %lu us (%lu records read)\r\n", restored ? "restored" : "empty", stats.restore_us, stats.scanned);
+    uint64_t position_a;
+    uint64_t position_b;
+    if (journal.get(JOURNAL_POSITION_A, position_a) && journal.get(JOURNAL_POSITION_B, position_b)) {
+        printf("  last position: A %.1f sec, B %.1f sec\r\n", _bits_to_float(position_a), _bits_to_float(position_b));
+    }
+    printf("  play %llu sec, gear cycles %llu, gear errors %llu, power cycles %llu\r\n", journal_get(JOURNAL_PLAY_MS) / 1000,
+        journal_get(JOURNAL_GEAR_CYCLES), journal_get(JOURNAL_GEAR_ERRORS), journal_get(JOURNAL_POWER_CYCLES));
+    journal_add(JOURNAL_POWER_CYCLES, 1);
+}
+
+// the records are put on RAM, flush() is done at the idle window of the mechanism
+static void journal_on_callback(const crp42602y_ctrl::callback_type_t callback_type)
+{
+    switch (callback_type) {
+    case crp42602y_ctrl::ON_PLAY:
+        journal_add(JOURNAL_GEAR_CYCLES, 1);
+        if (_play_start_ms == 0) _play_start_ms = _millis();  // play continues at auto reverse
+        return;
+    case crp42602y_ctrl::ON_STOP:  // fallthrough
+    case crp42602y_ctrl::ON_FF_REW:  // fallthrough
+    case crp42602y_ctrl::ON_CUE:
+        journal_add(JOURNAL_GEAR_CYCLES, 1);
+        break;
+    case crp42602y_ctrl::ON_GEAR_ERROR:
+        journal_add(JOURNAL_GEAR_ERRORS, 1);
+        break;
+    case crp42602y_ctrl::ON_TIMEOUT_POWER_OFF:
+        break;
+    case crp42602y_ctrl::ON_RECOVER_POWER_FROM_TIMEOUT:
+        journal_add(JOURNAL_POWER_CYCLES, 1);
+        return;
+    default:
+        return;
+    }
+    if (_play_start_ms != 0) {
+        journal_add(JOURNAL_PLAY_MS, _millis() - _play_start_ms);
+        _play_start_ms = 0;
+    }
+    if (callback_type == crp42602y_ctrl::ON_STOP && crp42602y_counter0 != nullptr) {
+        crp42602y_counter::counter_snapshot_t snapshot;
+        crp42602y_counter0->get_snapshot(snapshot);
+        journal.put(JOURNAL_POSITION_A, _float_to_bits(snapshot.playing_sec[0]));
+        journal.put(JOURNAL_POSITION_B, _float_to_bits(snapshot.playing_sec[1]));
+        journal.put(JOURNAL_TAPE_THICKNESS, _float_to_bits(snapshot.tape_thickness_um));
+    }
+}
+
+static void __isr standby_gpio_irq_handler()
+{
+    // only to wake up core0 from WFE, the wake up sources are checked in the main loop
+    uint32_t mask = _standby_wake_mask;
+    while (mask) {
+        uint gpio = __builtin_ctz(mask);
+        mask &= mask - 1;
+        uint32_t events = gpio_get_irq_event_mask(gpio) & (GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE);
+        if (events) {
+            gpio_acknowledge_irq(gpio, events);
+        }
+    }
+}
+
+static bool is_any_button_pressed()
+{
+    for (int i = 0; i < sizeof(btns_5way_tactile_plus2) / sizeof(button_t); i++) {
+        if (!gpio_get(btns_5way_tactile_plus2[i].pin)) return true;
+    }
+    return false;
+}
+
+static void enter_standby()
+{
+    // core1 is already parked in wait_for_event() since the controller has no deadline during power off
+    cancel_repeating_timer(&timer);
+    canvas.wait_idle();
+    ssd1306_poweroff(&disp);
+
+    // wake up by serial input and IR remote (button edges wake up by the IRQ of the edge front end, cassette set wakes up by the callback from core1)
+    //   IR receiver wakes up by both edges since the frame is pushed by the state machine after the falling edge of its last burst
+    _standby_wake_mask = 1UL << PIN_IR_RECEIVER;
+#if LIB_PICO_STDIO_UART && defined(PICO_DEFAULT_UART_RX_PIN)
+    _standby_wake_mask |= 1UL << PICO_DEFAULT_UART_RX_PIN;  // start bit
+#endif
+    for (uint32_t mask = _standby_wake_mask; mask; mask &= mask - 1) {
+        gpio_set_irq_enabled(__builtin_ctz(mask), GPIO_IRQ_EDGE_FALL, true);
+    }
+    gpio_set_irq_enabled(PIN_IR_RECEIVER, GPIO_IRQ_EDGE_RISE, true);
+    gpio_add_raw_irq_handler_masked(_standby_wake_mask, standby_gpio_irq_handler);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+
+    // run clk_sys and clk_peri from PLL_USB (48 MHz) and stop PLL_SYS and unused clocks
+    //   clk_ref and the timer are kept, thus the time base of the controller is not disturbed
+    stdio_flush();  // drains the log before the baud rate changes
+    _standby_sys_clock_khz = clock_get_hz(clk_sys) / 1000;
+    if (level_meter0 != nullptr) level_meter0->stop();
+    clock_stop(clk_adc);
+    clock_stop(clk_rtc);
+    set_sys_clock_48mhz();
+#if LIB_PICO_STDIO_UART
+    uart_set_baudrate(uart_default, PICO_DEFAULT_UART_BAUD_RATE);
+#endif
+    ir_remote0->restart();  // clock divider for 48 MHz
+    _standby_start_us = _micros();
+    _standby = true;
+}
+
+static void exit_standby()
+{
+    uint64_t wake_us = _micros();
+    set_sys_clock_khz(_standby_sys_clock_khz, true);
+    clock_configure(clk_adc, 0, CLOCKS_CLK_ADC_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB, USB_CLK_HZ, USB_CLK_HZ);
+    clock_configure(clk_rtc, 0, CLOCKS_CLK_RTC_CTRL_AUXSRC_VALUE_CLKSRC_PLL_USB, USB_CLK_HZ, 46875);
+#if LIB_PICO_STDIO_UART
+    uart_set_baudrate(uart_default, PICO_DEFAULT_UART_BAUD_RATE);
+#endif
+    ir_remote0->restart();  // the frame waking up is kept
+    if (level_meter0 != nullptr) level_meter0->start();
+
+    gpio_remove_raw_irq_handler_masked(_standby_wake_mask, standby_gpio_irq_handler);
+    for (uint32_t mask = _standby_wake_mask; mask; mask &= mask - 1) {
+        gpio_set_irq_enabled(__builtin_ctz(mask), GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, false);
+    }
+    _standby_wake_mask = 0;
+    ssd1306_poweron(&disp);
+    add_repeating_timer_us(-INTERVAL_MS_BUTTONS_CHECK * 1000, periodic_func, nullptr, &timer);
+    _standby = false;
+
+    uint64_t ready_us = _micros();
+    printf("Standby exit: %llu ms in standby, wake-to-ready %llu us\r\n", (wake_us - _standby_start_us) / 1000, ready_us - wake_us);
+}
+
 int main()
 {
     stdio_init_all();
 
+    // Logging console: printf and the records go through the ring drained by DMA to UART
+    dma_log0 = new dma_log(uart_default);
+    dma_log0->enable_stdio();
+
     // GPIO settings
     gpio_init(PIN_LED);
     gpio_set_dir(PIN_LED, GPIO_OUT);
@@ -553,11 +846,28 @@ int main()
         crp42602y_ctrl0 = new crp42602y_ctrl(PIN_CASSETTE_DETECT, PIN_GEAR_STATUS_SW, PIN_ROTATION_SENS, PIN_SOLENOID_CTRL, PIN_POWER_CTRL);
     }
     crp42602y_ctrl0->set_power_off_timeout_sec(POWER_OFF_TIMEOUT_SEC);
+    crp42602y_ctrl0->set_warm_standby_ms(WARM_STANDBY_MS);
     crp42602y_ctrl0->register_callback_all(crp42602y_callback);
 
+    // Button edge front end (the press is timestamped and DOWN/UP commands are sent at the press)
+    button_edge0 = new button_edge(button_pins, NUM_BUTTONS, button_edge_callback, BUTTON_DEBOUNCE_US);
+
+    // Binary framed protocol on the serial with the single character commands
+    deck_proto_server0 = new deck_proto_server(crp42602y_ctrl0, serial_write);
+
     // EQ_NR
     eq_nr0 = new eq_nr(PIN_EQ_CTRL, PIN_NR_CTRL0, PIN_NR_CTRL1, PIN_EQ_MUTE);
 
+    // IR remote (the state machines are on the other PIO than the counter)
+    ir_remote0 = new ir_remote(crp42602y_ctrl0, PIN_IR_RECEIVER);
+    ir_remote0->set_keymap(ir_keymap, sizeof(ir_keymap) / sizeof(ir_remote::keymap_entry_t));
+    ir_remote0->register_callback(ir_remote_callback);
+
+#if SINGLE_PB_DECK_LEVEL_METER
+    // Level meter (the ADC and a DMA channel sample without CPU, the levels are measured in the UI loop)
+    level_meter0 = new level_meter(LEVEL_METER_INPUT_MASK);
+#endif
+
     // Bluetooth Tx
     gpio_init(PIN_BT_TX_POWER);
     gpio_set_dir(PIN_BT_TX_POWER, GPIO_OUT);
@@ -568,11 +878,12 @@ int main()
     // SSD1306
     disp.external_vcc = false;
     ssd1306_init(&disp, 128, 64, 0x3C, i2c0);
-    ssd1306_clear(&disp);
-    _ssd1306_show(&disp);
+    canvas.clear();
+    _ssd1306_show(&canvas);
 
     // configParam
     load_from_flash();
+    journal_restore();
     disp_default_contents();
 
     // negative timeout means exact delay (rather than delay between callbacks)
@@ -590,194 +901,231 @@ int main()
     button_event_t btnEvent;
 
     uint32_t prev_disp_time = 0;
+    uint64_t prev_loop_us = 0;
+    bool prev_button_pressed = false;
     int disp_count = 0;
     int bt_tx_count = 0;
     while (true) {
+        int c = getchar_timeout_us(0);
+
+        // Standby: sleep until serial input, button press, IR remote key or callback (cassette set)
+        if (_standby) {
+            if (c < 0 && !is_any_button_pressed() && !ir_remote0->has_frame() && queue_is_empty(&_callback_queue)) {
+                __wfe();
+                continue;
+            }
+            exit_standby();
+            prev_loop_us = 0;
+        }
+
         uint32_t now_time = _millis();
+        uint64_t loop_us = _micros();
+        if (prev_loop_us != 0 && loop_us - prev_loop_us > _max_loop_us) {
+            _max_loop_us = (uint32_t) (loop_us - prev_loop_us);
+        }
+        prev_loop_us = loop_us;
 
-        // Serial I/F
-        int c = getchar_timeout_us(0);
+        // Warm up the mechanism at the button press during power off (fallback of the edge front end)
+        bool button_pressed = is_any_button_pressed();
+        if (button_pressed && !prev_button_pressed && !_crp42602y_power) {
+            crp42602y_ctrl0->warm_up();
+        }
+        prev_button_pressed = button_pressed;
+
+        // Serial I/F: the frames of deck_proto are taken first, other bytes are single character commands
+        //   (the command is accepted also at the recovery from power off)
+        while (c >= 0 && deck_proto_server0->feed((uint8_t) c)) {
+            c = getchar_timeout_us(0);
+        }
+        deck_proto_server0->process();
         if (c >= 0) {
             if (!_crp42602y_power) {
                 crp42602y_ctrl0->recover_power_from_timeout();
-            } else {
-                if (c == 's') stop();
-                if (c == 'p') play(true);
-                if (c == 'q') play(false);
-                if (c == 'f') fast_forward();
-                if (c == 'r') rewind();
-                if (c == 'd') inc_head_dir();
-                if (c == 'v') inc_reverse_mode();
-                if (c == 'e') inc_eq();
-                if (c == 'n') inc_nr();
-                if (c == 'c') reset_counter();
+            }
+            if (c == 's') stop();
+            if (c == 'p') play(true);
+            if (c == 'q') play(false);
+            if (c == 'f') fast_forward();
+            if (c == 'r') rewind();
+            if (c == 'd') inc_head_dir();
+            if (c == 'v') inc_reverse_mode();
+            if (c == 'e') inc_eq();
+            if (c == 'n') inc_nr();
+            if (c == 'c') reset_counter();
+            if (c == 'i') print_ui_stat();
+            if (c == 'l') toggle_counter_log();
+            if (c == 'u') {
+                canvas.set_full_refresh(!canvas.get_full_refresh());
+                print_ui_stat();
             }
         }
 
-        // Button I/F
+        // IR remote I/F (the command is accepted also at the recovery from power off)
+        ir_remote0->process();
+
+        // Level meter (the samples since the last loop)
+        if (level_meter0 != nullptr) level_meter0->process();
+
+        // Button I/F (the command is accepted also at the recovery from power off)
         if (buttons->get_button_event(btnEvent)) {
             if (!_crp42602y_power) {
                 crp42602y_ctrl0->recover_power_from_timeout();
-            } else {
-                switch (btnEvent.type) {
-                case EVT_SINGLE:
-                    if (btnEvent.repeat_count > 0) {
-                        //printf("%s: 1 (Repeated %d)\r\n", btnEvent.button_name, btnEvent.repeat_count);
-                    } else {
-                        //printf("%s: 1\r\n", btnEvent.button_name);
-                        if (btnEvent.button_id == ID_CENTER_BUTTON) {
-                            if (crp42602y_ctrl0->is_playing() || crp42602y_ctrl0->is_ff_rew_ing()) {
-                                stop();
-                            } else {
-                                play(true);
-                            }
-                        } else if (btnEvent.button_id == ID_DOWN_BUTTON) {
-                            if (crp42602y_ctrl0->is_playing() || crp42602y_ctrl0->is_cueing()) {
-                                cue_fast_forward();
-                            } else {
-                                fast_forward();
-                            }
-                        } else if (btnEvent.button_id == ID_UP_BUTTON) {
-                            if (crp42602y_ctrl0->is_playing() || crp42602y_ctrl0->is_cueing()) {
-                                cue_rewind();
-                            } else {
-                                rewind();
-                            }
-                        } else if (btnEvent.button_id == ID_RIGHT_BUTTON) {
-                            inc_head_dir(_crp42602y_power && _has_cassette);
-                        } else if (btnEvent.button_id == ID_LEFT_BUTTON) {
-                            inc_reverse_mode(_crp42602y_power);
-                        } else if (btnEvent.button_id == ID_RESET_BUTTON) {
-                            inc_eq(_crp42602y_power);
-                        } else if (btnEvent.button_id == ID_SET_BUTTON) {
-                            inc_nr(_crp42602y_power);
-                        }
-                    }
-                    break;
-                case EVT_MULTI:
-                    //printf("%s: %d\r\n", btnEvent.button_name, btnEvent.click_count);
+            }
+            uint64_t edge_us = button_edge0->get_edge_time_us(btnEvent.button_id);
+            switch (btnEvent.type) {
+            case EVT_SINGLE:
+                if (btnEvent.repeat_count > 0) {
+                    dma_log0->log("Button %d: 1 (Repeated %d)\r\n", btnEvent.button_id, btnEvent.repeat_count);
+                } else {
+                    dma_log0->log("Button %d: 1\r\n", btnEvent.button_id);
                     if (btnEvent.button_id == ID_CENTER_BUTTON) {
-                        if (btnEvent.click_count == 2) {
-                            play(false);
-                        } else if (btnEvent.click_count == 3) {
-                            if (!get_bt_tx_enable()) {
-                                set_bt_tx_enable(true);
-                            } else {
-                                _bt_tx_connect_req = true;
-                            }
+                        if (crp42602y_ctrl0->is_playing() || crp42602y_ctrl0->is_ff_rew_ing()) {
+                            stop(edge_us);
+                        } else {
+                            play(true, edge_us);
+                        }
+                    } else if (btnEvent.button_id == ID_DOWN_BUTTON) {
+                        if (!take_fast_sent(ID_DOWN_BUTTON)) {
+                            down_button(edge_us, false);
+                        }
+                    } else if (btnEvent.button_id == ID_UP_BUTTON) {
+                        if (!take_fast_sent(ID_UP_BUTTON)) {
+                            up_button(edge_us, false);
                         }
-                    }
-                    break;
-                case EVT_LONG:
-                    //printf("%s: Long\r\n", btnEvent.button_name);
-                    if (btnEvent.button_id == ID_LEFT_BUTTON) {
-                        reset_counter();
                     } else if (btnEvent.button_id == ID_RIGHT_BUTTON) {
-                        if (!_flash_stored_display && !crp42602y_ctrl0->is_operating()) {
-                            if (store_to_flash()) {
-                                _flash_stored_display = true;
-                            }
+                        inc_head_dir(_crp42602y_power && _has_cassette);
+                    } else if (btnEvent.button_id == ID_LEFT_BUTTON) {
+                        inc_reverse_mode(_crp42602y_power);
+                    } else if (btnEvent.button_id == ID_RESET_BUTTON) {
+                        inc_eq(_crp42602y_power);
+                    } else if (btnEvent.button_id == ID_SET_BUTTON) {
+                        inc_nr(_crp42602y_power);
+                    }
+                }
+                break;
+            case EVT_MULTI:
+                dma_log0->log("Button %d: %d\r\n", btnEvent.button_id, btnEvent.click_count);
+                if (btnEvent.button_id == ID_CENTER_BUTTON) {
+                    if (btnEvent.click_count == 2) {
+                        play(false);
+                    } else if (btnEvent.click_count == 3) {
+                        if (!get_bt_tx_enable()) {
+                            set_bt_tx_enable(true);
+                        } else {
+                            _bt_tx_connect_req = true;
                         }
                     }
-                    break;
-                case EVT_LONG_LONG:
-                    //printf("%s: LongLong\r\n", btnEvent.button_name);
-                    if (btnEvent.button_id == ID_CENTER_BUTTON) {
-                        toggle_bt_tx_enable();
+                }
+                break;
+            case EVT_LONG:
+                dma_log0->log("Button %d: Long\r\n", btnEvent.button_id);
+                if (btnEvent.button_id == ID_LEFT_BUTTON) {
+                    reset_counter();
+                } else if (btnEvent.button_id == ID_RIGHT_BUTTON) {
+                    if (!_flash_stored_display && !crp42602y_ctrl0->is_operating()) {
+                        if (store_to_flash()) {
+                            _flash_stored_display = true;
+                        }
                     }
-                    break;
-                default:
-                    break;
                 }
-                crp42602y_ctrl0->extend_timeout_power_off();
+                break;
+            case EVT_LONG_LONG:
+                dma_log0->log("Button %d: LongLong\r\n", btnEvent.button_id);
+                if (btnEvent.button_id == ID_CENTER_BUTTON) {
+                    toggle_bt_tx_enable();
+                }
+                break;
+            default:
+                break;
             }
+            crp42602y_ctrl0->extend_timeout_power_off();
         }
 
         // Process callback
         crp42602y_ctrl::callback_type_t callback_type;
         while (crp42602y_get_callback(&callback_type)) {
+            journal_on_callback(callback_type);
+            deck_proto_server0->notify_event(callback_type);
             switch (callback_type) {
             // don't use ON_REVERSE since it always comes with ON_PLAY
             case crp42602y_ctrl::ON_GEAR_ERROR:
-                printf("Gear error\r\n");
+                dma_log0->log("Gear error\r\n");
                 prev_disp_time = 0;
                 break;
             case crp42602y_ctrl::ON_COMMAND_FIFO_OVERFLOW:
-                printf("Command FIFO overflow\r\n");
+                dma_log0->log("Command FIFO overflow\r\n");
                 prev_disp_time = 0;
                 break;
             case crp42602y_ctrl_with_counter::ON_COUNTER_FIFO_OVERFLOW:
-                printf("Counter FIFO overflow\r\n");
+                dma_log0->log("Counter FIFO overflow\r\n");
                 prev_disp_time = 0;
                 break;
             case crp42602y_ctrl::ON_CASSETTE_SET:
-                printf("Cassette set\r\n");
+                dma_log0->log("Cassette set\r\n");
                 _has_cassette = true;
                 prev_disp_time = 0;
-                crp42602y_ctrl0->recover_power_from_timeout();
+                // the power is already turned on by warm standby
                 break;
             case crp42602y_ctrl::ON_CASSETTE_EJECT:
-                printf("Cassette eject\r\n");
+                dma_log0->log("Cassette eject\r\n");
                 _has_cassette = false;
                 prev_disp_time = 0;
                 break;
             case crp42602y_ctrl::ON_STOP:
-                printf("Stop\r\n");
-                _ssd1306_clear_square(&disp, 0, 0, 6*7, 8);
-                ssd1306_draw_string(&disp, 0, 0, 1, "STOP");
-                _ssd1306_show(&disp);
+                dma_log0->log("Stop\r\n");
+                ui.draw_mode(deck_ui::MODE_STOP);
+                _ssd1306_show(&canvas);
                 prev_disp_time = 0;
                 eq_nr0->set_mute(true);
                 break;
             case crp42602y_ctrl::ON_PLAY:
-                _ssd1306_clear_square(&disp, 0, 0, 6*7, 8);
                 if (crp42602y_ctrl0->get_head_dir_is_a()) {
-                    printf("Play A\r\n");
-                    ssd1306_draw_string(&disp, 0, 0, 1, "PLAY A");
+                    dma_log0->log("Play A\r\n");
+                    ui.draw_mode(deck_ui::MODE_PLAY_A);
                 } else {
-                    printf("Play B\r\n");
-                    ssd1306_draw_string(&disp, 0, 0, 1, "PLAY B");
+                    dma_log0->log("Play B\r\n");
+                    ui.draw_mode(deck_ui::MODE_PLAY_B);
                 }
-                _ssd1306_show(&disp);
+                _ssd1306_show(&canvas);
                 prev_disp_time = 0;
                 eq_nr0->set_mute(false);
                 break;
             case crp42602y_ctrl::ON_FF_REW:
-                _ssd1306_clear_square(&disp, 0, 0, 6*7, 8);
                 if (crp42602y_ctrl0->get_cue_dir_is_a()) {
-                    printf("FF\r\n");
-                    ssd1306_draw_string(&disp, 0, 0, 1, "FF");
+                    dma_log0->log("FF\r\n");
+                    ui.draw_mode(deck_ui::MODE_FF);
                 } else {
-                    printf("REW\r\n");
-                    ssd1306_draw_string(&disp, 0, 0, 1, "REW");
+                    dma_log0->log("REW\r\n");
+                    ui.draw_mode(deck_ui::MODE_REW);
                 }
-                _ssd1306_show(&disp);
+                _ssd1306_show(&canvas);
                 prev_disp_time = 0;
                 eq_nr0->set_mute(true);
                 break;
             case crp42602y_ctrl::ON_CUE:
-                _ssd1306_clear_square(&disp, 0, 0, 6*7, 8);
                 if (crp42602y_ctrl0->get_cue_dir_is_a()) {
-                    printf("FF CUE\r\n");
-                    ssd1306_draw_string(&disp, 0, 0, 1, "FF CUE");
+                    dma_log0->log("FF CUE\r\n");
+                    ui.draw_mode(deck_ui::MODE_FF_CUE);
                 } else {
-                    printf("REW CUE\r\n");
-                    ssd1306_draw_string(&disp, 0, 0, 1, "REW CUE");
+                    dma_log0->log("REW CUE\r\n");
+                    ui.draw_mode(deck_ui::MODE_REW_CUE);
                 }
-                _ssd1306_show(&disp);
+                _ssd1306_show(&canvas);
                 prev_disp_time = 0;
                 eq_nr0->set_mute(true);
                 break;
             case crp42602y_ctrl::ON_TIMEOUT_POWER_OFF:
                 store_to_flash();
-                printf("Power off\r\n");
-                ssd1306_clear(&disp);
-                _ssd1306_show(&disp);
+                journal.flush();
+                dma_log0->log("Power off\r\n");
+                ui.clear();
+                _ssd1306_show(&canvas);
                 _crp42602y_power = false;
                 prev_disp_time = 0;
+                enter_standby();
                 break;
             case crp42602y_ctrl::ON_RECOVER_POWER_FROM_TIMEOUT:
-                printf("Power recover\r\n");
+                dma_log0->log("Power recover\r\n");
                 disp_default_contents();
                 _crp42602y_power = true;
                 prev_disp_time = 0;
@@ -787,56 +1135,64 @@ int main()
             }
         }
 
+        // Flash store deferred to the idle window of the mechanism
+        if (_flash_store_pending && crp42602y_ctrl0->is_idle()) {
+            store_to_flash();
+        }
+
+        // Flash journal at the idle window of the mechanism (batch of the records, otherwise erase of a stale sector)
+        if (crp42602y_ctrl0->is_idle()) {
+            if (journal.get_num_pending() > 0) {
+                journal.flush();
+            } else {
+                journal.compact();
+            }
+        }
+
+        // Display changes deferred by the transfer in progress
+        if (canvas.is_pending() && !canvas.is_busy()) {
+            _ssd1306_show(&canvas);
+        }
+
         if (now_time - prev_disp_time > DISP_INTERVAL_MS) {
             if (_crp42602y_power) {
                 // Image Display
-                _ssd1306_clear_square(&disp, 0, 16, 128-16, 8*4);
                 if (_flash_stored_display) {
-                    ssd1306_draw_string(&disp, 24, 32-4, 1, "SETTING SAVED");
+                    ui.draw_image(deck_ui::IMAGE_SETTING_SAVED);
                     if (disp_count++ > 40) {
                         _flash_stored_display = false;
                         disp_count = 0;
                     }
                 } else if (!_has_cassette) {
-                    ssd1306_draw_string(&disp, 32, 32-4, 1, "NO CASSETTE");
+                    ui.draw_image(deck_ui::IMAGE_NO_CASSETTE);
                     disp_count = 0;
                 } else {
                     if (crp42602y_ctrl0->is_playing()) {
-                        uint32_t pos = disp_count/4 % 16;
-                        _ssd1306_draw_play_arrow(&disp, crp42602y_ctrl0->get_head_dir_is_a(), pos);
+                        uint32_t pos = disp_count/4 % deck_ui::NUM_POSITIONS;
+                        ui.draw_image(deck_ui::IMAGE_PLAY, crp42602y_ctrl0->get_head_dir_is_a(), pos);
                         disp_count++;
                     } else if (crp42602y_ctrl0->is_ff_rew_ing() || crp42602y_ctrl0->is_cueing()) {
-                        uint32_t pos = disp_count % 16;
-                        _ssd1306_draw_cue_arrow(&disp, crp42602y_ctrl0->get_cue_dir_is_a(), pos);
+                        uint32_t pos = disp_count % deck_ui::NUM_POSITIONS;
+                        ui.draw_image(deck_ui::IMAGE_CUE, crp42602y_ctrl0->get_cue_dir_is_a(), pos);
                         disp_count++;
                     } else {  // STOP
-                        _ssd1306_draw_stop_arrow(&disp, crp42602y_ctrl0->get_head_dir_is_a());
+                        ui.draw_image(deck_ui::IMAGE_STOP, crp42602y_ctrl0->get_head_dir_is_a());
                         disp_count = 0;
                     }
                 }
                 if (has_rt_counter) {
                     // Counter
-                    _ssd1306_clear_square(&disp, 6*6, 64-8, 6*7, 8);
-                    float counter_sec_f = crp42602y_counter0->get();
-                    if (crp42602y_counter0->get_state() == crp42602y_counter::UNDETERMINED) {
-                        ssd1306_draw_string(&disp, 6*6, 64-8, 1, "  --:--");
-                    } else if ((!crp42602y_ctrl0->is_playing() && !crp42602y_ctrl0->is_ff_rew_ing() && !crp42602y_ctrl0->is_cueing()) ||
+                    crp42602y_counter::counter_snapshot_t counter;
+                    crp42602y_counter0->get_snapshot(counter);
+                    float counter_sec_f = counter.playing_sec[!crp42602y_ctrl0->get_head_dir_is_a()];
+                    // blink counter during estimation under cueing
+                    bool visible = (!crp42602y_ctrl0->is_playing() && !crp42602y_ctrl0->is_ff_rew_ing() && !crp42602y_ctrl0->is_cueing()) ||
                             crp42602y_ctrl0->is_playing() ||
-                            (crp42602y_ctrl0->is_cueing() && crp42602y_counter0->get_state() != crp42602y_counter::PLAY_ONLY || (now_time / 125) % 8 > 0)) {
-                                // blick counter during estimation under cueing
-                        int counter_sec = (int) counter_sec_f;
-                        int counter_min = counter_sec / 60;
-                        char str[16];
-                        if (counter_sec < 0 && counter_min == 0) {
-                            sprintf(str, "  -0:%02d", abs(counter_sec) % 60);
-                        } else {
-                            sprintf(str, "%4d:%02d", counter_min, abs(counter_sec) % 60);
-                        }
-                        ssd1306_draw_string(&disp, 6*6, 64-8, 1, str);
-                    }
+                            (crp42602y_ctrl0->is_cueing() && counter.state != crp42602y_counter::PLAY_ONLY || (now_time / 125) % 8 > 0);
+                    ui.draw_counter(counter.state != crp42602y_counter::UNDETERMINED, visible, counter_sec_f);
                 }
                 // Bluetooth
-                _ssd1306_clear_square(&disp, 128-16, 32-8, 16, 16);
+                bool bt_visible = false;
                 if (get_bt_tx_enable()) {
                     if (_bt_tx_connect_req) {
                         send_bt_tx_connect(true);
@@ -847,12 +1203,17 @@ int main()
                             send_bt_tx_connect(false);
                         }
                     }
-                    if (bt_tx_count % 8 < 4) {
-                        ssd1306_draw_char_with_font(&disp, 128-16, 32-8, 1, font_bluetooth, 0);
-                    }
+                    bt_visible = bt_tx_count % 8 < 4;
+                }
+                ui.draw_bluetooth(bt_visible);
+                // Level meter
+                if (level_meter0 != nullptr) {
+                    const int32_t rms_db10[2] = {level_meter0->get_dsp(0).get_rms_db10(), level_meter0->get_dsp(1).get_rms_db10()};
+                    const int32_t peak_db10[2] = {level_meter0->get_dsp(0).get_peak_hold_db10(), level_meter0->get_dsp(1).get_peak_hold_db10()};
+                    ui.draw_level_meter(rms_db10, peak_db10);
                 }
                 // Display
-                _ssd1306_show(&disp);
+                _ssd1306_show(&canvas);
             } else {
                 disp_count = 0;
                 bt_tx_count = 0;
@@ -860,6 +1221,9 @@ int main()
             }
             prev_disp_time = now_time;
         }
+
+        // Log to UART (formatted and transmitted by DMA while the next loop runs)
+        dma_log0->process();
     }
 
     return 0;